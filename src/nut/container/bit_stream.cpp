@@ -3,21 +3,213 @@
 #include <stdint.h>
 #include <memory.h>
 #include <string>
+#include <vector>
 #include <algorithm> // for std::max()
 
+#include "../platform/platform.h"
 #include "../numeric/word_array_integer/bit_op.h"
 #include "../platform/int_type.h" // for ssize_t in windows VC
 #include "bit_stream.h"
 #include "comparable.h"
 
+#if NUT_PLATFORM_AVX2
+#   include <immintrin.h>
+#elif NUT_PLATFORM_SSE2
+#   include <emmintrin.h>
+#endif
+
+#if NUT_PLATFORM_POPCNT && NUT_PLATFORM_CC_VC
+#   include <intrin.h>
+#endif
+
+#define WORD_BITS (sizeof(word_type) * 8)
+
+/* rank/select 目录中每个块包含的字数 */
+#define RS_BLOCK_WORDS 8
+
+/* select 采样间隔, 每隔这么多个 1 记录一次所在的块 */
+#define RS_SELECT_SAMPLE 512
+
 
 namespace nut
 {
 
+/**
+ * rank/select 目录
+ */
+struct BitStream::RankSelect
+{
+    // block_ranks[b] 为第 b 块之前 1 的个数, 最后多存放一个总数
+    std::vector<uint64_t> block_ranks;
+
+    // select_samples[j] 为第 (j * RS_SELECT_SAMPLE) 个 1 所在的块
+    std::vector<size_t> select_samples;
+};
+
+static inline unsigned popcount64(uint64_t w) noexcept
+{
+#if NUT_PLATFORM_POPCNT && NUT_PLATFORM_CC_GCC
+    return (unsigned) __builtin_popcountll(w);
+#elif NUT_PLATFORM_POPCNT && NUT_PLATFORM_CC_VC && NUT_PLATFORM_BITS_64
+    return (unsigned) __popcnt64(w);
+#else
+    return bit1_count(w);
+#endif
+}
+
+static size_t popcount_words(const uint64_t *words, size_t n) noexcept
+{
+    size_t ret = 0, i = 0;
+#if NUT_PLATFORM_AVX2
+    // 按 4 比特查表(见 Wojciech Muła 的 AVX2 popcount)
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i*) (words + i));
+        const __m256i lo = _mm256_and_si256(v, low_mask),
+            hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        const __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                            _mm256_shuffle_epi8(lookup, hi));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*) lanes, acc);
+    ret = (size_t) (lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+#endif
+    for (; i < n; ++i)
+        ret += popcount64(words[i]);
+    return ret;
+}
+
+/**
+ * @return 低 nbit 位为 1 的掩码, 0 <= nbit <= 64
+ */
+static inline uint64_t low_mask(size_t nbit) noexcept
+{
+    assert(nbit <= 64);
+    return 0 == nbit ? 0 : (~(uint64_t) 0) >> (64 - nbit);
+}
+
+/**
+ * @return w 中第 r 个(0-based) 1 的位置
+ */
+static int select_in_word(uint64_t w, unsigned r) noexcept
+{
+    assert(r < popcount64(w));
+    // 先按字节跳过
+    int base = 0;
+    while (true)
+    {
+        const unsigned c = popcount64(w & 0xff);
+        if (r < c)
+            break;
+        r -= c;
+        w >>= 8;
+        base += 8;
+    }
+    for (; r > 0; --r)
+        w &= w - 1; // 清除最低位的 1
+    return base + lowest_bit1(w);
+}
+
+/**
+ * 按字执行的位运算
+ */
+namespace
+{
+
+struct AndOp
+{
+    uint64_t operator()(uint64_t a, uint64_t b) const noexcept
+    {
+        return a & b;
+    }
+
+#if NUT_PLATFORM_AVX2
+    __m256i operator()(__m256i a, __m256i b) const noexcept
+    {
+        return _mm256_and_si256(a, b);
+    }
+#elif NUT_PLATFORM_SSE2
+    __m128i operator()(__m128i a, __m128i b) const noexcept
+    {
+        return _mm_and_si128(a, b);
+    }
+#endif
+};
+
+struct OrOp
+{
+    uint64_t operator()(uint64_t a, uint64_t b) const noexcept
+    {
+        return a | b;
+    }
+
+#if NUT_PLATFORM_AVX2
+    __m256i operator()(__m256i a, __m256i b) const noexcept
+    {
+        return _mm256_or_si256(a, b);
+    }
+#elif NUT_PLATFORM_SSE2
+    __m128i operator()(__m128i a, __m128i b) const noexcept
+    {
+        return _mm_or_si128(a, b);
+    }
+#endif
+};
+
+struct XorOp
+{
+    uint64_t operator()(uint64_t a, uint64_t b) const noexcept
+    {
+        return a ^ b;
+    }
+
+#if NUT_PLATFORM_AVX2
+    __m256i operator()(__m256i a, __m256i b) const noexcept
+    {
+        return _mm256_xor_si256(a, b);
+    }
+#elif NUT_PLATFORM_SSE2
+    __m128i operator()(__m128i a, __m128i b) const noexcept
+    {
+        return _mm_xor_si128(a, b);
+    }
+#endif
+};
+
+}
+
+/**
+ * dst[i] = op(a[i], b[i]), dst 可以与 a、b 重叠
+ */
+template <typename OP>
+static void apply_words(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n, OP op) noexcept
+{
+    size_t i = 0;
+#if NUT_PLATFORM_AVX2
+    for (; i + 4 <= n; i += 4)
+        _mm256_storeu_si256((__m256i*) (dst + i),
+                            op(_mm256_loadu_si256((const __m256i*) (a + i)),
+                               _mm256_loadu_si256((const __m256i*) (b + i))));
+#elif NUT_PLATFORM_SSE2
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_si128((__m128i*) (dst + i),
+                         op(_mm_loadu_si128((const __m128i*) (a + i)),
+                            _mm_loadu_si128((const __m128i*) (b + i))));
+#endif
+    for (; i < n; ++i)
+        dst[i] = op(a[i], b[i]);
+}
+
 void BitStream::_ensure_cap(size_t new_bit_size) noexcept
 {
     // XXX 常量运算留给编译器来优化
-    const size_t new_word_size = (new_bit_size + sizeof(word_type) * 8 - 1) / (sizeof(word_type) * 8);
+    const size_t new_word_size = (new_bit_size + WORD_BITS - 1) / WORD_BITS;
     if (new_word_size <= _word_cap)
         return;
 
@@ -32,7 +224,7 @@ void BitStream::_ensure_cap(size_t new_bit_size) noexcept
 
 size_t BitStream::_word_size() const noexcept
 {
-    return (_bit_size + sizeof(word_type) * 8 - 1) / (sizeof(word_type) * 8);
+    return (_bit_size + WORD_BITS - 1) / WORD_BITS;
 }
 
 BitStream::BitStream(size_t bit_size, int fill_bit) noexcept
@@ -92,11 +284,13 @@ BitStream::BitStream(const std::wstring& s) noexcept
 }
 
 BitStream::BitStream(BitStream&& x) noexcept
-    : _buf(x._buf), _word_cap(x._word_cap), _bit_size(x._bit_size)
+    : _buf(x._buf), _word_cap(x._word_cap), _bit_size(x._bit_size),
+      _rank_select(x._rank_select)
 {
     x._buf = nullptr;
     x._word_cap = 0;
     x._bit_size = 0;
+    x._rank_select = nullptr;
 }
 
 BitStream::BitStream(const BitStream& x) noexcept
@@ -107,10 +301,13 @@ BitStream::BitStream(const BitStream& x) noexcept
     _ensure_cap(x._bit_size);
     ::memcpy(_buf, x._buf, (x._bit_size + 7) >> 3);
     _bit_size = x._bit_size;
+    if (nullptr != x._rank_select)
+        _rank_select = new RankSelect(*x._rank_select);
 }
 
 BitStream::~BitStream() noexcept
 {
+    _drop_rank_select();
     if (nullptr != _buf)
         ::free(_buf);
     _buf = nullptr;
@@ -120,7 +317,7 @@ BitStream::~BitStream() noexcept
 
 void BitStream::_normalize_tail() noexcept
 {
-    const size_t tail_bitlen = _bit_size % (sizeof(word_type) * 8);
+    const size_t tail_bitlen = _bit_size % WORD_BITS;
     if (0 != tail_bitlen)
     {
         const size_t last_index = _word_size() - 1;
@@ -128,21 +325,33 @@ void BitStream::_normalize_tail() noexcept
     }
 }
 
+void BitStream::_drop_rank_select() noexcept
+{
+    if (nullptr != _rank_select)
+    {
+        delete _rank_select;
+        _rank_select = nullptr;
+    }
+}
+
 BitStream& BitStream::operator=(BitStream&& x) noexcept
 {
     if (this == &x)
         return *this;
 
+    _drop_rank_select();
     if (nullptr != _buf)
         ::free(_buf);
 
     _buf = x._buf;
     _word_cap = x._word_cap;
     _bit_size = x._bit_size;
+    _rank_select = x._rank_select;
 
     x._buf = nullptr;
     x._word_cap = 0;
     x._bit_size = 0;
+    x._rank_select = nullptr;
 
     return *this;
 }
@@ -152,9 +361,12 @@ BitStream& BitStream::operator=(const BitStream& x) noexcept
     if (this == &x)
         return *this;
 
+    _drop_rank_select();
     _ensure_cap(x._bit_size);
     ::memcpy(_buf, x._buf, (x._bit_size + 7) >> 3);
     _bit_size = x._bit_size;
+    if (nullptr != x._rank_select)
+        _rank_select = new RankSelect(*x._rank_select);
     return *this;
 }
 
@@ -165,14 +377,14 @@ bool BitStream::operator==(const BitStream& x) const noexcept
     if (_bit_size != x._bit_size)
         return false;
 
-    const size_t word_count = _bit_size / (sizeof(word_type) * 8),
-        bit_remained_count = _bit_size % (sizeof(word_type) * 8);
+    const size_t word_count = _bit_size / WORD_BITS,
+        bit_remained_count = _bit_size % WORD_BITS;
     if (0 != ::memcmp(_buf, x._buf, sizeof(word_type) * word_count))
         return false;
     if (bit_remained_count > 0)
     {
-        const word_type l = _buf[word_count] << (sizeof(word_type) * 8 - bit_remained_count),
-            r = x._buf[word_count] << (sizeof(word_type) * 8 - bit_remained_count);
+        const word_type l = _buf[word_count] << (WORD_BITS - bit_remained_count),
+            r = x._buf[word_count] << (WORD_BITS - bit_remained_count);
         if (l != r)
             return false;
     }
@@ -219,159 +431,106 @@ BitStream& BitStream::operator+=(const BitStream& x) noexcept
     return *this;
 }
 
-BitStream BitStream::operator&(const BitStream& x) const noexcept
+/**
+ * 结果长度为两者中较长的，较短的一方按 0 补齐
+ */
+template <typename OP>
+void BitStream::_bitwise(const BitStream& x, OP op, BitStream *result) const noexcept
 {
-    BitStream rs;
+    assert(nullptr != result);
     const size_t new_bit_size = std::max(_bit_size, x._bit_size);
-    rs._ensure_cap(new_bit_size);
+    result->_drop_rank_select();
+    result->_ensure_cap(new_bit_size);
 
+    // 双方都是完整字的部分直接并行处理
     const size_t word_size1 = _word_size(), word_size2 = x._word_size(),
         new_word_size = std::max(word_size1, word_size2),
-        tail_bitlen1 = _bit_size % (sizeof(word_type) * 8),
-        tail_bitlen2 = x._bit_size % (sizeof(word_type) * 8);
-    for (size_t i = 0; i < new_word_size; ++i)
+        full_words = std::min(_bit_size, x._bit_size) / WORD_BITS;
+    apply_words(result->_buf, _buf, x._buf, full_words, op);
+
+    // 剩余部分需要屏蔽尾部无效的比特
+    const size_t tail_bitlen1 = _bit_size % WORD_BITS, tail_bitlen2 = x._bit_size % WORD_BITS;
+    for (size_t i = full_words; i < new_word_size; ++i)
     {
         word_type w1 = (i < word_size1 ? _buf[i] : 0);
         if (0 != tail_bitlen1 && i + 1 == word_size1)
-            w1 &= ~((~(word_type)0) << tail_bitlen1);
+            w1 &= low_mask(tail_bitlen1);
 
         word_type w2 = (i < word_size2 ? x._buf[i] : 0);
         if (0 != tail_bitlen2 && i + 1 == word_size2)
-            w2 &= ~((~(word_type)0) << tail_bitlen2);
+            w2 &= low_mask(tail_bitlen2);
 
-        rs._buf[i] = w1 & w2;
+        result->_buf[i] = op(w1, w2);
     }
-    rs._bit_size = new_bit_size;
+    result->_bit_size = new_bit_size;
+}
+
+BitStream BitStream::operator&(const BitStream& x) const noexcept
+{
+    BitStream rs;
+    _bitwise(x, AndOp(), &rs);
     return rs;
 }
 
 BitStream& BitStream::operator&=(const BitStream& x) noexcept
 {
-    const size_t new_bit_size = std::max(_bit_size, x._bit_size);
-    _ensure_cap(new_bit_size);
-
-    const size_t word_size1 = _word_size(), word_size2 = x._word_size(),
-        new_word_size = std::max(word_size1, word_size2),
-        tail_bitlen1 = _bit_size % (sizeof(word_type) * 8),
-        tail_bitlen2 = x._bit_size % (sizeof(word_type) * 8);
-    for (size_t i = 0; i < new_word_size; ++i)
-    {
-        word_type w1 = (i < word_size1 ? _buf[i] : 0);
-        if (0 != tail_bitlen1 && i + 1 == word_size1)
-            w1 &= ~((~(word_type)0) << tail_bitlen1);
-
-        word_type w2 = (i < word_size2 ? x._buf[i] : 0);
-        if (0 != tail_bitlen2 && i + 1 == word_size2)
-            w2 &= ~((~(word_type)0) << tail_bitlen2);
-
-        _buf[i] = w1 & w2;
-    }
-    _bit_size = new_bit_size;
+    _bitwise(x, AndOp(), this);
     return *this;
 }
 
 BitStream BitStream::operator|(const BitStream& x) const noexcept
 {
     BitStream rs;
-    const size_t new_bit_size = std::max(_bit_size, x._bit_size);
-    rs._ensure_cap(new_bit_size);
-
-    const size_t word_size1 = _word_size(), word_size2 = x._word_size(),
-        new_word_size = std::max(word_size1, word_size2),
-        tail_bitlen1 = _bit_size % (sizeof(word_type) * 8),
-        tail_bitlen2 = x._bit_size % (sizeof(word_type) * 8);
-    for (size_t i = 0; i < new_word_size; ++i)
-    {
-        word_type w1 = (i < word_size1 ? _buf[i] : 0);
-        if (0 != tail_bitlen1 && i + 1 == word_size1)
-            w1 &= ~((~(word_type)0) << tail_bitlen1);
-
-        word_type w2 = (i < word_size2 ? x._buf[i] : 0);
-        if (0 != tail_bitlen2 && i + 1 == word_size2)
-            w2 &= ~((~(word_type)0) << tail_bitlen2);
-
-        rs._buf[i] = w1 | w2;
-    }
-    rs._bit_size = new_bit_size;
+    _bitwise(x, OrOp(), &rs);
     return rs;
 }
 
 BitStream& BitStream::operator|=(const BitStream& x) noexcept
 {
-    const size_t new_bit_size = std::max(_bit_size, x._bit_size);
-    _ensure_cap(new_bit_size);
-
-    const size_t word_size1 = _word_size(), word_size2 = x._word_size(),
-        new_word_size = std::max(word_size1, word_size2),
-        tail_bitlen1 = _bit_size % (sizeof(word_type) * 8),
-        tail_bitlen2 = x._bit_size % (sizeof(word_type) * 8);
-    for (size_t i = 0; i < new_word_size; ++i)
-    {
-        word_type w1 = (i < word_size1 ? _buf[i] : 0);
-        if (0 != tail_bitlen1 && i + 1 == word_size1)
-            w1 &= ~((~(word_type)0) << tail_bitlen1);
-
-        word_type w2 = (i < word_size2 ? x._buf[i] : 0);
-        if (0 != tail_bitlen2 && i + 1 == word_size2)
-            w2 &= ~((~(word_type)0) << tail_bitlen2);
-
-        _buf[i] = w1 | w2;
-    }
-    _bit_size = new_bit_size;
+    _bitwise(x, OrOp(), this);
     return *this;
 }
 
 BitStream BitStream::operator^(const BitStream& x) const noexcept
 {
     BitStream rs;
-    const size_t new_bit_size = std::max(_bit_size, x._bit_size);
-    rs._ensure_cap(new_bit_size);
-
-    const size_t word_size1 = _word_size(), word_size2 = x._word_size(),
-        new_word_size = std::max(word_size1, word_size2),
-        tail_bitlen1 = _bit_size % (sizeof(word_type) * 8),
-        tail_bitlen2 = x._bit_size % (sizeof(word_type) * 8);
-    for (size_t i = 0; i < new_word_size; ++i)
-    {
-        word_type w1 = (i < word_size1 ? _buf[i] : 0);
-        if (0 != tail_bitlen1 && i + 1 == word_size1)
-            w1 &= ~((~(word_type)0) << tail_bitlen1);
-
-        word_type w2 = (i < word_size2 ? x._buf[i] : 0);
-        if (0 != tail_bitlen2 && i + 1 == word_size2)
-            w2 &= ~((~(word_type)0) << tail_bitlen2);
-
-        rs._buf[i] = w1 ^ w2;
-    }
-    rs._bit_size = new_bit_size;
+    _bitwise(x, XorOp(), &rs);
     return rs;
 }
 
 BitStream& BitStream::operator^=(const BitStream& x) noexcept
 {
-    const size_t new_bit_size = std::max(_bit_size, x._bit_size);
-    _ensure_cap(new_bit_size);
-
-    const size_t word_size1 = _word_size(), word_size2 = x._word_size(),
-        new_word_size = std::max(word_size1, word_size2),
-        tail_bitlen1 = _bit_size % (sizeof(word_type) * 8),
-        tail_bitlen2 = x._bit_size % (sizeof(word_type) * 8);
-    for (size_t i = 0; i < new_word_size; ++i)
-    {
-        word_type w1 = (i < word_size1 ? _buf[i] : 0);
-        if (0 != tail_bitlen1 && i + 1 == word_size1)
-            w1 &= ~((~(word_type)0) << tail_bitlen1);
-
-        word_type w2 = (i < word_size2 ? x._buf[i] : 0);
-        if (0 != tail_bitlen2 && i + 1 == word_size2)
-            w2 &= ~((~(word_type)0) << tail_bitlen2);
-
-        _buf[i] = w1 ^ w2;
-    }
-    _bit_size = new_bit_size;
+    _bitwise(x, XorOp(), this);
     return *this;
 }
 
+BitStream BitStream::operator~() const noexcept
+{
+    BitStream rs;
+    if (0 == _bit_size)
+        return rs;
+
+    rs._ensure_cap(_bit_size);
+    const size_t word_size = _word_size();
+    size_t i = 0;
+#if NUT_PLATFORM_AVX2
+    const __m256i ones = _mm256_set1_epi32(-1);
+    for (; i + 4 <= word_size; i += 4)
+        _mm256_storeu_si256((__m256i*) (rs._buf + i),
+                            _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (_buf + i)), ones));
+#elif NUT_PLATFORM_SSE2
+    const __m128i ones = _mm_set1_epi32(-1);
+    for (; i + 2 <= word_size; i += 2)
+        _mm_storeu_si128((__m128i*) (rs._buf + i),
+                         _mm_xor_si128(_mm_loadu_si128((const __m128i*) (_buf + i)), ones));
+#endif
+    for (; i < word_size; ++i)
+        rs._buf[i] = ~_buf[i];
+    rs._bit_size = _bit_size;
+    rs._normalize_tail();
+    return rs;
+}
+
 int BitStream::operator[](size_t i) const noexcept
 {
     return bit_at(i);
@@ -383,17 +542,17 @@ int BitStream::compare(const BitStream& x) const noexcept
         return 0;
 
     const size_t min_bitsz = std::min(_bit_size, x._bit_size);
-    const size_t word_count = min_bitsz / (sizeof(word_type) * 8);
+    const size_t word_count = min_bitsz / WORD_BITS;
     for (size_t i = 0; i < word_count; ++i)
     {
         if (_buf[i] != x._buf[i])
             return nut::compare(reverse_bits(_buf[i]), reverse_bits(x._buf[i])); // NOTE 比较字典序而不是整数值
     }
-    const size_t bit_remained_count = min_bitsz % (sizeof(word_type) * 8);
+    const size_t bit_remained_count = min_bitsz % WORD_BITS;
     if (bit_remained_count > 0)
     {
-        const word_type l = _buf[word_count] << (sizeof(word_type) * 8 - bit_remained_count),
-            r = x._buf[word_count] << (sizeof(word_type) * 8 - bit_remained_count);
+        const word_type l = _buf[word_count] << (WORD_BITS - bit_remained_count),
+            r = x._buf[word_count] << (WORD_BITS - bit_remained_count);
         if (l != r)
             return nut::compare(reverse_bits(l), reverse_bits(r));
     }
@@ -409,6 +568,7 @@ void BitStream::resize(size_t new_bit_size, int fill_bit) noexcept
 {
     assert(0 == fill_bit || 1 == fill_bit);
 
+    _drop_rank_select();
     if (new_bit_size < _bit_size)
     {
         _bit_size = new_bit_size;
@@ -423,43 +583,46 @@ void BitStream::resize(size_t new_bit_size, int fill_bit) noexcept
 
 void BitStream::clear() noexcept
 {
+    _drop_rank_select();
     _bit_size = 0;
 }
 
 int BitStream::bit_at(size_t i) const noexcept
 {
     assert(i < _bit_size);
-    return (_buf[i / (sizeof(word_type) * 8)] >> (i % (sizeof(word_type) * 8))) & 0x01;
+    return (_buf[i / WORD_BITS] >> (i % WORD_BITS)) & 0x01;
 }
 
 void BitStream::set_bit(size_t i, int bit) noexcept
 {
     assert(i < _bit_size && (0 == bit || 1 == bit));
+    _drop_rank_select();
     if (0 == bit)
-        _buf[i / (sizeof(word_type) * 8)] &= ~(1 << (i % (sizeof(word_type) * 8)));
+        _buf[i / WORD_BITS] &= ~(((word_type) 1) << (i % WORD_BITS));
     else
-        _buf[i / (sizeof(word_type) * 8)] |= 1 << (i % (sizeof(word_type) * 8));
+        _buf[i / WORD_BITS] |= ((word_type) 1) << (i % WORD_BITS);
 }
 
 void BitStream::fill_bits(size_t i, size_t nbit, int bit) noexcept
 {
     assert(i + nbit <= _bit_size && (0 == bit || 1 == bit));
+    if (0 == nbit)
+        return;
+
+    _drop_rank_select();
     const size_t end = i + nbit;
-    const size_t wb = (i + sizeof(word_type) * 8 - 1) / (sizeof(word_type) * 8),
-        we = end / (sizeof(word_type) * 8);
-    if (wb < we)
-    {
-        const uint8_t fill = (0 == bit ? 0 : 0xff);
-        ::memset(_buf + wb, fill, (we - wb) * sizeof(word_type));
-        for (ssize_t k = wb * sizeof(word_type) * 8 - 1; k >= (ssize_t) i; --k)
-            set_bit(k, bit);
-        for (size_t k = we * sizeof(word_type) * 8; k < end; ++k)
-            set_bit(k, bit);
-    }
-    else
+    const size_t first_word = i / WORD_BITS, last_word = (end - 1) / WORD_BITS;
+    for (size_t k = first_word; k <= last_word; ++k)
     {
-        for (size_t k = i; k < end; ++k)
-            set_bit(k, bit);
+        word_type mask = ~(word_type) 0;
+        if (k == first_word)
+            mask &= (~(word_type) 0) << (i % WORD_BITS);
+        if (k == last_word)
+            mask &= low_mask(end - k * WORD_BITS);
+        if (0 == bit)
+            _buf[k] &= ~mask;
+        else
+            _buf[k] |= mask;
     }
 }
 
@@ -473,53 +636,200 @@ void BitStream::append_bit(int bit) noexcept
 
 void BitStream::append(const BitStream& x) noexcept
 {
+    if (0 == x._bit_size)
+        return;
+    if (this == &x)
+    {
+        const BitStream copy(x);
+        append(copy);
+        return;
+    }
+
+    _drop_rank_select();
     _ensure_cap(_bit_size + x._bit_size);
-    const size_t old_bit_size = _bit_size; // XXX 这里需要保证及时是 this==&x 也是正确的
+    const size_t shift = _bit_size % WORD_BITS, dst_word = _bit_size / WORD_BITS,
+        src_words = x._word_size();
     _bit_size += x._bit_size;
-    for (size_t i = old_bit_size; i < _bit_size; ++i)
-        set_bit(i, x.bit_at(i - old_bit_size));
+    if (0 == shift)
+    {
+        ::memcpy(_buf + dst_word, x._buf, sizeof(word_type) * src_words);
+        return;
+    }
+
+    // 按字移位拼接, 源数据尾部无效的比特会落在新长度之外
+    const size_t new_word_size = _word_size();
+    _buf[dst_word] &= low_mask(shift);
+    for (size_t i = 0; i < src_words; ++i)
+    {
+        const word_type w = x._buf[i];
+        _buf[dst_word + i] |= w << shift;
+        if (dst_word + i + 1 < new_word_size)
+            _buf[dst_word + i + 1] = w >> (WORD_BITS - shift);
+    }
 }
 
-BitStream BitStream::substream(size_t i, size_t nbit) noexcept
+BitStream BitStream::substream(size_t i, size_t nbit) const noexcept
 {
-    assert(i + nbit < _bit_size);
+    assert(i + nbit <= _bit_size);
     BitStream ret;
+    if (0 == nbit)
+        return ret;
+
     ret._ensure_cap(nbit);
     ret._bit_size = nbit;
-    for (size_t k = 0; k < nbit; ++k)
-        ret.set_bit(k, bit_at(i + k));
+    const size_t shift = i % WORD_BITS, src_word = i / WORD_BITS,
+        dst_words = ret._word_size(), src_words = _word_size();
+    if (0 == shift)
+    {
+        ::memcpy(ret._buf, _buf + src_word, sizeof(word_type) * dst_words);
+    }
+    else
+    {
+        for (size_t k = 0; k < dst_words; ++k)
+        {
+            word_type w = _buf[src_word + k] >> shift;
+            if (src_word + k + 1 < src_words)
+                w |= _buf[src_word + k + 1] << (WORD_BITS - shift);
+            ret._buf[k] = w;
+        }
+    }
+    ret._normalize_tail();
     return ret;
 }
 
-size_t BitStream::bit1_count() noexcept
+size_t BitStream::bit1_count() const noexcept
 {
-    const size_t word_count = _bit_size / (sizeof(word_type) * 8);
-    size_t ret = 0;
-    for (size_t i = 0; i < word_count; ++i)
-        ret += nut::bit1_count(_buf[i]);
-    for (size_t i = word_count * (sizeof(word_type) * 8); i < _bit_size; ++i)
-        ret += (0 == bit_at(i) ? 0 : 1);
+    const size_t word_count = _bit_size / WORD_BITS,
+        tail_bitlen = _bit_size % WORD_BITS;
+    size_t ret = popcount_words(_buf, word_count);
+    if (0 != tail_bitlen)
+        ret += popcount64(_buf[word_count] & low_mask(tail_bitlen));
     return ret;
 }
 
-size_t BitStream::bit0_count() noexcept
+size_t BitStream::bit0_count() const noexcept
 {
     return _bit_size - bit1_count();
 }
 
-std::string BitStream::to_string() noexcept
+void BitStream::build_rank_select() noexcept
 {
-    std::string s;
-    for (size_t i = 0; i < _bit_size; ++i)
-        s.push_back(0 == bit_at(i) ? '0' : '1');
+    _drop_rank_select();
+    RankSelect *rs = new RankSelect;
+
+    const size_t word_size = _word_size(),
+        block_count = (word_size + RS_BLOCK_WORDS - 1) / RS_BLOCK_WORDS;
+    rs->block_ranks.reserve(block_count + 1);
+    uint64_t rank = 0;
+    for (size_t b = 0; b < block_count; ++b)
+    {
+        rs->block_ranks.push_back(rank);
+        const size_t begin = b * RS_BLOCK_WORDS,
+            end = std::min<size_t>(begin + RS_BLOCK_WORDS, word_size);
+        for (size_t i = begin; i < end; ++i)
+        {
+            word_type w = _buf[i];
+            if (i + 1 == word_size && 0 != _bit_size % WORD_BITS)
+                w &= low_mask(_bit_size % WORD_BITS);
+
+            // 记录 select 采样点
+            const unsigned c = popcount64(w);
+            const uint64_t next_sample = rs->select_samples.size() * RS_SELECT_SAMPLE;
+            if (next_sample < rank + c)
+                rs->select_samples.push_back(b);
+            rank += c;
+        }
+    }
+    rs->block_ranks.push_back(rank);
+
+    _rank_select = rs;
+}
+
+bool BitStream::has_rank_select() const noexcept
+{
+    return nullptr != _rank_select;
+}
+
+size_t BitStream::rank1(size_t i) const noexcept
+{
+    assert(i <= _bit_size);
+    const size_t word_index = i / WORD_BITS, tail_bitlen = i % WORD_BITS;
+    size_t ret = 0, begin = 0;
+    if (nullptr != _rank_select)
+    {
+        const size_t b = word_index / RS_BLOCK_WORDS;
+        ret = (size_t) _rank_select->block_ranks[b];
+        begin = b * RS_BLOCK_WORDS;
+    }
+    ret += popcount_words(_buf + begin, word_index - begin);
+    if (0 != tail_bitlen)
+        ret += popcount64(_buf[word_index] & low_mask(tail_bitlen));
+    return ret;
+}
+
+ssize_t BitStream::select1(size_t k) const noexcept
+{
+    const size_t word_size = _word_size();
+    size_t word_index = 0;
+    if (nullptr != _rank_select)
+    {
+        const std::vector<uint64_t>& ranks = _rank_select->block_ranks;
+        if (k >= ranks.back())
+            return -1;
+
+        // 在两个采样点之间二分查找所在的块
+        const std::vector<size_t>& samples = _rank_select->select_samples;
+        const size_t s = k / RS_SELECT_SAMPLE;
+        size_t lo = samples[s],
+            hi = (s + 1 < samples.size() ? samples[s + 1] : ranks.size() - 2);
+        while (lo < hi)
+        {
+            const size_t mid = (lo + hi + 1) / 2;
+            if (ranks[mid] <= k)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        k -= (size_t) ranks[lo];
+        word_index = lo * RS_BLOCK_WORDS;
+    }
+
+    for (; word_index < word_size; ++word_index)
+    {
+        word_type w = _buf[word_index];
+        if (word_index + 1 == word_size && 0 != _bit_size % WORD_BITS)
+            w &= low_mask(_bit_size % WORD_BITS);
+        const unsigned c = popcount64(w);
+        if (k < c)
+            return word_index * WORD_BITS + select_in_word(w, (unsigned) k);
+        k -= c;
+    }
+    return -1;
+}
+
+std::string BitStream::to_string() const noexcept
+{
+    std::string s(_bit_size, '0');
+    for (size_t i = 0, word_size = _word_size(); i < word_size; ++i)
+    {
+        word_type w = _buf[i];
+        const size_t begin = i * WORD_BITS, end = std::min(begin + WORD_BITS, _bit_size);
+        for (size_t k = begin; k < end; ++k, w >>= 1)
+            s[k] = (char) ('0' + (w & 0x01));
+    }
     return s;
 }
 
-std::wstring BitStream::to_wstring() noexcept
+std::wstring BitStream::to_wstring() const noexcept
 {
-    std::wstring s;
-    for (size_t i = 0; i < _bit_size; ++i)
-        s.push_back(0 == bit_at(i) ? L'0' : L'1');
+    std::wstring s(_bit_size, L'0');
+    for (size_t i = 0, word_size = _word_size(); i < word_size; ++i)
+    {
+        word_type w = _buf[i];
+        const size_t begin = i * WORD_BITS, end = std::min(begin + WORD_BITS, _bit_size);
+        for (size_t k = begin; k < end; ++k, w >>= 1)
+            s[k] = (wchar_t) (L'0' + (w & 0x01));
+    }
     return s;
 }
 
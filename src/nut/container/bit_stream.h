@@ -6,17 +6,28 @@
 #include <stdint.h>
 #include <memory.h>
 #include <string>
+#include <type_traits>
 
 #include "../nut_config.h"
+#include "../platform/int_type.h" // for ssize_t in windows VC
 
 
 namespace nut
 {
 
+/**
+ * 比特流
+ *
+ * 按 64 位字存储, 位运算、拼接、截取、计数都按字并行处理, 支持时使用 AVX2 / SSE2 /
+ * POPCNT 指令. 可选地调用 build_rank_select() 建立 rank/select 目录, 使得
+ * rank1() / select1() 为 O(1)
+ */
 class NUT_API BitStream
 {
 private:
-    typedef unsigned int word_type;
+    typedef uint64_t word_type;
+
+    struct RankSelect;
 
     static_assert(std::is_unsigned<word_type>::value, "Unexpected integer type");
 
@@ -64,6 +75,11 @@ public:
     BitStream operator^(const BitStream& x) const noexcept;
     BitStream& operator^=(const BitStream& x) noexcept;
 
+    /**
+     * 按位取反, 长度不变
+     */
+    BitStream operator~() const noexcept;
+
     /**
      * @return 1 或者 0
      */
@@ -104,13 +120,32 @@ public:
 
     void append(const BitStream& x) noexcept;
 
-    BitStream substream(size_t i, size_t nbit) noexcept;
+    BitStream substream(size_t i, size_t nbit) const noexcept;
+
+    size_t bit1_count() const noexcept;
+    size_t bit0_count() const noexcept;
+
+    /**
+     * 建立 rank/select 目录, 额外占用约 1/8 的空间. 比特流被修改后目录自动失效,
+     * 需要重新建立
+     */
+    void build_rank_select() noexcept;
+
+    bool has_rank_select() const noexcept;
+
+    /**
+     * @return [0, i) 中 1 的个数, 0 <= i <= size()
+     */
+    size_t rank1(size_t i) const noexcept;
 
-    size_t bit1_count() noexcept;
-    size_t bit0_count() noexcept;
+    /**
+     * @param k 0-based
+     * @return 第 k 个 1 的位置, 不存在则返回 -1
+     */
+    ssize_t select1(size_t k) const noexcept;
 
-    std::string to_string() noexcept;
-    std::wstring to_wstring() noexcept;
+    std::string to_string() const noexcept;
+    std::wstring to_wstring() const noexcept;
 
 private:
     void _ensure_cap(size_t new_bit_size) noexcept;
@@ -120,10 +155,17 @@ private:
     // 使最后一个有效的 word 空位为 0
     void _normalize_tail() noexcept;
 
+    // 比特流被修改，使 rank/select 目录失效
+    void _drop_rank_select() noexcept;
+
+    template <typename OP>
+    void _bitwise(const BitStream& x, OP op, BitStream *result) const noexcept;
+
 private:
     word_type *_buf = nullptr; // 缓冲区
     size_t _word_cap = 0; // 缓冲区长度
     size_t _bit_size = 0; // bit 长度
+    RankSelect *_rank_select = nullptr; // 可选的 rank/select 目录
 };
 
 }
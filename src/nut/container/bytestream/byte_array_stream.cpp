@@ -1,9 +1,11 @@
 ﻿
 #include <assert.h>
-#include <string.h> // for ::memcpy()
+#include <string.h> // for ::memcpy(), ::memset()
 #include <algorithm> // for std::min()
 
+#include "../../platform/endian.h"
 #include "byte_array_stream.h"
+#include "varint.h"
 
 
 namespace nut
@@ -105,4 +107,109 @@ size_t ByteArrayStream::write(const std::vector<uint8_t>& ba) noexcept
     return write(ba.data(), ba.size());
 }
 
+uint8_t* ByteArrayStream::prepare_write(size_t cb) noexcept
+{
+    assert(_index <= _data.size());
+    if (_index + cb > _data.size())
+        _data.resize(_index + cb);
+    uint8_t *ret = _data.data() + _index;
+    _index += cb;
+    return ret;
+}
+
+void ByteArrayStream::write_varuint32(uint32_t v) noexcept
+{
+    write_varuint64(v);
+}
+
+void ByteArrayStream::write_varuint64(uint64_t v) noexcept
+{
+    uint8_t buf[NUT_VARINT_MAX_BYTES];
+    const size_t len = varint_encode(v, buf);
+    ::memcpy(prepare_write(len), buf, len);
+}
+
+void ByteArrayStream::write_varint32(int32_t v) noexcept
+{
+    write_varuint64(zigzag_encode32(v));
+}
+
+void ByteArrayStream::write_varint64(int64_t v) noexcept
+{
+    write_varuint64(zigzag_encode64(v));
+}
+
+uint32_t ByteArrayStream::read_varuint32() noexcept
+{
+    return (uint32_t) read_varuint64();
+}
+
+uint64_t ByteArrayStream::read_varuint64() noexcept
+{
+    uint64_t ret = 0;
+    if (!try_read_varuint64(&ret))
+        return 0;
+    return ret;
+}
+
+bool ByteArrayStream::try_read_varuint64(uint64_t *v) noexcept
+{
+    assert(nullptr != v);
+    const size_t len = varint_decode(_data.data() + _index, readable_size(), v);
+    if (len > 0)
+    {
+        _index += len;
+        return true;
+    }
+
+    // 与基类一致, 跳过已检查过的字节, 调用者不会反复读到同一个错误的 varint
+    _index += std::min(readable_size(), (size_t) NUT_VARINT_MAX_BYTES);
+    return false;
+}
+
+int32_t ByteArrayStream::read_varint32() noexcept
+{
+    return zigzag_decode32((uint32_t) read_varuint64());
+}
+
+int64_t ByteArrayStream::read_varint64() noexcept
+{
+    return zigzag_decode64(read_varuint64());
+}
+
+void ByteArrayStream::write_elements(const void *arr, size_t elem_size, size_t count) noexcept
+{
+    assert((nullptr != arr || 0 == count) && elem_size > 0);
+    const size_t cb = elem_size * count;
+    if (0 == cb)
+        return;
+
+    // 直接转换到字节数组中, 不需要中间缓冲区
+    uint8_t *dst = prepare_write(cb);
+    if (1 == elem_size || _little_endian == (NUT_ENDIAN_LITTLE_BYTE != 0))
+        ::memcpy(dst, arr, cb);
+    else
+        bswap_array(dst, arr, elem_size, count);
+}
+
+void ByteArrayStream::read_elements(void *arr, size_t elem_size, size_t count) noexcept
+{
+    assert((nullptr != arr || 0 == count) && elem_size > 0);
+
+    // 与 read() 一样不越界; 读不到的元素填 0
+    const size_t readable = std::min(count, readable_size() / elem_size);
+    const size_t cb = elem_size * readable;
+    if (readable < count)
+        ::memset(reinterpret_cast<uint8_t*>(arr) + cb, 0, elem_size * (count - readable));
+    if (0 == cb)
+        return;
+
+    const uint8_t *src = _data.data() + _index;
+    if (1 == elem_size || _little_endian == (NUT_ENDIAN_LITTLE_BYTE != 0))
+        ::memcpy(arr, src, cb);
+    else
+        bswap_array(arr, src, elem_size, readable);
+    _index += cb;
+}
+
 }
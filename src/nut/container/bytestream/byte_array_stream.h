@@ -47,10 +47,40 @@ public:
 
     size_t write(const std::vector<uint8_t>& ba) noexcept;
 
+    /**
+     * 直接操作字节数组的变长编码, 隐藏基类中逐字节调用虚函数的实现
+     */
+    void write_varuint32(uint32_t v) noexcept;
+    void write_varuint64(uint64_t v) noexcept;
+    void write_varint32(int32_t v) noexcept;
+    void write_varint64(int64_t v) noexcept;
+
+    /**
+     * 数据不完整或者超长时返回 0, 并跳过这些字节
+     */
+    uint32_t read_varuint32() noexcept;
+    uint64_t read_varuint64() noexcept;
+    bool try_read_varuint64(uint64_t *v) noexcept;
+    int32_t read_varint32() noexcept;
+    int64_t read_varint64() noexcept;
+
+    virtual void write_elements(const void *arr, size_t elem_size, size_t count) noexcept override;
+    /**
+     * 可读的完整元素不足 count 个时只读出这些, 其余填 0
+     */
+    virtual void read_elements(void *arr, size_t elem_size, size_t count) noexcept override;
+
 private:
     ByteArrayStream(const ByteArrayStream&) = delete;
     ByteArrayStream& operator=(const ByteArrayStream&) = delete;
 
+    /**
+     * 在写位置预留 cb 字节, 写位置后移
+     *
+     * @return 预留区域的起始地址
+     */
+    uint8_t* prepare_write(size_t cb) noexcept;
+
 private:
     std::vector<uint8_t> _data;
     size_t _index = 0;
@@ -0,0 +1,522 @@
+﻿
+#include "../../platform/platform.h"
+
+#if !NUT_PLATFORM_OS_WINDOWS
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h> // for ::posix_memalign(), ::free()
+#include <string.h> // for ::memcpy(), ::memmove()
+#include <algorithm> // for std::min()
+
+#include <fcntl.h>
+#include <unistd.h> // for ::read(), ::write(), ::lseek()
+#include <sys/stat.h> // for ::fstat()
+
+#include "file_stream.h"
+
+
+/* O_DIRECT 要求缓冲区地址、长度和文件偏移都按块对齐 */
+#define DIRECT_IO_ALIGNMENT 4096
+
+namespace nut
+{
+
+constexpr size_t FileInputStream::DEFAULT_BUFFER_SIZE;
+constexpr size_t FileOutputStream::DEFAULT_BUFFER_SIZE;
+
+static uint8_t* alloc_buffer(size_t size) noexcept
+{
+    void *p = nullptr;
+    const int rs = ::posix_memalign(&p, DIRECT_IO_ALIGNMENT, size);
+    assert(0 == rs && nullptr != p);
+    UNUSED(rs);
+    return (uint8_t*) p;
+}
+
+/**
+ * 使用 O_DIRECT 时缓冲区长度必须按块对齐
+ */
+static void align_buffer(uint8_t **buffer, size_t *buffer_size) noexcept
+{
+    if (0 == *buffer_size % DIRECT_IO_ALIGNMENT)
+        return;
+    ::free(*buffer);
+    *buffer_size = (*buffer_size + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+    *buffer = alloc_buffer(*buffer_size);
+}
+
+/**
+ * 打开文件, 按需绕过页缓存
+ *
+ * @return 失败则返回 -1
+ */
+static int open_file(const std::string& path, int flags, bool direct_io) noexcept
+{
+    flags |= O_CLOEXEC;
+#if defined(O_DIRECT)
+    if (direct_io)
+        flags |= O_DIRECT;
+#endif
+
+    const int fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0)
+        return -1;
+
+#if !defined(O_DIRECT)
+    if (direct_io)
+    {
+#   if NUT_PLATFORM_OS_MACOS
+        if (0 != ::fcntl(fd, F_NOCACHE, 1))
+        {
+            ::close(fd);
+            return -1;
+        }
+#   else
+        ::close(fd);
+        return -1;
+#   endif
+    }
+#endif
+    return fd;
+}
+
+#if defined(O_DIRECT)
+static bool clear_direct_io(int fd, int flags) noexcept
+{
+    return 0 == ::fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+}
+#endif
+
+/**
+ * O_DIRECT 要求文件偏移按块对齐, 且不能与 O_APPEND 一起使用; 不满足时去掉
+ * O_DIRECT, 退回到经过页缓存的读写
+ *
+ * @param direct_io 返回是否仍然使用 O_DIRECT
+ * @return 无法去掉 O_DIRECT 时返回 false
+ */
+static bool check_direct_io(int fd, bool *direct_io) noexcept
+{
+    assert(nullptr != direct_io);
+    *direct_io = false;
+#if defined(O_DIRECT)
+    const int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0 || 0 == (flags & O_DIRECT))
+        return true;
+
+    const off_t offset = ::lseek(fd, 0, SEEK_CUR);
+    if (0 == (flags & O_APPEND) && offset >= 0 && 0 == offset % DIRECT_IO_ALIGNMENT)
+    {
+        *direct_io = true;
+        return true;
+    }
+    return clear_direct_io(fd, flags);
+#else
+    UNUSED(fd);
+    return true;
+#endif
+}
+
+FileInputStream::FileInputStream(size_t buffer_size) noexcept
+    : _buffer_size(buffer_size)
+{
+    assert(buffer_size > 0);
+    _buffer = alloc_buffer(_buffer_size);
+}
+
+FileInputStream::~FileInputStream() noexcept
+{
+    close();
+    ::free(_buffer);
+    _buffer = nullptr;
+    _buffer_size = 0;
+}
+
+bool FileInputStream::open(const std::string& path, bool direct_io) noexcept
+{
+    close();
+
+    const int fd = open_file(path, O_RDONLY, direct_io);
+    if (fd < 0)
+        return false;
+    return attach(fd, true);
+}
+
+bool FileInputStream::attach(int fd, bool own_fd) noexcept
+{
+    assert(fd >= 0);
+    close();
+
+    struct stat st;
+    bool direct_io = false;
+    if (0 != ::fstat(fd, &st) || !check_direct_io(fd, &direct_io))
+    {
+        if (own_fd)
+            ::close(fd);
+        return false;
+    }
+
+    _fd = fd;
+    _own_fd = own_fd;
+    _direct_io = direct_io;
+    if (_direct_io)
+        align_buffer(&_buffer, &_buffer_size);
+
+    _regular_file = S_ISREG(st.st_mode);
+    if (_regular_file)
+    {
+        _file_size = (uint64_t) st.st_size;
+        const off_t offset = ::lseek(fd, 0, SEEK_CUR);
+        _file_offset = (offset > 0 ? (uint64_t) offset : 0);
+    }
+    return true;
+}
+
+void FileInputStream::close() noexcept
+{
+    if (_fd >= 0 && _own_fd)
+        ::close(_fd);
+    _fd = -1;
+    _own_fd = false;
+    _direct_io = false;
+    _regular_file = false;
+    _file_size = 0;
+    _file_offset = 0;
+    _pos = 0;
+    _end = 0;
+}
+
+bool FileInputStream::is_open() const noexcept
+{
+    return _fd >= 0;
+}
+
+int FileInputStream::fd() const noexcept
+{
+    return _fd;
+}
+
+bool FileInputStream::advise(AccessHint hint) noexcept
+{
+    if (_fd < 0)
+        return false;
+
+#if NUT_PLATFORM_OS_LINUX
+    int advice = POSIX_FADV_NORMAL;
+    switch (hint)
+    {
+    case AccessHint::Sequential:
+        advice = POSIX_FADV_SEQUENTIAL;
+        break;
+
+    case AccessHint::Random:
+        advice = POSIX_FADV_RANDOM;
+        break;
+
+    default:
+        break;
+    }
+    return 0 == ::posix_fadvise(_fd, 0, 0, advice);
+#elif NUT_PLATFORM_OS_MACOS
+    return 0 == ::fcntl(_fd, F_RDAHEAD, AccessHint::Random == hint ? 0 : 1);
+#else
+    UNUSED(hint);
+    return false;
+#endif
+}
+
+bool FileInputStream::prefetch(uint64_t offset, uint64_t len) noexcept
+{
+    if (_fd < 0)
+        return false;
+
+#if NUT_PLATFORM_OS_LINUX
+    return 0 == ::posix_fadvise(_fd, (off_t) offset, (off_t) len, POSIX_FADV_WILLNEED);
+#else
+    UNUSED(offset);
+    UNUSED(len);
+    return false;
+#endif
+}
+
+bool FileInputStream::is_little_endian() const noexcept
+{
+    return _little_endian;
+}
+
+void FileInputStream::set_little_endian(bool le) noexcept
+{
+    _little_endian = le;
+}
+
+size_t FileInputStream::readable_size() const noexcept
+{
+    size_t ret = _end - _pos;
+    if (_regular_file && _file_size > _file_offset)
+        ret += (size_t) (_file_size - _file_offset);
+    return ret;
+}
+
+bool FileInputStream::fill() noexcept
+{
+    assert(_pos == _end);
+    if (_fd < 0)
+        return false;
+
+    ssize_t rs;
+    do
+    {
+        rs = ::read(_fd, _buffer, _buffer_size);
+    } while (rs < 0 && EINTR == errno);
+    if (rs <= 0)
+        return false;
+
+    _pos = 0;
+    _end = (size_t) rs;
+    _file_offset += (uint64_t) rs;
+    return true;
+}
+
+size_t FileInputStream::read(void *buf, size_t cb) noexcept
+{
+    assert(nullptr != buf || 0 == cb);
+
+    size_t readed = 0;
+    while (readed < cb)
+    {
+        if (_pos == _end)
+        {
+            // 大块读取直接读入调用者的缓冲区
+            const size_t left = cb - readed;
+            if (!_direct_io && left >= _buffer_size && _fd >= 0)
+            {
+                const ssize_t rs = ::read(_fd, (uint8_t*) buf + readed, left);
+                if (rs < 0 && EINTR == errno)
+                    continue;
+                if (rs <= 0)
+                    break;
+                readed += (size_t) rs;
+                _file_offset += (uint64_t) rs;
+                continue;
+            }
+
+            if (!fill())
+                break;
+        }
+
+        const size_t n = std::min(cb - readed, _end - _pos);
+        ::memcpy((uint8_t*) buf + readed, _buffer + _pos, n);
+        _pos += n;
+        readed += n;
+    }
+    return readed;
+}
+
+void FileInputStream::skip_read(size_t cb) noexcept
+{
+    const size_t n = std::min(cb, _end - _pos);
+    _pos += n;
+    cb -= n;
+    if (0 == cb)
+        return;
+
+    // 普通文件直接移动文件偏移; O_DIRECT 要求偏移对齐, 只能读出后丢弃
+    if (_regular_file && !_direct_io)
+    {
+        const off_t rs = ::lseek(_fd, (off_t) cb, SEEK_CUR);
+        assert(rs >= 0);
+        if (rs >= 0)
+            _file_offset = (uint64_t) rs;
+        return;
+    }
+
+    while (cb > 0 && fill())
+    {
+        const size_t skiped = std::min(cb, _end);
+        _pos = skiped;
+        cb -= skiped;
+    }
+}
+
+FileOutputStream::FileOutputStream(size_t buffer_size) noexcept
+    : _buffer_size(buffer_size)
+{
+    assert(buffer_size > 0);
+    _buffer = alloc_buffer(_buffer_size);
+}
+
+FileOutputStream::~FileOutputStream() noexcept
+{
+    close();
+    ::free(_buffer);
+    _buffer = nullptr;
+    _buffer_size = 0;
+}
+
+bool FileOutputStream::open(const std::string& path, bool append, bool direct_io) noexcept
+{
+    close();
+
+    // O_DIRECT 不能与 O_APPEND 一起使用, 改为定位到文件末尾
+    int flags = O_WRONLY | O_CREAT;
+    if (!append)
+        flags |= O_TRUNC;
+    else if (!direct_io)
+        flags |= O_APPEND;
+    const int fd = open_file(path, flags, direct_io);
+    if (fd < 0)
+        return false;
+    if (append && direct_io && ::lseek(fd, 0, SEEK_END) < 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    return attach(fd, true);
+}
+
+bool FileOutputStream::attach(int fd, bool own_fd) noexcept
+{
+    assert(fd >= 0);
+    close();
+
+    bool direct_io = false;
+    if (!check_direct_io(fd, &direct_io))
+    {
+        if (own_fd)
+            ::close(fd);
+        return false;
+    }
+
+    _fd = fd;
+    _own_fd = own_fd;
+    _direct_io = direct_io;
+    if (_direct_io)
+        align_buffer(&_buffer, &_buffer_size);
+    _error = false;
+    return true;
+}
+
+bool FileOutputStream::close() noexcept
+{
+    if (_fd < 0)
+        return true;
+
+    bool ret = flush();
+#if defined(O_DIRECT)
+    if (_direct_io && _size > 0)
+    {
+        // 最后不足一块的部分不能以 O_DIRECT 写出
+        const int flags = ::fcntl(_fd, F_GETFL);
+        if (flags < 0 || !clear_direct_io(_fd, flags) || write_fd(_buffer, _size) != _size)
+            ret = false;
+    }
+#endif
+
+    if (_own_fd)
+        ::close(_fd);
+    _fd = -1;
+    _own_fd = false;
+    _direct_io = false;
+    _size = 0;
+    return ret && !_error;
+}
+
+bool FileOutputStream::is_open() const noexcept
+{
+    return _fd >= 0;
+}
+
+int FileOutputStream::fd() const noexcept
+{
+    return _fd;
+}
+
+bool FileOutputStream::has_error() const noexcept
+{
+    return _error;
+}
+
+bool FileOutputStream::is_little_endian() const noexcept
+{
+    return _little_endian;
+}
+
+void FileOutputStream::set_little_endian(bool le) noexcept
+{
+    _little_endian = le;
+}
+
+size_t FileOutputStream::write_fd(const void *buf, size_t cb) noexcept
+{
+    if (_fd < 0)
+    {
+        _error = true;
+        return 0;
+    }
+
+    size_t written = 0;
+    while (written < cb)
+    {
+        const ssize_t rs = ::write(_fd, (const uint8_t*) buf + written, cb - written);
+        if (rs < 0 && EINTR == errno)
+            continue;
+        if (rs <= 0)
+        {
+            _error = true;
+            break;
+        }
+        written += (size_t) rs;
+    }
+    return written;
+}
+
+bool FileOutputStream::flush_buffer() noexcept
+{
+    const size_t n = (_direct_io ? _size / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT : _size);
+    if (0 == n)
+        return true;
+
+    // 出错时已写出的部分也移出缓冲区, 避免再次写出
+    const size_t written = write_fd(_buffer, n);
+    if (written < _size)
+        ::memmove(_buffer, _buffer + written, _size - written);
+    _size -= written;
+    return written == n;
+}
+
+bool FileOutputStream::flush() noexcept
+{
+    return flush_buffer();
+}
+
+size_t FileOutputStream::write(const void *buf, size_t cb) noexcept
+{
+    assert(nullptr != buf || 0 == cb);
+
+    const uint8_t *p = (const uint8_t*) buf;
+    size_t left = cb;
+    while (left > 0)
+    {
+        // 大块写入直接写出
+        if (0 == _size && !_direct_io && left >= _buffer_size)
+            return cb - left + write_fd(p, left);
+
+        const size_t n = std::min(left, _buffer_size - _size);
+        ::memcpy(_buffer + _size, p, n);
+        _size += n;
+        p += n;
+        left -= n;
+        if (_size == _buffer_size && !flush_buffer())
+        {
+            // 缓冲区末尾是本次写入的数据, 丢弃其中未写出的部分, 只计入实际写出的字节
+            const size_t unwritten = std::min(_size, n);
+            _size -= unwritten;
+            return cb - left - unwritten;
+        }
+    }
+    return cb;
+}
+
+}
+
+#endif
@@ -0,0 +1,405 @@
+﻿
+#ifndef ___HEADFILE_8B1F4D27_6E3A_4C95_A0D8_E57C29B3F614_
+#define ___HEADFILE_8B1F4D27_6E3A_4C95_A0D8_E57C29B3F614_
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h> // for ::memcpy()
+#include <string>
+
+#include "../../nut_config.h"
+#include "../../platform/platform.h"
+#include "../../platform/endian.h"
+#include "input_stream.h"
+#include "output_stream.h"
+#include "varint.h"
+
+
+#if !NUT_PLATFORM_OS_WINDOWS
+
+namespace nut
+{
+
+/**
+ * 带缓冲的文件输入流
+ *
+ * 以大块读取文件描述符, 小的定长读取在缓冲区内完成; 一次读取超过缓冲区大小时直接
+ * 读入调用者的缓冲区. 下面隐藏了基类的定长数值和变长整数读取函数, 缓冲区足够时
+ * 内联完成, 不经过虚函数, 也没有系统调用
+ *
+ * 对于普通文件 readable_size() 包含文件中未读的部分; 对于管道、socket 等只包含
+ * 已缓冲的部分
+ */
+class NUT_API FileInputStream : public InputStream
+{
+    NUT_REF_COUNTABLE_OVERRIDE
+
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    /**
+     * 预读提示, 对应 posix_fadvise()
+     */
+    enum class AccessHint
+    {
+        Normal,
+        Sequential, // 顺序访问, 加大预读窗口
+        Random,     // 随机访问, 不预读
+    };
+
+public:
+    /**
+     * @param buffer_size 缓冲区大小; 使用 O_DIRECT 时向上取整到对齐大小
+     */
+    explicit FileInputStream(size_t buffer_size = DEFAULT_BUFFER_SIZE) noexcept;
+    ~FileInputStream() noexcept;
+
+    /**
+     * 打开文件, 之前打开的文件会被关闭
+     *
+     * @param direct_io 使用 O_DIRECT 绕过页缓存, 此时缓冲区按块对齐; 不支持的
+     *        平台或文件系统上打开失败
+     */
+    bool open(const std::string& path, bool direct_io = false) noexcept;
+
+    /**
+     * 关联已打开的文件描述符, 从其当前位置开始读取
+     *
+     * 带 O_DIRECT 的文件描述符当前位置未按块对齐时, 去掉 O_DIRECT 改为普通读取
+     *
+     * @param own_fd 为 true 则关闭流时关闭文件描述符
+     */
+    bool attach(int fd, bool own_fd = false) noexcept;
+
+    void close() noexcept;
+    bool is_open() const noexcept;
+    int fd() const noexcept;
+
+    /**
+     * 设置预读提示
+     */
+    bool advise(AccessHint hint) noexcept;
+
+    /**
+     * 提示内核异步预读文件的一段区域
+     */
+    bool prefetch(uint64_t offset, uint64_t len) noexcept;
+
+    virtual bool is_little_endian() const noexcept override;
+    virtual void set_little_endian(bool le) noexcept override;
+
+    virtual size_t readable_size() const noexcept override;
+    virtual void skip_read(size_t cb) noexcept override;
+
+    /**
+     * @return 读到的字节数, 少于 cb 说明遇到文件末尾或者出错
+     */
+    virtual size_t read(void *buf, size_t cb) noexcept override;
+
+    /**
+     * 隐藏基类的实现, 缓冲区足够时内联完成
+     */
+    uint8_t read_uint8() noexcept
+    {
+        uint8_t ret = 0;
+        read_raw(&ret, sizeof(ret));
+        return ret;
+    }
+
+    int8_t read_int8() noexcept
+    {
+        return (int8_t) read_uint8();
+    }
+
+    uint16_t read_uint16() noexcept
+    {
+        uint16_t ret = 0;
+        read_raw(&ret, sizeof(ret));
+        return _little_endian ? le16toh(ret) : be16toh(ret);
+    }
+
+    int16_t read_int16() noexcept
+    {
+        return (int16_t) read_uint16();
+    }
+
+    uint32_t read_uint32() noexcept
+    {
+        uint32_t ret = 0;
+        read_raw(&ret, sizeof(ret));
+        return _little_endian ? le32toh(ret) : be32toh(ret);
+    }
+
+    int32_t read_int32() noexcept
+    {
+        return (int32_t) read_uint32();
+    }
+
+    uint64_t read_uint64() noexcept
+    {
+        uint64_t ret = 0;
+        read_raw(&ret, sizeof(ret));
+        return _little_endian ? le64toh(ret) : be64toh(ret);
+    }
+
+    int64_t read_int64() noexcept
+    {
+        return (int64_t) read_uint64();
+    }
+
+    uint64_t read_varuint64() noexcept
+    {
+        uint64_t ret = 0;
+        const size_t len = varint_decode(_buffer + _pos, _end - _pos, &ret);
+        if (len > 0)
+        {
+            _pos += len;
+            return ret;
+        }
+        return InputStream::read_varuint64();
+    }
+
+    bool try_read_varuint64(uint64_t *v) noexcept
+    {
+        assert(nullptr != v);
+        const size_t len = varint_decode(_buffer + _pos, _end - _pos, v);
+        if (len > 0)
+        {
+            _pos += len;
+            return true;
+        }
+        return InputStream::try_read_varuint64(v);
+    }
+
+    uint32_t read_varuint32() noexcept
+    {
+        return (uint32_t) read_varuint64();
+    }
+
+    int32_t read_varint32() noexcept
+    {
+        return zigzag_decode32((uint32_t) read_varuint64());
+    }
+
+    int64_t read_varint64() noexcept
+    {
+        return zigzag_decode64(read_varuint64());
+    }
+
+private:
+    FileInputStream(const FileInputStream&) = delete;
+    FileInputStream& operator=(const FileInputStream&) = delete;
+
+    void read_raw(void *buf, size_t cb) noexcept
+    {
+        if (_end - _pos >= cb)
+        {
+            ::memcpy(buf, _buffer + _pos, cb);
+            _pos += cb;
+            return;
+        }
+        const size_t rs = FileInputStream::read(buf, cb);
+        assert(rs == cb);
+        UNUSED(rs);
+    }
+
+    /**
+     * 缓冲区为空时从文件读满缓冲区
+     *
+     * @return 遇到文件末尾或者出错返回 false
+     */
+    bool fill() noexcept;
+
+private:
+    uint8_t *_buffer = nullptr;
+    size_t _buffer_size = 0;
+    size_t _pos = 0, _end = 0; // 缓冲区中未读数据的范围
+
+    int _fd = -1;
+    bool _own_fd = false;
+    bool _direct_io = false;
+    bool _regular_file = false;
+    uint64_t _file_size = 0, _file_offset = 0; // 仅普通文件有效
+    bool _little_endian = true;
+};
+
+/**
+ * 带缓冲的文件输出流
+ *
+ * 写入先进入缓冲区, 缓冲区满时以大块写出; 一次写入超过缓冲区大小时直接写出. 下面
+ * 隐藏了基类的定长数值和变长整数写入函数, 缓冲区足够时内联完成, 不经过虚函数, 也
+ * 没有系统调用
+ *
+ * 写出失败后 has_error() 返回 true
+ */
+class NUT_API FileOutputStream : public OutputStream
+{
+    NUT_REF_COUNTABLE_OVERRIDE
+
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+public:
+    /**
+     * @param buffer_size 缓冲区大小; 使用 O_DIRECT 时向上取整到对齐大小
+     */
+    explicit FileOutputStream(size_t buffer_size = DEFAULT_BUFFER_SIZE) noexcept;
+    ~FileOutputStream() noexcept;
+
+    /**
+     * 打开文件, 文件不存在则创建, 之前打开的文件会被关闭
+     *
+     * @param append 为 true 则追加到文件末尾; 否则清空文件
+     * @param direct_io 使用 O_DIRECT 绕过页缓存, 此时总是以整块写出, 关闭时再
+     *        写出最后不足一块的部分; 不支持的平台或文件系统上打开失败. 追加时
+     *        不使用 O_APPEND, 而是定位到文件末尾, 文件长度未按块对齐则改为普通
+     *        写入
+     */
+    bool open(const std::string& path, bool append = false, bool direct_io = false) noexcept;
+
+    /**
+     * 关联已打开的文件描述符
+     *
+     * 带 O_DIRECT 的文件描述符同时带有 O_APPEND, 或者当前位置未按块对齐时, 去掉
+     * O_DIRECT 改为普通写入
+     *
+     * @param own_fd 为 true 则关闭流时关闭文件描述符
+     */
+    bool attach(int fd, bool own_fd = false) noexcept;
+
+    /**
+     * 写出所有缓冲的数据后关闭
+     */
+    bool close() noexcept;
+    bool is_open() const noexcept;
+    int fd() const noexcept;
+
+    /**
+     * 写出缓冲的数据; 使用 O_DIRECT 时只写出整块
+     */
+    bool flush() noexcept;
+
+    bool has_error() const noexcept;
+
+    virtual bool is_little_endian() const noexcept override;
+    virtual void set_little_endian(bool le) noexcept override;
+
+    /**
+     * @return 写入的字节数, 少于 cb 说明出错, 此时只计入已写出或者仍在缓冲区中的
+     *         字节
+     */
+    virtual size_t write(const void *buf, size_t cb) noexcept override;
+
+    /**
+     * 隐藏基类的实现, 缓冲区足够时内联完成
+     */
+    void write_uint8(uint8_t v) noexcept
+    {
+        write_raw(&v, sizeof(v));
+    }
+
+    void write_int8(int8_t v) noexcept
+    {
+        write_uint8((uint8_t) v);
+    }
+
+    void write_uint16(uint16_t v) noexcept
+    {
+        v = _little_endian ? htole16(v) : htobe16(v);
+        write_raw(&v, sizeof(v));
+    }
+
+    void write_int16(int16_t v) noexcept
+    {
+        write_uint16((uint16_t) v);
+    }
+
+    void write_uint32(uint32_t v) noexcept
+    {
+        v = _little_endian ? htole32(v) : htobe32(v);
+        write_raw(&v, sizeof(v));
+    }
+
+    void write_int32(int32_t v) noexcept
+    {
+        write_uint32((uint32_t) v);
+    }
+
+    void write_uint64(uint64_t v) noexcept
+    {
+        v = _little_endian ? htole64(v) : htobe64(v);
+        write_raw(&v, sizeof(v));
+    }
+
+    void write_int64(int64_t v) noexcept
+    {
+        write_uint64((uint64_t) v);
+    }
+
+    void write_varuint64(uint64_t v) noexcept
+    {
+        if (_buffer_size - _size >= NUT_VARINT_MAX_BYTES)
+            _size += varint_encode(v, _buffer + _size);
+        else
+            OutputStream::write_varuint64(v);
+    }
+
+    void write_varuint32(uint32_t v) noexcept
+    {
+        write_varuint64(v);
+    }
+
+    void write_varint32(int32_t v) noexcept
+    {
+        write_varuint64(zigzag_encode32(v));
+    }
+
+    void write_varint64(int64_t v) noexcept
+    {
+        write_varuint64(zigzag_encode64(v));
+    }
+
+private:
+    FileOutputStream(const FileOutputStream&) = delete;
+    FileOutputStream& operator=(const FileOutputStream&) = delete;
+
+    void write_raw(const void *buf, size_t cb) noexcept
+    {
+        if (_buffer_size - _size >= cb)
+        {
+            ::memcpy(_buffer + _size, buf, cb);
+            _size += cb;
+            return;
+        }
+        FileOutputStream::write(buf, cb);
+    }
+
+    /**
+     * 写出缓冲区; 使用 O_DIRECT 时只写出整块, 剩余部分移到缓冲区开头
+     */
+    bool flush_buffer() noexcept;
+
+    /**
+     * 写出全部数据
+     *
+     * @return 实际写出的字节数, 少于 cb 说明出错
+     */
+    size_t write_fd(const void *buf, size_t cb) noexcept;
+
+private:
+    uint8_t *_buffer = nullptr;
+    size_t _buffer_size = 0;
+    size_t _size = 0; // 缓冲区中未写出的数据长度
+
+    int _fd = -1;
+    bool _own_fd = false;
+    bool _direct_io = false;
+    bool _error = false;
+    bool _little_endian = true;
+};
+
+}
+
+#endif
+
+#endif
@@ -1,6 +1,7 @@
 ﻿
 #include "../../platform/endian.h"
 #include "input_stream.h"
+#include "varint.h"
 
 
 namespace nut
@@ -222,4 +223,75 @@ std::wstring InputStream::read_wstring()
     return ret;
 }
 
+uint32_t InputStream::read_varuint32()
+{
+    return (uint32_t) read_varuint64();
+}
+
+uint64_t InputStream::read_varuint64()
+{
+    uint64_t ret = 0;
+    for (size_t i = 0; i < NUT_VARINT_MAX_BYTES; ++i)
+    {
+        const uint8_t b = read_uint8();
+        ret |= ((uint64_t) (b & 0x7f)) << (7 * i);
+        if (0 == (b & 0x80))
+            return ret;
+    }
+    assert(false); // 超长的 varint
+    return ret;
+}
+
+bool InputStream::try_read_varuint64(uint64_t *v)
+{
+    assert(nullptr != v);
+    uint64_t ret = 0;
+    for (size_t i = 0; i < NUT_VARINT_MAX_BYTES && readable_size() > 0; ++i)
+    {
+        const uint8_t b = read_uint8();
+        ret |= ((uint64_t) (b & 0x7f)) << (7 * i);
+        if (0 == (b & 0x80))
+        {
+            *v = ret;
+            return true;
+        }
+    }
+    return false;
+}
+
+int32_t InputStream::read_varint32()
+{
+    return zigzag_decode32((uint32_t) read_varuint64());
+}
+
+int64_t InputStream::read_varint64()
+{
+    return zigzag_decode64(read_varuint64());
+}
+
+std::string InputStream::read_varstring()
+{
+    std::string ret;
+    const size_t len = (size_t) read_varuint64();
+    assert(readable_size() >= sizeof(char) * len);
+    ret.resize(len);
+    const size_t rs = read((char*) ret.data(), sizeof(char) * len);
+    assert(rs == sizeof(char) * len);
+    UNUSED(rs);
+    return ret;
+}
+
+void InputStream::read_elements(void *arr, size_t elem_size, size_t count)
+{
+    assert((nullptr != arr || 0 == count) && elem_size > 0);
+    assert(readable_size() >= elem_size * count);
+
+    const size_t rs = read(arr, elem_size * count);
+    assert(rs == elem_size * count);
+    UNUSED(rs);
+
+    // 原地转换字节序
+    if (1 != elem_size && is_little_endian() != (NUT_ENDIAN_LITTLE_BYTE != 0))
+        bswap_array(arr, arr, elem_size, count);
+}
 }
@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <stddef.h> // for size_t and so on
 #include <string>
+#include <type_traits>
 
 #include "../../nut_config.h"
 #include "../../rc/rc_ptr.h"
@@ -69,6 +70,39 @@ public:
     // Read 4 byte length + string data
     virtual std::string read_string();
     virtual std::wstring read_wstring();
+
+    // LEB128 变长编码
+    uint32_t read_varuint32();
+    uint64_t read_varuint64();
+
+    /**
+     * 读取 LEB128 变长编码, 用于解码不可信的数据
+     *
+     * @return 数据不完整或者超长则返回 false
+     */
+    bool try_read_varuint64(uint64_t *v);
+
+    // zigzag + LEB128 变长编码
+    int32_t read_varint32();
+    int64_t read_varint64();
+
+    // Read varint length + string data
+    std::string read_varstring();
+
+    /**
+     * 批量读取数值数组, 一次读出后按流的字节序转换
+     */
+    template <typename T>
+    void read_array(T *arr, size_t count)
+    {
+        static_assert(std::is_arithmetic<T>::value, "Only arithmetic types are supported");
+        read_elements(arr, sizeof(T), count);
+    }
+
+    /**
+     * 读取 count 个 elem_size 字节的元素, 转换为主机字节序
+     */
+    virtual void read_elements(void *arr, size_t elem_size, size_t count);
 };
 
 }
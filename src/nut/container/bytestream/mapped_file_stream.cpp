@@ -0,0 +1,382 @@
+﻿
+#include "../../platform/platform.h"
+
+#if !NUT_PLATFORM_OS_WINDOWS
+
+#include <assert.h>
+#include <string.h> // for ::memcpy(), ::memset()
+#include <algorithm> // for std::min(), std::max()
+
+#include <fcntl.h>
+#include <unistd.h> // for ::ftruncate(), ::close()
+#include <sys/mman.h> // for ::mmap(), ::madvise()
+#include <sys/stat.h> // for ::fstat()
+
+#include "../../platform/endian.h"
+#include "mapped_file_stream.h"
+
+
+namespace nut
+{
+
+static size_t page_size() noexcept
+{
+    static const size_t size = (size_t) ::sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+static size_t round_to_page(size_t size) noexcept
+{
+    const size_t page = page_size();
+    return (size + page - 1) / page * page;
+}
+
+static bool need_swap(bool little_endian) noexcept
+{
+    return little_endian != (NUT_ENDIAN_LITTLE_BYTE != 0);
+}
+
+MappedFileStream::~MappedFileStream() noexcept
+{
+    close();
+}
+
+bool MappedFileStream::open(const std::string& path) noexcept
+{
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (0 != ::fstat(fd, &st))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // 空文件不能映射
+    const size_t size = (size_t) st.st_size;
+    if (size > 0)
+    {
+        void *p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == p)
+        {
+            ::close(fd);
+            return false;
+        }
+        _data = (const uint8_t*) p;
+    }
+
+    // 映射建立后不再需要文件描述符
+    ::close(fd);
+    _size = size;
+    _index = 0;
+    _opened = true;
+    return true;
+}
+
+void MappedFileStream::close() noexcept
+{
+    if (nullptr != _data)
+        ::munmap(const_cast<uint8_t*>(_data), _size);
+    _data = nullptr;
+    _size = 0;
+    _index = 0;
+    _opened = false;
+}
+
+bool MappedFileStream::is_open() const noexcept
+{
+    return _opened;
+}
+
+bool MappedFileStream::advise(AccessHint hint) noexcept
+{
+    if (nullptr == _data)
+        return _opened;
+
+    int advice = MADV_NORMAL;
+    switch (hint)
+    {
+    case AccessHint::Sequential:
+        advice = MADV_SEQUENTIAL;
+        break;
+
+    case AccessHint::Random:
+        advice = MADV_RANDOM;
+        break;
+
+    default:
+        break;
+    }
+    return 0 == ::madvise(const_cast<uint8_t*>(_data), _size, advice);
+}
+
+const void* MappedFileStream::data() const noexcept
+{
+    return _data;
+}
+
+const void* MappedFileStream::readable_pointer() const noexcept
+{
+    return nullptr == _data ? nullptr : _data + _index;
+}
+
+bool MappedFileStream::is_little_endian() const noexcept
+{
+    return _little_endian;
+}
+
+void MappedFileStream::set_little_endian(bool le) noexcept
+{
+    _little_endian = le;
+}
+
+size_t MappedFileStream::size() const noexcept
+{
+    return _size;
+}
+
+size_t MappedFileStream::tell() const noexcept
+{
+    return _index;
+}
+
+void MappedFileStream::seek(size_t index) noexcept
+{
+    assert(index <= _size);
+    _index = index;
+}
+
+size_t MappedFileStream::readable_size() const noexcept
+{
+    return _size - _index;
+}
+
+void MappedFileStream::skip_read(size_t cb) noexcept
+{
+    _index += std::min(cb, readable_size());
+}
+
+size_t MappedFileStream::read(void *buf, size_t cb) noexcept
+{
+    assert(nullptr != buf || 0 == cb);
+    const size_t ret = std::min(cb, readable_size());
+    if (ret > 0)
+        ::memcpy(buf, _data + _index, ret);
+    _index += ret;
+    return ret;
+}
+
+void MappedFileStream::read_elements(void *arr, size_t elem_size, size_t count) noexcept
+{
+    assert((nullptr != arr || 0 == count) && elem_size > 0);
+
+    // 文件被截断或者数据有误时不能越过映射区域, 读不到的元素填 0
+    const size_t readable = std::min(count, readable_size() / elem_size);
+    const size_t cb = elem_size * readable;
+    if (readable < count)
+        ::memset(reinterpret_cast<uint8_t*>(arr) + cb, 0, elem_size * (count - readable));
+    if (0 == cb)
+        return;
+
+    const uint8_t *src = _data + _index;
+    if (1 == elem_size || !need_swap(_little_endian))
+        ::memcpy(arr, src, cb);
+    else
+        bswap_array(arr, src, elem_size, readable);
+    _index += cb;
+}
+
+WritableMappedFileStream::~WritableMappedFileStream() noexcept
+{
+    close();
+}
+
+bool WritableMappedFileStream::open(const std::string& path, bool append) noexcept
+{
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC), 0644);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (0 != ::fstat(fd, &st))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    const size_t size = (size_t) st.st_size;
+    if (size > 0)
+    {
+        void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == p)
+        {
+            ::close(fd);
+            return false;
+        }
+        _data = (uint8_t*) p;
+    }
+
+    _fd = fd;
+    _capacity = size;
+    _size = size;
+    _index = size;
+    return true;
+}
+
+void WritableMappedFileStream::close() noexcept
+{
+    if (_fd < 0)
+        return;
+
+    if (nullptr != _data)
+        ::munmap(_data, _capacity);
+    // 去掉预留的多余空间
+    if (_capacity != _size)
+        (void) ::ftruncate(_fd, (off_t) _size);
+    ::close(_fd);
+
+    _fd = -1;
+    _data = nullptr;
+    _capacity = 0;
+    _size = 0;
+    _index = 0;
+}
+
+bool WritableMappedFileStream::is_open() const noexcept
+{
+    return _fd >= 0;
+}
+
+bool WritableMappedFileStream::flush() noexcept
+{
+    if (nullptr == _data)
+        return _fd >= 0;
+    return 0 == ::msync(_data, _size, MS_SYNC);
+}
+
+bool WritableMappedFileStream::remap(size_t new_capacity) noexcept
+{
+    assert(_fd >= 0 && new_capacity > _capacity);
+    if (0 != ::ftruncate(_fd, (off_t) new_capacity))
+        return false;
+
+    void *p;
+#if NUT_PLATFORM_OS_LINUX
+    if (nullptr != _data)
+        p = ::mremap(_data, _capacity, new_capacity, MREMAP_MAYMOVE);
+    else
+        p = ::mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+#else
+    p = ::mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (MAP_FAILED != p && nullptr != _data)
+        ::munmap(_data, _capacity);
+#endif
+    if (MAP_FAILED == p)
+    {
+        (void) ::ftruncate(_fd, (off_t) _capacity);
+        return false;
+    }
+
+    _data = (uint8_t*) p;
+    _capacity = new_capacity;
+    return true;
+}
+
+bool WritableMappedFileStream::reserve(size_t new_size) noexcept
+{
+    if (_fd < 0)
+        return false;
+    if (new_size <= _capacity)
+        return true;
+    return remap(round_to_page(new_size));
+}
+
+void* WritableMappedFileStream::data() noexcept
+{
+    return _data;
+}
+
+bool WritableMappedFileStream::is_little_endian() const noexcept
+{
+    return _little_endian;
+}
+
+void WritableMappedFileStream::set_little_endian(bool le) noexcept
+{
+    _little_endian = le;
+}
+
+size_t WritableMappedFileStream::size() const noexcept
+{
+    return _size;
+}
+
+size_t WritableMappedFileStream::tell() const noexcept
+{
+    return _index;
+}
+
+void WritableMappedFileStream::seek(size_t index) noexcept
+{
+    assert(index <= _size);
+    _index = index;
+}
+
+uint8_t* WritableMappedFileStream::prepare_write(size_t cb) noexcept
+{
+    assert(_fd >= 0 && _index <= _size);
+    const size_t end = _index + cb;
+    if (end > _capacity)
+    {
+        // 成倍扩大, 减少 ftruncate() 和重新映射的次数
+        const size_t new_capacity = round_to_page(std::max(end, _capacity * 2));
+        if (!remap(new_capacity))
+            return nullptr;
+    }
+
+    uint8_t *ret = _data + _index;
+    _index = end;
+    if (_size < end)
+        _size = end;
+    return ret;
+}
+
+size_t WritableMappedFileStream::write(const void *buf, size_t cb) noexcept
+{
+    assert(nullptr != buf || 0 == cb);
+    if (0 == cb)
+        return 0;
+
+    uint8_t *dst = prepare_write(cb);
+    if (nullptr == dst)
+        return 0;
+    ::memcpy(dst, buf, cb);
+    return cb;
+}
+
+void WritableMappedFileStream::write_elements(const void *arr, size_t elem_size, size_t count) noexcept
+{
+    assert((nullptr != arr || 0 == count) && elem_size > 0);
+    const size_t cb = elem_size * count;
+    if (0 == cb)
+        return;
+
+    // 直接转换到映射区中, 不需要中间缓冲区
+    uint8_t *dst = prepare_write(cb);
+    if (nullptr == dst)
+        return;
+    if (1 == elem_size || !need_swap(_little_endian))
+        ::memcpy(dst, arr, cb);
+    else
+        bswap_array(dst, arr, elem_size, count);
+}
+
+}
+
+#endif
@@ -0,0 +1,182 @@
+﻿
+#ifndef ___HEADFILE_5D0E8C3A_B47F_4E12_9A61_C28F3D7B40E9_
+#define ___HEADFILE_5D0E8C3A_B47F_4E12_9A61_C28F3D7B40E9_
+
+#include <stdint.h>
+#include <stddef.h> // for size_t
+#include <string>
+
+#include "../../nut_config.h"
+#include "../../platform/platform.h"
+#include "input_stream.h"
+#include "output_stream.h"
+#include "random_access_stream.h"
+
+
+#if !NUT_PLATFORM_OS_WINDOWS
+
+namespace nut
+{
+
+/**
+ * 只读的内存映射文件流
+ *
+ * 整个文件被映射到地址空间, 由操作系统按需调页, 因此可以解析远大于内存的文件而
+ * 不需要预先读入. 读取直接从映射区复制, readable_pointer() 还可以零拷贝地访问
+ * 数据
+ */
+class NUT_API MappedFileStream : public InputStream, public RandomAccessStream
+{
+    NUT_REF_COUNTABLE_OVERRIDE
+
+public:
+    /**
+     * 访问模式提示, 对应 madvise()
+     */
+    enum class AccessHint
+    {
+        Normal,
+        Sequential, // 顺序访问, 积极预读, 已读页面可以尽早回收
+        Random,     // 随机访问, 不预读
+    };
+
+public:
+    MappedFileStream() = default;
+    ~MappedFileStream() noexcept;
+
+    /**
+     * 打开并映射文件, 之前打开的文件会被关闭
+     */
+    bool open(const std::string& path) noexcept;
+    void close() noexcept;
+    bool is_open() const noexcept;
+
+    /**
+     * 设置访问模式提示
+     */
+    bool advise(AccessHint hint) noexcept;
+
+    /**
+     * 映射区的起始地址, 空文件返回 nullptr
+     */
+    const void* data() const noexcept;
+
+    /**
+     * 读位置对应的地址, 之后有 readable_size() 字节可读
+     */
+    const void* readable_pointer() const noexcept;
+
+    virtual bool is_little_endian() const noexcept override;
+    virtual void set_little_endian(bool le) noexcept override;
+
+    virtual size_t size() const noexcept override;
+    virtual size_t tell() const noexcept override;
+    virtual void seek(size_t index) noexcept override;
+
+    virtual size_t readable_size() const noexcept override;
+    virtual void skip_read(size_t cb) noexcept override;
+    virtual size_t read(void *buf, size_t cb) noexcept override;
+
+    /**
+     * 直接从映射区转换; 可读的完整元素不足 count 个时只读出这些, 其余填 0
+     */
+    virtual void read_elements(void *arr, size_t elem_size, size_t count) noexcept override;
+
+private:
+    MappedFileStream(const MappedFileStream&) = delete;
+    MappedFileStream& operator=(const MappedFileStream&) = delete;
+
+private:
+    const uint8_t *_data = nullptr;
+    size_t _size = 0;
+    size_t _index = 0;
+    bool _opened = false;
+    bool _little_endian = true;
+};
+
+/**
+ * 可写的内存映射文件流
+ *
+ * 文件按需用 ftruncate() 成倍扩大后重新映射, 写入直接复制到映射区. 关闭时文件被
+ * 截断到实际写入的长度
+ */
+class NUT_API WritableMappedFileStream : public OutputStream, public RandomAccessStream
+{
+    NUT_REF_COUNTABLE_OVERRIDE
+
+public:
+    WritableMappedFileStream() = default;
+    ~WritableMappedFileStream() noexcept;
+
+    /**
+     * 打开并映射文件, 文件不存在则创建, 之前打开的文件会被关闭
+     *
+     * @param append 为 true 则保留原有内容, 写位置在文件末尾; 否则清空文件
+     */
+    bool open(const std::string& path, bool append = false) noexcept;
+
+    /**
+     * 将文件截断到实际长度后关闭
+     */
+    void close() noexcept;
+    bool is_open() const noexcept;
+
+    /**
+     * 将映射区的修改同步写回文件
+     */
+    bool flush() noexcept;
+
+    /**
+     * 预留至少 new_size 字节的文件空间
+     */
+    bool reserve(size_t new_size) noexcept;
+
+    /**
+     * 映射区的起始地址, 之后有 size() 字节有效
+     */
+    void* data() noexcept;
+
+    virtual bool is_little_endian() const noexcept override;
+    virtual void set_little_endian(bool le) noexcept override;
+
+    virtual size_t size() const noexcept override;
+    virtual size_t tell() const noexcept override;
+    virtual void seek(size_t index) noexcept override;
+
+    /**
+     * @return 写入的字节数, 扩大文件失败则返回 0
+     */
+    virtual size_t write(const void *buf, size_t cb) noexcept override;
+
+    virtual void write_elements(const void *arr, size_t elem_size, size_t count) noexcept override;
+
+private:
+    WritableMappedFileStream(const WritableMappedFileStream&) = delete;
+    WritableMappedFileStream& operator=(const WritableMappedFileStream&) = delete;
+
+    /**
+     * 扩大文件并重新映射
+     */
+    bool remap(size_t new_capacity) noexcept;
+
+    /**
+     * 在写位置预留 cb 字节, 写位置后移
+     *
+     * @return 预留区域的起始地址, 失败则返回 nullptr
+     */
+    uint8_t* prepare_write(size_t cb) noexcept;
+
+private:
+    int _fd = -1;
+    uint8_t *_data = nullptr;
+    size_t _capacity = 0; // 映射的长度, 即当前文件长度
+    size_t _size = 0; // 实际写入的长度
+    size_t _index = 0;
+    bool _little_endian = true;
+};
+
+}
+
+#endif
+
+#endif
@@ -1,7 +1,13 @@
 ﻿
+#include <algorithm> // for std::min()
+
 #include "../../platform/endian.h"
 #include "output_stream.h"
+#include "varint.h"
+
 
+/* 字节序转换时使用的栈上缓冲区大小 */
+#define SWAP_BUFFER_SIZE 256
 
 namespace nut
 {
@@ -224,4 +230,63 @@ void OutputStream::write_wstring(const std::wstring& s)
     UNUSED(rs);
 }
 
+void OutputStream::write_varuint32(uint32_t v)
+{
+    write_varuint64(v);
+}
+
+void OutputStream::write_varuint64(uint64_t v)
+{
+    uint8_t buf[NUT_VARINT_MAX_BYTES];
+    const size_t len = varint_encode(v, buf);
+    const size_t rs = write(buf, len);
+    assert(rs == len);
+    UNUSED(rs);
+}
+
+void OutputStream::write_varint32(int32_t v)
+{
+    write_varuint64(zigzag_encode32(v));
+}
+
+void OutputStream::write_varint64(int64_t v)
+{
+    write_varuint64(zigzag_encode64(v));
+}
+
+void OutputStream::write_varstring(const std::string& s)
+{
+    const size_t len = s.length();
+    write_varuint64(len);
+    const size_t rs = write(s.data(), sizeof(char) * len);
+    assert(rs == sizeof(char) * len);
+    UNUSED(rs);
+}
+
+void OutputStream::write_elements(const void *arr, size_t elem_size, size_t count)
+{
+    assert((nullptr != arr || 0 == count) && elem_size > 0);
+
+    // 字节序相同则一次写入
+    if (1 == elem_size || is_little_endian() == (NUT_ENDIAN_LITTLE_BYTE != 0))
+    {
+        const size_t rs = write(arr, elem_size * count);
+        assert(rs == elem_size * count);
+        UNUSED(rs);
+        return;
+    }
+
+    // 分块转换字节序后写入
+    assert(elem_size <= SWAP_BUFFER_SIZE);
+    uint8_t buf[SWAP_BUFFER_SIZE];
+    const size_t per_round = SWAP_BUFFER_SIZE / elem_size;
+    for (size_t i = 0; i < count; i += per_round)
+    {
+        const size_t n = std::min(per_round, count - i);
+        bswap_array(buf, (const uint8_t*) arr + i * elem_size, elem_size, n);
+        const size_t rs = write(buf, elem_size * n);
+        assert(rs == elem_size * n);
+        UNUSED(rs);
+    }
+}
 }
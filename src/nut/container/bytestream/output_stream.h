@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <string>
+#include <type_traits>
 
 #include "../../nut_config.h"
 #include "../../rc/rc_ptr.h"
@@ -70,6 +71,32 @@ public:
     void write_wstring(const wchar_t* s, ssize_t len = -1);
     virtual void write_string(const std::string& s);
     virtual void write_wstring(const std::wstring& s);
+
+    // LEB128 变长编码
+    void write_varuint32(uint32_t v);
+    void write_varuint64(uint64_t v);
+
+    // zigzag + LEB128 变长编码
+    void write_varint32(int32_t v);
+    void write_varint64(int64_t v);
+
+    // Write varint length + string data
+    void write_varstring(const std::string& s);
+
+    /**
+     * 批量写入数值数组, 按流的字节序转换后一次写入
+     */
+    template <typename T>
+    void write_array(const T *arr, size_t count)
+    {
+        static_assert(std::is_arithmetic<T>::value, "Only arithmetic types are supported");
+        write_elements(arr, sizeof(T), count);
+    }
+
+    /**
+     * 写入 count 个 elem_size 字节的元素(主机字节序), 按流的字节序转换
+     */
+    virtual void write_elements(const void *arr, size_t elem_size, size_t count);
 };
 
 }
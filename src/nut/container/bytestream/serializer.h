@@ -0,0 +1,840 @@
+﻿
+#ifndef ___HEADFILE_C6E1A94F_2B78_4D3E_8F05_7A9D3B61E2C8_
+#define ___HEADFILE_C6E1A94F_2B78_4D3E_8F05_7A9D3B61E2C8_
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h> // for size_t
+#include <string.h> // for ::memcpy()
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <type_traits>
+#include <utility>
+
+#include "../../platform/platform.h"
+#include "varint.h"
+#include "byte_array_stream.h"
+
+
+/**
+ * 基于字段表的结构体序列化
+ *
+ * 在结构体中用 NUT_SERIALIZABLE() 列出需要序列化的字段, 每个字段有一个唯一的正整数
+ * 标签:
+ *
+ *   struct Point
+ *   {
+ *       int32_t x = 0, y = 0;
+ *       std::string name;
+ *
+ *       NUT_SERIALIZABLE(
+ *           NUT_FIELD(1, x),
+ *           NUT_FIELD(2, y),
+ *           NUT_OPTIONAL_FIELD(3, name))
+ *   };
+ *
+ *   serialize(*stream, point);
+ *   deserialize(*stream, &point);
+ *
+ * 编码格式与 protobuf 类似, 每个字段写为 varint(标签 << 2 | 编码类型) 加上字段值:
+ *   - 整数、bool、枚举: varint, 有符号数使用 zigzag
+ *   - float / double: 4 / 8 字节定长, 字节序随流的设置
+ *   - 字符串、容器、结构体: varint 长度加内容
+ *
+ * 解码时跳过不认识的标签, 缺失的字段保持原值, 因此增删字段(不复用标签)可以前后兼容.
+ * 可选字段在值为默认值(数值为 0, 字符串和容器为空)时不写出; 结构体类型的字段总是
+ * 写出
+ *
+ * 编解码函数以流的具体类型为模板参数, 所有字段的编解码都在编译期展开, 没有虚函数
+ * 分派; ByteArrayStream、FileInputStream、FileOutputStream 隐藏了基类的变长编码
+ * 函数, 传入这些具体类型时可以直接内联到其缓冲区操作
+ *
+ * 解码不信任输入数据: 截断或者超长的 varint、标签为 0、长度越界都返回 false
+ *
+ * NOTE 解码依赖输入流的 readable_size() 判断长度
+ */
+#define NUT_SERIALIZABLE(...)                                           \
+    template <typename NutVisitor>                                      \
+    void nut_visit_fields(NutVisitor& visitor)                          \
+    {                                                                   \
+        visitor.visit(__VA_ARGS__);                                     \
+    }                                                                   \
+    template <typename NutVisitor>                                      \
+    void nut_visit_fields(NutVisitor& visitor) const                    \
+    {                                                                   \
+        visitor.visit(__VA_ARGS__);                                     \
+    }
+
+#define NUT_FIELD(tag, member) ::nut::make_serial_field<(tag), false>(member)
+#define NUT_OPTIONAL_FIELD(tag, member) ::nut::make_serial_field<(tag), true>(member)
+
+namespace nut
+{
+
+/**
+ * 字段值的编码类型, 用于跳过不认识的字段
+ */
+enum class WireType : uint8_t
+{
+    Varint = 0,
+    Fixed32 = 1,
+    Fixed64 = 2,
+    LengthDelimited = 3,
+};
+
+template <uint32_t TAG, bool OPTIONAL, typename T>
+struct SerialField
+{
+    static_assert(TAG > 0 && TAG < (1u << 29), "Serial field tag out of range");
+
+    T& value;
+};
+
+template <uint32_t TAG, bool OPTIONAL, typename T>
+SerialField<TAG, OPTIONAL, T> make_serial_field(T& value) noexcept
+{
+    return SerialField<TAG, OPTIONAL, T>{value};
+}
+
+/**
+ * 判断结构体是否用 NUT_SERIALIZABLE() 定义了字段表
+ */
+template <typename T>
+class IsSerializableStruct
+{
+    struct NullVisitor
+    {
+        template <typename ...Fields>
+        void visit(Fields...) noexcept
+        {}
+    };
+
+    template <typename U>
+    static auto test(int) -> decltype(std::declval<U&>().nut_visit_fields(std::declval<NullVisitor&>()),
+                                      std::true_type());
+
+    template <typename U>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<T>(0))::value;
+};
+
+/**
+ * 各类型的编解码, 每个特化提供:
+ *   WIRE_TYPE                  编码类型
+ *   is_default(v)              是否为默认值
+ *   size(v)                    编码后的字节数
+ *   write(os, v)               编码
+ *   read(is, v)                解码, 数据错误返回 false
+ *
+ * 编码类型为 WireType::LengthDelimited 的特化需继承 LengthDelimitedSerializer, 以便
+ * 嵌套时复用预先算出的长度
+ */
+template <typename T, typename ENABLE = void>
+struct Serializer;
+
+/**
+ * 变长内容的长度, 按写出的顺序(先序)排列
+ *
+ * 写出之前遍历一次算出所有嵌套层次的长度, 写出时依次取用, 避免每一层都重新计算其
+ * 下各层的长度
+ */
+class SerialSizeCache
+{
+public:
+    /**
+     * 占一个位置, 子层的长度排在其后
+     */
+    size_t reserve()
+    {
+        _sizes.push_back(0);
+        return _sizes.size() - 1;
+    }
+
+    void set(size_t index, size_t len) noexcept
+    {
+        assert(index < _sizes.size());
+        _sizes[index] = len;
+    }
+
+    size_t next() noexcept
+    {
+        assert(_next < _sizes.size());
+        return _sizes[_next++];
+    }
+
+private:
+    std::vector<size_t> _sizes;
+    size_t _next = 0;
+};
+
+/**
+ * 编码后的字节数; cache 不为 nullptr 时记录其中各个变长内容的长度
+ */
+template <typename T>
+size_t _serial_size(const T& v, SerialSizeCache *, std::false_type)
+{
+    return Serializer<T>::size(v);
+}
+
+template <typename T>
+size_t _serial_size(const T& v, SerialSizeCache *cache, std::true_type)
+{
+    return Serializer<T>::size(v, cache);
+}
+
+template <typename T>
+size_t _serial_size(const T& v, SerialSizeCache *cache)
+{
+    return _serial_size(v, cache, std::integral_constant<
+                        bool, WireType::LengthDelimited == Serializer<T>::WIRE_TYPE>());
+}
+
+/**
+ * 编码, 变长内容的长度从 cache 中依次取用
+ */
+template <typename OS, typename T>
+void _serial_write(OS& os, const T& v, SerialSizeCache *, std::false_type)
+{
+    Serializer<T>::write(os, v);
+}
+
+template <typename OS, typename T>
+void _serial_write(OS& os, const T& v, SerialSizeCache *cache, std::true_type)
+{
+    Serializer<T>::write(os, v, cache);
+}
+
+template <typename OS, typename T>
+void _serial_write(OS& os, const T& v, SerialSizeCache *cache)
+{
+    _serial_write(os, v, cache, std::integral_constant<
+                  bool, WireType::LengthDelimited == Serializer<T>::WIRE_TYPE>());
+}
+
+template <typename T>
+size_t serialized_size(const T& v)
+{
+    return Serializer<T>::size(v);
+}
+
+template <typename OS, typename T>
+void serialize(OS& os, const T& v)
+{
+    Serializer<T>::write(os, v);
+}
+
+/**
+ * 序列化到字节数组流, 预先按编码后的大小分配空间
+ */
+template <typename T>
+void serialize(ByteArrayStream& os, const T& v)
+{
+    SerialSizeCache cache;
+    const size_t size = _serial_size(v, &cache);
+    std::vector<uint8_t>& arr = os.byte_array();
+    arr.reserve(os.tell() + size);
+    _serial_write(os, v, &cache);
+}
+
+template <typename IS, typename T>
+bool deserialize(IS& is, T *v)
+{
+    assert(nullptr != v);
+    return Serializer<T>::read(is, v);
+}
+
+/**
+ * 跳过一个字段值
+ */
+template <typename IS>
+bool skip_serial_value(IS& is, WireType wire)
+{
+    switch (wire)
+    {
+    case WireType::Varint:
+    {
+        uint64_t dummy;
+        return is.try_read_varuint64(&dummy);
+    }
+
+    case WireType::Fixed32:
+    case WireType::Fixed64:
+    {
+        const size_t len = (WireType::Fixed32 == wire ? 4 : 8);
+        if (is.readable_size() < len)
+            return false;
+        is.skip_read(len);
+        return true;
+    }
+
+    default:
+    {
+        uint64_t len;
+        if (!is.try_read_varuint64(&len) || len > is.readable_size())
+            return false;
+        is.skip_read((size_t) len);
+        return true;
+    }
+    }
+}
+
+/**
+ * 无符号整数和 bool
+ */
+template <typename T>
+struct Serializer<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type>
+{
+    static constexpr WireType WIRE_TYPE = WireType::Varint;
+
+    static bool is_default(T v) noexcept
+    {
+        return 0 == v;
+    }
+
+    static size_t size(T v) noexcept
+    {
+        return varint_size((uint64_t) v);
+    }
+
+    template <typename OS>
+    static void write(OS& os, T v)
+    {
+        os.write_varuint64((uint64_t) v);
+    }
+
+    template <typename IS>
+    static bool read(IS& is, T *v)
+    {
+        uint64_t u;
+        if (!is.try_read_varuint64(&u))
+            return false;
+        *v = (T) u;
+        return true;
+    }
+};
+
+/**
+ * 有符号整数, 使用 zigzag 编码
+ */
+template <typename T>
+struct Serializer<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type>
+{
+    static constexpr WireType WIRE_TYPE = WireType::Varint;
+
+    static bool is_default(T v) noexcept
+    {
+        return 0 == v;
+    }
+
+    static size_t size(T v) noexcept
+    {
+        return varint_size(zigzag_encode64((int64_t) v));
+    }
+
+    template <typename OS>
+    static void write(OS& os, T v)
+    {
+        os.write_varint64((int64_t) v);
+    }
+
+    template <typename IS>
+    static bool read(IS& is, T *v)
+    {
+        uint64_t u;
+        if (!is.try_read_varuint64(&u))
+            return false;
+        *v = (T) zigzag_decode64(u);
+        return true;
+    }
+};
+
+/**
+ * 枚举, 按底层整数类型编码
+ */
+template <typename T>
+struct Serializer<T, typename std::enable_if<std::is_enum<T>::value>::type>
+{
+    typedef typename std::underlying_type<T>::type underlying_type;
+    typedef Serializer<underlying_type> underlying_serializer;
+
+    static constexpr WireType WIRE_TYPE = WireType::Varint;
+
+    static bool is_default(T v) noexcept
+    {
+        return 0 == (underlying_type) v;
+    }
+
+    static size_t size(T v) noexcept
+    {
+        return underlying_serializer::size((underlying_type) v);
+    }
+
+    template <typename OS>
+    static void write(OS& os, T v)
+    {
+        underlying_serializer::write(os, (underlying_type) v);
+    }
+
+    template <typename IS>
+    static bool read(IS& is, T *v)
+    {
+        underlying_type u = 0;
+        if (!underlying_serializer::read(is, &u))
+            return false;
+        *v = (T) u;
+        return true;
+    }
+};
+
+/**
+ * float / double, 按位写为定长整数
+ */
+template <typename T>
+struct Serializer<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static_assert(4 == sizeof(T) || 8 == sizeof(T), "Unsupported floating point size");
+
+    static constexpr WireType WIRE_TYPE = (4 == sizeof(T) ? WireType::Fixed32 : WireType::Fixed64);
+
+    static bool is_default(T v) noexcept
+    {
+        return 0 == v;
+    }
+
+    static size_t size(T) noexcept
+    {
+        return sizeof(T);
+    }
+
+    template <typename OS>
+    static void write(OS& os, T v)
+    {
+        if (4 == sizeof(T))
+        {
+            uint32_t bits;
+            ::memcpy(&bits, &v, 4);
+            os.write_uint32(bits);
+        }
+        else
+        {
+            uint64_t bits;
+            ::memcpy(&bits, &v, 8);
+            os.write_uint64(bits);
+        }
+    }
+
+    template <typename IS>
+    static bool read(IS& is, T *v)
+    {
+        if (is.readable_size() < sizeof(T))
+            return false;
+        if (4 == sizeof(T))
+        {
+            const uint32_t bits = is.read_uint32();
+            ::memcpy(v, &bits, 4);
+        }
+        else
+        {
+            const uint64_t bits = is.read_uint64();
+            ::memcpy(v, &bits, 8);
+        }
+        return true;
+    }
+};
+
+/**
+ * 变长类型的公共部分, IMPL 提供 payload_size() / write_payload() / read_payload()
+ *
+ * payload_size() 和 write_payload() 对嵌套的内容分别调用 _serial_size() 和
+ * _serial_write(), 并传递 cache
+ */
+template <typename T, typename IMPL>
+struct LengthDelimitedSerializer
+{
+    static constexpr WireType WIRE_TYPE = WireType::LengthDelimited;
+
+    static size_t size(const T& v)
+    {
+        return size(v, nullptr);
+    }
+
+    /**
+     * @param cache 不为 nullptr 时, 按先序记录本层及各个子层的内容长度
+     */
+    static size_t size(const T& v, SerialSizeCache *cache)
+    {
+        const size_t index = (nullptr != cache ? cache->reserve() : 0);
+        const size_t len = IMPL::payload_size(v, cache);
+        if (nullptr != cache)
+            cache->set(index, len);
+        return varint_size(len) + len;
+    }
+
+    template <typename OS>
+    static void write(OS& os, const T& v)
+    {
+        SerialSizeCache cache;
+        size(v, &cache);
+        write(os, v, &cache);
+    }
+
+    /**
+     * @param cache 由 size(v, cache) 填充, 依次取用其中的长度
+     */
+    template <typename OS>
+    static void write(OS& os, const T& v, SerialSizeCache *cache)
+    {
+        assert(nullptr != cache);
+        os.write_varuint64(cache->next());
+        IMPL::write_payload(os, v, cache);
+    }
+
+    template <typename IS>
+    static bool read(IS& is, T *v)
+    {
+        uint64_t len;
+        if (!is.try_read_varuint64(&len))
+            return false;
+        const size_t readable = is.readable_size();
+        if (len > readable)
+            return false;
+
+        // 内容必须恰好用掉 len 字节
+        const size_t end = readable - (size_t) len;
+        return IMPL::read_payload(is, end, v) && is.readable_size() == end;
+    }
+};
+
+template <typename T>
+struct Serializer<T, typename std::enable_if<std::is_same<T, std::string>::value>::type>
+    : public LengthDelimitedSerializer<T, Serializer<T>>
+{
+    static bool is_default(const T& v) noexcept
+    {
+        return v.empty();
+    }
+
+    static size_t payload_size(const T& v, SerialSizeCache *) noexcept
+    {
+        return v.length();
+    }
+
+    template <typename OS>
+    static void write_payload(OS& os, const T& v, SerialSizeCache *)
+    {
+        os.write(v.data(), v.length());
+    }
+
+    template <typename IS>
+    static bool read_payload(IS& is, size_t end, T *v)
+    {
+        v->resize(is.readable_size() - end);
+        return v->empty() || is.read(&(*v)[0], v->length()) == v->length();
+    }
+};
+
+/**
+ * 单字节整数和浮点数的数组整块编解码, 其他类型的数组逐个元素编解码
+ */
+template <typename T>
+struct IsSerialBulkElement
+{
+    static constexpr bool value = (std::is_integral<T>::value && 1 == sizeof(T) && !std::is_same<T, bool>::value) ||
+        std::is_floating_point<T>::value;
+};
+
+template <typename T, typename A>
+struct Serializer<std::vector<T, A>, typename std::enable_if<IsSerialBulkElement<T>::value>::type>
+    : public LengthDelimitedSerializer<std::vector<T, A>, Serializer<std::vector<T, A>>>
+{
+    static bool is_default(const std::vector<T, A>& v) noexcept
+    {
+        return v.empty();
+    }
+
+    static size_t payload_size(const std::vector<T, A>& v, SerialSizeCache *) noexcept
+    {
+        return sizeof(T) * v.size();
+    }
+
+    template <typename OS>
+    static void write_payload(OS& os, const std::vector<T, A>& v, SerialSizeCache *)
+    {
+        os.write_array(v.data(), v.size());
+    }
+
+    template <typename IS>
+    static bool read_payload(IS& is, size_t end, std::vector<T, A> *v)
+    {
+        const size_t len = is.readable_size() - end;
+        if (0 != len % sizeof(T))
+            return false;
+        v->resize(len / sizeof(T));
+        is.read_array(v->data(), v->size());
+        return true;
+    }
+};
+
+template <typename T, typename A>
+struct Serializer<std::vector<T, A>, typename std::enable_if<!IsSerialBulkElement<T>::value>::type>
+    : public LengthDelimitedSerializer<std::vector<T, A>, Serializer<std::vector<T, A>>>
+{
+    static bool is_default(const std::vector<T, A>& v) noexcept
+    {
+        return v.empty();
+    }
+
+    static size_t payload_size(const std::vector<T, A>& v, SerialSizeCache *cache)
+    {
+        size_t ret = 0;
+        for (const T& e : v)
+            ret += _serial_size(e, cache);
+        return ret;
+    }
+
+    template <typename OS>
+    static void write_payload(OS& os, const std::vector<T, A>& v, SerialSizeCache *cache)
+    {
+        for (const T& e : v)
+            _serial_write(os, e, cache);
+    }
+
+    template <typename IS>
+    static bool read_payload(IS& is, size_t end, std::vector<T, A> *v)
+    {
+        v->clear();
+        while (is.readable_size() > end)
+        {
+            T e = T();
+            if (!Serializer<T>::read(is, &e))
+                return false;
+            v->push_back(std::move(e));
+        }
+        return true;
+    }
+};
+
+/**
+ * 关联容器, 依次编码键和值
+ */
+template <typename M>
+struct MapSerializer : public LengthDelimitedSerializer<M, MapSerializer<M>>
+{
+    typedef typename M::key_type key_type;
+    typedef typename M::mapped_type mapped_type;
+
+    static bool is_default(const M& m) noexcept
+    {
+        return m.empty();
+    }
+
+    static size_t payload_size(const M& m, SerialSizeCache *cache)
+    {
+        size_t ret = 0;
+        for (const auto& kv : m)
+        {
+            ret += _serial_size(kv.first, cache);
+            ret += _serial_size(kv.second, cache);
+        }
+        return ret;
+    }
+
+    template <typename OS>
+    static void write_payload(OS& os, const M& m, SerialSizeCache *cache)
+    {
+        for (const auto& kv : m)
+        {
+            _serial_write(os, kv.first, cache);
+            _serial_write(os, kv.second, cache);
+        }
+    }
+
+    template <typename IS>
+    static bool read_payload(IS& is, size_t end, M *m)
+    {
+        m->clear();
+        while (is.readable_size() > end)
+        {
+            key_type k = key_type();
+            mapped_type v = mapped_type();
+            if (!Serializer<key_type>::read(is, &k) || !Serializer<mapped_type>::read(is, &v))
+                return false;
+            (*m)[std::move(k)] = std::move(v);
+        }
+        return true;
+    }
+};
+
+template <typename K, typename V, typename C, typename A>
+struct Serializer<std::map<K, V, C, A>> : public MapSerializer<std::map<K, V, C, A>>
+{};
+
+template <typename K, typename V, typename H, typename E, typename A>
+struct Serializer<std::unordered_map<K, V, H, E, A>> : public MapSerializer<std::unordered_map<K, V, H, E, A>>
+{};
+
+/**
+ * 字段表的遍历器
+ */
+class SerialFieldSizer
+{
+public:
+    explicit SerialFieldSizer(SerialSizeCache *cache) noexcept
+        : _cache(cache)
+    {}
+
+    template <typename ...Fields>
+    void visit(Fields... fields)
+    {
+        const int dummy[] = {0, (add(fields), 0)...};
+        UNUSED(dummy);
+    }
+
+    size_t size() const noexcept
+    {
+        return _size;
+    }
+
+private:
+    template <uint32_t TAG, bool OPTIONAL, typename T>
+    void add(SerialField<TAG, OPTIONAL, T> field)
+    {
+        typedef Serializer<typename std::remove_const<T>::type> serializer;
+        if (OPTIONAL && serializer::is_default(field.value))
+            return;
+        _size += varint_size(((uint64_t) TAG << 2) | (uint64_t) serializer::WIRE_TYPE);
+        _size += _serial_size(field.value, _cache);
+    }
+
+private:
+    SerialSizeCache *const _cache;
+    size_t _size = 0;
+};
+
+template <typename OS>
+class SerialFieldWriter
+{
+public:
+    SerialFieldWriter(OS& os, SerialSizeCache *cache) noexcept
+        : _os(os), _cache(cache)
+    {}
+
+    template <typename ...Fields>
+    void visit(Fields... fields)
+    {
+        const int dummy[] = {0, (write(fields), 0)...};
+        UNUSED(dummy);
+    }
+
+private:
+    template <uint32_t TAG, bool OPTIONAL, typename T>
+    void write(SerialField<TAG, OPTIONAL, T> field)
+    {
+        typedef Serializer<typename std::remove_const<T>::type> serializer;
+        if (OPTIONAL && serializer::is_default(field.value))
+            return;
+        _os.write_varuint64(((uint64_t) TAG << 2) | (uint64_t) serializer::WIRE_TYPE);
+        _serial_write(_os, field.value, _cache);
+    }
+
+private:
+    OS& _os;
+    SerialSizeCache *const _cache;
+};
+
+template <typename IS>
+class SerialFieldReader
+{
+public:
+    SerialFieldReader(IS& is, uint32_t tag, WireType wire) noexcept
+        : _is(is), _tag(tag), _wire(wire)
+    {}
+
+    template <typename ...Fields>
+    void visit(Fields... fields)
+    {
+        const int dummy[] = {0, (read(fields), 0)...};
+        UNUSED(dummy);
+    }
+
+    /**
+     * @return 标签匹配但是读取失败时返回 false
+     */
+    bool finish()
+    {
+        // 不认识的标签或者编码类型已改变的字段, 跳过
+        if (!_matched)
+            return skip_serial_value(_is, _wire);
+        return _ok;
+    }
+
+private:
+    template <uint32_t TAG, bool OPTIONAL, typename T>
+    void read(SerialField<TAG, OPTIONAL, T> field)
+    {
+        typedef Serializer<T> serializer;
+        if (TAG != _tag || serializer::WIRE_TYPE != _wire || _matched)
+            return;
+        _matched = true;
+        _ok = serializer::read(_is, &field.value);
+    }
+
+private:
+    IS& _is;
+    const uint32_t _tag;
+    const WireType _wire;
+    bool _matched = false;
+    bool _ok = false;
+};
+
+/**
+ * 用 NUT_SERIALIZABLE() 定义了字段表的结构体
+ */
+template <typename T>
+struct Serializer<T, typename std::enable_if<IsSerializableStruct<T>::value>::type>
+    : public LengthDelimitedSerializer<T, Serializer<T>>
+{
+    static bool is_default(const T&) noexcept
+    {
+        return false;
+    }
+
+    static size_t payload_size(const T& v, SerialSizeCache *cache)
+    {
+        SerialFieldSizer sizer(cache);
+        v.nut_visit_fields(sizer);
+        return sizer.size();
+    }
+
+    template <typename OS>
+    static void write_payload(OS& os, const T& v, SerialSizeCache *cache)
+    {
+        SerialFieldWriter<OS> writer(os, cache);
+        v.nut_visit_fields(writer);
+    }
+
+    template <typename IS>
+    static bool read_payload(IS& is, size_t end, T *v)
+    {
+        while (is.readable_size() > end)
+        {
+            // 标签必须在 SerialField 允许的范围内
+            uint64_t key;
+            if (!is.try_read_varuint64(&key) || 0 == (key >> 2) || (key >> 2) >= (1u << 29))
+                return false;
+            SerialFieldReader<IS> reader(is, (uint32_t) (key >> 2), (WireType) (key & 0x03));
+            v->nut_visit_fields(reader);
+            if (!reader.finish())
+                return false;
+        }
+        return true;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+﻿
+#ifndef ___HEADFILE_61F2D8A4_3C57_4B9E_A0E6_8D19F47C2B35_
+#define ___HEADFILE_61F2D8A4_3C57_4B9E_A0E6_8D19F47C2B35_
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h> // for size_t
+
+
+/**
+ * LEB128 变长整数编码及 zigzag 编码
+ *
+ * LEB128: 从低位开始每 7 位一个字节, 字节最高位为 1 表示后面还有字节
+ * zigzag: 0, -1, 1, -2, 2 ... 依次映射为 0, 1, 2, 3, 4 ..., 使绝对值小的负数
+ *         编码后也很短
+ */
+
+/* 64 位整数编码后的最大字节数 */
+#define NUT_VARINT_MAX_BYTES 10
+
+namespace nut
+{
+
+/**
+ * @param buf 至少 NUT_VARINT_MAX_BYTES 字节
+ * @return 编码后的字节数
+ */
+inline size_t varint_encode(uint64_t v, uint8_t *buf) noexcept
+{
+    assert(nullptr != buf);
+    size_t i = 0;
+    while (v >= 0x80)
+    {
+        buf[i++] = (uint8_t) (v | 0x80);
+        v >>= 7;
+    }
+    buf[i++] = (uint8_t) v;
+    return i;
+}
+
+/**
+ * @return 编码后的字节数
+ */
+inline size_t varint_size(uint64_t v) noexcept
+{
+    size_t ret = 1;
+    while (v >= 0x80)
+    {
+        v >>= 7;
+        ++ret;
+    }
+    return ret;
+}
+
+/**
+ * @return 解码用掉的字节数; 数据不完整或者超长则返回 0
+ */
+inline size_t varint_decode(const uint8_t *buf, size_t cb, uint64_t *v) noexcept
+{
+    assert((nullptr != buf || 0 == cb) && nullptr != v);
+
+    // 单字节的快速路径
+    if (cb > 0 && buf[0] < 0x80)
+    {
+        *v = buf[0];
+        return 1;
+    }
+
+    uint64_t ret = 0;
+    for (size_t i = 0; i < cb && i < NUT_VARINT_MAX_BYTES; ++i)
+    {
+        ret |= ((uint64_t) (buf[i] & 0x7f)) << (7 * i);
+        if (0 == (buf[i] & 0x80))
+        {
+            *v = ret;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+inline uint32_t zigzag_encode32(int32_t v) noexcept
+{
+    return (((uint32_t) v) << 1) ^ (uint32_t) (v >> 31);
+}
+
+inline int32_t zigzag_decode32(uint32_t v) noexcept
+{
+    return (int32_t) ((v >> 1) ^ (~(v & 1) + 1));
+}
+
+inline uint64_t zigzag_encode64(int64_t v) noexcept
+{
+    return (((uint64_t) v) << 1) ^ (uint64_t) (v >> 63);
+}
+
+inline int64_t zigzag_decode64(uint64_t v) noexcept
+{
+    return (int64_t) ((v >> 1) ^ (~(v & 1) + 1));
+}
+
+}
+
+#endif
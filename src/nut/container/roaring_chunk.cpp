@@ -0,0 +1,1091 @@
+﻿
+#include <assert.h>
+#include <string.h> // for ::memset()
+#include <algorithm>
+#include <iterator> // for std::back_inserter()
+
+#include "../platform/platform.h"
+#include "../platform/int_type.h" // for ssize_t in windows VC
+#include "../numeric/word_array_integer/bit_op.h"
+#include "roaring_chunk.h"
+
+#if NUT_PLATFORM_SSE2
+#   include <emmintrin.h>
+#endif
+
+
+namespace nut
+{
+
+/**
+ * 将 words 中 [first, last] 的比特置为 value
+ */
+static void set_bits(uint64_t *words, uint32_t first, uint32_t last, bool value) noexcept
+{
+    assert(nullptr != words && first <= last && last < 65536);
+    const uint32_t first_word = first / 64, last_word = last / 64;
+    for (uint32_t i = first_word; i <= last_word; ++i)
+    {
+        uint64_t mask = ~(uint64_t) 0;
+        if (i == first_word)
+            mask &= ~(uint64_t) 0 << (first % 64);
+        if (i == last_word)
+            mask &= ~(uint64_t) 0 >> (63 - last % 64);
+        if (value)
+            words[i] |= mask;
+        else
+            words[i] &= ~mask;
+    }
+}
+
+static size_t count_bits(const uint64_t *words, size_t n) noexcept
+{
+    size_t ret = 0;
+    for (size_t i = 0; i < n; ++i)
+        ret += bit1_count(words[i]);
+    return ret;
+}
+
+RoaringChunk::RoaringChunk(uint16_t first, uint16_t last) noexcept
+    : _type(Type::Run), _size((uint32_t) last - first + 1)
+{
+    assert(first <= last);
+    _runs.push_back(first);
+    _runs.push_back(last);
+}
+
+RoaringChunk::RoaringChunk(RoaringChunk&& x) noexcept
+    : _type(x._type), _size(x._size), _array(std::move(x._array)),
+      _bitmap(std::move(x._bitmap)), _runs(std::move(x._runs))
+{
+    x._type = Type::Array;
+    x._size = 0;
+}
+
+RoaringChunk& RoaringChunk::operator=(RoaringChunk&& x) noexcept
+{
+    if (this != &x)
+    {
+        _type = x._type;
+        _size = x._size;
+        _array = std::move(x._array);
+        _bitmap = std::move(x._bitmap);
+        _runs = std::move(x._runs);
+
+        x._type = Type::Array;
+        x._size = 0;
+    }
+    return *this;
+}
+
+bool RoaringChunk::operator==(const RoaringChunk& x) const noexcept
+{
+    if (this == &x)
+        return true;
+    if (_size != x._size)
+        return false;
+    if (_type == x._type)
+    {
+        switch (_type)
+        {
+        case Type::Array:
+            return _array == x._array;
+
+        case Type::Bitmap:
+            return _bitmap == x._bitmap;
+
+        case Type::Run:
+            return _runs == x._runs;
+        }
+    }
+    return 0 == compare(x);
+}
+
+bool RoaringChunk::operator!=(const RoaringChunk& x) const noexcept
+{
+    return !(*this == x);
+}
+
+int RoaringChunk::compare(const RoaringChunk& x) const noexcept
+{
+    if (this == &x)
+        return 0;
+
+    // 转换为区间后比较, 与 IntegerSet::compare() 一致
+    std::vector<uint16_t> r1, r2;
+    visit_ranges([&] (uint16_t first, uint16_t last) {
+            r1.push_back(first);
+            r1.push_back(last);
+            return true;
+        });
+    x.visit_ranges([&] (uint16_t first, uint16_t last) {
+            r2.push_back(first);
+            r2.push_back(last);
+            return true;
+        });
+
+    const size_t lsz = r1.size() / 2, rsz = r2.size() / 2;
+    size_t i = 0;
+    for (; i < lsz && i < rsz; ++i)
+    {
+        if (r1[2 * i] != r2[2 * i])
+            return r1[2 * i] < r2[2 * i] ? -1 : 1;
+        else if (r1[2 * i + 1] < r2[2 * i + 1])
+            return i + 1 >= lsz ? -1 : 1;
+        else if (r1[2 * i + 1] > r2[2 * i + 1])
+            return i + 1 < rsz ? -1 : 1;
+    }
+    return i < lsz ? 1 : (i < rsz ? -1 : 0);
+}
+
+RoaringChunk RoaringChunk::operator|(const RoaringChunk& x) const noexcept
+{
+    return combine(*this, x, Op::Or);
+}
+
+RoaringChunk RoaringChunk::operator&(const RoaringChunk& x) const noexcept
+{
+    return combine(*this, x, Op::And);
+}
+
+RoaringChunk RoaringChunk::operator-(const RoaringChunk& x) const noexcept
+{
+    return combine(*this, x, Op::AndNot);
+}
+
+RoaringChunk RoaringChunk::operator^(const RoaringChunk& x) const noexcept
+{
+    return combine(*this, x, Op::Xor);
+}
+
+void RoaringChunk::clear() noexcept
+{
+    _type = Type::Array;
+    _size = 0;
+    _array.clear();
+    _bitmap.clear();
+    _runs.clear();
+}
+
+bool RoaringChunk::contains(uint16_t value) const noexcept
+{
+    switch (_type)
+    {
+    case Type::Array:
+        return std::binary_search(_array.begin(), _array.end(), value);
+
+    case Type::Bitmap:
+        return 0 != (_bitmap[value / 64] & (((uint64_t) 1) << (value % 64)));
+
+    case Type::Run:
+    {
+        const size_t i = run_lower_bound(value);
+        return 2 * i < _runs.size() && _runs[2 * i] <= value;
+    }
+    }
+    return false;
+}
+
+bool RoaringChunk::add(uint16_t value) noexcept
+{
+    switch (_type)
+    {
+    case Type::Array:
+    {
+        const std::vector<uint16_t>::iterator iter =
+            std::lower_bound(_array.begin(), _array.end(), value);
+        if (iter != _array.end() && *iter == value)
+            return false;
+        _array.insert(iter, value);
+        ++_size;
+        break;
+    }
+
+    case Type::Bitmap:
+    {
+        uint64_t& word = _bitmap[value / 64];
+        const uint64_t mask = ((uint64_t) 1) << (value % 64);
+        if (0 != (word & mask))
+            return false;
+        word |= mask;
+        ++_size;
+        break;
+    }
+
+    case Type::Run:
+        if (contains(value))
+            return false;
+        run_add_range(value, value);
+        break;
+    }
+    adjust_after_update();
+    return true;
+}
+
+bool RoaringChunk::remove(uint16_t value) noexcept
+{
+    switch (_type)
+    {
+    case Type::Array:
+    {
+        const std::vector<uint16_t>::iterator iter =
+            std::lower_bound(_array.begin(), _array.end(), value);
+        if (iter == _array.end() || *iter != value)
+            return false;
+        _array.erase(iter);
+        --_size;
+        break;
+    }
+
+    case Type::Bitmap:
+    {
+        uint64_t& word = _bitmap[value / 64];
+        const uint64_t mask = ((uint64_t) 1) << (value % 64);
+        if (0 == (word & mask))
+            return false;
+        word &= ~mask;
+        --_size;
+        break;
+    }
+
+    case Type::Run:
+        if (!contains(value))
+            return false;
+        run_remove_range(value, value);
+        break;
+    }
+    adjust_after_update();
+    return true;
+}
+
+void RoaringChunk::add_range(uint16_t first, uint16_t last) noexcept
+{
+    assert(first <= last);
+    switch (_type)
+    {
+    case Type::Array:
+        if (_size + ((size_t) last - first + 1) <= ARRAY_MAX_SIZE)
+        {
+            const std::vector<uint16_t>::iterator begin =
+                std::lower_bound(_array.begin(), _array.end(), first);
+            const std::vector<uint16_t>::iterator end =
+                std::upper_bound(begin, _array.end(), last);
+            const size_t pos = begin - _array.begin();
+            _array.erase(begin, end);
+            _array.insert(_array.begin() + pos, (size_t) last - first + 1, 0);
+            for (uint32_t v = first; v <= last; ++v)
+                _array[pos + v - first] = (uint16_t) v;
+            _size = (uint32_t) _array.size();
+            break;
+        }
+        convert_to_bitmap();
+        // fall through
+
+    case Type::Bitmap:
+        set_bits(_bitmap.data(), first, last, true);
+        _size = (uint32_t) count_bits(_bitmap.data(), BITMAP_WORDS);
+        break;
+
+    case Type::Run:
+        run_add_range(first, last);
+        break;
+    }
+    optimize();
+}
+
+void RoaringChunk::remove_range(uint16_t first, uint16_t last) noexcept
+{
+    assert(first <= last);
+    switch (_type)
+    {
+    case Type::Array:
+    {
+        const std::vector<uint16_t>::iterator begin =
+            std::lower_bound(_array.begin(), _array.end(), first);
+        const std::vector<uint16_t>::iterator end =
+            std::upper_bound(begin, _array.end(), last);
+        _array.erase(begin, end);
+        _size = (uint32_t) _array.size();
+        break;
+    }
+
+    case Type::Bitmap:
+        set_bits(_bitmap.data(), first, last, false);
+        _size = (uint32_t) count_bits(_bitmap.data(), BITMAP_WORDS);
+        break;
+
+    case Type::Run:
+        run_remove_range(first, last);
+        break;
+    }
+    optimize();
+}
+
+uint16_t RoaringChunk::first_value() const noexcept
+{
+    assert(!empty());
+    return (uint16_t) next_value(0);
+}
+
+uint16_t RoaringChunk::last_value() const noexcept
+{
+    assert(!empty());
+    return (uint16_t) prev_value(65535);
+}
+
+int32_t RoaringChunk::next_value(uint32_t value) const noexcept
+{
+    if (value > 65535)
+        return -1;
+
+    switch (_type)
+    {
+    case Type::Array:
+    {
+        const std::vector<uint16_t>::const_iterator iter =
+            std::lower_bound(_array.begin(), _array.end(), (uint16_t) value);
+        return iter == _array.end() ? -1 : *iter;
+    }
+
+    case Type::Bitmap:
+    {
+        size_t i = value / 64;
+        uint64_t word = _bitmap[i] & (~(uint64_t) 0 << (value % 64));
+        while (true)
+        {
+            if (0 != word)
+                return (int32_t) (i * 64 + lowest_bit1(word));
+            if (++i >= BITMAP_WORDS)
+                return -1;
+            word = _bitmap[i];
+        }
+    }
+
+    case Type::Run:
+    {
+        const size_t i = run_lower_bound(value);
+        if (2 * i >= _runs.size())
+            return -1;
+        return std::max<uint32_t>(_runs[2 * i], value);
+    }
+    }
+    return -1;
+}
+
+int32_t RoaringChunk::prev_value(int32_t value) const noexcept
+{
+    if (value < 0)
+        return -1;
+    if (value > 65535)
+        value = 65535;
+
+    switch (_type)
+    {
+    case Type::Array:
+    {
+        const std::vector<uint16_t>::const_iterator iter =
+            std::upper_bound(_array.begin(), _array.end(), (uint16_t) value);
+        return iter == _array.begin() ? -1 : *(iter - 1);
+    }
+
+    case Type::Bitmap:
+    {
+        ssize_t i = value / 64;
+        uint64_t word = _bitmap[i] & (~(uint64_t) 0 >> (63 - value % 64));
+        while (true)
+        {
+            if (0 != word)
+                return (int32_t) (i * 64 + highest_bit1(word));
+            if (--i < 0)
+                return -1;
+            word = _bitmap[i];
+        }
+    }
+
+    case Type::Run:
+    {
+        const size_t i = run_lower_bound(value);
+        if (2 * i < _runs.size() && _runs[2 * i] <= value)
+            return value;
+        return 0 == i ? -1 : _runs[2 * i - 1];
+    }
+    }
+    return -1;
+}
+
+int32_t RoaringChunk::next_absent(int32_t value) const noexcept
+{
+    assert(0 <= value);
+    if (value > 65535)
+        return 65536;
+
+    switch (_type)
+    {
+    case Type::Array:
+    {
+        size_t i = std::lower_bound(_array.begin(), _array.end(), (uint16_t) value) - _array.begin();
+        while (i < _array.size() && _array[i] == value)
+        {
+            ++i;
+            ++value;
+        }
+        return value;
+    }
+
+    case Type::Bitmap:
+    {
+        size_t i = value / 64;
+        uint64_t word = ~_bitmap[i] & (~(uint64_t) 0 << (value % 64));
+        while (true)
+        {
+            if (0 != word)
+                return (int32_t) (i * 64 + lowest_bit1(word));
+            if (++i >= BITMAP_WORDS)
+                return 65536;
+            word = ~_bitmap[i];
+        }
+    }
+
+    case Type::Run:
+    {
+        const size_t i = run_lower_bound(value);
+        if (2 * i < _runs.size() && _runs[2 * i] <= value)
+            return (int32_t) _runs[2 * i + 1] + 1;
+        return value;
+    }
+    }
+    return value;
+}
+
+size_t RoaringChunk::rank(uint16_t value) const noexcept
+{
+    switch (_type)
+    {
+    case Type::Array:
+        return std::lower_bound(_array.begin(), _array.end(), value) - _array.begin();
+
+    case Type::Bitmap:
+    {
+        size_t ret = count_bits(_bitmap.data(), value / 64);
+        if (0 != value % 64)
+            ret += bit1_count(_bitmap[value / 64] & (~(uint64_t) 0 >> (64 - value % 64)));
+        return ret;
+    }
+
+    case Type::Run:
+    {
+        size_t ret = 0;
+        for (size_t i = 0, sz = _runs.size(); i < sz && _runs[i] < value; i += 2)
+        {
+            const uint32_t last = std::min<uint32_t>(_runs[i + 1], value - 1);
+            ret += last - _runs[i] + 1;
+        }
+        return ret;
+    }
+    }
+    return 0;
+}
+
+uint16_t RoaringChunk::select(size_t index) const noexcept
+{
+    assert(index < _size);
+    switch (_type)
+    {
+    case Type::Array:
+        return _array[index];
+
+    case Type::Bitmap:
+        for (size_t i = 0; i < BITMAP_WORDS; ++i)
+        {
+            uint64_t word = _bitmap[i];
+            const size_t cnt = bit1_count(word);
+            if (index >= cnt)
+            {
+                index -= cnt;
+                continue;
+            }
+            for (; index > 0; --index)
+                word &= word - 1; // 清除最低位的 1
+            return (uint16_t) (i * 64 + lowest_bit1(word));
+        }
+        break;
+
+    case Type::Run:
+        for (size_t i = 0, sz = _runs.size(); i < sz; i += 2)
+        {
+            const size_t len = (size_t) _runs[i + 1] - _runs[i] + 1;
+            if (index < len)
+                return (uint16_t) (_runs[i] + index);
+            index -= len;
+        }
+        break;
+    }
+    assert(false); // Index out of range
+    return 0;
+}
+
+void RoaringChunk::optimize() noexcept
+{
+    const size_t array_bytes = sizeof(uint16_t) * _size,
+        bitmap_bytes = sizeof(uint64_t) * BITMAP_WORDS,
+        run_bytes = sizeof(uint16_t) * 2 * count_runs();
+    if (run_bytes < std::min(array_bytes, bitmap_bytes))
+        convert_to_run();
+    else if (_size <= ARRAY_MAX_SIZE)
+        convert_to_array();
+    else
+        convert_to_bitmap();
+}
+
+size_t RoaringChunk::memory_size() const noexcept
+{
+    switch (_type)
+    {
+    case Type::Array:
+        return sizeof(uint16_t) * _array.size();
+
+    case Type::Bitmap:
+        return sizeof(uint64_t) * _bitmap.size();
+
+    case Type::Run:
+        return sizeof(uint16_t) * _runs.size();
+    }
+    return 0;
+}
+
+void RoaringChunk::serialize(OutputStream *os) const
+{
+    assert(nullptr != os);
+    const bool le = os->is_little_endian();
+    os->set_little_endian(true);
+
+    os->write_uint8((uint8_t) _type);
+    os->write_uint32(_size);
+    switch (_type)
+    {
+    case Type::Array:
+        for (size_t i = 0, sz = _array.size(); i < sz; ++i)
+            os->write_uint16(_array[i]);
+        break;
+
+    case Type::Bitmap:
+        for (size_t i = 0; i < BITMAP_WORDS; ++i)
+            os->write_uint64(_bitmap[i]);
+        break;
+
+    case Type::Run:
+        os->write_uint16((uint16_t) (_runs.size() / 2));
+        for (size_t i = 0, sz = _runs.size(); i < sz; i += 2)
+        {
+            os->write_uint16(_runs[i]);
+            os->write_uint16(_runs[i + 1] - _runs[i]);
+        }
+        break;
+    }
+
+    os->set_little_endian(le);
+}
+
+bool RoaringChunk::deserialize(InputStream *is)
+{
+    assert(nullptr != is);
+    clear();
+    if (is->readable_size() < 5)
+        return false;
+
+    const bool le = is->is_little_endian();
+    is->set_little_endian(true);
+
+    bool ok = false;
+    const uint8_t type = is->read_uint8();
+    const uint32_t size = is->read_uint32();
+    if (type == (uint8_t) Type::Array && size <= 65536 &&
+        is->readable_size() >= sizeof(uint16_t) * size)
+    {
+        _array.reserve(size);
+        ok = true;
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            const uint16_t v = is->read_uint16();
+            if (!_array.empty() && v <= _array.back())
+                ok = false;
+            _array.push_back(v);
+        }
+        _type = Type::Array;
+    }
+    else if (type == (uint8_t) Type::Bitmap &&
+             is->readable_size() >= sizeof(uint64_t) * BITMAP_WORDS)
+    {
+        _bitmap.resize(BITMAP_WORDS);
+        for (size_t i = 0; i < BITMAP_WORDS; ++i)
+            _bitmap[i] = is->read_uint64();
+        _type = Type::Bitmap;
+        ok = (count_bits(_bitmap.data(), BITMAP_WORDS) == size);
+    }
+    else if (type == (uint8_t) Type::Run && is->readable_size() >= sizeof(uint16_t))
+    {
+        const size_t nruns = is->read_uint16();
+        if (is->readable_size() >= sizeof(uint16_t) * 2 * nruns)
+        {
+            _runs.reserve(2 * nruns);
+            ok = true;
+            size_t total = 0;
+            for (size_t i = 0; i < nruns; ++i)
+            {
+                const uint16_t first = is->read_uint16(), len = is->read_uint16();
+                // 区间之间必须有间隔, 不能相邻或者重叠
+                if ((uint32_t) first + len > 65535 ||
+                    (!_runs.empty() && first <= (uint32_t) _runs.back() + 1))
+                    ok = false;
+                _runs.push_back(first);
+                _runs.push_back((uint16_t) (first + len));
+                total += (size_t) len + 1;
+            }
+            ok = ok && (total == size);
+            _type = Type::Run;
+        }
+    }
+
+    is->set_little_endian(le);
+    if (!ok)
+    {
+        clear();
+        return false;
+    }
+    _size = size;
+    return true;
+}
+
+RoaringChunk RoaringChunk::combine(const RoaringChunk& a, const RoaringChunk& b, Op op) noexcept
+{
+    // 空集
+    if (a.empty() || b.empty())
+    {
+        if (Op::And == op)
+            return RoaringChunk();
+        if (b.empty())
+            return a;
+        return Op::AndNot == op ? RoaringChunk() : b;
+    }
+
+    if (Type::Run == a._type && Type::Run == b._type)
+        return combine_runs(a, b, op);
+    if (Type::Array == a._type && Type::Array == b._type)
+        return combine_arrays(a, b, op);
+
+    // 结果不会多于 Array 的元素, 直接按 Array 过滤
+    if (Type::Array == a._type && (Op::And == op || Op::AndNot == op))
+        return filter_array(a, b, Op::And == op);
+    if (Type::Array == b._type && Op::And == op)
+        return filter_array(b, a, true);
+
+    return combine_bitmaps(a, b, op);
+}
+
+RoaringChunk RoaringChunk::combine_arrays(const RoaringChunk& a, const RoaringChunk& b, Op op) noexcept
+{
+    assert(Type::Array == a._type && Type::Array == b._type);
+    RoaringChunk ret;
+    std::vector<uint16_t>& out = ret._array;
+    switch (op)
+    {
+    case Op::Or:
+        out.reserve(a._array.size() + b._array.size());
+        std::set_union(a._array.begin(), a._array.end(), b._array.begin(), b._array.end(),
+                       std::back_inserter(out));
+        break;
+
+    case Op::And:
+        out.reserve(std::min(a._array.size(), b._array.size()));
+        std::set_intersection(a._array.begin(), a._array.end(), b._array.begin(), b._array.end(),
+                              std::back_inserter(out));
+        break;
+
+    case Op::AndNot:
+        out.reserve(a._array.size());
+        std::set_difference(a._array.begin(), a._array.end(), b._array.begin(), b._array.end(),
+                            std::back_inserter(out));
+        break;
+
+    case Op::Xor:
+        out.reserve(a._array.size() + b._array.size());
+        std::set_symmetric_difference(a._array.begin(), a._array.end(),
+                                      b._array.begin(), b._array.end(),
+                                      std::back_inserter(out));
+        break;
+    }
+    ret._size = (uint32_t) out.size();
+    ret.optimize();
+    return ret;
+}
+
+RoaringChunk RoaringChunk::combine_runs(const RoaringChunk& a, const RoaringChunk& b, Op op) noexcept
+{
+    assert(Type::Run == a._type && Type::Run == b._type);
+
+    // 区间端点扫描, 区间按半开区间 [first, last + 1) 处理
+    RoaringChunk ret;
+    ret._type = Type::Run;
+    const size_t na = a._runs.size(), nb = b._runs.size();
+    size_t i = 0, j = 0;
+    bool in_a = false, in_b = false, in_ret = false;
+    uint32_t start = 0;
+    while (i < na || j < nb)
+    {
+        const uint32_t pa = (i >= na ? 0x10000 + 1 : a._runs[i] + (i % 2)),
+            pb = (j >= nb ? 0x10000 + 1 : b._runs[j] + (j % 2));
+        const uint32_t p = std::min(pa, pb);
+        if (pa == p)
+        {
+            in_a = !in_a;
+            ++i;
+        }
+        if (pb == p)
+        {
+            in_b = !in_b;
+            ++j;
+        }
+
+        bool r = false;
+        switch (op)
+        {
+        case Op::Or:
+            r = in_a || in_b;
+            break;
+
+        case Op::And:
+            r = in_a && in_b;
+            break;
+
+        case Op::AndNot:
+            r = in_a && !in_b;
+            break;
+
+        case Op::Xor:
+            r = in_a != in_b;
+            break;
+        }
+
+        if (r != in_ret)
+        {
+            if (r)
+            {
+                start = p;
+            }
+            else
+            {
+                ret._runs.push_back((uint16_t) start);
+                ret._runs.push_back((uint16_t) (p - 1));
+                ret._size += p - start;
+            }
+            in_ret = r;
+        }
+    }
+    assert(!in_ret);
+    ret.optimize();
+    return ret;
+}
+
+RoaringChunk RoaringChunk::combine_bitmaps(const RoaringChunk& a, const RoaringChunk& b, Op op) noexcept
+{
+    RoaringChunk ret;
+    ret._type = Type::Bitmap;
+    ret._bitmap.resize(BITMAP_WORDS);
+    uint64_t *const rw = ret._bitmap.data();
+    a.to_words(rw);
+
+    uint64_t local[BITMAP_WORDS];
+    const uint64_t *bw = nullptr;
+    if (Type::Bitmap == b._type)
+    {
+        bw = b._bitmap.data();
+    }
+    else
+    {
+        b.to_words(local);
+        bw = local;
+    }
+
+    size_t i = 0;
+#if NUT_PLATFORM_SSE2
+    switch (op)
+    {
+    case Op::Or:
+        for (; i + 2 <= BITMAP_WORDS; i += 2)
+            _mm_storeu_si128((__m128i*) (rw + i),
+                             _mm_or_si128(_mm_loadu_si128((const __m128i*) (rw + i)),
+                                          _mm_loadu_si128((const __m128i*) (bw + i))));
+        break;
+
+    case Op::And:
+        for (; i + 2 <= BITMAP_WORDS; i += 2)
+            _mm_storeu_si128((__m128i*) (rw + i),
+                             _mm_and_si128(_mm_loadu_si128((const __m128i*) (rw + i)),
+                                           _mm_loadu_si128((const __m128i*) (bw + i))));
+        break;
+
+    case Op::AndNot:
+        // NOTE _mm_andnot_si128(x, y) 计算的是 (~x & y)
+        for (; i + 2 <= BITMAP_WORDS; i += 2)
+            _mm_storeu_si128((__m128i*) (rw + i),
+                             _mm_andnot_si128(_mm_loadu_si128((const __m128i*) (bw + i)),
+                                              _mm_loadu_si128((const __m128i*) (rw + i))));
+        break;
+
+    case Op::Xor:
+        for (; i + 2 <= BITMAP_WORDS; i += 2)
+            _mm_storeu_si128((__m128i*) (rw + i),
+                             _mm_xor_si128(_mm_loadu_si128((const __m128i*) (rw + i)),
+                                           _mm_loadu_si128((const __m128i*) (bw + i))));
+        break;
+    }
+#endif
+    for (; i < BITMAP_WORDS; ++i)
+    {
+        switch (op)
+        {
+        case Op::Or:
+            rw[i] |= bw[i];
+            break;
+
+        case Op::And:
+            rw[i] &= bw[i];
+            break;
+
+        case Op::AndNot:
+            rw[i] &= ~bw[i];
+            break;
+
+        case Op::Xor:
+            rw[i] ^= bw[i];
+            break;
+        }
+    }
+
+    ret._size = (uint32_t) count_bits(rw, BITMAP_WORDS);
+    ret.optimize();
+    return ret;
+}
+
+RoaringChunk RoaringChunk::filter_array(const RoaringChunk& arr, const RoaringChunk& x, bool keep) noexcept
+{
+    assert(Type::Array == arr._type);
+    RoaringChunk ret;
+    for (size_t i = 0, sz = arr._array.size(); i < sz; ++i)
+    {
+        if (x.contains(arr._array[i]) == keep)
+            ret._array.push_back(arr._array[i]);
+    }
+    ret._size = (uint32_t) ret._array.size();
+    ret.optimize();
+    return ret;
+}
+
+size_t RoaringChunk::count_runs() const noexcept
+{
+    switch (_type)
+    {
+    case Type::Array:
+    {
+        size_t ret = 0;
+        for (size_t i = 0, sz = _array.size(); i < sz; ++i)
+        {
+            if (0 == i || _array[i] != _array[i - 1] + 1)
+                ++ret;
+        }
+        return ret;
+    }
+
+    case Type::Bitmap:
+    {
+        // 区间起点即左侧相邻比特为 0 的 1
+        size_t ret = 0;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < BITMAP_WORDS; ++i)
+        {
+            const uint64_t word = _bitmap[i];
+            ret += bit1_count(word & ~((word << 1) | carry));
+            carry = word >> 63;
+        }
+        return ret;
+    }
+
+    case Type::Run:
+        return _runs.size() / 2;
+    }
+    return 0;
+}
+
+void RoaringChunk::to_words(uint64_t *words) const noexcept
+{
+    assert(nullptr != words);
+    if (Type::Bitmap == _type)
+    {
+        ::memcpy(words, _bitmap.data(), sizeof(uint64_t) * BITMAP_WORDS);
+        return;
+    }
+
+    ::memset(words, 0, sizeof(uint64_t) * BITMAP_WORDS);
+    if (Type::Array == _type)
+    {
+        for (size_t i = 0, sz = _array.size(); i < sz; ++i)
+            words[_array[i] / 64] |= ((uint64_t) 1) << (_array[i] % 64);
+    }
+    else
+    {
+        for (size_t i = 0, sz = _runs.size(); i < sz; i += 2)
+            set_bits(words, _runs[i], _runs[i + 1], true);
+    }
+}
+
+void RoaringChunk::convert_to_array() noexcept
+{
+    if (Type::Array == _type)
+        return;
+
+    std::vector<uint16_t> arr;
+    arr.reserve(_size);
+    visit_ranges([&] (uint16_t first, uint16_t last) {
+            for (uint32_t v = first; v <= last; ++v)
+                arr.push_back((uint16_t) v);
+            return true;
+        });
+    _array = std::move(arr);
+    _bitmap.clear();
+    _bitmap.shrink_to_fit();
+    _runs.clear();
+    _runs.shrink_to_fit();
+    _type = Type::Array;
+}
+
+void RoaringChunk::convert_to_bitmap() noexcept
+{
+    if (Type::Bitmap == _type)
+        return;
+
+    _bitmap.resize(BITMAP_WORDS);
+    to_words(_bitmap.data());
+    _array.clear();
+    _array.shrink_to_fit();
+    _runs.clear();
+    _runs.shrink_to_fit();
+    _type = Type::Bitmap;
+}
+
+void RoaringChunk::convert_to_run() noexcept
+{
+    if (Type::Run == _type)
+        return;
+
+    std::vector<uint16_t> runs;
+    visit_ranges([&] (uint16_t first, uint16_t last) {
+            runs.push_back(first);
+            runs.push_back(last);
+            return true;
+        });
+    _runs = std::move(runs);
+    _array.clear();
+    _array.shrink_to_fit();
+    _bitmap.clear();
+    _bitmap.shrink_to_fit();
+    _type = Type::Run;
+}
+
+void RoaringChunk::adjust_after_update() noexcept
+{
+    switch (_type)
+    {
+    case Type::Array:
+        if (_size > ARRAY_MAX_SIZE)
+            convert_to_bitmap();
+        break;
+
+    case Type::Bitmap:
+        if (_size <= ARRAY_MAX_SIZE)
+            convert_to_array();
+        break;
+
+    case Type::Run:
+        // 区间表示不再划算时退化
+        if (sizeof(uint16_t) * _runs.size() >
+            std::min(sizeof(uint16_t) * _size, sizeof(uint64_t) * BITMAP_WORDS))
+        {
+            if (_size <= ARRAY_MAX_SIZE)
+                convert_to_array();
+            else
+                convert_to_bitmap();
+        }
+        break;
+    }
+}
+
+size_t RoaringChunk::run_lower_bound(uint32_t value) const noexcept
+{
+    size_t left = 0, right = _runs.size() / 2;
+    while (left < right)
+    {
+        const size_t mid = (left + right) / 2;
+        if (_runs[2 * mid + 1] < value)
+            left = mid + 1;
+        else
+            right = mid;
+    }
+    return left;
+}
+
+void RoaringChunk::run_add_range(uint16_t first, uint16_t last) noexcept
+{
+    assert(Type::Run == _type && first <= last);
+
+    // 与 [first - 1, last + 1] 有交集的区间都需要合并
+    const size_t i1 = run_lower_bound(0 == first ? 0 : first - 1);
+    size_t i2 = i1;
+    uint32_t new_first = first, new_last = last;
+    while (2 * i2 < _runs.size() && _runs[2 * i2] <= (uint32_t) last + 1)
+    {
+        new_first = std::min<uint32_t>(new_first, _runs[2 * i2]);
+        new_last = std::max<uint32_t>(new_last, _runs[2 * i2 + 1]);
+        ++i2;
+    }
+
+    _runs.erase(_runs.begin() + 2 * i1, _runs.begin() + 2 * i2);
+    const uint16_t rg[2] = {(uint16_t) new_first, (uint16_t) new_last};
+    _runs.insert(_runs.begin() + 2 * i1, rg, rg + 2);
+
+    _size = 0;
+    for (size_t i = 0, sz = _runs.size(); i < sz; i += 2)
+        _size += (uint32_t) _runs[i + 1] - _runs[i] + 1;
+}
+
+void RoaringChunk::run_remove_range(uint16_t first, uint16_t last) noexcept
+{
+    assert(Type::Run == _type && first <= last);
+
+    const size_t i1 = run_lower_bound(first);
+    size_t i2 = i1;
+    while (2 * i2 < _runs.size() && _runs[2 * i2] <= last)
+        ++i2;
+    if (i1 == i2)
+        return;
+
+    // 首尾区间可能只被部分移除
+    std::vector<uint16_t> keep;
+    if (_runs[2 * i1] < first)
+    {
+        keep.push_back(_runs[2 * i1]);
+        keep.push_back(first - 1);
+    }
+    if (_runs[2 * i2 - 1] > last)
+    {
+        keep.push_back(last + 1);
+        keep.push_back(_runs[2 * i2 - 1]);
+    }
+    _runs.erase(_runs.begin() + 2 * i1, _runs.begin() + 2 * i2);
+    _runs.insert(_runs.begin() + 2 * i1, keep.begin(), keep.end());
+
+    _size = 0;
+    for (size_t i = 0, sz = _runs.size(); i < sz; i += 2)
+        _size += (uint32_t) _runs[i + 1] - _runs[i] + 1;
+}
+
+}
@@ -0,0 +1,257 @@
+﻿
+#ifndef ___HEADFILE_5E2A7C41_0B8D_4F36_9A1E_C47D2B93F610_
+#define ___HEADFILE_5E2A7C41_0B8D_4F36_9A1E_C47D2B93F610_
+
+#include <assert.h>
+#include <stdint.h>
+#include <vector>
+
+#include "../nut_config.h"
+#include "bytestream/input_stream.h"
+#include "bytestream/output_stream.h"
+
+
+namespace nut
+{
+
+/**
+ * Roaring bitmap 中的一个块, 存放 [0, 65535] 中的整数集合
+ *
+ * 有三种表示:
+ * - Array  有序的 uint16_t 数组, 用于稀疏的块(元素个数 <= 4096)
+ * - Bitmap 65536 比特的位图, 用于稠密的块
+ * - Run    有序的 [first, last] 区间数组, 用于连续的块
+ *
+ * 区间操作和集合运算之后会自动转换为占用空间最小的表示; 单个元素的增删只在
+ * Array / Bitmap 之间按元素个数切换, 以免频繁扫描
+ */
+class NUT_API RoaringChunk
+{
+public:
+    enum class Type : uint8_t
+    {
+        Array = 0,
+        Bitmap = 1,
+        Run = 2
+    };
+
+    /* Array 表示的最大元素个数, 超出后 Bitmap 更节省空间 */
+    static constexpr size_t ARRAY_MAX_SIZE = 4096;
+
+    /* Bitmap 的 64 位字数 */
+    static constexpr size_t BITMAP_WORDS = 65536 / 64;
+
+public:
+    RoaringChunk() = default;
+
+    /**
+     * 包含 [first, last] 所有值的块
+     */
+    RoaringChunk(uint16_t first, uint16_t last) noexcept;
+
+    RoaringChunk(RoaringChunk&& x) noexcept;
+    RoaringChunk(const RoaringChunk& x) = default;
+
+    RoaringChunk& operator=(RoaringChunk&& x) noexcept;
+    RoaringChunk& operator=(const RoaringChunk& x) = default;
+
+    bool operator==(const RoaringChunk& x) const noexcept;
+    bool operator!=(const RoaringChunk& x) const noexcept;
+
+    /**
+     * 按元素序列的字典序比较
+     */
+    int compare(const RoaringChunk& x) const noexcept;
+
+    RoaringChunk operator|(const RoaringChunk& x) const noexcept;
+    RoaringChunk operator&(const RoaringChunk& x) const noexcept;
+    RoaringChunk operator-(const RoaringChunk& x) const noexcept;
+    RoaringChunk operator^(const RoaringChunk& x) const noexcept;
+
+    Type type() const noexcept
+    {
+        return _type;
+    }
+
+    /**
+     * 元素个数, [0, 65536]
+     */
+    size_t size() const noexcept
+    {
+        return _size;
+    }
+
+    bool empty() const noexcept
+    {
+        return 0 == _size;
+    }
+
+    void clear() noexcept;
+
+    bool contains(uint16_t value) const noexcept;
+
+    /**
+     * @return 原来不存在而被加入则返回 true
+     */
+    bool add(uint16_t value) noexcept;
+
+    /**
+     * @return 原来存在而被移除则返回 true
+     */
+    bool remove(uint16_t value) noexcept;
+
+    void add_range(uint16_t first, uint16_t last) noexcept;
+    void remove_range(uint16_t first, uint16_t last) noexcept;
+
+    /**
+     * 块非空时有效
+     */
+    uint16_t first_value() const noexcept;
+    uint16_t last_value() const noexcept;
+
+    /**
+     * @return 第一个 >= value 的元素, 没有则返回 -1
+     */
+    int32_t next_value(uint32_t value) const noexcept;
+
+    /**
+     * @return 最后一个 <= value 的元素, 没有则返回 -1
+     */
+    int32_t prev_value(int32_t value) const noexcept;
+
+    /**
+     * @return < value 的元素个数
+     */
+    size_t rank(uint16_t value) const noexcept;
+
+    /**
+     * @param index 0-based, 必须 < size()
+     */
+    uint16_t select(size_t index) const noexcept;
+
+    /**
+     * 转换为占用空间最小的表示
+     */
+    void optimize() noexcept;
+
+    /**
+     * 占用的数据字节数(不含对象本身)
+     */
+    size_t memory_size() const noexcept;
+
+    /**
+     * 按区间访问所有元素
+     *
+     * @param visitor 形如 bool visitor(uint16_t first, uint16_t last), 返回 false 则停止
+     */
+    template <typename VISITOR>
+    void visit_ranges(VISITOR&& visitor) const
+    {
+        switch (_type)
+        {
+        case Type::Array:
+            for (size_t i = 0, sz = _array.size(); i < sz;)
+            {
+                size_t j = i + 1;
+                while (j < sz && _array[j] == _array[j - 1] + 1)
+                    ++j;
+                if (!visitor(_array[i], _array[j - 1]))
+                    return;
+                i = j;
+            }
+            break;
+
+        case Type::Bitmap:
+        {
+            int32_t v = next_value(0);
+            while (v >= 0)
+            {
+                const int32_t last = next_absent(v) - 1;
+                if (!visitor((uint16_t) v, (uint16_t) last))
+                    return;
+                v = next_value(last + 1);
+            }
+            break;
+        }
+
+        case Type::Run:
+            for (size_t i = 0, sz = _runs.size(); i < sz; i += 2)
+            {
+                if (!visitor(_runs[i], _runs[i + 1]))
+                    return;
+            }
+            break;
+        }
+    }
+
+    /**
+     * 按可移植的格式(小端序)序列化
+     *
+     * 格式: uint8 类型, uint32 元素个数, 然后
+     * - Array:  元素个数个 uint16
+     * - Bitmap: 1024 个 uint64
+     * - Run:    uint16 区间个数, 每个区间为 uint16 起点 + uint16 (长度-1)
+     */
+    void serialize(OutputStream *os) const;
+
+    /**
+     * @return 数据格式错误则返回 false, 同时块被清空
+     */
+    bool deserialize(InputStream *is);
+
+private:
+    enum class Op
+    {
+        Or,
+        And,
+        AndNot,
+        Xor
+    };
+
+    static RoaringChunk combine(const RoaringChunk& a, const RoaringChunk& b, Op op) noexcept;
+    static RoaringChunk combine_arrays(const RoaringChunk& a, const RoaringChunk& b, Op op) noexcept;
+    static RoaringChunk combine_runs(const RoaringChunk& a, const RoaringChunk& b, Op op) noexcept;
+    static RoaringChunk combine_bitmaps(const RoaringChunk& a, const RoaringChunk& b, Op op) noexcept;
+    static RoaringChunk filter_array(const RoaringChunk& arr, const RoaringChunk& x, bool keep) noexcept;
+
+    /**
+     * @return 第一个 >= value 且不在集合中的值, 可能是 65536
+     */
+    int32_t next_absent(int32_t value) const noexcept;
+
+    size_t count_runs() const noexcept;
+
+    /**
+     * 写出 Bitmap 表示到 words 中, words 长度为 BITMAP_WORDS
+     */
+    void to_words(uint64_t *words) const noexcept;
+
+    void convert_to_array() noexcept;
+    void convert_to_bitmap() noexcept;
+    void convert_to_run() noexcept;
+
+    /**
+     * 单个元素增删后, 在 Array / Bitmap 间切换
+     */
+    void adjust_after_update() noexcept;
+
+    void run_add_range(uint16_t first, uint16_t last) noexcept;
+    void run_remove_range(uint16_t first, uint16_t last) noexcept;
+
+    /**
+     * @return 第一个 last >= value 的区间下标(以区间计), 没有则返回区间个数
+     */
+    size_t run_lower_bound(uint32_t value) const noexcept;
+
+private:
+    Type _type = Type::Array;
+    uint32_t _size = 0;
+
+    std::vector<uint16_t> _array; // Array 表示
+    std::vector<uint64_t> _bitmap; // Bitmap 表示
+    std::vector<uint16_t> _runs; // Run 表示, 依次存放各区间的 first, last
+};
+
+}
+
+#endif
@@ -0,0 +1,742 @@
+﻿
+#ifndef ___HEADFILE_A83D1F6C_27E4_4B59_8C0A_3F9E6D52B71E_
+#define ___HEADFILE_A83D1F6C_27E4_4B59_8C0A_3F9E6D52B71E_
+
+#include <assert.h>
+#include <stddef.h> // for ptrdiff_t
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <iterator>
+#include <algorithm> // for std::lower_bound() and so on
+#include <type_traits>
+
+#include "../platform/int_type.h" // for ssize_t in windows VC
+#include "../util/string/to_string.h"
+#include "bytestream/input_stream.h"
+#include "bytestream/output_stream.h"
+#include "roaring_chunk.h"
+
+
+namespace nut
+{
+
+/**
+ * An ascending set of integers, Roaring bitmap style
+ *
+ * 整数按高位分块, 每 65536 个值为一块, 块内按稀疏程度选择 Array / Bitmap / Run
+ * 表示(见 RoaringChunk). 与 IntegerSet 接口相同, 对于稀疏分散的整数, 插入删除
+ * 不需要移动整个区间数组; 对于稠密的连续区间, IntegerSet 更节省空间
+ *
+ * NOTE 跨越很多块的 add_value_range() 会为每一块创建一个 Run 表示的块
+ */
+template <typename Integral = int>
+class RoaringIntegerSet
+{
+private:
+    typedef RoaringIntegerSet<Integral> self_type;
+
+public:
+    typedef typename std::enable_if<std::is_integral<Integral>::value,Integral>::type int_type;
+
+private:
+    typedef typename std::make_unsigned<int_type>::type uint_type;
+    typedef typename std::conditional<(sizeof(int_type) > 4), uint64_t, uint32_t>::type key_type;
+
+    /* 有符号数翻转符号位后, 无符号数的大小顺序与原来一致 */
+    static constexpr uint_type SIGN_FLIP = std::is_signed<int_type>::value ?
+        (uint_type) (((uint_type) 1) << (sizeof(uint_type) * 8 - 1)) : 0;
+
+    /* 序列化格式标识 */
+    static constexpr uint32_t MAGIC = 0x52415253; // "SRAR"
+
+public:
+    class const_iterator
+    {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef int_type                        value_type;
+        typedef ptrdiff_t                       difference_type;
+        typedef int_type                        reference;       // FIXME 这里实际上无法返回引用
+        typedef int_type*                       pointer;
+
+    public:
+        const_iterator(const self_type *container, ssize_t index, uint16_t low) noexcept
+            : _container(container), _index(index), _low(low)
+        {
+            assert(nullptr != _container);
+        }
+
+        int_type operator*() const noexcept
+        {
+            assert(nullptr != _container);
+            assert(0 <= _index && _index < (ssize_t) _container->_chunks.size());
+            return make_value(_container->_keys[_index], _low);
+        }
+
+        const_iterator& operator++() noexcept
+        {
+            assert(nullptr != _container);
+            assert(0 <= _index && _index < (ssize_t) _container->_chunks.size());
+
+            const int32_t next = _container->_chunks[_index].next_value((uint32_t) _low + 1);
+            if (next >= 0)
+            {
+                _low = (uint16_t) next;
+            }
+            else
+            {
+                ++_index;
+                if (_index < (ssize_t) _container->_chunks.size())
+                    _low = _container->_chunks[_index].first_value();
+            }
+            return *this;
+        }
+
+        const_iterator& operator--() noexcept
+        {
+            assert(nullptr != _container);
+            assert(0 <= _index && _index <= (ssize_t) _container->_chunks.size());
+
+            const int32_t prev = (_index < (ssize_t) _container->_chunks.size() ?
+                                  _container->_chunks[_index].prev_value((int32_t) _low - 1) : -1);
+            if (prev >= 0)
+            {
+                _low = (uint16_t) prev;
+            }
+            else
+            {
+                --_index;
+                if (_index >= 0)
+                    _low = _container->_chunks[_index].last_value();
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) noexcept
+        {
+            const_iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        const_iterator operator--(int) noexcept
+        {
+            const_iterator ret = *this;
+            --*this;
+            return ret;
+        }
+
+        bool operator==(const const_iterator& x) const noexcept
+        {
+            assert(nullptr != _container && _container == x._container);
+            if (_index != x._index)
+                return false;
+            if (0 <= _index && _index < (ssize_t) _container->_chunks.size())
+                return _low == x._low;
+            return true;
+        }
+
+        bool operator!=(const const_iterator& x) const noexcept
+        {
+            return !(*this == x);
+        }
+
+    private:
+        const self_type *_container = nullptr;
+        ssize_t _index = 0;
+        uint16_t _low = 0;
+    };
+
+public:
+    RoaringIntegerSet() = default;
+
+    RoaringIntegerSet(RoaringIntegerSet&& x) noexcept
+        : _keys(std::move(x._keys)), _chunks(std::move(x._chunks))
+    {}
+
+    RoaringIntegerSet(const RoaringIntegerSet& x) = default;
+
+    RoaringIntegerSet& operator=(RoaringIntegerSet&& x) noexcept
+    {
+        _keys = std::move(x._keys);
+        _chunks = std::move(x._chunks);
+        return *this;
+    }
+
+    RoaringIntegerSet& operator=(const RoaringIntegerSet& x) = default;
+
+    bool operator==(const self_type& x) const noexcept
+    {
+        if (this == &x)
+            return true;
+        return _keys == x._keys && _chunks == x._chunks;
+    }
+
+    bool operator!=(const self_type& x) const noexcept
+    {
+        return !(*this == x);
+    }
+
+    bool operator<(const self_type& x) const noexcept
+    {
+        return compare(x) < 0;
+    }
+
+    bool operator>(const self_type& x) const noexcept
+    {
+        return x < *this;
+    }
+
+    bool operator<=(const self_type& x) const noexcept
+    {
+        return !(x < *this);
+    }
+
+    bool operator>=(const self_type& x) const noexcept
+    {
+        return !(*this < x);
+    }
+
+    /**
+     * 求并集
+     */
+    self_type operator+(const self_type& x) const noexcept
+    {
+        return *this | x;
+    }
+
+    /**
+     * 求补集
+     */
+    self_type operator-(const self_type& x) const noexcept
+    {
+        return combine(*this, x, true, false,
+                       [] (const RoaringChunk& a, const RoaringChunk& b) { return a - b; });
+    }
+
+    /**
+     * 求并集
+     */
+    self_type operator|(const self_type& x) const noexcept
+    {
+        return combine(*this, x, true, true,
+                       [] (const RoaringChunk& a, const RoaringChunk& b) { return a | b; });
+    }
+
+    /**
+     * 求交集
+     */
+    self_type operator&(const self_type& x) const noexcept
+    {
+        return combine(*this, x, false, false,
+                       [] (const RoaringChunk& a, const RoaringChunk& b) { return a & b; });
+    }
+
+    /**
+     * 求两集合相互补集的并集
+     */
+    self_type operator^(const self_type& x) const noexcept
+    {
+        return combine(*this, x, true, true,
+                       [] (const RoaringChunk& a, const RoaringChunk& b) { return a ^ b; });
+    }
+
+    self_type& operator+=(const self_type& x) noexcept
+    {
+        *this = *this | x;
+        return *this;
+    }
+
+    self_type& operator-=(const self_type& x) noexcept
+    {
+        *this = *this - x;
+        return *this;
+    }
+
+    self_type& operator|=(const self_type& x) noexcept
+    {
+        *this = *this | x;
+        return *this;
+    }
+
+    self_type& operator&=(const self_type& x) noexcept
+    {
+        *this = *this & x;
+        return *this;
+    }
+
+    self_type& operator^=(const self_type& x) noexcept
+    {
+        *this = *this ^ x;
+        return *this;
+    }
+
+    /**
+     * 按元素序列的字典序比较, 与 IntegerSet::compare() 一致
+     */
+    int compare(const self_type& x) const noexcept
+    {
+        if (this == &x)
+            return 0;
+
+        // 跳过相同的块
+        size_t i = 0;
+        const size_t lsz = _chunks.size(), rsz = x._chunks.size();
+        while (i < lsz && i < rsz && _keys[i] == x._keys[i] && _chunks[i] == x._chunks[i])
+            ++i;
+        if (i >= lsz || i >= rsz)
+            return i < lsz ? 1 : (i < rsz ? -1 : 0);
+        if (_keys[i] != x._keys[i])
+            return _keys[i] < x._keys[i] ? -1 : 1;
+
+        // 逐个元素比较
+        const_iterator iter1(this, i, _chunks[i].first_value()), end1 = end(),
+            iter2(&x, i, x._chunks[i].first_value()), end2 = x.end();
+        for (; iter1 != end1 && iter2 != end2; ++iter1, ++iter2)
+        {
+            const int_type v1 = *iter1, v2 = *iter2;
+            if (v1 != v2)
+                return v1 < v2 ? -1 : 1;
+        }
+        return iter1 != end1 ? 1 : (iter2 != end2 ? -1 : 0);
+    }
+
+    void add_value(int_type value) noexcept
+    {
+        const uint_type u = to_unsigned(value);
+        get_or_create_chunk(key_of(u)).add(low_of(u));
+    }
+
+    void add_value_range(int_type first_value, int_type last_value) noexcept
+    {
+        assert(first_value <= last_value);
+        const uint_type first = to_unsigned(first_value), last = to_unsigned(last_value);
+        const key_type first_key = key_of(first), last_key = key_of(last);
+        for (key_type k = first_key; true; ++k)
+        {
+            const uint16_t lo = (k == first_key ? low_of(first) : 0),
+                hi = (k == last_key ? low_of(last) : (uint16_t) 0xffff);
+            RoaringChunk& chunk = get_or_create_chunk(k);
+            if (0 == lo && 0xffff == hi)
+                chunk = RoaringChunk(0, 0xffff);
+            else
+                chunk.add_range(lo, hi);
+
+            if (k == last_key)
+                break;
+        }
+    }
+
+    // 查询指定整数是否在该容器中
+    bool contains(int_type value) const noexcept
+    {
+        const uint_type u = to_unsigned(value);
+        const ssize_t i = index_of_key(key_of(u));
+        return i >= 0 && _chunks[i].contains(low_of(u));
+    }
+
+    void remove_value(int_type value) noexcept
+    {
+        const uint_type u = to_unsigned(value);
+        const ssize_t i = index_of_key(key_of(u));
+        if (i < 0)
+            return;
+        _chunks[i].remove(low_of(u));
+        if (_chunks[i].empty())
+            erase_chunks(i, i + 1);
+    }
+
+    void remove_value_range(int_type first_value, int_type last_value) noexcept
+    {
+        assert(first_value <= last_value);
+        const uint_type first = to_unsigned(first_value), last = to_unsigned(last_value);
+        const key_type first_key = key_of(first), last_key = key_of(last);
+
+        // 只需要处理已有的块
+        size_t i = std::lower_bound(_keys.begin(), _keys.end(), first_key) - _keys.begin();
+        size_t dst = i;
+        for (; i < _keys.size() && _keys[i] <= last_key; ++i)
+        {
+            const key_type k = _keys[i];
+            const uint16_t lo = (k == first_key ? low_of(first) : 0),
+                hi = (k == last_key ? low_of(last) : (uint16_t) 0xffff);
+            if (0 == lo && 0xffff == hi)
+                continue;
+            _chunks[i].remove_range(lo, hi);
+            if (_chunks[i].empty())
+                continue;
+
+            // 保留非空的块
+            if (dst != i)
+            {
+                _keys[dst] = k;
+                _chunks[dst] = std::move(_chunks[i]);
+            }
+            ++dst;
+        }
+        erase_chunks(dst, i);
+    }
+
+    void clear() noexcept
+    {
+        _keys.clear();
+        _chunks.clear();
+    }
+
+    size_t size_of_values() const noexcept
+    {
+        size_t ret = 0;
+        for (size_t i = 0, sz = _chunks.size(); i < sz; ++i)
+            ret += _chunks[i].size();
+        return ret;
+    }
+
+    bool empty() const noexcept
+    {
+        return _chunks.empty();
+    }
+
+    int_type get_first_value() const noexcept
+    {
+        assert(!_chunks.empty());
+        return make_value(_keys.front(), _chunks.front().first_value());
+    }
+
+    int_type get_last_value() const noexcept
+    {
+        assert(!_chunks.empty());
+        return make_value(_keys.back(), _chunks.back().last_value());
+    }
+
+    ssize_t index_of(int_type value) const noexcept
+    {
+        const uint_type u = to_unsigned(value);
+        const ssize_t i = index_of_key(key_of(u));
+        if (i < 0 || !_chunks[i].contains(low_of(u)))
+            return -1;
+
+        size_t index = 0;
+        for (ssize_t j = 0; j < i; ++j)
+            index += _chunks[j].size();
+        return index + _chunks[i].rank(low_of(u));
+    }
+
+    int_type value_at(size_t index) const noexcept
+    {
+        for (size_t i = 0, sz = _chunks.size(); i < sz; ++i)
+        {
+            if (index < _chunks[i].size())
+                return make_value(_keys[i], _chunks[i].select(index));
+            index -= _chunks[i].size();
+        }
+        // Index out of range
+        assert(false);
+        return 0;
+    }
+
+    const_iterator begin() const noexcept
+    {
+        if (_chunks.empty())
+            return const_iterator(this, 0, 0);
+        return const_iterator(this, 0, _chunks.front().first_value());
+    }
+
+    const_iterator end() const noexcept
+    {
+        return const_iterator(this, _chunks.size(), 0);
+    }
+
+    /**
+     * @return 指向第一个 >= value 的元素
+     */
+    const_iterator value_iterator(int_type value) const noexcept
+    {
+        const uint_type u = to_unsigned(value);
+        const key_type k = key_of(u);
+        size_t i = std::lower_bound(_keys.begin(), _keys.end(), k) - _keys.begin();
+        if (i < _keys.size() && _keys[i] == k)
+        {
+            const int32_t next = _chunks[i].next_value(low_of(u));
+            if (next >= 0)
+                return const_iterator(this, i, (uint16_t) next);
+            ++i;
+        }
+        if (i >= _chunks.size())
+            return end();
+        return const_iterator(this, i, _chunks[i].first_value());
+    }
+
+    /**
+     * 块的个数
+     */
+    size_t size_of_chunks() const noexcept
+    {
+        return _chunks.size();
+    }
+
+    const RoaringChunk& chunk_at(size_t index) const noexcept
+    {
+        return _chunks.at(index);
+    }
+
+    /**
+     * 将所有块转换为占用空间最小的表示
+     */
+    void optimize() noexcept
+    {
+        for (size_t i = 0, sz = _chunks.size(); i < sz; ++i)
+            _chunks[i].optimize();
+    }
+
+    std::string to_string() const noexcept
+    {
+        std::string s("{");
+        bool first_range = true;
+        visit_ranges([&] (int_type first, int_type last) {
+                if (!first_range)
+                    s.push_back(',');
+                first_range = false;
+                if (first == last)
+                {
+                    s += value_to_str(first);
+                }
+                else
+                {
+                    s.push_back('[');
+                    s += value_to_str(first);
+                    s.push_back(',');
+                    s += value_to_str(last);
+                    s.push_back(']');
+                }
+            });
+        s.push_back('}');
+        return s;
+    }
+
+    std::wstring to_wstring() const noexcept
+    {
+        const std::string s = to_string();
+        return std::wstring(s.begin(), s.end());
+    }
+
+    /**
+     * 按可移植的格式(小端序)序列化
+     *
+     * 格式: uint32 MAGIC, uint8 整数位数, uint32 块个数, 然后每块为 uint64 高位
+     * 键值 + RoaringChunk 序列化数据
+     */
+    void serialize(OutputStream *os) const
+    {
+        assert(nullptr != os);
+        const bool le = os->is_little_endian();
+        os->set_little_endian(true);
+        os->write_uint32(MAGIC);
+        os->write_uint8((uint8_t) (sizeof(int_type) * 8));
+        os->write_uint32((uint32_t) _chunks.size());
+        for (size_t i = 0, sz = _chunks.size(); i < sz; ++i)
+        {
+            os->write_uint64(_keys[i]);
+            _chunks[i].serialize(os);
+        }
+        os->set_little_endian(le);
+    }
+
+    /**
+     * @return 数据格式错误则返回 false, 同时集合被清空
+     */
+    bool deserialize(InputStream *is)
+    {
+        assert(nullptr != is);
+        clear();
+        if (is->readable_size() < 9)
+            return false;
+
+        const bool le = is->is_little_endian();
+        is->set_little_endian(true);
+        bool ok = (MAGIC == is->read_uint32() &&
+                   sizeof(int_type) * 8 == is->read_uint8());
+        const uint32_t count = (ok ? is->read_uint32() : 0);
+        for (uint32_t i = 0; ok && i < count; ++i)
+        {
+            if (is->readable_size() < sizeof(uint64_t))
+            {
+                ok = false;
+                break;
+            }
+            const uint64_t k = is->read_uint64();
+            RoaringChunk chunk;
+            ok = (k <= max_key() && (_keys.empty() || k > _keys.back()) &&
+                  chunk.deserialize(is) && !chunk.empty() &&
+                  (sizeof(int_type) >= 2 || chunk.last_value() <= (uint_type) ~(uint_type) 0));
+            if (ok)
+            {
+                _keys.push_back((key_type) k);
+                _chunks.push_back(std::move(chunk));
+            }
+        }
+        is->set_little_endian(le);
+
+        if (!ok)
+            clear();
+        return ok;
+    }
+
+private:
+    static uint_type to_unsigned(int_type v) noexcept
+    {
+        return ((uint_type) v) ^ SIGN_FLIP;
+    }
+
+    static key_type key_of(uint_type u) noexcept
+    {
+        return (key_type) (((uint64_t) u) >> 16);
+    }
+
+    static uint16_t low_of(uint_type u) noexcept
+    {
+        return (uint16_t) (u & 0xffff);
+    }
+
+    static key_type max_key() noexcept
+    {
+        return key_of((uint_type) ~(uint_type) 0);
+    }
+
+    static int_type make_value(key_type key, uint16_t low) noexcept
+    {
+        const uint_type u = (uint_type) ((((uint64_t) key) << 16) | low);
+        return (int_type) (u ^ SIGN_FLIP);
+    }
+
+    static std::string value_to_str(int_type v) noexcept
+    {
+        if (std::is_signed<int_type>::value)
+            return llong_to_str((long long) v);
+        return ullong_to_str((unsigned long long) v);
+    }
+
+    /**
+     * @return 找不到则返回 -1
+     */
+    ssize_t index_of_key(key_type k) const noexcept
+    {
+        const typename std::vector<key_type>::const_iterator iter =
+            std::lower_bound(_keys.begin(), _keys.end(), k);
+        if (iter == _keys.end() || *iter != k)
+            return -1;
+        return iter - _keys.begin();
+    }
+
+    RoaringChunk& get_or_create_chunk(key_type k) noexcept
+    {
+        const typename std::vector<key_type>::iterator iter =
+            std::lower_bound(_keys.begin(), _keys.end(), k);
+        const size_t i = iter - _keys.begin();
+        if (iter == _keys.end() || *iter != k)
+        {
+            _keys.insert(iter, k);
+            _chunks.emplace(_chunks.begin() + i);
+        }
+        return _chunks[i];
+    }
+
+    void erase_chunks(size_t begin, size_t end) noexcept
+    {
+        _keys.erase(_keys.begin() + begin, _keys.begin() + end);
+        _chunks.erase(_chunks.begin() + begin, _chunks.begin() + end);
+    }
+
+    /**
+     * 按区间访问所有元素, 跨越块边界的区间会被合并
+     *
+     * @param visitor 形如 void visitor(int_type first, int_type last)
+     */
+    template <typename VISITOR>
+    void visit_ranges(VISITOR&& visitor) const
+    {
+        bool has_range = false;
+        uint64_t range_first = 0, range_last = 0; // 无符号表示
+        for (size_t i = 0, sz = _chunks.size(); i < sz; ++i)
+        {
+            const uint64_t base = ((uint64_t) _keys[i]) << 16;
+            _chunks[i].visit_ranges([&] (uint16_t first, uint16_t last) {
+                    if (has_range && range_last + 1 == base + first)
+                    {
+                        range_last = base + last;
+                        return true;
+                    }
+                    if (has_range)
+                        visitor(unsigned_to_value(range_first), unsigned_to_value(range_last));
+                    has_range = true;
+                    range_first = base + first;
+                    range_last = base + last;
+                    return true;
+                });
+        }
+        if (has_range)
+            visitor(unsigned_to_value(range_first), unsigned_to_value(range_last));
+    }
+
+    static int_type unsigned_to_value(uint64_t u) noexcept
+    {
+        return (int_type) (((uint_type) u) ^ SIGN_FLIP);
+    }
+
+    /**
+     * 按键值归并两个集合的块
+     *
+     * @param keep_a 是否保留只在 a 中出现的块
+     * @param keep_b 是否保留只在 b 中出现的块
+     * @param op 形如 RoaringChunk op(const RoaringChunk&, const RoaringChunk&)
+     */
+    template <typename OP>
+    static self_type combine(const self_type& a, const self_type& b, bool keep_a,
+                             bool keep_b, OP&& op) noexcept
+    {
+        self_type ret;
+        size_t i = 0, j = 0;
+        const size_t asz = a._keys.size(), bsz = b._keys.size();
+        while (i < asz || j < bsz)
+        {
+            if (j >= bsz || (i < asz && a._keys[i] < b._keys[j]))
+            {
+                if (keep_a)
+                {
+                    ret._keys.push_back(a._keys[i]);
+                    ret._chunks.push_back(a._chunks[i]);
+                }
+                ++i;
+            }
+            else if (i >= asz || b._keys[j] < a._keys[i])
+            {
+                if (keep_b)
+                {
+                    ret._keys.push_back(b._keys[j]);
+                    ret._chunks.push_back(b._chunks[j]);
+                }
+                ++j;
+            }
+            else
+            {
+                RoaringChunk chunk = op(a._chunks[i], b._chunks[j]);
+                if (!chunk.empty())
+                {
+                    ret._keys.push_back(a._keys[i]);
+                    ret._chunks.push_back(std::move(chunk));
+                }
+                ++i;
+                ++j;
+            }
+        }
+        return ret;
+    }
+
+private:
+    std::vector<key_type> _keys; // 升序排列的高位键值
+    std::vector<RoaringChunk> _chunks; // 与 _keys 一一对应, 都不为空
+};
+
+}
+
+#endif
@@ -4,30 +4,51 @@
 #include <string.h> // for ::memcpy()
 #include <algorithm>
 
+#include "../../mem/lengthfixed_mp.h"
+#include "../../rc/rc_new.h"
 #include "fragment_buffer.h"
 
+#if !NUT_PLATFORM_OS_WINDOWS
+#   include <limits.h> // for IOV_MAX
+#   include <sys/uio.h> // for ::readv(), ::writev()
+#endif
 
-#define MIN_FRAGMENT_BUFFER_SIZE 64
+
+/* 从内存池分配的 fragment 的总大小 */
+#define POOLED_FRAGMENT_ALLOC_SIZE 4096
+
+/* 一次 writev() 最多使用的 fragment 个数 */
+#define MAX_WRITEV_FRAGMENTS 64
 
 namespace nut
 {
 
-FragmentBuffer::FragmentBuffer(FragmentBuffer&& x) noexcept
+const size_t FragmentBuffer::DEFAULT_FRAGMENT_CAPACITY =
+    POOLED_FRAGMENT_ALLOC_SIZE - sizeof(FragmentBuffer::Fragment) + 1;
+
+static size_t fragment_alloc_size(size_t capacity) noexcept
 {
-    _read_fragment = x._read_fragment;
-    _write_fragment = x._write_fragment;
-    _read_index = x._read_index;
-    _read_available = x._read_available;
+    return sizeof(FragmentBuffer::Fragment) + capacity - 1;
+}
+
+static memory_allocator* fragment_pool() noexcept
+{
+    // NOTE 有意不释放, 以免全局对象析构时内存池已经被销毁
+    static rc_ptr<lengthfixed_mtmp> *pool = new rc_ptr<lengthfixed_mtmp>(
+        rc_new<lengthfixed_mtmp>(POOLED_FRAGMENT_ALLOC_SIZE));
+    return pool->pointer();
+}
 
-    x._read_fragment = nullptr;
-    x._write_fragment = nullptr;
-    x._read_index = 0;
+FragmentBuffer::FragmentBuffer(FragmentBuffer&& x) noexcept
+    : _refs(std::move(x._refs)), _read_available(x._read_available)
+{
+    x._refs.clear();
     x._read_available = 0;
 }
 
 FragmentBuffer::FragmentBuffer(const FragmentBuffer& x) noexcept
 {
-    *this = x;
+    append(x);
 }
 
 FragmentBuffer::~FragmentBuffer() noexcept
@@ -42,14 +63,10 @@ FragmentBuffer& FragmentBuffer::operator=(FragmentBuffer&& x) noexcept
 
     clear();
 
-    _read_fragment = x._read_fragment;
-    _write_fragment = x._write_fragment;
-    _read_index = x._read_index;
+    _refs = std::move(x._refs);
     _read_available = x._read_available;
 
-    x._read_fragment = nullptr;
-    x._write_fragment = nullptr;
-    x._read_index = 0;
+    x._refs.clear();
     x._read_available = 0;
 
     return *this;
@@ -61,55 +78,61 @@ FragmentBuffer& FragmentBuffer::operator=(const FragmentBuffer& x) noexcept
         return *this;
 
     clear();
-
-    Fragment *p = x._read_fragment;
-    while (nullptr != p)
-    {
-        Fragment *new_frag = new_fragment(p->size);
-        assert(nullptr != new_frag);
-        ::memcpy(new_frag->buffer, p->buffer, p->size);
-        new_frag->size = p->size;
-
-        enqueue(new_frag);
-    }
-    _read_index = x._read_index;
-    _read_available = x._read_available;
+    append(x);
 
     return *this;
 }
 
-void FragmentBuffer::enqueue(Fragment *frag) noexcept
+void FragmentBuffer::enqueue(Fragment *frag, size_t offset, size_t length) noexcept
 {
-    assert(nullptr != frag && frag->capacity >= frag->size);
+    assert(nullptr != frag && offset + length <= frag->size && frag->size <= frag->capacity);
 
-    frag->next = nullptr;
-    if (nullptr == _write_fragment)
+    if (0 == length)
     {
-        _write_fragment = frag;
-        _read_fragment = frag;
-        _read_index = 0;
-        _read_available = frag->size;
+        delete_fragment(frag);
+        return;
     }
-    else
+
+    // 与最后一个引用相邻则合并, 例如 cut() 之后再 append() 回来
+    if (!_refs.empty())
     {
-        _write_fragment->next = frag;
-        _write_fragment = frag;
-        _read_available += frag->size;
+        FragmentRef& last = _refs.back();
+        if (last.fragment == frag && last.offset + last.length == offset)
+        {
+            last.length += length;
+            _read_available += length;
+            delete_fragment(frag);
+            return;
+        }
     }
+
+    FragmentRef ref;
+    ref.fragment = frag;
+    ref.offset = offset;
+    ref.length = length;
+    _refs.push_back(ref);
+    _read_available += length;
+}
+
+FragmentBuffer::Fragment* FragmentBuffer::appendable_fragment() const noexcept
+{
+    if (_refs.empty())
+        return nullptr;
+
+    // 只有独占且引用到已写入末尾时才能追加, 否则会改变其他引用者看到的数据
+    const FragmentRef& last = _refs.back();
+    Fragment *frag = last.fragment;
+    if (last.offset + last.length != frag->size || frag->size >= frag->capacity ||
+        1 != frag->ref_count.load(std::memory_order_acquire))
+        return nullptr;
+    return frag;
 }
 
 void FragmentBuffer::clear() noexcept
 {
-    Fragment *p = _read_fragment;
-    while (nullptr != p)
-    {
-        Fragment *next = p->next;
-        delete_fragment(p);
-        p = next;
-    }
-    _read_fragment = nullptr;
-    _write_fragment = nullptr;
-    _read_index = 0;
+    for (const FragmentRef& ref : _refs)
+        delete_fragment(ref.fragment);
+    _refs.clear();
     _read_available = 0;
 }
 
@@ -120,56 +143,22 @@ size_t FragmentBuffer::readable_size() const noexcept
 
 size_t FragmentBuffer::read(void *buf, size_t len) noexcept
 {
-    const size_t can_read = std::min(len, _read_available);
-    size_t readed = 0;
-    while (readed < can_read)
-    {
-        assert(nullptr != _read_fragment && _read_fragment->size >= _read_index);
-        const size_t can_read_once = std::min(_read_fragment->size - _read_index,
-                                              can_read - readed);
-        const bool full_read = (_read_fragment->size - _read_index <=
-                                can_read - readed);
-        ::memcpy((uint8_t*) buf + readed, _read_fragment->buffer + _read_index,
-                 can_read_once);
-        if (full_read)
-        {
-            Fragment *next = _read_fragment->next;
-            delete_fragment(_read_fragment);
-            _read_fragment = next;
-            if (nullptr == next)
-                _write_fragment = nullptr;
-            _read_index = 0;
-        }
-        else
-        {
-            _read_index += can_read_once;
-        }
-        readed += can_read_once;
-    }
-    assert(readed == can_read);
-    _read_available -= can_read;
-    return can_read;
+    assert(nullptr != buf || 0 == len);
+    const size_t readed = look_ahead(buf, len);
+    skip_read(readed);
+    return readed;
 }
 
 size_t FragmentBuffer::look_ahead(void *buf, size_t len) const noexcept
 {
     const size_t can_read = std::min(len, _read_available);
     size_t readed = 0;
-    Fragment *p = _read_fragment;
-    size_t read_index = _read_index;
-    while (readed < can_read)
+    for (size_t i = 0; readed < can_read; ++i)
     {
-        assert(nullptr != p && p->size >= read_index);
-        const size_t can_read_once = std::min(p->size - read_index,
-                                              can_read - readed);
-        const bool full_read = (p->size - read_index <= can_read - readed);
-        ::memcpy((uint8_t*) buf + readed, p->buffer + read_index,
-                 can_read_once);
-        if (full_read)
-        {
-            p = p->next;
-            read_index = 0;
-        }
+        assert(i < _refs.size());
+        const FragmentRef& ref = _refs[i];
+        const size_t can_read_once = std::min(ref.length, can_read - readed);
+        ::memcpy((uint8_t*) buf + readed, ref.fragment->buffer + ref.offset, can_read_once);
         readed += can_read_once;
     }
     assert(readed == can_read);
@@ -178,29 +167,25 @@ size_t FragmentBuffer::look_ahead(void *buf, size_t len) const noexcept
 
 size_t FragmentBuffer::skip_read(size_t len) noexcept
 {
-    size_t can_skip = std::min(len, _read_available);
+    const size_t can_skip = std::min(len, _read_available);
     size_t skiped = 0;
     while (skiped < can_skip)
     {
-        assert(nullptr != _read_fragment && _read_fragment->size >= _read_index);
-        const size_t can_skip_once = std::min(_read_fragment->size - _read_index,
-                                              can_skip - skiped);
-        const bool full_skip = (_read_fragment->size - _read_index <=
-                                can_skip - skiped);
-        if (full_skip)
+        assert(!_refs.empty());
+        FragmentRef& ref = _refs.front();
+        if (ref.length <= can_skip - skiped)
         {
-            Fragment *next = _read_fragment->next;
-            delete_fragment(_read_fragment);
-            _read_fragment = next;
-            if (nullptr == next)
-                _write_fragment = nullptr;
-            _read_index = 0;
+            skiped += ref.length;
+            delete_fragment(ref.fragment);
+            _refs.pop_front();
         }
         else
         {
-            _read_index += can_skip_once;
+            const size_t can_skip_once = can_skip - skiped;
+            ref.offset += can_skip_once;
+            ref.length -= can_skip_once;
+            skiped += can_skip_once;
         }
-        skiped += can_skip_once;
     }
     assert(skiped == can_skip);
     _read_available -= can_skip;
@@ -212,21 +197,12 @@ size_t FragmentBuffer::readable_pointers(const void **buf_ptrs, size_t *len_ptrs
 {
     assert(nullptr != buf_ptrs && nullptr != len_ptrs);
 
-    size_t buf_count = 0;
-    Fragment *p = _read_fragment;
-    size_t read_index = _read_index;
-    while (nullptr != p && buf_count < ptr_count)
+    const size_t buf_count = std::min(ptr_count, _refs.size());
+    for (size_t i = 0; i < buf_count; ++i)
     {
-        assert(p->size >= read_index);
-        *buf_ptrs = p->buffer + read_index;
-        *len_ptrs = p->size - read_index;
-
-        ++buf_ptrs;
-        ++len_ptrs;
-        ++buf_count;
-
-        p = p->next;
-        read_index = 0;
+        const FragmentRef& ref = _refs[i];
+        buf_ptrs[i] = ref.fragment->buffer + ref.offset;
+        len_ptrs[i] = ref.length;
     }
     return buf_count;
 }
@@ -238,11 +214,13 @@ void FragmentBuffer::write(const void *buf, size_t len) noexcept
         return;
 
     // 先写入一部分
-    if (nullptr != _write_fragment && _write_fragment->capacity > _write_fragment->size)
+    Fragment *tail = appendable_fragment();
+    if (nullptr != tail)
     {
-        const size_t can_write = std::min(_write_fragment->capacity - _write_fragment->size, len);
-        ::memcpy(_write_fragment->buffer + _write_fragment->size, buf, can_write);
-        _write_fragment->size += can_write;
+        const size_t can_write = std::min(tail->capacity - tail->size, len);
+        ::memcpy(tail->buffer + tail->size, buf, can_write);
+        tail->size += can_write;
+        _refs.back().length += can_write;
         _read_available += can_write;
         buf = ((const uint8_t*) buf) + can_write;
         len -= can_write;
@@ -251,45 +229,227 @@ void FragmentBuffer::write(const void *buf, size_t len) noexcept
         return;
 
     // 写入剩余部分
-    Fragment *frag = new_fragment(std::max(len, (size_t) MIN_FRAGMENT_BUFFER_SIZE));
+    Fragment *frag = new_fragment(std::max(len, DEFAULT_FRAGMENT_CAPACITY));
     ::memcpy(frag->buffer, buf, len);
     frag->size = len;
-    enqueue(frag);
+    enqueue(frag, 0, len);
 }
 
 FragmentBuffer::Fragment* FragmentBuffer::new_fragment(size_t capacity) noexcept
 {
     assert(capacity > 0);
-    Fragment* p = (Fragment*) ::malloc(sizeof(Fragment) + capacity - 1);
+    const size_t alloc_size = fragment_alloc_size(capacity);
+    Fragment *p;
+    if (POOLED_FRAGMENT_ALLOC_SIZE == alloc_size)
+        p = (Fragment*) fragment_pool()->alloc(alloc_size);
+    else
+        p = (Fragment*) ::malloc(alloc_size);
     assert(nullptr != p);
     new (p) Fragment(capacity);
     return p;
 }
 
+FragmentBuffer::Fragment* FragmentBuffer::retain_fragment(Fragment *frag) noexcept
+{
+    assert(nullptr != frag);
+    frag->ref_count.fetch_add(1, std::memory_order_relaxed);
+    return frag;
+}
+
 void FragmentBuffer::delete_fragment(Fragment *frag) noexcept
 {
     assert(nullptr != frag);
+    if (1 != frag->ref_count.fetch_sub(1, std::memory_order_acq_rel))
+        return;
+
+    const size_t alloc_size = fragment_alloc_size(frag->capacity);
     frag->~Fragment();
-    ::free(frag);
+    if (POOLED_FRAGMENT_ALLOC_SIZE == alloc_size)
+        fragment_pool()->free(frag, alloc_size);
+    else
+        ::free(frag);
 }
 
 FragmentBuffer::Fragment* FragmentBuffer::write_fragment(Fragment *frag) noexcept
 {
     assert(nullptr != frag && frag->size <= frag->capacity);
 
-    if (nullptr != _write_fragment &&
-        _write_fragment->capacity - _write_fragment->size >= frag->size)
+    Fragment *tail = appendable_fragment();
+    if (nullptr != tail && tail->capacity - tail->size >= frag->size)
     {
-        ::memcpy(_write_fragment->buffer + _write_fragment->size, frag->buffer,
-                 frag->size);
-        _write_fragment->size += frag->size;
+        ::memcpy(tail->buffer + tail->size, frag->buffer, frag->size);
+        tail->size += frag->size;
+        _refs.back().length += frag->size;
         _read_available += frag->size;
         frag->size = 0;
         return frag;
     }
 
-    enqueue(frag);
+    enqueue(frag, 0, frag->size);
     return nullptr;
 }
 
+FragmentBuffer FragmentBuffer::slice(size_t offset, size_t len) const noexcept
+{
+    FragmentBuffer ret;
+    if (offset >= _read_available)
+        return ret;
+    len = std::min(len, _read_available - offset);
+
+    for (size_t i = 0; len > 0; ++i)
+    {
+        assert(i < _refs.size());
+        const FragmentRef& ref = _refs[i];
+        if (offset >= ref.length)
+        {
+            offset -= ref.length;
+            continue;
+        }
+        const size_t once = std::min(ref.length - offset, len);
+        ret.enqueue(retain_fragment(ref.fragment), ref.offset + offset, once);
+        offset = 0;
+        len -= once;
+    }
+    return ret;
+}
+
+FragmentBuffer FragmentBuffer::cut(size_t len) noexcept
+{
+    FragmentBuffer ret;
+    len = std::min(len, _read_available);
+    _read_available -= len;
+    while (len > 0)
+    {
+        assert(!_refs.empty());
+        FragmentRef& ref = _refs.front();
+        if (ref.length <= len)
+        {
+            // 整个引用转移过去
+            len -= ref.length;
+            ret.enqueue(ref.fragment, ref.offset, ref.length);
+            _refs.pop_front();
+        }
+        else
+        {
+            // 在 fragment 中间拆分, 两边共享
+            ret.enqueue(retain_fragment(ref.fragment), ref.offset, len);
+            ref.offset += len;
+            ref.length -= len;
+            len = 0;
+        }
+    }
+    return ret;
+}
+
+void FragmentBuffer::append(FragmentBuffer&& x) noexcept
+{
+    if (this == &x)
+        return;
+
+    for (const FragmentRef& ref : x._refs)
+        enqueue(ref.fragment, ref.offset, ref.length);
+    x._refs.clear();
+    x._read_available = 0;
+}
+
+void FragmentBuffer::append(const FragmentBuffer& x) noexcept
+{
+    // NOTE 追加自身时, 合并相邻引用会修改正在遍历的引用
+    if (this == &x)
+    {
+        append(FragmentBuffer(x));
+        return;
+    }
+
+    for (const FragmentRef& ref : x._refs)
+        enqueue(retain_fragment(ref.fragment), ref.offset, ref.length);
+}
+
+#if !NUT_PLATFORM_OS_WINDOWS
+ssize_t FragmentBuffer::read_from_fd(int fd, size_t max_len) noexcept
+{
+    assert(fd >= 0);
+    if (0 == max_len)
+        return 0;
+
+    // 先填满最后一个 fragment 的空余空间，不够的部分读入新的 fragment
+    struct iovec iov[2];
+    int iov_count = 0;
+    size_t tail_space = 0;
+    Fragment *tail = appendable_fragment();
+    if (nullptr != tail)
+    {
+        tail_space = std::min(tail->capacity - tail->size, max_len);
+        iov[0].iov_base = tail->buffer + tail->size;
+        iov[0].iov_len = tail_space;
+        ++iov_count;
+    }
+    Fragment *frag = nullptr;
+    if (tail_space < max_len)
+    {
+        const size_t remain = max_len - tail_space;
+        frag = new_fragment(std::max(remain, DEFAULT_FRAGMENT_CAPACITY));
+        iov[iov_count].iov_base = frag->buffer;
+        iov[iov_count].iov_len = remain;
+        ++iov_count;
+    }
+
+    const ssize_t rs = ::readv(fd, iov, iov_count);
+    if (rs <= 0)
+    {
+        if (nullptr != frag)
+            delete_fragment(frag);
+        return rs;
+    }
+
+    const size_t to_tail = std::min((size_t) rs, tail_space);
+    if (to_tail > 0)
+    {
+        tail->size += to_tail;
+        _refs.back().length += to_tail;
+        _read_available += to_tail;
+    }
+    if (nullptr != frag)
+    {
+        if ((size_t) rs > to_tail)
+        {
+            frag->size = rs - to_tail;
+            enqueue(frag, 0, frag->size);
+        }
+        else
+        {
+            delete_fragment(frag);
+        }
+    }
+    return rs;
+}
+
+ssize_t FragmentBuffer::write_to_fd(int fd) noexcept
+{
+    assert(fd >= 0);
+    if (0 == _read_available)
+        return 0;
+
+#if defined(IOV_MAX) && IOV_MAX < MAX_WRITEV_FRAGMENTS
+    struct iovec iov[IOV_MAX];
+    const size_t max_count = IOV_MAX;
+#else
+    struct iovec iov[MAX_WRITEV_FRAGMENTS];
+    const size_t max_count = MAX_WRITEV_FRAGMENTS;
+#endif
+    const size_t count = std::min(max_count, _refs.size());
+    for (size_t i = 0; i < count; ++i)
+    {
+        const FragmentRef& ref = _refs[i];
+        iov[i].iov_base = ref.fragment->buffer + ref.offset;
+        iov[i].iov_len = ref.length;
+    }
+
+    const ssize_t rs = ::writev(fd, iov, (int) count);
+    if (rs > 0)
+        skip_read(rs);
+    return rs;
+}
+#endif
+
 }
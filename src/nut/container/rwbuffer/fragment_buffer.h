@@ -4,8 +4,12 @@
 
 #include <stdint.h>
 #include <stddef.h> // for size_t
+#include <atomic>
+#include <deque>
 
 #include "../../nut_config.h"
+#include "../../platform/platform.h"
+#include "../../platform/int_type.h" // for ssize_t in windows VC
 
 
 namespace nut
@@ -19,9 +23,19 @@ namespace nut
  *                |
  *          +----------+         +----------+
  * read <-  | Fragment |    -    | Fragment +    .....  <- write
- *          +----------+-> next  +----------+->      ↑
+ *          +----------+         +----------+        ↑
  *                                                   |
  *                                            enqueue to tail
+ *
+ * 缓冲区中存放的是对 fragment 中一段数据的引用; fragment 带有引用计数, 可以被多个
+ * 缓冲区共享. 复制、slice()、cut()、append() 都只增加引用而不复制数据. 已写入
+ * fragment 的数据不再改变, 只有独占 fragment 且引用到已写入末尾时才会在其空余空间
+ * 上继续追加
+ *
+ * 默认大小的 fragment 从内存池中分配
+ *
+ * NOTE FragmentBuffer 本身不是线程安全的, 但共享同一 fragment 的不同缓冲区可以在
+ *      不同线程中使用
  */
 class NUT_API FragmentBuffer
 {
@@ -40,13 +54,18 @@ public:
 
     public:
         const size_t capacity = 0;
-        size_t size = 0;
-        Fragment *next = nullptr;
+        size_t size = 0; // 已写入的大小
+        std::atomic<int> ref_count = ATOMIC_VAR_INIT(1);
 
         // NOTE 这一部分是变长的，应该作为最后一个成员
         uint8_t buffer[1];
     };
 
+    /**
+     * 从内存池分配的 fragment 的容量, 数据和头部合计 4K
+     */
+    static const size_t DEFAULT_FRAGMENT_CAPACITY;
+
 public:
     FragmentBuffer() = default;
     FragmentBuffer(FragmentBuffer&& x) noexcept;
@@ -98,12 +117,19 @@ public:
     void write(const void *buf, size_t len) noexcept;
 
     /**
-     * 创建 fragment
+     * 创建 fragment, 引用计数为 1
+     *
+     * capacity 等于 DEFAULT_FRAGMENT_CAPACITY 时从内存池分配
      */
     static Fragment* new_fragment(size_t capacity) noexcept;
 
     /**
-     * 销毁 fragment
+     * 增加 fragment 的引用计数
+     */
+    static Fragment* retain_fragment(Fragment *frag) noexcept;
+
+    /**
+     * 减少 fragment 的引用计数, 归零时销毁或者归还内存池
      */
     static void delete_fragment(Fragment *frag) noexcept;
 
@@ -114,14 +140,68 @@ public:
      */
     Fragment* write_fragment(Fragment *frag) noexcept;
 
-private:
-    void enqueue(Fragment *frag) noexcept;
+    /**
+     * 共享 [offset, offset + len) 范围内的可读数据, 不复制数据
+     */
+    FragmentBuffer slice(size_t offset, size_t len) const noexcept;
+
+    /**
+     * 从头部切下 len 字节作为新的缓冲区返回, 用于在消息边界处拆分, 不复制数据
+     */
+    FragmentBuffer cut(size_t len) noexcept;
+
+    /**
+     * 将 x 的数据追加到末尾, x 被清空, 不复制数据
+     */
+    void append(FragmentBuffer&& x) noexcept;
+
+    /**
+     * 共享 x 的数据追加到末尾, 不复制数据
+     */
+    void append(const FragmentBuffer& x) noexcept;
+
+#if !NUT_PLATFORM_OS_WINDOWS
+    /**
+     * 使用 readv() 从文件描述符直接读入最后一个 fragment 的空余空间以及一个新
+     * fragment 中，只调用一次 readv()
+     *
+     * @param max_len 最多读取的字节数
+     * @return 读到的字节数; 0 表示 EOF; -1 表示出错，错误码见 errno
+     */
+    ssize_t read_from_fd(int fd, size_t max_len = 4096) noexcept;
+
+    /**
+     * 使用 writev() 将各个 fragment 直接写入文件描述符，只调用一次 writev()，
+     * 写出的数据从缓冲区中移除
+     *
+     * @return 写出的字节数; -1 表示出错，错误码见 errno
+     */
+    ssize_t write_to_fd(int fd) noexcept;
+#endif
 
 private:
-    Fragment *_read_fragment = nullptr;
-    Fragment *_write_fragment = nullptr;
+    /**
+     * 对 fragment 中一段数据的引用, 持有 fragment 的一个引用计数
+     */
+    struct FragmentRef
+    {
+        Fragment *fragment;
+        size_t offset;
+        size_t length;
+    };
+
+    /**
+     * 追加引用, 接管 frag 的一个引用计数
+     */
+    void enqueue(Fragment *frag, size_t offset, size_t length) noexcept;
 
-    size_t _read_index = 0;
+    /**
+     * 可以在空余空间上继续追加的最后一个 fragment
+     */
+    Fragment* appendable_fragment() const noexcept;
+
+private:
+    std::deque<FragmentRef> _refs;
     size_t _read_available = 0;
 };
 
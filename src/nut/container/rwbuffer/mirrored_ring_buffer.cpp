@@ -0,0 +1,335 @@
+﻿
+#include "../../platform/platform.h"
+
+#if !NUT_PLATFORM_OS_WINDOWS
+
+#include <assert.h>
+#include <stdio.h> // for ::snprintf()
+#include <string.h> // for ::memcpy()
+#include <algorithm> // for std::min()
+#include <atomic>
+
+#include <fcntl.h>
+#include <unistd.h> // for ::ftruncate(), ::read(), ::write()
+#include <sys/mman.h> // for ::mmap(), ::memfd_create()
+
+#include "mirrored_ring_buffer.h"
+
+
+#define VALIDATE_MEMBERS() \
+    assert((nullptr == _buffer && 0 == _capacity && 0 == _read_index && 0 == _size) || \
+           (nullptr != _buffer && _capacity > 0 && _read_index < _capacity && _size <= _capacity))
+
+namespace nut
+{
+
+static size_t page_size() noexcept
+{
+    static const size_t size = (size_t) ::sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+static size_t round_to_page(size_t size) noexcept
+{
+    const size_t page = page_size();
+    return (size + page - 1) / page * page;
+}
+
+/**
+ * 创建匿名的共享内存文件
+ *
+ * @return 失败则返回 -1
+ */
+static int create_shared_file() noexcept
+{
+#if NUT_PLATFORM_OS_LINUX
+    return ::memfd_create("nut-mirrored-ring-buffer", MFD_CLOEXEC);
+#else
+    static std::atomic<unsigned> counter(0);
+    char name[64];
+    ::snprintf(name, sizeof(name), "/nut-mrb-%d-%u", (int) ::getpid(), counter++);
+    const int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0)
+        ::shm_unlink(name);
+    return fd;
+#endif
+}
+
+MirroredRingBuffer::MirroredRingBuffer(size_t capacity) noexcept
+{
+    if (capacity > 0)
+        remap(round_to_page(capacity));
+}
+
+MirroredRingBuffer::MirroredRingBuffer(MirroredRingBuffer&& x) noexcept
+    : _buffer(x._buffer), _capacity(x._capacity), _read_index(x._read_index),
+      _size(x._size), _fd(x._fd)
+{
+    x._buffer = nullptr;
+    x._capacity = 0;
+    x._read_index = 0;
+    x._size = 0;
+    x._fd = -1;
+}
+
+MirroredRingBuffer::MirroredRingBuffer(const MirroredRingBuffer& x) noexcept
+{
+    *this = x;
+}
+
+MirroredRingBuffer::~MirroredRingBuffer() noexcept
+{
+    release();
+}
+
+void MirroredRingBuffer::release() noexcept
+{
+    if (nullptr != _buffer)
+        ::munmap(_buffer, 2 * _capacity);
+    if (_fd >= 0)
+        ::close(_fd);
+    _buffer = nullptr;
+    _capacity = 0;
+    _read_index = 0;
+    _size = 0;
+    _fd = -1;
+}
+
+MirroredRingBuffer& MirroredRingBuffer::operator=(MirroredRingBuffer&& x) noexcept
+{
+    if (this == &x)
+        return *this;
+
+    release();
+
+    _buffer = x._buffer;
+    _capacity = x._capacity;
+    _read_index = x._read_index;
+    _size = x._size;
+    _fd = x._fd;
+
+    x._buffer = nullptr;
+    x._capacity = 0;
+    x._read_index = 0;
+    x._size = 0;
+    x._fd = -1;
+
+    return *this;
+}
+
+MirroredRingBuffer& MirroredRingBuffer::operator=(const MirroredRingBuffer& x) noexcept
+{
+    if (this == &x)
+        return *this;
+
+    clear();
+    if (x._size > 0)
+        write(x.readable_pointer(), x._size);
+    return *this;
+}
+
+void MirroredRingBuffer::clear() noexcept
+{
+    _read_index = 0;
+    _size = 0;
+}
+
+size_t MirroredRingBuffer::capacity() const noexcept
+{
+    return _capacity;
+}
+
+size_t MirroredRingBuffer::readable_size() const noexcept
+{
+    VALIDATE_MEMBERS();
+    return _size;
+}
+
+size_t MirroredRingBuffer::read(void *buf, size_t len) noexcept
+{
+    assert(nullptr != buf);
+    const size_t readed = look_ahead(buf, len);
+    skip_read(readed);
+    return readed;
+}
+
+size_t MirroredRingBuffer::look_ahead(void *buf, size_t len) const noexcept
+{
+    assert(nullptr != buf);
+    const size_t readed = std::min(len, _size);
+    if (readed > 0)
+        ::memcpy(buf, _buffer + _read_index, readed);
+    return readed;
+}
+
+size_t MirroredRingBuffer::skip_read(size_t len) noexcept
+{
+    const size_t skiped = std::min(len, _size);
+    _size -= skiped;
+    if (0 == _size)
+        _read_index = 0; // Reset to zero, this does no harm
+    else
+        _read_index = (_read_index + skiped) % _capacity;
+    return skiped;
+}
+
+const void* MirroredRingBuffer::readable_pointer() const noexcept
+{
+    VALIDATE_MEMBERS();
+    return nullptr == _buffer ? nullptr : _buffer + _read_index;
+}
+
+size_t MirroredRingBuffer::readable_pointers(const void **buf_ptr1, size_t *len_ptr1,
+                                             const void **buf_ptr2, size_t *len_ptr2) const noexcept
+{
+    (void) buf_ptr2;
+    (void) len_ptr2;
+    if (0 == _size)
+        return 0;
+
+    if (nullptr != buf_ptr1)
+        *buf_ptr1 = _buffer + _read_index;
+    if (nullptr != len_ptr1)
+        *len_ptr1 = _size;
+    return 1;
+}
+
+size_t MirroredRingBuffer::writable_size() const noexcept
+{
+    VALIDATE_MEMBERS();
+    return _capacity - _size;
+}
+
+bool MirroredRingBuffer::ensure_writable_size(size_t write_size) noexcept
+{
+    VALIDATE_MEMBERS();
+    if (writable_size() >= write_size)
+        return true;
+
+    size_t new_cap = _capacity * 3 / 2;
+    if (new_cap < _size + write_size)
+        new_cap = _size + write_size;
+    return remap(round_to_page(new_cap));
+}
+
+size_t MirroredRingBuffer::write(const void *buf, size_t len) noexcept
+{
+    assert(nullptr != buf || 0 == len);
+    if (0 == len || !ensure_writable_size(len))
+        return 0;
+
+    ::memcpy(writable_pointer(), buf, len);
+    _size += len;
+    return len;
+}
+
+size_t MirroredRingBuffer::skip_write(size_t len) noexcept
+{
+    const size_t skiped = std::min(len, writable_size());
+    _size += skiped;
+    return skiped;
+}
+
+void* MirroredRingBuffer::writable_pointer() noexcept
+{
+    VALIDATE_MEMBERS();
+    if (nullptr == _buffer)
+        return nullptr;
+    return _buffer + (_read_index + _size) % _capacity;
+}
+
+size_t MirroredRingBuffer::writable_pointers(void **buf_ptr1, size_t *len_ptr1,
+                                             void **buf_ptr2, size_t *len_ptr2) noexcept
+{
+    (void) buf_ptr2;
+    (void) len_ptr2;
+    if (0 == writable_size())
+        return 0;
+
+    if (nullptr != buf_ptr1)
+        *buf_ptr1 = writable_pointer();
+    if (nullptr != len_ptr1)
+        *len_ptr1 = writable_size();
+    return 1;
+}
+
+ssize_t MirroredRingBuffer::read_from_fd(int fd, size_t max_len) noexcept
+{
+    assert(fd >= 0);
+    if (0 == max_len)
+        return 0;
+    if (!ensure_writable_size(max_len))
+        return -1;
+
+    const ssize_t rs = ::read(fd, writable_pointer(), max_len);
+    if (rs > 0)
+        _size += rs;
+    return rs;
+}
+
+ssize_t MirroredRingBuffer::write_to_fd(int fd) noexcept
+{
+    assert(fd >= 0);
+    if (0 == _size)
+        return 0;
+
+    const ssize_t rs = ::write(fd, readable_pointer(), _size);
+    if (rs > 0)
+        skip_read(rs);
+    return rs;
+}
+
+bool MirroredRingBuffer::remap(size_t new_cap) noexcept
+{
+    assert(new_cap > _capacity && 0 == new_cap % page_size());
+
+    if (_fd < 0)
+    {
+        _fd = create_shared_file();
+        if (_fd < 0)
+            return false;
+    }
+    if (0 != ::ftruncate(_fd, (off_t) new_cap))
+        return false;
+
+    // 先预留连续的地址空间, 再将文件映射两次
+    uint8_t *base = (uint8_t*) ::mmap(nullptr, 2 * new_cap, PROT_NONE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == (void*) base)
+        return false;
+    if (MAP_FAILED == ::mmap(base, new_cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, _fd, 0) ||
+        MAP_FAILED == ::mmap(base + new_cap, new_cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, _fd, 0))
+    {
+        ::munmap(base, 2 * new_cap);
+        return false;
+    }
+
+    // 文件的前 _capacity 字节保持不变, 只有环绕的数据需要搬移较短的一段
+    if (nullptr != _buffer)
+    {
+        if (_read_index + _size > _capacity)
+        {
+            const size_t head = _capacity - _read_index, tail = _size - head;
+            if (tail <= head)
+            {
+                // 把环绕到开头的部分接到原来的末尾之后
+                ::memcpy(base + _capacity, base, tail);
+            }
+            else
+            {
+                // 把末尾的部分移到新的末尾
+                ::memmove(base + new_cap - head, base + _read_index, head);
+                _read_index = new_cap - head;
+            }
+        }
+        ::munmap(_buffer, 2 * _capacity);
+    }
+
+    _buffer = base;
+    _capacity = new_cap;
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,172 @@
+﻿
+#ifndef ___HEADFILE_E4B7215D_6C93_4A0F_B8D1_92F05A3C7E64_
+#define ___HEADFILE_E4B7215D_6C93_4A0F_B8D1_92F05A3C7E64_
+
+#include <stdint.h>
+#include <stddef.h> // for size_t
+
+#include "../../nut_config.h"
+#include "../../platform/platform.h"
+#include "../../platform/int_type.h" // for ssize_t in windows VC
+
+
+#if !NUT_PLATFORM_OS_WINDOWS
+
+namespace nut
+{
+
+/**
+ * 镜像环形存储
+ *
+ * 同一组物理页面被连续映射两次，环绕的数据在虚拟地址上也是连续的，因此可读、
+ * 可写区域总是只有一段, 可以直接在缓冲区上解析协议而不需要拼接
+ *
+ *    |<------- capacity ------->|<------- capacity ------->|
+ *    |==========|---------|^>>>>|==========|---------|^>>>>|
+ *    0     write_index  read_index         (镜像)
+ *                          |^>>>>>>>>>>>>>>>|
+ *                              可读区域(连续)
+ *
+ * 容量总是页面大小的整数倍. 扩容时重新映射而不复制数据，只有当数据环绕时需要
+ * 搬移较短的一段
+ *
+ * Linux 上使用 memfd_create(), 其他 POSIX 系统使用 shm_open()
+ */
+class NUT_API MirroredRingBuffer
+{
+public:
+    MirroredRingBuffer() = default;
+
+    /**
+     * @param capacity 初始容量，会向上取整到页面大小的整数倍
+     */
+    explicit MirroredRingBuffer(size_t capacity) noexcept;
+
+    MirroredRingBuffer(MirroredRingBuffer&& x) noexcept;
+    MirroredRingBuffer(const MirroredRingBuffer& x) noexcept;
+    ~MirroredRingBuffer() noexcept;
+    MirroredRingBuffer& operator=(MirroredRingBuffer&& x) noexcept;
+    MirroredRingBuffer& operator=(const MirroredRingBuffer& x) noexcept;
+
+    void clear() noexcept;
+
+    size_t capacity() const noexcept;
+
+    /**
+     * 剩余可读的大小
+     */
+    size_t readable_size() const noexcept;
+
+    /**
+     * 读数据
+     *
+     * @return 读到的字节数
+     */
+    size_t read(void *buf, size_t len) noexcept;
+
+    /**
+     * 读数据，但是不设置读指针
+     *
+     * @return 读到的字节数
+     */
+    size_t look_ahead(void *buf, size_t len) const noexcept;
+
+    /**
+     * 使读指针跳过一定字节数
+     *
+     * @return 跳过的字节数
+     */
+    size_t skip_read(size_t len) noexcept;
+
+    /**
+     * 可读区域, 长度为 readable_size()
+     */
+    const void* readable_pointer() const noexcept;
+
+    /**
+     * 与 RingBuffer 兼容的接口
+     *
+     * @return 0 指针无效, readable_size() == 0
+     *         1 第一个指针有效
+     */
+    size_t readable_pointers(const void **buf_ptr1, size_t *len_ptr1,
+                             const void **buf_ptr2 = nullptr, size_t *len_ptr2 = nullptr) const noexcept;
+
+    /**
+     * 在不扩容的前提下，当前可写的大小
+     */
+    size_t writable_size() const noexcept;
+
+    /**
+     * 确保至少有 write_size 大小的可写空间
+     *
+     * @return 映射内存失败则返回 false
+     */
+    bool ensure_writable_size(size_t write_size) noexcept;
+
+    /**
+     * 写数据，如果 writable_size() 不够，则会扩容
+     *
+     * @return 写入的字节数, 扩容失败则返回 0
+     */
+    size_t write(const void *buf, size_t len) noexcept;
+
+    /**
+     * 使写指针跳过一定字节数
+     *
+     * NOTE 被跳过的数据处于未定义状态
+     *
+     * @return 跳过的字节数
+     */
+    size_t skip_write(size_t len) noexcept;
+
+    /**
+     * 可写区域, 长度为 writable_size()
+     */
+    void* writable_pointer() noexcept;
+
+    /**
+     * 与 RingBuffer 兼容的接口
+     *
+     * @return 0 指针无效, writable_size() == 0
+     *         1 第一个指针有效
+     */
+    size_t writable_pointers(void **buf_ptr1, size_t *len_ptr1,
+                             void **buf_ptr2 = nullptr, size_t *len_ptr2 = nullptr) noexcept;
+
+    /**
+     * 从文件描述符直接读入可写区域
+     *
+     * @param max_len 最多读取的字节数，可写空间不足时会先扩容
+     * @return 读到的字节数; 0 表示 EOF; -1 表示出错，错误码见 errno
+     */
+    ssize_t read_from_fd(int fd, size_t max_len = 4096) noexcept;
+
+    /**
+     * 将可读区域直接写入文件描述符，写出的数据从缓冲区中移除
+     *
+     * @return 写出的字节数; -1 表示出错，错误码见 errno
+     */
+    ssize_t write_to_fd(int fd) noexcept;
+
+private:
+    /**
+     * 重新映射到新的容量，保留原有数据
+     */
+    bool remap(size_t new_cap) noexcept;
+
+    void release() noexcept;
+
+private:
+    uint8_t *_buffer = nullptr; // 映射的起始地址, 映射长度为 2 * _capacity
+    size_t _capacity = 0;
+    size_t _read_index = 0; // [0, _capacity)
+    size_t _size = 0; // 可读的大小
+    int _fd = -1; // 共享内存文件
+};
+
+}
+
+#endif
+
+#endif
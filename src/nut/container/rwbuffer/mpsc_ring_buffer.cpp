@@ -0,0 +1,183 @@
+﻿
+#include <assert.h>
+#include <stdlib.h> // for ::calloc(), ::free()
+#include <string.h> // for ::memcpy(), ::memset()
+
+#include "mpsc_ring_buffer.h"
+
+
+// 记录头的状态
+#define STATE_EMPTY 0
+#define STATE_COMMITTED 1
+#define STATE_PADDING 2
+
+#define HEADER_SIZE 8
+#define RECORD_ALIGN 8
+#define MIN_CAPACITY 64
+
+namespace nut
+{
+
+struct MPSCRingBuffer::RecordHeader
+{
+    std::atomic<uint32_t> state;
+    uint32_t length; // 数据长度, 不含记录头
+};
+
+static_assert(HEADER_SIZE == sizeof(std::atomic<uint32_t>) + sizeof(uint32_t),
+              "Unexpected record header size");
+
+static size_t record_size(size_t len) noexcept
+{
+    return HEADER_SIZE + (len + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+}
+
+MPSCRingBuffer::MPSCRingBuffer(size_t capacity) noexcept
+{
+    size_t cap = MIN_CAPACITY;
+    while (cap < capacity)
+        cap <<= 1;
+    // 初始清零, 所有记录头都处于 STATE_EMPTY
+    _buffer = (uint8_t*) ::calloc(cap, 1);
+    assert(nullptr != _buffer);
+    _capacity = cap;
+}
+
+MPSCRingBuffer::~MPSCRingBuffer() noexcept
+{
+    ::free(_buffer);
+    _buffer = nullptr;
+    _capacity = 0;
+}
+
+size_t MPSCRingBuffer::capacity() const noexcept
+{
+    return _capacity;
+}
+
+size_t MPSCRingBuffer::max_record_size() const noexcept
+{
+    // 不超过容量的一半, 保证加上填充记录后总能放下
+    return _capacity / 2 - HEADER_SIZE;
+}
+
+MPSCRingBuffer::RecordHeader* MPSCRingBuffer::header_at(uint64_t pos) const noexcept
+{
+    return reinterpret_cast<RecordHeader*>(_buffer + (size_t) (pos & (_capacity - 1)));
+}
+
+void* MPSCRingBuffer::reserve(size_t len) noexcept
+{
+    if (len > max_record_size())
+        return nullptr;
+
+    const size_t need = record_size(len);
+    uint64_t pos = _reserve_pos.load(std::memory_order_relaxed);
+    size_t pad;
+    while (true)
+    {
+        // 放不下则先用填充记录跳到开头
+        const size_t to_end = _capacity - (size_t) (pos & (_capacity - 1));
+        pad = (to_end < need ? to_end : 0);
+
+        // acquire: 消费者对释放区域的清零先于此处可见
+        const uint64_t read_pos = _read_pos.load(std::memory_order_acquire);
+        if (read_pos > pos)
+        {
+            // pos 已过期: 其他生产者的预留和消费者的释放都越过了它. 重新读取, 否则
+            // 下面的无符号减法会回绕, 误判为已满
+            pos = _reserve_pos.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (pos + pad + need - read_pos > _capacity)
+            return nullptr;
+
+        if (_reserve_pos.compare_exchange_weak(
+                pos, pos + pad + need, std::memory_order_relaxed, std::memory_order_relaxed))
+            break;
+    }
+
+    if (pad > 0)
+    {
+        RecordHeader *padding = header_at(pos);
+        padding->length = (uint32_t) (pad - HEADER_SIZE);
+        padding->state.store(STATE_PADDING, std::memory_order_release);
+    }
+
+    RecordHeader *header = header_at(pos + pad);
+    header->length = (uint32_t) len;
+    return header + 1;
+}
+
+void MPSCRingBuffer::commit(void *data) noexcept
+{
+    assert(nullptr != data);
+    RecordHeader *header = reinterpret_cast<RecordHeader*>(data) - 1;
+    assert(STATE_EMPTY == header->state.load(std::memory_order_relaxed));
+    header->state.store(STATE_COMMITTED, std::memory_order_release);
+}
+
+bool MPSCRingBuffer::write(const void *buf, size_t len) noexcept
+{
+    assert(nullptr != buf || 0 == len);
+    void *data = reserve(len);
+    if (nullptr == data)
+        return false;
+    if (len > 0)
+        ::memcpy(data, buf, len);
+    commit(data);
+    return true;
+}
+
+MPSCRingBuffer::RecordHeader* MPSCRingBuffer::next_committed() noexcept
+{
+    while (true)
+    {
+        RecordHeader *header = header_at(_read_pos.load(std::memory_order_relaxed));
+        const uint32_t state = header->state.load(std::memory_order_acquire);
+        if (STATE_COMMITTED == state)
+            return header;
+        if (STATE_PADDING != state)
+            return nullptr;
+        release_record(header);
+    }
+}
+
+void MPSCRingBuffer::release_record(RecordHeader *header) noexcept
+{
+    const size_t size = record_size(header->length);
+    ::memset(reinterpret_cast<uint8_t*>(header) + HEADER_SIZE, 0, size - HEADER_SIZE);
+    header->length = 0;
+    header->state.store(STATE_EMPTY, std::memory_order_relaxed);
+
+    // release: 清零先于新的读位置对生产者可见
+    _read_pos.store(_read_pos.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
+
+size_t MPSCRingBuffer::readable_pointers(const void **buf_ptr1, size_t *len_ptr1,
+                                         const void **buf_ptr2, size_t *len_ptr2) noexcept
+{
+    (void) buf_ptr2;
+    (void) len_ptr2;
+
+    const RecordHeader *header = next_committed();
+    if (nullptr == header)
+        return 0;
+
+    if (nullptr != buf_ptr1)
+        *buf_ptr1 = header + 1;
+    if (nullptr != len_ptr1)
+        *len_ptr1 = header->length;
+    return 1;
+}
+
+bool MPSCRingBuffer::skip_read() noexcept
+{
+    RecordHeader *header = next_committed();
+    if (nullptr == header)
+        return false;
+    release_record(header);
+    return true;
+}
+
+}
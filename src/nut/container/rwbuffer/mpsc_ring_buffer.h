@@ -0,0 +1,125 @@
+﻿
+#ifndef ___HEADFILE_7C25E0B4_91DA_4F63_8A07_D46B3E1F25C9_
+#define ___HEADFILE_7C25E0B4_91DA_4F63_8A07_D46B3E1F25C9_
+
+#include <stdint.h>
+#include <stddef.h> // for size_t
+#include <atomic>
+
+#include "../../nut_config.h"
+#include "../../platform/platform.h"
+
+
+namespace nut
+{
+
+/**
+ * 多生产者单消费者的无锁环形存储, 存放变长记录
+ *
+ * 生产者通过 reserve() 预留一块连续空间(CAS 推进预留位置), 直接写入后 commit()
+ * 提交; 多个生产者可以并发地写各自预留的记录, 提交顺序任意. 消费者按预留顺序
+ * 用 readable_pointers() 取得下一条已提交的记录, 处理完后 skip_read() 释放
+ *
+ * 每条记录前有 8 字节的记录头, 记录按 8 字节对齐; 记录总是连续的, 到达末尾放不下
+ * 时用一条填充记录跳到开头. 消费者释放记录时将其清零, 因此未提交的记录头总是读
+ * 到 0
+ *
+ * NOTE 未提交的记录会阻塞其后所有记录的读取
+ */
+class NUT_API MPSCRingBuffer
+{
+public:
+    /**
+     * @param capacity 容量，会向上取整到 2 的幂
+     */
+    explicit MPSCRingBuffer(size_t capacity) noexcept;
+    ~MPSCRingBuffer() noexcept;
+
+    size_t capacity() const noexcept;
+
+    /**
+     * 单条记录的最大长度, 约为容量的一半
+     */
+    size_t max_record_size() const noexcept;
+
+    /**
+     * 以下可由多个生产者线程并发调用
+     */
+
+    /**
+     * 预留一条记录
+     *
+     * @return 长度为 len 的连续可写区域, 空间不足则返回 nullptr
+     */
+    void* reserve(size_t len) noexcept;
+
+    /**
+     * 提交 reserve() 预留的记录, 使其对消费者可见
+     */
+    void commit(void *data) noexcept;
+
+    /**
+     * 复制写入一条记录
+     *
+     * @return 空间不足则返回 false
+     */
+    bool write(const void *buf, size_t len) noexcept;
+
+    /**
+     * 以下由消费者线程调用
+     */
+
+    /**
+     * 取得下一条已提交的记录
+     *
+     * @return 0 指针无效, 没有已提交的记录
+     *         1 第一个指针有效, 记录总是连续的
+     */
+    size_t readable_pointers(const void **buf_ptr1, size_t *len_ptr1,
+                             const void **buf_ptr2 = nullptr, size_t *len_ptr2 = nullptr) noexcept;
+
+    /**
+     * 释放 readable_pointers() 取得的记录
+     *
+     * @return 没有已提交的记录则返回 false
+     */
+    bool skip_read() noexcept;
+
+private:
+    MPSCRingBuffer(const MPSCRingBuffer&) = delete;
+    MPSCRingBuffer& operator=(const MPSCRingBuffer&) = delete;
+
+    struct RecordHeader;
+
+    RecordHeader* header_at(uint64_t pos) const noexcept;
+
+    /**
+     * 跳过填充记录后, 读位置上已提交的记录头
+     *
+     * @return 没有已提交的记录则返回 nullptr
+     */
+    RecordHeader* next_committed() noexcept;
+
+    /**
+     * 清零并释放读位置上的记录
+     */
+    void release_record(RecordHeader *header) noexcept;
+
+private:
+    // 只读数据
+    uint8_t *_buffer = nullptr;
+    size_t _capacity = 0;
+    char _pad0[NUT_CACHE_LINE_SIZE];
+
+    // 生产者数据
+    std::atomic<uint64_t> _reserve_pos = ATOMIC_VAR_INIT(0);
+    char _pad1[NUT_CACHE_LINE_SIZE];
+
+    // 消费者数据
+    std::atomic<uint64_t> _read_pos = ATOMIC_VAR_INIT(0);
+    char _pad2[NUT_CACHE_LINE_SIZE];
+};
+
+}
+
+#endif
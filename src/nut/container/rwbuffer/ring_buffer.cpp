@@ -6,6 +6,10 @@
 
 #include "ring_buffer.h"
 
+#if !NUT_PLATFORM_OS_WINDOWS
+#   include <sys/uio.h> // for ::readv(), ::writev()
+#endif
+
 
 #define VALIDATE_MEMBERS() \
     assert((nullptr == _buffer && 0 == _capacity && 0 == _read_index && 0 == _write_index) || \
@@ -210,7 +214,7 @@ void RingBuffer::write(const void *buf, size_t len) noexcept
 size_t RingBuffer::skip_write(size_t len) noexcept
 {
     const size_t skiped = std::min(len, writable_size());
-    _write_index += len;
+    _write_index += skiped;
     if (0 != _capacity)
         _write_index %= _capacity;
     return skiped;
@@ -286,4 +290,56 @@ void RingBuffer::ensure_writable_size(size_t write_size) noexcept
     }
 }
 
+#if !NUT_PLATFORM_OS_WINDOWS
+ssize_t RingBuffer::read_from_fd(int fd, size_t max_len) noexcept
+{
+    assert(fd >= 0);
+    if (0 == max_len)
+        return 0;
+
+    ensure_writable_size(max_len);
+    void *bufs[2];
+    size_t lens[2];
+    const size_t n = writable_pointers(bufs, lens, bufs + 1, lens + 1);
+    assert(n > 0);
+
+    struct iovec iov[2];
+    size_t remain = max_len;
+    int iov_count = 0;
+    for (size_t i = 0; i < n && remain > 0; ++i, ++iov_count)
+    {
+        iov[i].iov_base = bufs[i];
+        iov[i].iov_len = std::min(lens[i], remain);
+        remain -= iov[i].iov_len;
+    }
+
+    const ssize_t rs = ::readv(fd, iov, iov_count);
+    if (rs > 0)
+        skip_write(rs);
+    return rs;
+}
+
+ssize_t RingBuffer::write_to_fd(int fd) noexcept
+{
+    assert(fd >= 0);
+    const void *bufs[2];
+    size_t lens[2];
+    const size_t n = readable_pointers(bufs, lens, bufs + 1, lens + 1);
+    if (0 == n)
+        return 0;
+
+    struct iovec iov[2];
+    for (size_t i = 0; i < n; ++i)
+    {
+        iov[i].iov_base = const_cast<void*>(bufs[i]);
+        iov[i].iov_len = lens[i];
+    }
+
+    const ssize_t rs = ::writev(fd, iov, (int) n);
+    if (rs > 0)
+        skip_read(rs);
+    return rs;
+}
+#endif
+
 }
@@ -6,6 +6,8 @@
 #include <stddef.h> // for size_t
 
 #include "../../nut_config.h"
+#include "../../platform/platform.h"
+#include "../../platform/int_type.h" // for ssize_t in windows VC
 
 
 namespace nut
@@ -110,6 +112,24 @@ public:
     size_t writable_pointers(void **buf_ptr1, size_t *len_ptr1,
                              void **buf_ptr2, size_t *len_ptr2) noexcept;
 
+#if !NUT_PLATFORM_OS_WINDOWS
+    /**
+     * 使用 readv() 从文件描述符直接读入可写区域，只调用一次 readv()
+     *
+     * @param max_len 最多读取的字节数，可写空间不足时会先扩容
+     * @return 读到的字节数; 0 表示 EOF; -1 表示出错，错误码见 errno
+     */
+    ssize_t read_from_fd(int fd, size_t max_len = 4096) noexcept;
+
+    /**
+     * 使用 writev() 将可读区域直接写入文件描述符，只调用一次 writev()，
+     * 写出的数据从缓冲区中移除
+     *
+     * @return 写出的字节数; -1 表示出错，错误码见 errno
+     */
+    ssize_t write_to_fd(int fd) noexcept;
+#endif
+
 private:
     void *_buffer = nullptr;
     size_t _capacity = 0;
@@ -0,0 +1,172 @@
+﻿
+#include <assert.h>
+#include <stdlib.h> // for ::malloc(), ::free()
+#include <string.h> // for ::memcpy()
+#include <algorithm> // for std::min()
+
+#include "spsc_ring_buffer.h"
+
+
+namespace nut
+{
+
+SPSCRingBuffer::SPSCRingBuffer(size_t capacity) noexcept
+{
+    size_t cap = 1;
+    while (cap < capacity)
+        cap <<= 1;
+    _buffer = (uint8_t*) ::malloc(cap);
+    assert(nullptr != _buffer);
+    _capacity = cap;
+}
+
+SPSCRingBuffer::~SPSCRingBuffer() noexcept
+{
+    ::free(_buffer);
+    _buffer = nullptr;
+    _capacity = 0;
+}
+
+size_t SPSCRingBuffer::capacity() const noexcept
+{
+    return _capacity;
+}
+
+size_t SPSCRingBuffer::available_to_read(size_t want) noexcept
+{
+    const size_t r = _read_pos.load(std::memory_order_relaxed);
+    size_t avail = _cached_write_pos - r;
+    if (avail < want)
+    {
+        _cached_write_pos = _write_pos.load(std::memory_order_acquire);
+        avail = _cached_write_pos - r;
+    }
+    return avail;
+}
+
+size_t SPSCRingBuffer::available_to_write(size_t want) noexcept
+{
+    const size_t w = _write_pos.load(std::memory_order_relaxed);
+    size_t avail = _capacity - (w - _cached_read_pos);
+    if (avail < want)
+    {
+        _cached_read_pos = _read_pos.load(std::memory_order_acquire);
+        avail = _capacity - (w - _cached_read_pos);
+    }
+    return avail;
+}
+
+size_t SPSCRingBuffer::readable_size() noexcept
+{
+    return available_to_read(SIZE_MAX);
+}
+
+size_t SPSCRingBuffer::read(void *buf, size_t len) noexcept
+{
+    assert(nullptr != buf);
+    const size_t readed = look_ahead(buf, len);
+    if (readed > 0)
+        _read_pos.store(_read_pos.load(std::memory_order_relaxed) + readed, std::memory_order_release);
+    return readed;
+}
+
+size_t SPSCRingBuffer::look_ahead(void *buf, size_t len) noexcept
+{
+    assert(nullptr != buf);
+    const size_t readed = std::min(len, available_to_read(len));
+    if (0 == readed)
+        return 0;
+
+    const size_t offset = _read_pos.load(std::memory_order_relaxed) & (_capacity - 1);
+    const size_t first = std::min(readed, _capacity - offset);
+    ::memcpy(buf, _buffer + offset, first);
+    if (readed > first)
+        ::memcpy((uint8_t*) buf + first, _buffer, readed - first);
+    return readed;
+}
+
+size_t SPSCRingBuffer::skip_read(size_t len) noexcept
+{
+    const size_t skiped = std::min(len, available_to_read(len));
+    if (skiped > 0)
+        _read_pos.store(_read_pos.load(std::memory_order_relaxed) + skiped, std::memory_order_release);
+    return skiped;
+}
+
+size_t SPSCRingBuffer::readable_pointers(const void **buf_ptr1, size_t *len_ptr1,
+                                         const void **buf_ptr2, size_t *len_ptr2) noexcept
+{
+    const size_t readable = readable_size();
+    if (0 == readable)
+        return 0;
+
+    const size_t offset = _read_pos.load(std::memory_order_relaxed) & (_capacity - 1);
+    const size_t first = std::min(readable, _capacity - offset);
+    if (nullptr != buf_ptr1)
+        *buf_ptr1 = _buffer + offset;
+    if (nullptr != len_ptr1)
+        *len_ptr1 = first;
+    if (readable == first)
+        return 1;
+
+    if (nullptr != buf_ptr2)
+        *buf_ptr2 = _buffer;
+    if (nullptr != len_ptr2)
+        *len_ptr2 = readable - first;
+    return 2;
+}
+
+size_t SPSCRingBuffer::writable_size() noexcept
+{
+    return available_to_write(SIZE_MAX);
+}
+
+size_t SPSCRingBuffer::write(const void *buf, size_t len) noexcept
+{
+    assert(nullptr != buf || 0 == len);
+    const size_t writen = std::min(len, available_to_write(len));
+    if (0 == writen)
+        return 0;
+
+    const size_t w = _write_pos.load(std::memory_order_relaxed);
+    const size_t offset = w & (_capacity - 1);
+    const size_t first = std::min(writen, _capacity - offset);
+    ::memcpy(_buffer + offset, buf, first);
+    if (writen > first)
+        ::memcpy(_buffer, (const uint8_t*) buf + first, writen - first);
+    _write_pos.store(w + writen, std::memory_order_release);
+    return writen;
+}
+
+size_t SPSCRingBuffer::skip_write(size_t len) noexcept
+{
+    const size_t skiped = std::min(len, available_to_write(len));
+    if (skiped > 0)
+        _write_pos.store(_write_pos.load(std::memory_order_relaxed) + skiped, std::memory_order_release);
+    return skiped;
+}
+
+size_t SPSCRingBuffer::writable_pointers(void **buf_ptr1, size_t *len_ptr1,
+                                         void **buf_ptr2, size_t *len_ptr2) noexcept
+{
+    const size_t writable = writable_size();
+    if (0 == writable)
+        return 0;
+
+    const size_t offset = _write_pos.load(std::memory_order_relaxed) & (_capacity - 1);
+    const size_t first = std::min(writable, _capacity - offset);
+    if (nullptr != buf_ptr1)
+        *buf_ptr1 = _buffer + offset;
+    if (nullptr != len_ptr1)
+        *len_ptr1 = first;
+    if (writable == first)
+        return 1;
+
+    if (nullptr != buf_ptr2)
+        *buf_ptr2 = _buffer;
+    if (nullptr != len_ptr2)
+        *len_ptr2 = writable - first;
+    return 2;
+}
+
+}
@@ -0,0 +1,141 @@
+﻿
+#ifndef ___HEADFILE_3A9D61F0_27C4_4E85_B1D3_5F8E0C6A92B7_
+#define ___HEADFILE_3A9D61F0_27C4_4E85_B1D3_5F8E0C6A92B7_
+
+#include <stdint.h>
+#include <stddef.h> // for size_t
+#include <atomic>
+
+#include "../../nut_config.h"
+#include "../../platform/platform.h"
+
+
+namespace nut
+{
+
+/**
+ * 单生产者单消费者的无锁环形存储
+ *
+ * 生产者线程只调用 writable_*() / write() / skip_write(), 消费者线程只调用
+ * readable_*() / read() / look_ahead() / skip_read()
+ *
+ * 读写位置都是单调增长的计数, 容量为 2 的幂, 因此可以用满整个容量. 生产者和消费者
+ * 各自缓存对方的位置, 只有缓存的空间不足时才重新加载对方的位置(acquire), 发布
+ * 自己的位置时使用 release. 两组位置分别放在不同的缓存行上以避免伪共享
+ *
+ * 容量固定, 不会扩容
+ */
+class NUT_API SPSCRingBuffer
+{
+public:
+    /**
+     * @param capacity 容量，会向上取整到 2 的幂
+     */
+    explicit SPSCRingBuffer(size_t capacity) noexcept;
+    ~SPSCRingBuffer() noexcept;
+
+    size_t capacity() const noexcept;
+
+    /**
+     * 以下由消费者线程调用
+     */
+
+    /**
+     * 当前可读的大小
+     */
+    size_t readable_size() noexcept;
+
+    /**
+     * 读数据
+     *
+     * @return 读到的字节数
+     */
+    size_t read(void *buf, size_t len) noexcept;
+
+    /**
+     * 读数据，但是不设置读指针
+     *
+     * @return 读到的字节数
+     */
+    size_t look_ahead(void *buf, size_t len) noexcept;
+
+    /**
+     * 使读指针跳过一定字节数, 释放的空间对生产者可见
+     *
+     * @return 跳过的字节数
+     */
+    size_t skip_read(size_t len) noexcept;
+
+    /**
+     * @return 0 指针无效, readable_size() == 0
+     *         1 第一个指针有效
+     *         2 两个指针都有效
+     */
+    size_t readable_pointers(const void **buf_ptr1, size_t *len_ptr1,
+                             const void **buf_ptr2 = nullptr, size_t *len_ptr2 = nullptr) noexcept;
+
+    /**
+     * 以下由生产者线程调用
+     */
+
+    /**
+     * 当前可写的大小
+     */
+    size_t writable_size() noexcept;
+
+    /**
+     * 写数据
+     *
+     * @return 写入的字节数, 空间不足时只写入一部分
+     */
+    size_t write(const void *buf, size_t len) noexcept;
+
+    /**
+     * 使写指针跳过一定字节数, 之前写入 writable_pointers() 的数据对消费者可见
+     *
+     * @return 跳过的字节数
+     */
+    size_t skip_write(size_t len) noexcept;
+
+    /**
+     * @return 0 指针无效, writable_size() == 0
+     *         1 第一个指针有效
+     *         2 两个指针都有效
+     */
+    size_t writable_pointers(void **buf_ptr1, size_t *len_ptr1,
+                             void **buf_ptr2 = nullptr, size_t *len_ptr2 = nullptr) noexcept;
+
+private:
+    SPSCRingBuffer(const SPSCRingBuffer&) = delete;
+    SPSCRingBuffer& operator=(const SPSCRingBuffer&) = delete;
+
+    /**
+     * 可读的大小, 缓存的写位置不足 want 时重新加载
+     */
+    size_t available_to_read(size_t want) noexcept;
+
+    /**
+     * 可写的大小, 缓存的读位置不足 want 时重新加载
+     */
+    size_t available_to_write(size_t want) noexcept;
+
+private:
+    // 只读数据
+    uint8_t *_buffer = nullptr;
+    size_t _capacity = 0;
+    char _pad0[NUT_CACHE_LINE_SIZE];
+
+    // 生产者数据
+    std::atomic<size_t> _write_pos = ATOMIC_VAR_INIT(0);
+    size_t _cached_read_pos = 0;
+    char _pad1[NUT_CACHE_LINE_SIZE];
+
+    // 消费者数据
+    std::atomic<size_t> _read_pos = ATOMIC_VAR_INIT(0);
+    size_t _cached_write_pos = 0;
+    char _pad2[NUT_CACHE_LINE_SIZE];
+};
+
+}
+
+#endif
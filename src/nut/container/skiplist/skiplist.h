@@ -1,4 +1,3 @@
-﻿
 #ifndef ___HEADFILE_CD9958A8_95CB_49A7_A294_60B2304EDB7E_
 #define ___HEADFILE_CD9958A8_95CB_49A7_A294_60B2304EDB7E_
 
@@ -14,18 +13,26 @@ namespace nut
 /**
  * skip-list 的公共算法
  *
+ * 每一层的指针都附带一个跨度(span), 表示沿该层指针前进时跨过的 level-0 节点数，
+ * 据此可以在 O(log n) 内计算排名(rank)以及按排名选取节点(select).
+ * 指向 nullptr 的指针其跨度无意义，保持为 0
+ *
  * @param K 键值类型，要求能用 "<" 操作符比较大小
  * @param NODE 节点类型，要求实现以下方法
- *      const K& get_key() const   获取键值
- *      int get_level() const      获取 0-based 层数
- *      NODE* get_next(int) const  获取指定层数的指针
- *      void set_level(int)        设置层数，并自动分配 level+1 长度的 next 数组
- *      void set_next(int,NODE*)   设置指定层数的指针
+ *      const K& get_key() const        获取键值
+ *      int get_level() const           获取 0-based 层数
+ *      NODE* get_next(int) const       获取指定层数的指针
+ *      void set_next(int,NODE*)        设置指定层数的指针
+ *      size_t get_span(int) const      获取指定层数指针的跨度
+ *      void set_span(int,size_t)       设置指定层数指针的跨度
+ *      NOTE 节点的层数在创建时就确定了, next 数组与节点本身在同一块内存中
  * @param SL 跳表数据结构本身，要求实现以下方法
- *      int get_level() const      获取跳表 0-based 层数
- *      NODE* get_head(int) const  获取跳表头
- *      void set_level(int)        设置层数，并自动分配 level+1 长度的 head 数组
- *      void set_head(int,NODE*)   设置跳表头
+ *      int get_level() const           获取跳表 0-based 层数
+ *      NODE* get_head(int) const       获取跳表头
+ *      void set_level(int)             设置层数，新增层的 head 初始化为 nullptr
+ *      void set_head(int,NODE*)        设置跳表头
+ *      size_t get_head_span(int) const 获取跳表头的跨度
+ *      void set_head_span(int,size_t)  设置跳表头的跨度
  */
 template <typename K, typename NODE, typename SL>
 class SkipList
@@ -54,24 +61,46 @@ public:
         return level;
     }
 
+    /**
+     * 批量构建时使用的确定性 level, 使得构建出的跳表完全平衡
+     *
+     * @param rank 1-based 排名
+     * @return 0-based
+     */
+    static int balanced_level(size_t rank) noexcept
+    {
+        assert(rank > 0);
+        int level = 0;
+        while (0 == (rank % LEVEL_FACTOR) && level < MAX_LEVEL)
+        {
+            rank /= LEVEL_FACTOR;
+            ++level;
+        }
+        return level;
+    }
+
     /**
      * 查找节点，附带查找各层前向节点
      *
      * @param k         要查找的键值
      * @param sl        跳表本身
      * @param pre_lv    存放返回值，可以是 nullptr. 存放前向节点的返回值数组，长度为 (level+1).
+     * @param rank_lv   存放返回值，可以是 nullptr. 存放前向节点的 1-based 排名，
+     *                  表头的排名为 0. 长度为 (level+1).
      */
-    static NODE* search_node(const K& key, const SL& sl, NODE **pre_lv) noexcept
+    static NODE* search_node(const K& key, const SL& sl, NODE **pre_lv,
+                             size_t *rank_lv = nullptr) noexcept
     {
         NODE *ret = nullptr;
         NODE *pre = nullptr;
+        size_t rank = 0;
         int lv = sl.get_level();
         assert(lv >= 0);
         do
         {
             while (true)
             {
-                NODE *n = (nullptr == pre ? sl.get_head(lv) : pre->get_next(lv));
+                NODE *n = next_of(sl, pre, lv);
                 if (nullptr == n)
                 {
                     if (nullptr != pre_lv)
@@ -88,6 +117,7 @@ public:
                 }
                 else if (rs > 0)
                 {
+                    rank += span_of(sl, pre, lv);
                     pre = n;
                 }
                 else
@@ -104,6 +134,8 @@ public:
                     }
                 }
             }
+            if (nullptr != rank_lv)
+                rank_lv[lv] = rank;
         } while (--lv >= 0);
         return ret;
     }
@@ -111,34 +143,32 @@ public:
     /**
      * 插入节点
      *
-     * @param n         要插入的节点
-     *                  如果其leve数无效，则会生成随机level数，否则使用原有的level数
+     * @param n         要插入的节点, 其层数必须有效(一般由 random_level() 生成)
      * @param sl        跳表本身
      * @param pre_lv    前向节点数组，长度为 (level+1)
+     * @param rank_lv   前向节点的排名数组，长度为 (level+1)
      */
-    static void insert_node(NODE *n, SL& sl, NODE** pre_lv) noexcept
+    static void insert_node(NODE *n, SL& sl, NODE** pre_lv, const size_t *rank_lv) noexcept
     {
-        assert(nullptr != n && nullptr != pre_lv);
-
-        // random level
-        if (n->get_level() < 0)
-            n->set_level(random_level());
+        assert(nullptr != n && nullptr != pre_lv && nullptr != rank_lv);
 
         // adjust low-half level
         const int sl_level = sl.get_level(), n_level = n->get_level();
         assert(sl_level >= 0 && n_level >= 0);
+        const size_t n_rank = rank_lv[0] + 1;
         for (int i = 0; i <= sl_level && i <= n_level; ++i)
         {
-            if (nullptr == pre_lv[i])
-            {
-                n->set_next(i, sl.get_head(i));
-                sl.set_head(i, n);
-            }
-            else
-            {
-                n->set_next(i, pre_lv[i]->get_next(i));
-                pre_lv[i]->set_next(i, n);
-            }
+            NODE *next = next_of(sl, pre_lv[i], i);
+            n->set_next(i, next);
+            n->set_span(i, nullptr == next ? 0 : rank_lv[i] + span_of(sl, pre_lv[i], i) - rank_lv[0]);
+            set_link(sl, pre_lv[i], i, n, n_rank - rank_lv[i]);
+        }
+
+        // pointers over the new node
+        for (int i = n_level + 1; i <= sl_level; ++i)
+        {
+            if (nullptr != next_of(sl, pre_lv[i], i))
+                set_link(sl, pre_lv[i], i, next_of(sl, pre_lv[i], i), span_of(sl, pre_lv[i], i) + 1);
         }
 
         // adjust high-half level
@@ -148,7 +178,9 @@ public:
             for (int i = sl_level + 1; i <= n_level; ++i)
             {
                 sl.set_head(i, n);
+                sl.set_head_span(i, n_rank);
                 n->set_next(i, nullptr);
+                n->set_span(i, 0);
             }
         }
     }
@@ -156,26 +188,140 @@ public:
     /**
      * 移除节点
      *
-     * @param n         要插入的节点
+     * @param n         要移除的节点
      * @param sl        跳表本身
      * @param pre_lv    前向节点数组，长度为 (level+1)
      */
     static void remove_node(NODE *n, SL& sl, NODE **pre_lv) noexcept
     {
         assert(nullptr != n && nullptr != pre_lv);
-        const int sl_level = sl.get_level(), n_level = n->get_level();
-        assert(sl_level >= 0 && n_level >= 0);
-        for (int i = 0; i <= sl_level && i <= n_level; ++i)
+        const int sl_level = sl.get_level();
+        assert(sl_level >= 0 && n->get_level() >= 0);
+        for (int i = 0; i <= sl_level; ++i)
+        {
+            NODE *next = next_of(sl, pre_lv[i], i);
+            if (next == n)
+            {
+                NODE *nn = n->get_next(i);
+                set_link(sl, pre_lv[i], i, nn,
+                         nullptr == nn ? 0 : span_of(sl, pre_lv[i], i) + n->get_span(i) - 1);
+            }
+            else if (nullptr != next)
+            {
+                assert(i > n->get_level());
+                set_link(sl, pre_lv[i], i, next, span_of(sl, pre_lv[i], i) - 1);
+            }
+        }
+    }
+
+    /**
+     * @return 第一个键值 >= key 的节点, 没有则返回 nullptr
+     */
+    static NODE* lower_bound(const K& key, const SL& sl) noexcept
+    {
+        return bound(key, sl, false);
+    }
+
+    /**
+     * @return 第一个键值 > key 的节点, 没有则返回 nullptr
+     */
+    static NODE* upper_bound(const K& key, const SL& sl) noexcept
+    {
+        return bound(key, sl, true);
+    }
+
+    /**
+     * @return 键值 < key 的节点个数
+     */
+    static size_t rank(const K& key, const SL& sl) noexcept
+    {
+        NODE *pre = nullptr;
+        size_t rank = 0;
+        for (int lv = sl.get_level(); lv >= 0; --lv)
+        {
+            NODE *n = next_of(sl, pre, lv);
+            while (nullptr != n && compare(n->get_key(), key) < 0)
+            {
+                rank += span_of(sl, pre, lv);
+                pre = n;
+                n = next_of(sl, pre, lv);
+            }
+        }
+        return rank;
+    }
+
+    /**
+     * @param index 0-based 排名
+     * @return 对应的节点, 越界则返回 nullptr
+     */
+    static NODE* select(size_t index, const SL& sl) noexcept
+    {
+        const size_t target = index + 1; // 1-based
+        NODE *pre = nullptr;
+        size_t rank = 0;
+        for (int lv = sl.get_level(); lv >= 0; --lv)
         {
-            if (nullptr == pre_lv[i])
-                sl.set_head(i, n->get_next(i));
-            else
-                pre_lv[i]->set_next(i, n->get_next(i));
+            NODE *n = next_of(sl, pre, lv);
+            while (nullptr != n && rank + span_of(sl, pre, lv) <= target)
+            {
+                rank += span_of(sl, pre, lv);
+                pre = n;
+                if (rank == target)
+                    return pre;
+                n = next_of(sl, pre, lv);
+            }
         }
+        return nullptr;
     }
 
 private:
     SkipList() = delete;
+
+    static NODE* next_of(const SL& sl, NODE *pre, int lv) noexcept
+    {
+        return nullptr == pre ? sl.get_head(lv) : pre->get_next(lv);
+    }
+
+    static size_t span_of(const SL& sl, NODE *pre, int lv) noexcept
+    {
+        return nullptr == pre ? sl.get_head_span(lv) : pre->get_span(lv);
+    }
+
+    static void set_link(SL& sl, NODE *pre, int lv, NODE *next, size_t span) noexcept
+    {
+        if (nullptr == pre)
+        {
+            sl.set_head(lv, next);
+            sl.set_head_span(lv, span);
+        }
+        else
+        {
+            pre->set_next(lv, next);
+            pre->set_span(lv, span);
+        }
+    }
+
+    static NODE* bound(const K& key, const SL& sl, bool upper) noexcept
+    {
+        if (sl.get_level() < 0)
+            return nullptr;
+
+        NODE *pre = nullptr;
+        for (int lv = sl.get_level(); lv >= 0; --lv)
+        {
+            while (true)
+            {
+                NODE *n = next_of(sl, pre, lv);
+                if (nullptr == n)
+                    break;
+                const int rs = compare(n->get_key(), key);
+                if (rs > 0 || (0 == rs && !upper))
+                    break;
+                pre = n;
+            }
+        }
+        return next_of(sl, pre, 0);
+    }
 };
 
 }
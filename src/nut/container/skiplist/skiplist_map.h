@@ -2,9 +2,15 @@
 #ifndef ___HEADFILE_40DE4FAF_9BB0_4CF2_A78E_8FB1F58E09D3_
 #define ___HEADFILE_40DE4FAF_9BB0_4CF2_A78E_8FB1F58E09D3_
 
+#include <assert.h>
+#include <stddef.h> // for ptrdiff_t
 #include <stdlib.h>
+#include <string.h> // for ::memset()
 #include <new>
+#include <iterator>
+#include <utility> // for std::forward()
 
+#include "../../mem/memory_allocator.h"
 #include "../comparable.h"
 #include "skiplist.h"
 
@@ -12,41 +18,55 @@
 namespace nut
 {
 
+/**
+ * 跳表 map
+ *
+ * 每个节点(包括其各层 next 指针)只占用一块连续内存，level-0 的指针紧挨着键值，
+ * 遍历时每跳一层只有一次 cache miss. 节点大小只有 MAX_LEVEL+1 种，适合配合
+ * segments_stmp 等内存池使用
+ *
+ * 各层指针附带跨度，支持 O(log n) 的 rank()/select(), 可用于按偏移量分页
+ */
 template <typename K, typename V>
 class SkipListMap
 {
-private:
+public:
     class Node;
+
+private:
     typedef SkipListMap<K,V>                 self_type;
     typedef SkipList<K,Node,self_type>       algo_type;
 
     friend class SkipList<K,Node,self_type>;
 
-    class Node
+    struct Link
     {
-    public:
-        Node(K&& k, V&& v) noexcept
-            : _key(std::forward<K>(k)), _value(std::forward<V>(v))
-        {}
-
-        Node(const K& k, V&& v) noexcept
-            : _key(k), _value(std::forward<V>(v))
-        {}
+        Node *next;
+        size_t span;
+    };
 
-        Node(K&& k, const V& v) noexcept
-            : _key(std::forward<K>(k)), _value(v)
-        {}
+public:
+    class Node
+    {
+        friend class SkipListMap<K,V>;
+        friend class SkipList<K,Node,self_type>;
 
-        Node(const K& k, const V& v) noexcept
-            : _key(k), _value(v)
-        {}
+    public:
+        template <typename KK, typename VV>
+        Node(int lv, KK&& k, VV&& v) noexcept
+            : _key(std::forward<KK>(k)), _value(std::forward<VV>(v)), _level(lv)
+        {
+            assert(lv >= 0);
+            ::memset(_links, 0, sizeof(Link) * (lv + 1));
+        }
 
-        ~Node() noexcept
+        /**
+         * 具有 lv 层的节点所占用的内存大小
+         */
+        static size_t alloc_size(int lv) noexcept
         {
-            if (nullptr != _next)
-                ::free(_next);
-            _next = nullptr;
-            _level = algo_type::INVALID_LEVEL;
+            assert(lv >= 0);
+            return sizeof(Node) + sizeof(Link) * lv;
         }
 
         const K& get_key() const noexcept
@@ -79,96 +99,127 @@ private:
             return _level;
         }
 
-        void set_level(int lv) noexcept
+        Node* get_next(int lv) const noexcept
         {
-            assert(lv >= 0);
-            if (nullptr != _next)
-            {
-                assert(_level >= 0);
-                _next = (Node**) ::realloc(_next, sizeof(Node*) * (lv + 1));
-                if (lv > _level)
-                    ::memset(_next + _level + 1, 0, sizeof(Node*) * (lv - _level));
-            }
-            else
-            {
-                assert(_level < 0);
-                _next = (Node**) ::malloc(sizeof(Node*) * (lv + 1));
-                ::memset(_next, 0, sizeof(Node*) * (lv + 1));
-            }
-            _level = lv;
+            assert(0 <= lv && lv <= _level);
+            return _links[lv].next;
         }
 
-        Node* get_next(int lv) const noexcept
+    private:
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+
+        void set_next(int lv, Node *n) noexcept
         {
-            assert(nullptr != _next && 0 <= lv && lv <= _level);
-            return _next[lv];
+            assert(0 <= lv && lv <= _level);
+            _links[lv].next = n;
         }
 
-        void set_next(int lv, Node *n) noexcept
+        size_t get_span(int lv) const noexcept
         {
-            assert(nullptr != _next && 0 <= lv && lv <= _level);
-            _next[lv] = n;
+            assert(0 <= lv && lv <= _level);
+            return _links[lv].span;
         }
 
-    private:
-        Node(const Node&) = delete;
-        Node& operator=(const Node&) = delete;
+        void set_span(int lv, size_t span) noexcept
+        {
+            assert(0 <= lv && lv <= _level);
+            _links[lv].span = span;
+        }
 
     private:
         const K _key;
         V _value;
-        Node **_next = nullptr;
-        int _level = algo_type::INVALID_LEVEL; // 0-based
+        const int _level; // 0-based
+
+        // NOTE 这一部分是变长的，应该作为最后一个成员
+        Link _links[1];
+    };
+
+    /**
+     * 按键值升序的只读迭代器
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Node                      value_type;
+        typedef ptrdiff_t                 difference_type;
+        typedef const Node&               reference;
+        typedef const Node*               pointer;
+
+    public:
+        explicit const_iterator(const Node *n = nullptr) noexcept
+            : _current(n)
+        {}
+
+        const Node& operator*() const noexcept
+        {
+            assert(nullptr != _current);
+            return *_current;
+        }
+
+        const Node* operator->() const noexcept
+        {
+            assert(nullptr != _current);
+            return _current;
+        }
+
+        const_iterator& operator++() noexcept
+        {
+            assert(nullptr != _current);
+            _current = _current->get_next(0);
+            return *this;
+        }
+
+        const_iterator operator++(int) noexcept
+        {
+            const_iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const const_iterator& x) const noexcept
+        {
+            return _current == x._current;
+        }
+
+        bool operator!=(const const_iterator& x) const noexcept
+        {
+            return _current != x._current;
+        }
+
+    private:
+        const Node *_current = nullptr;
     };
 
 public:
-    SkipListMap() = default;
+    /**
+     * @param ma 节点内存分配器，为 nullptr 时直接使用 ::malloc()
+     */
+    explicit SkipListMap(memory_allocator *ma = nullptr) noexcept
+        : _alloc(ma)
+    {}
 
     SkipListMap(self_type&& x) noexcept
-        : _level(x._level), _head(x._head), _size(x._size)
+        : _alloc(x._alloc), _level(x._level), _size(x._size)
     {
+        if (_level >= 0)
+            ::memcpy(_head, x._head, sizeof(Link) * (_level + 1));
+
         x._level = algo_type::INVALID_LEVEL;
-        x._head = nullptr;
         x._size = 0;
     }
 
     SkipListMap(const self_type& x) noexcept
+        : _alloc(x._alloc)
     {
-        if (x._size == 0)
-            return;
-        assert(nullptr != x._head && x._level >= 0);
-
-        // Initial attributes
-        _level = x._level;
-        _head = (Node**) ::malloc(sizeof(Node*) * (_level + 1));
-        ::memset(_head, 0, sizeof(Node*) * (_level + 1));
-
-        // Copy nodes
-        Node **pre_lv = (Node**) ::malloc(sizeof(Node*) * (_level + 1));
-        ::memset(pre_lv, 0, sizeof(Node*) * (_level + 1));
-        Node *n = x._head[0];
-        while (nullptr != n)
-        {
-            Node *c = (Node*) ::malloc(sizeof(Node));
-            new (c) Node(n->get_key(), n->get_value());
-            const int level = n->get_level();
-            c->set_level(level);
-            algo_type::insert_node(c, *this, pre_lv);
-            for (size_t i = 0; i <= level; ++i)
-                pre_lv[i] = c;
-
-            n = n->get_next(0);
-        }
-        ::free(pre_lv);
-        _size = x._size;
+        copy_nodes(x);
     }
 
     ~SkipListMap() noexcept
     {
         clear();
-        if (nullptr != _head)
-            ::free(_head);
-        _head = nullptr;
         _level = algo_type::INVALID_LEVEL;
     }
 
@@ -178,15 +229,14 @@ public:
             return *this;
 
         clear();
-        if (nullptr != _head)
-            ::free(_head);
 
+        _alloc = x._alloc;
         _level = x._level;
-        _head = x._head;
+        if (_level >= 0)
+            ::memcpy(_head, x._head, sizeof(Link) * (_level + 1));
         _size = x._size;
 
         x._level = algo_type::INVALID_LEVEL;
-        x._head = nullptr;
         x._size = 0;
 
         return *this;
@@ -197,45 +247,8 @@ public:
         if (this == &x)
             return *this;
 
-        // Clear memory
         clear();
-        if (x._size == 0)
-            return *this;
-        assert(nullptr != x._head && x._level >= 0);
-
-        // Initial attributes
-        if (nullptr != _head)
-        {
-            assert(_level >= 0);
-            _head = (Node**) ::realloc(_head, sizeof(Node*) * (x._level + 1));
-        }
-        else
-        {
-            assert(_level < 0);
-            _head = (Node**) ::malloc(sizeof(Node*) * (x._level + 1));
-        }
-        _level = x._level;
-        ::memset(_head, 0, sizeof(Node*) * (_level + 1));
-
-        // Copy nodes
-        Node **pre_lv = (Node**) ::malloc(sizeof(Node*) * (_level + 1));
-        ::memset(pre_lv, 0, sizeof(Node*) * (_level + 1));
-        Node *n = x._head[0];
-        while (nullptr != n)
-        {
-            Node *c = (Node*) ::malloc(sizeof(Node));
-            new (c) Node(n->get_key(), n->get_value());
-            const int level = n->get_level();
-            c->set_level(level);
-            algo_type::insert_node(c, *this, pre_lv);
-            for (size_t i = 0; i <= level; ++i)
-                pre_lv[i] = c;
-
-            n = n->get_next(0);
-        }
-        ::free(pre_lv);
-        _size = x._size;
-
+        copy_nodes(x);
         return *this;
     }
 
@@ -247,9 +260,9 @@ public:
             return false;
         else if (0 == _size)
             return true;
-        assert(nullptr != _head && _level >= 0 && nullptr != x._head && x._level >= 0);
+        assert(_level >= 0 && x._level >= 0);
 
-        Node *current1 = _head[0], current2 = x._head[0];
+        Node *current1 = _head[0].next, *current2 = x._head[0].next;
         while (nullptr != current1)
         {
             assert(nullptr != current2);
@@ -290,72 +303,12 @@ public:
 
     V& operator[](K&& k) noexcept
     {
-        if (nullptr == _head)
-        {
-            assert(_level < 0 && _size == 0);
-            Node *n = (Node*) ::malloc(sizeof(Node));
-            new (n) Node(std::forward<K>(k), V());
-            _head = (Node**) ::malloc(sizeof(Node*) * 1);
-            _level = 0;
-            _head[0] = n;
-            n->set_level(0);
-            n->set_next(0, nullptr);
-            _size = 1;
-            return n->get_value();
-        }
-        assert(_level >= 0);
-
-        // Search
-        Node **pre_lv = (Node **) ::malloc(sizeof(Node*) * (_level + 1));
-        Node *n = algo_type::search_node(k, *this, pre_lv);
-        if (nullptr != n)
-        {
-            ::free(pre_lv);
-            return n->get_value();
-        }
-
-        // Insert
-        n = (Node*) ::malloc(sizeof(Node));
-        new (n) Node(std::forward<K>(k), V());
-        algo_type::insert_node(n, *this, pre_lv);
-        ::free(pre_lv);
-        ++_size;
-        return n->get_value();
+        return search_or_insert(std::forward<K>(k))->get_value();
     }
 
     V& operator[](const K& k) noexcept
     {
-        if (nullptr == _head)
-        {
-            assert(_level < 0 && _size == 0);
-            Node *n = (Node*) ::malloc(sizeof(Node));
-            new (n) Node(k, V());
-            _head = (Node**) ::malloc(sizeof(Node*) * 1);
-            _level = 0;
-            _head[0] = n;
-            n->set_level(0);
-            n->set_next(0, nullptr);
-            _size = 1;
-            return n->get_value();
-        }
-        assert(_level >= 0);
-
-        // Search
-        Node **pre_lv = (Node **) ::malloc(sizeof(Node*) * (_level + 1));
-        Node *n = algo_type::search_node(k, *this, pre_lv);
-        if (nullptr != n)
-        {
-            ::free(pre_lv);
-            return n->get_value();
-        }
-
-        // Insert
-        n = (Node*) ::malloc(sizeof(Node));
-        new (n) Node(k, V());
-        algo_type::insert_node(n, *this, pre_lv);
-        ::free(pre_lv);
-        ++_size;
-        return n->get_value();
+        return search_or_insert(k)->get_value();
     }
 
     int compare(const self_type& x) const noexcept
@@ -364,16 +317,16 @@ public:
             return 0;
         else if (0 == _size || 0 == x._size)
             return 0 == _size ? (0 != x._size ? -1 : 0) : 1;
-        assert(nullptr != _head && _level >= 0 && nullptr != x._head && x._level >= 0);
+        assert(_level >= 0 && x._level >= 0);
 
-        Node *current1 = _head[0], current2 = x._head[0];
+        Node *current1 = _head[0].next, *current2 = x._head[0].next;
         while (nullptr != current1 && nullptr != current2)
         {
-            const int krs = compare(current1->get_key(), current2->get_key());
+            const int krs = nut::compare(current1->get_key(), current2->get_key());
             if (0 != krs)
                 return krs;
 
-            const int vrs = compare(current1->get_value(), current2->get_value());
+            const int vrs = nut::compare(current1->get_value(), current2->get_value());
             if (0 != vrs)
                 return vrs;
 
@@ -392,17 +345,16 @@ public:
     {
         if (0 == _size)
             return;
-        assert(nullptr != _head && _level >= 0);
+        assert(_level >= 0);
 
-        Node *current = _head[0];
+        Node *current = _head[0].next;
         while (nullptr != current)
         {
             Node *next = current->get_next(0);
-            current->~Node();
-            ::free(current);
+            delete_node(current);
             current = next;
         }
-        ::memset(_head, 0, sizeof(Node*) * (_level + 1));
+        ::memset(_head, 0, sizeof(Link) * (_level + 1));
         _size = 0;
     }
 
@@ -410,7 +362,7 @@ public:
     {
         if (0 == _size)
             return false;
-        assert(nullptr != _head && _level >= 0);
+        assert(_level >= 0);
 
         return nullptr != algo_type::search_node(k, *this, nullptr);
     }
@@ -458,40 +410,7 @@ public:
      */
     int put(K&& k, V&& v, bool force = true) noexcept
     {
-        if (nullptr == _head)
-        {
-            assert(_level < 0 && _size == 0);
-            Node *n = (Node*) ::malloc(sizeof(Node));
-            new (n) Node(std::forward<K>(k), std::forward<V>(v));
-            _head = (Node**) ::malloc(sizeof(Node*) * 1);
-            _level = 0;
-            _head[0] = n;
-            n->set_level(0);
-            n->set_next(0, nullptr);
-            _size = 1;
-            return 1;
-        }
-        assert(_level >= 0);
-
-        // Search
-        Node **pre_lv = (Node **) ::malloc(sizeof(Node*) * (_level + 1));
-        Node *n = algo_type::search_node(k, *this, pre_lv);
-        if (nullptr != n)
-        {
-            ::free(pre_lv);
-            if (!force)
-                return 0;
-            n->set_value(std::forward<V>(v));
-            return -1;
-        }
-
-        // Insert
-        n = (Node*) ::malloc(sizeof(Node));
-        new (n) Node(std::forward<K>(k), std::forward<V>(v));
-        algo_type::insert_node(n, *this, pre_lv);
-        ::free(pre_lv);
-        ++_size;
-        return 1;
+        return put_node(std::forward<K>(k), std::forward<V>(v), force);
     }
 
     /**
@@ -501,40 +420,7 @@ public:
      */
     int put(const K& k, V&& v, bool force = true) noexcept
     {
-        if (nullptr == _head)
-        {
-            assert(_level < 0 && _size == 0);
-            Node *n = (Node*) ::malloc(sizeof(Node));
-            new (n) Node(k, std::forward<V>(v));
-            _head = (Node**) ::malloc(sizeof(Node*) * 1);
-            _level = 0;
-            _head[0] = n;
-            n->set_level(0);
-            n->set_next(0, nullptr);
-            _size = 1;
-            return 1;
-        }
-        assert(_level >= 0);
-
-        // Search
-        Node **pre_lv = (Node **) ::malloc(sizeof(Node*) * (_level + 1));
-        Node *n = algo_type::search_node(k, *this, pre_lv);
-        if (nullptr != n)
-        {
-            ::free(pre_lv);
-            if (!force)
-                return 0;
-            n->set_value(std::forward<V>(v));
-            return -1;
-        }
-
-        // Insert
-        n = (Node*) ::malloc(sizeof(Node));
-        new (n) Node(k, std::forward<V>(v));
-        algo_type::insert_node(n, *this, pre_lv);
-        ::free(pre_lv);
-        ++_size;
-        return 1;
+        return put_node(k, std::forward<V>(v), force);
     }
 
     /**
@@ -544,40 +430,7 @@ public:
      */
     int put(K&& k, const V& v, bool force = true) noexcept
     {
-        if (nullptr == _head)
-        {
-            assert(_level < 0 && _size == 0);
-            Node *n = (Node*) ::malloc(sizeof(Node));
-            new (n) Node(std::forward<K>(k), v);
-            _head = (Node**) ::malloc(sizeof(Node*) * 1);
-            _level = 0;
-            _head[0] = n;
-            n->set_level(0);
-            n->set_next(0, nullptr);
-            _size = 1;
-            return 1;
-        }
-        assert(_level >= 0);
-
-        // Search
-        Node **pre_lv = (Node **) ::malloc(sizeof(Node*) * (_level + 1));
-        Node *n = algo_type::search_node(k, *this, pre_lv);
-        if (nullptr != n)
-        {
-            ::free(pre_lv);
-            if (!force)
-                return 0;
-            n->set_value(v);
-            return -1;
-        }
-
-        // Insert
-        n = (Node*) ::malloc(sizeof(Node));
-        new (n) Node(std::forward<K>(k), v);
-        algo_type::insert_node(n, *this, pre_lv);
-        ::free(pre_lv);
-        ++_size;
-        return 1;
+        return put_node(std::forward<K>(k), v, force);
     }
 
     /**
@@ -587,40 +440,7 @@ public:
      */
     int put(const K& k, const V& v, bool force = true) noexcept
     {
-        if (nullptr == _head)
-        {
-            assert(_level < 0 && _size == 0);
-            Node *n = (Node*) ::malloc(sizeof(Node));
-            new (n) Node(k, v);
-            _head = (Node**) ::malloc(sizeof(Node*) * 1);
-            _level = 0;
-            _head[0] = n;
-            n->set_level(0);
-            n->set_next(0, nullptr);
-            _size = 1;
-            return 1;
-        }
-        assert(_level >= 0);
-
-        // Search
-        Node **pre_lv = (Node **) ::malloc(sizeof(Node*) * (_level + 1));
-        Node *n = algo_type::search_node(k, *this, pre_lv);
-        if (nullptr != n)
-        {
-            ::free(pre_lv);
-            if (!force)
-                return 0;
-            n->set_value(v);
-            return -1;
-        }
-
-        // Insert
-        n = (Node*) ::malloc(sizeof(Node));
-        new (n) Node(k, v);
-        algo_type::insert_node(n, *this, pre_lv);
-        ::free(pre_lv);
-        ++_size;
-        return 1;
+        return put_node(k, v, force);
     }
 
     /**
@@ -631,22 +451,17 @@ public:
     {
         if (0 == _size)
             return false;
-        assert(nullptr != _head && _level >= 0);
+        assert(_level >= 0);
 
         // Search
-        Node **pre_lv = (Node **) ::malloc(sizeof(Node*) * (_level + 1));
+        Node *pre_lv[algo_type::MAX_LEVEL + 1];
         Node *n = algo_type::search_node(k, *this, pre_lv);
         if (nullptr == n)
-        {
-            ::free(pre_lv);
             return false;
-        }
 
         // Remove
         algo_type::remove_node(n, *this, pre_lv);
-        ::free(pre_lv);
-        n->~Node();
-        ::free(n);
+        delete_node(n);
         --_size;
         return true;
     }
@@ -655,53 +470,248 @@ public:
     {
         if (0 == _size)
             return nullptr;
-        assert(nullptr != _head && _level >= 0);
+        assert(_level >= 0);
         Node *n = algo_type::search_node(k, *this, nullptr);
         if (nullptr == n)
             return nullptr;
         return &n->get_value();
     }
 
+    const_iterator begin() const noexcept
+    {
+        return const_iterator(_level < 0 ? nullptr : _head[0].next);
+    }
+
+    const_iterator end() const noexcept
+    {
+        return const_iterator();
+    }
+
+    /**
+     * @return 指向第一个键值 >= k 的数据
+     */
+    const_iterator lower_bound(const K& k) const noexcept
+    {
+        return const_iterator(algo_type::lower_bound(k, *this));
+    }
+
+    /**
+     * @return 指向第一个键值 > k 的数据
+     */
+    const_iterator upper_bound(const K& k) const noexcept
+    {
+        return const_iterator(algo_type::upper_bound(k, *this));
+    }
+
+    /**
+     * @return 键值 < k 的数据个数，即 lower_bound(k) 的 0-based 位置
+     */
+    size_t rank(const K& k) const noexcept
+    {
+        return algo_type::rank(k, *this);
+    }
+
+    /**
+     * @param index 0-based 位置
+     * @return 指向第 index 个数据, 越界则返回 end()
+     */
+    const_iterator select(size_t index) const noexcept
+    {
+        if (index >= _size)
+            return end();
+        return const_iterator(algo_type::select(index, *this));
+    }
+
+    /**
+     * 按键值升序访问 [lo, hi) 范围内的数据
+     *
+     * @param visitor 形如 bool visitor(const K&, const V&), 返回 false 则终止遍历
+     * @return 访问的数据个数
+     */
+    template <typename VISITOR>
+    size_t range(const K& lo, const K& hi, VISITOR&& visitor) const noexcept
+    {
+        size_t count = 0;
+        for (const Node *n = algo_type::lower_bound(lo, *this);
+             nullptr != n && nut::compare(n->get_key(), hi) < 0; n = n->get_next(0))
+        {
+            ++count;
+            if (!visitor(n->get_key(), n->get_value()))
+                break;
+        }
+        return count;
+    }
+
+    /**
+     * 用已按键值升序排列的数据重建跳表, O(n)
+     *
+     * 原有数据会被清除; 键值重复的数据只保留第一个
+     *
+     * @param first, last 迭代器, 要求 first->first 为键值, first->second 为数据
+     */
+    template <typename ITER>
+    void assign_sorted(ITER first, ITER last) noexcept
+    {
+        clear();
+        if (_level < 0)
+            set_level(0);
+
+        Node *tail_lv[algo_type::MAX_LEVEL + 1];
+        size_t rank_lv[algo_type::MAX_LEVEL + 1];
+        ::memset(tail_lv, 0, sizeof(tail_lv));
+        ::memset(rank_lv, 0, sizeof(rank_lv));
+        for (; first != last; ++first)
+        {
+            if (nullptr != tail_lv[0] && !(tail_lv[0]->get_key() < first->first))
+            {
+                assert(!(first->first < tail_lv[0]->get_key())); // Should be sorted
+                continue;
+            }
+            append_node(new_node(algo_type::balanced_level(_size + 1), first->first, first->second),
+                        tail_lv, rank_lv);
+        }
+    }
+
 private:
-    int get_level() const noexcept
+    template <typename KK, typename VV>
+    Node* new_node(int lv, KK&& k, VV&& v) noexcept
     {
-        return _level;
+        Node *n = (Node*) ma_alloc(_alloc, Node::alloc_size(lv));
+        assert(nullptr != n);
+        new (n) Node(lv, std::forward<KK>(k), std::forward<VV>(v));
+        return n;
     }
 
-    void set_level(int lv) noexcept
+    void delete_node(Node *n) noexcept
     {
-        assert(lv >= 0);
-        if (nullptr != _head)
+        assert(nullptr != n);
+        const size_t sz = Node::alloc_size(n->get_level());
+        n->~Node();
+        ma_free(_alloc, n, sz);
+    }
+
+    /**
+     * 在表尾添加节点
+     *
+     * @param tail_lv 各层的尾节点
+     * @param rank_lv 各层尾节点的排名
+     */
+    void append_node(Node *n, Node **tail_lv, size_t *rank_lv) noexcept
+    {
+        assert(nullptr != n && _level >= 0);
+        algo_type::insert_node(n, *this, tail_lv, rank_lv);
+        ++_size;
+        for (int i = 0, level = n->get_level(); i <= level; ++i)
         {
-            assert(_level >= 0);
-            _head = (Node**) ::realloc(_head, sizeof(Node*) * (lv + 1));
-            if (lv > _level)
-                ::memset(_head + _level + 1, 0, sizeof(Node*) * (lv - _level));
+            tail_lv[i] = n;
+            rank_lv[i] = _size;
         }
-        else
+    }
+
+    /**
+     * 按顺序复制 x 的所有节点，各节点保持原有层数
+     */
+    void copy_nodes(const self_type& x) noexcept
+    {
+        assert(0 == _size);
+        if (0 == x._size)
+            return;
+        assert(x._level >= 0);
+
+        set_level(0);
+        Node *tail_lv[algo_type::MAX_LEVEL + 1];
+        size_t rank_lv[algo_type::MAX_LEVEL + 1];
+        ::memset(tail_lv, 0, sizeof(tail_lv));
+        ::memset(rank_lv, 0, sizeof(rank_lv));
+        for (Node *n = x._head[0].next; nullptr != n; n = n->get_next(0))
+            append_node(new_node(n->get_level(), n->get_key(), n->get_value()), tail_lv, rank_lv);
+        assert(_size == x._size);
+    }
+
+    template <typename KK>
+    Node* search_or_insert(KK&& k) noexcept
+    {
+        if (_level < 0)
+            set_level(0);
+
+        Node *pre_lv[algo_type::MAX_LEVEL + 1];
+        size_t rank_lv[algo_type::MAX_LEVEL + 1];
+        Node *n = algo_type::search_node(k, *this, pre_lv, rank_lv);
+        if (nullptr != n)
+            return n;
+
+        n = new_node(algo_type::random_level(), std::forward<KK>(k), V());
+        algo_type::insert_node(n, *this, pre_lv, rank_lv);
+        ++_size;
+        return n;
+    }
+
+    template <typename KK, typename VV>
+    int put_node(KK&& k, VV&& v, bool force) noexcept
+    {
+        if (_level < 0)
+            set_level(0);
+
+        // Search
+        Node *pre_lv[algo_type::MAX_LEVEL + 1];
+        size_t rank_lv[algo_type::MAX_LEVEL + 1];
+        Node *n = algo_type::search_node(k, *this, pre_lv, rank_lv);
+        if (nullptr != n)
         {
-            assert(_level < 0);
-            _head = (Node**) ::malloc(sizeof(Node*) * (lv + 1));
-            ::memset(_head, 0, sizeof(Node*) * (lv + 1));
+            if (!force)
+                return 0;
+            n->set_value(std::forward<VV>(v));
+            return -1;
         }
+
+        // Insert
+        n = new_node(algo_type::random_level(), std::forward<KK>(k), std::forward<VV>(v));
+        algo_type::insert_node(n, *this, pre_lv, rank_lv);
+        ++_size;
+        return 1;
+    }
+
+    int get_level() const noexcept
+    {
+        return _level;
+    }
+
+    void set_level(int lv) noexcept
+    {
+        assert(lv >= 0 && lv <= algo_type::MAX_LEVEL);
+        if (lv > _level)
+            ::memset(_head + _level + 1, 0, sizeof(Link) * (lv - _level));
         _level = lv;
     }
 
     Node* get_head(int lv) const noexcept
     {
-        assert(nullptr != _head && 0 <= lv && lv <= _level);
-        return _head[lv];
+        assert(0 <= lv && lv <= _level);
+        return _head[lv].next;
     }
 
     void set_head(int lv, Node *n) noexcept
     {
-        assert(nullptr != _head && 0 <= lv && lv <= _level);
-        _head[lv] = n;
+        assert(0 <= lv && lv <= _level);
+        _head[lv].next = n;
+    }
+
+    size_t get_head_span(int lv) const noexcept
+    {
+        assert(0 <= lv && lv <= _level);
+        return _head[lv].span;
+    }
+
+    void set_head_span(int lv, size_t span) noexcept
+    {
+        assert(0 <= lv && lv <= _level);
+        _head[lv].span = span;
     }
 
 private:
+    rc_ptr<memory_allocator> _alloc;
     int _level = algo_type::INVALID_LEVEL; // 0-based
-    Node **_head = nullptr;
+    Link _head[algo_type::MAX_LEVEL + 1];
     size_t _size = 0;
 };
 
@@ -2,9 +2,15 @@
 #ifndef ___HEADFILE_60C4D68A_A1D8_4B2C_A488_40E9A9FFE426_
 #define ___HEADFILE_60C4D68A_A1D8_4B2C_A488_40E9A9FFE426_
 
+#include <assert.h>
+#include <stddef.h> // for ptrdiff_t
 #include <stdlib.h>
+#include <string.h> // for ::memset()
 #include <new>
+#include <iterator>
+#include <utility> // for std::forward()
 
+#include "../../mem/memory_allocator.h"
 #include "../comparable.h"
 #include "skiplist.h"
 
@@ -12,6 +18,11 @@
 namespace nut
 {
 
+/**
+ * 跳表 set
+ *
+ * 节点内存布局同 SkipListMap
+ */
 template <typename T>
 class SkipListSet
 {
@@ -22,23 +33,30 @@ private:
 
     friend class SkipList<T,Node,self_type>;
 
+    struct Link
+    {
+        Node *next;
+        size_t span;
+    };
+
     class Node
     {
     public:
-        explicit Node(T&& k) noexcept
-            : _key(std::forward<T>(k))
-        {}
-
-        explicit Node(const T& k) noexcept
-            : _key(k)
-        {}
+        template <typename ...Args>
+        explicit Node(int lv, Args&& ...args) noexcept
+            : _key(std::forward<Args>(args)...), _level(lv)
+        {
+            assert(lv >= 0);
+            ::memset(_links, 0, sizeof(Link) * (lv + 1));
+        }
 
-        ~Node() noexcept
+        /**
+         * 具有 lv 层的节点所占用的内存大小
+         */
+        static size_t alloc_size(int lv) noexcept
         {
-            if (nullptr != _next)
-                ::free(_next);
-            _next = nullptr;
-            _level = algo_type::INVALID_LEVEL;
+            assert(lv >= 0);
+            return sizeof(Node) + sizeof(Link) * lv;
         }
 
         const T& get_key() const noexcept
@@ -51,35 +69,28 @@ private:
             return _level;
         }
 
-        void set_level(int lv) noexcept
+        Node* get_next(int lv) const noexcept
         {
-            assert(lv >= 0);
-            if (nullptr != _next)
-            {
-                assert(_level >= 0);
-                _next = (Node**) ::realloc(_next, sizeof(Node*) * (lv + 1));
-                if (lv > _level)
-                    ::memset(_next + _level + 1, 0, sizeof(Node*) * (lv - _level));
-            }
-            else
-            {
-                assert(_level < 0);
-                _next = (Node**) ::malloc(sizeof(Node*) * (lv + 1));
-                ::memset(_next, 0, sizeof(Node*) * (lv + 1));
-            }
-            _level = lv;
+            assert(0 <= lv && lv <= _level);
+            return _links[lv].next;
         }
 
-        Node* get_next(int lv) const noexcept
+        void set_next(int lv, Node *n) noexcept
         {
-            assert(nullptr != _next && 0 <= lv && lv <= _level);
-            return _next[lv];
+            assert(0 <= lv && lv <= _level);
+            _links[lv].next = n;
         }
 
-        void set_next(int lv, Node *n) noexcept
+        size_t get_span(int lv) const noexcept
         {
-            assert(nullptr != _next && 0 <= lv && lv <= _level);
-            _next[lv] = n;
+            assert(0 <= lv && lv <= _level);
+            return _links[lv].span;
+        }
+
+        void set_span(int lv, size_t span) noexcept
+        {
+            assert(0 <= lv && lv <= _level);
+            _links[lv].span = span;
         }
 
     private:
@@ -88,58 +99,97 @@ private:
 
     private:
         const T _key;
-        Node **_next = nullptr;
-        int _level = algo_type::INVALID_LEVEL; // 0-based
+        const int _level; // 0-based
+
+        // NOTE 这一部分是变长的，应该作为最后一个成员
+        Link _links[1];
+    };
+
+public:
+    /**
+     * 升序的只读迭代器
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T                         value_type;
+        typedef ptrdiff_t                 difference_type;
+        typedef const T&                  reference;
+        typedef const T*                  pointer;
+
+    public:
+        explicit const_iterator(const Node *n = nullptr) noexcept
+            : _current(n)
+        {}
+
+        const T& operator*() const noexcept
+        {
+            assert(nullptr != _current);
+            return _current->get_key();
+        }
+
+        const T* operator->() const noexcept
+        {
+            assert(nullptr != _current);
+            return &_current->get_key();
+        }
+
+        const_iterator& operator++() noexcept
+        {
+            assert(nullptr != _current);
+            _current = _current->get_next(0);
+            return *this;
+        }
+
+        const_iterator operator++(int) noexcept
+        {
+            const_iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const const_iterator& x) const noexcept
+        {
+            return _current == x._current;
+        }
+
+        bool operator!=(const const_iterator& x) const noexcept
+        {
+            return _current != x._current;
+        }
+
+    private:
+        const Node *_current = nullptr;
     };
 
 public:
-    SkipListSet() = default;
+    /**
+     * @param ma 节点内存分配器，为 nullptr 时直接使用 ::malloc()
+     */
+    explicit SkipListSet(memory_allocator *ma = nullptr) noexcept
+        : _alloc(ma)
+    {}
 
     SkipListSet(self_type&& x) noexcept
-        : _level(x._level), _head(x._head), _size(x._size)
+        : _alloc(x._alloc), _level(x._level), _size(x._size)
     {
+        if (_level >= 0)
+            ::memcpy(_head, x._head, sizeof(Link) * (_level + 1));
+
         x._level = algo_type::INVALID_LEVEL;
-        x._head = nullptr;
         x._size = 0;
     }
 
     SkipListSet(const self_type& x) noexcept
+        : _alloc(x._alloc)
     {
-        if (x._size == 0)
-            return;
-        assert(nullptr != x._head && x._level >= 0);
-
-        // Initial attributes
-        _level = x._level;
-        _head = (Node**) ::malloc(sizeof(Node*) * (_level + 1));
-        ::memset(_head, 0, sizeof(Node*) * (_level + 1));
-
-        // Copy nodes
-        Node **pre_lv = (Node**) ::malloc(sizeof(Node*) * (_level + 1));
-        ::memset(pre_lv, 0, sizeof(Node*) * (_level + 1));
-        Node *n = x._head[0];
-        while (nullptr != n)
-        {
-            Node *c = (Node*) ::malloc(sizeof(Node));
-            new (c) Node(n->get_key());
-            const int level = n->get_level();
-            c->set_level(level);
-            algo_type::insert_node(c, *this, pre_lv);
-            for (size_t i = 0; i <= level; ++i)
-                pre_lv[i] = c;
-
-            n = n->get_next(0);
-        }
-        ::free(pre_lv);
-        _size = x._size;
+        copy_nodes(x);
     }
 
     ~SkipListSet() noexcept
     {
         clear();
-        if (nullptr != _head)
-            ::free(_head);
-        _head = nullptr;
         _level = algo_type::INVALID_LEVEL;
     }
 
@@ -149,15 +199,14 @@ public:
             return *this;
 
         clear();
-        if (nullptr != _head)
-            ::free(_head);
 
+        _alloc = x._alloc;
         _level = x._level;
-        _head = x._head;
+        if (_level >= 0)
+            ::memcpy(_head, x._head, sizeof(Link) * (_level + 1));
         _size = x._size;
 
         x._level = algo_type::INVALID_LEVEL;
-        x._head = nullptr;
         x._size = 0;
 
         return *this;
@@ -168,45 +217,8 @@ public:
         if (this == &x)
             return *this;
 
-        // Clear memory
         clear();
-        if (x._size == 0)
-            return *this;
-        assert(nullptr != x._head && x._level >= 0);
-
-        // Initial attributes
-        if (nullptr != _head)
-        {
-            assert(_level >= 0);
-            _head = (Node**) ::realloc(_head, sizeof(Node*) * (x._level + 1));
-        }
-        else
-        {
-            assert(_level < 0);
-            _head = (Node**) ::malloc(sizeof(Node*) * (x._level + 1));
-        }
-        _level = x._level;
-        ::memset(_head, 0, sizeof(Node*) * (_level + 1));
-
-        // Copy nodes
-        Node **pre_lv = (Node**) ::malloc(sizeof(Node*) * (_level + 1));
-        ::memset(pre_lv, 0, sizeof(Node*) * (_level + 1));
-        Node *n = x._head[0];
-        while (nullptr != n)
-        {
-            Node *c = (Node*) ::malloc(sizeof(Node));
-            new (c) Node(n->get_key());
-            const int level = n->get_level();
-            c->set_level(level);
-            algo_type::insert_node(c, *this, pre_lv);
-            for (size_t i = 0; i <= level; ++i)
-                pre_lv[i] = c;
-
-            n = n->get_next(0);
-        }
-        ::free(pre_lv);
-        _size = x._size;
-
+        copy_nodes(x);
         return *this;
     }
 
@@ -218,9 +230,9 @@ public:
             return false;
         else if (0 == _size)
             return true;
-        assert(nullptr != _head && _level >= 0 && nullptr != x._head && x._level >= 0);
+        assert(_level >= 0 && x._level >= 0);
 
-        Node *current1 = _head[0], current2 = x._head[0];
+        Node *current1 = _head[0].next, *current2 = x._head[0].next;
         while (nullptr != current1)
         {
             assert(nullptr != current2);
@@ -264,12 +276,12 @@ public:
             return 0;
         else if (0 == _size || 0 == x._size)
             return 0 == _size ? (0 != x._size ? -1 : 0) : 1;
-        assert(nullptr != _head && _level >= 0 && nullptr != x._head && x._level >= 0);
+        assert(_level >= 0 && x._level >= 0);
 
-        Node *current1 = _head[0], current2 = x._head[0];
+        Node *current1 = _head[0].next, *current2 = x._head[0].next;
         while (nullptr != current1 && nullptr != current2)
         {
-            const int rs = compare(current1->get_key(), current2->get_key());
+            const int rs = nut::compare(current1->get_key(), current2->get_key());
             if (0 != rs)
                 return rs;
 
@@ -288,17 +300,16 @@ public:
     {
         if (0 == _size)
             return;
-        assert(nullptr != _head && _level >= 0);
+        assert(_level >= 0);
 
-        Node *current = _head[0];
+        Node *current = _head[0].next;
         while (nullptr != current)
         {
             Node *next = current->get_next(0);
-            current->~Node();
-            ::free(current);
+            delete_node(current);
             current = next;
         }
-        ::memset(_head, 0, sizeof(Node*) * (_level + 1));
+        ::memset(_head, 0, sizeof(Link) * (_level + 1));
         _size = 0;
     }
 
@@ -306,7 +317,7 @@ public:
     {
         if (0 == _size)
             return false;
-        assert(nullptr != _head && _level >= 0);
+        assert(_level >= 0);
 
         return nullptr != algo_type::search_node(k, *this, nullptr);
     }
@@ -317,38 +328,7 @@ public:
     template <typename ...Args>
     bool emplace(Args&& ...args) noexcept
     {
-        if (nullptr == _head)
-        {
-            assert(_level < 0 && _size == 0);
-            Node *n = (Node*) ::malloc(sizeof(Node));
-            new (n) Node(std::forward<Args>(args)...);
-            _head = (Node**) ::malloc(sizeof(Node*) * 1);
-            _level = 0;
-            _head[0] = n;
-            n->set_level(0);
-            n->set_next(0, nullptr);
-            _size = 1;
-            return true;
-        }
-        assert(_level >= 0);
-
-        // Search
-        T k(std::forward<Args>(args)...);
-        Node **pre_lv = (Node **) ::malloc(sizeof(Node*) * (_level + 1));
-        Node *n = algo_type::search_node(k, *this, pre_lv);
-        if (nullptr != n)
-        {
-            ::free(pre_lv);
-            return false;
-        }
-
-        // Insert
-        n = (Node*) ::malloc(sizeof(Node));
-        new (n) Node(std::move(k));
-        algo_type::insert_node(n, *this, pre_lv);
-        ::free(pre_lv);
-        ++_size;
-        return true;
+        return add_node(T(std::forward<Args>(args)...));
     }
 
     /**
@@ -356,105 +336,207 @@ public:
      */
     bool add(T&& k) noexcept
     {
-        if (nullptr == _head)
-        {
-            assert(_level < 0 && _size == 0);
-            Node *n = (Node*) ::malloc(sizeof(Node));
-            new (n) Node(std::forward<T>(k));
-            _head = (Node**) ::malloc(sizeof(Node*) * 1);
-            _level = 0;
-            _head[0] = n;
-            n->set_level(0);
-            n->set_next(0, nullptr);
-            _size = 1;
-            return true;
-        }
+        return add_node(std::forward<T>(k));
+    }
+
+    /**
+     * @return 插入成功返回 true; 否则表示存在重复数据, 返回 false
+     */
+    bool add(const T& k) noexcept
+    {
+        return add_node(k);
+    }
+
+    /**
+     * @return 删除成功返回 true; 否则表示未找到数据, 返回 false
+     */
+    bool remove(const T& k) noexcept
+    {
+        if (0 == _size)
+            return false;
         assert(_level >= 0);
 
         // Search
-        Node **pre_lv = (Node **) ::malloc(sizeof(Node*) * (_level + 1));
+        Node *pre_lv[algo_type::MAX_LEVEL + 1];
         Node *n = algo_type::search_node(k, *this, pre_lv);
-        if (nullptr != n)
-        {
-            ::free(pre_lv);
+        if (nullptr == n)
             return false;
-        }
 
-        // Insert
-        n = (Node*) ::malloc(sizeof(Node));
-        new (n) Node(std::forward<T>(k));
-        algo_type::insert_node(n, *this, pre_lv);
-        ::free(pre_lv);
-        ++_size;
+        // Remove
+        algo_type::remove_node(n, *this, pre_lv);
+        delete_node(n);
+        --_size;
         return true;
     }
 
+    const_iterator begin() const noexcept
+    {
+        return const_iterator(_level < 0 ? nullptr : _head[0].next);
+    }
+
+    const_iterator end() const noexcept
+    {
+        return const_iterator();
+    }
+
     /**
-     * @return 插入成功返回 true; 否则表示存在重复数据, 返回 false
+     * @return 指向第一个 >= k 的数据
      */
-    bool add(const T& k) noexcept
+    const_iterator lower_bound(const T& k) const noexcept
+    {
+        return const_iterator(algo_type::lower_bound(k, *this));
+    }
+
+    /**
+     * @return 指向第一个 > k 的数据
+     */
+    const_iterator upper_bound(const T& k) const noexcept
+    {
+        return const_iterator(algo_type::upper_bound(k, *this));
+    }
+
+    /**
+     * @return < k 的数据个数，即 lower_bound(k) 的 0-based 位置
+     */
+    size_t rank(const T& k) const noexcept
+    {
+        return algo_type::rank(k, *this);
+    }
+
+    /**
+     * @param index 0-based 位置
+     * @return 指向第 index 个数据, 越界则返回 end()
+     */
+    const_iterator select(size_t index) const noexcept
     {
-        if (nullptr == _head)
+        if (index >= _size)
+            return end();
+        return const_iterator(algo_type::select(index, *this));
+    }
+
+    /**
+     * 按升序访问 [lo, hi) 范围内的数据
+     *
+     * @param visitor 形如 bool visitor(const T&), 返回 false 则终止遍历
+     * @return 访问的数据个数
+     */
+    template <typename VISITOR>
+    size_t range(const T& lo, const T& hi, VISITOR&& visitor) const noexcept
+    {
+        size_t count = 0;
+        for (const Node *n = algo_type::lower_bound(lo, *this);
+             nullptr != n && nut::compare(n->get_key(), hi) < 0; n = n->get_next(0))
         {
-            assert(_level < 0 && _size == 0);
-            Node *n = (Node*) ::malloc(sizeof(Node));
-            new (n) Node(k);
-            _head = (Node**) ::malloc(sizeof(Node*) * 1);
-            _level = 0;
-            _head[0] = n;
-            n->set_level(0);
-            n->set_next(0, nullptr);
-            _size = 1;
-            return true;
+            ++count;
+            if (!visitor(n->get_key()))
+                break;
         }
-        assert(_level >= 0);
+        return count;
+    }
 
-        // Search
-        Node **pre_lv = (Node **) ::malloc(sizeof(Node*) * (_level + 1));
-        Node *n = algo_type::search_node(k, *this, pre_lv);
-        if (nullptr != n)
+    /**
+     * 用已升序排列的数据重建跳表, O(n)
+     *
+     * 原有数据会被清除; 重复的数据只保留第一个
+     */
+    template <typename ITER>
+    void assign_sorted(ITER first, ITER last) noexcept
+    {
+        clear();
+        if (_level < 0)
+            set_level(0);
+
+        Node *tail_lv[algo_type::MAX_LEVEL + 1];
+        size_t rank_lv[algo_type::MAX_LEVEL + 1];
+        ::memset(tail_lv, 0, sizeof(tail_lv));
+        ::memset(rank_lv, 0, sizeof(rank_lv));
+        for (; first != last; ++first)
         {
-            ::free(pre_lv);
-            return false;
+            if (nullptr != tail_lv[0] && !(tail_lv[0]->get_key() < *first))
+            {
+                assert(!(*first < tail_lv[0]->get_key())); // Should be sorted
+                continue;
+            }
+            append_node(new_node(algo_type::balanced_level(_size + 1), *first), tail_lv, rank_lv);
         }
+    }
 
-        // Insert
-        n = (Node*) ::malloc(sizeof(Node));
-        new (n) Node(k);
-        algo_type::insert_node(n, *this, pre_lv);
-        ::free(pre_lv);
+private:
+    template <typename ...Args>
+    Node* new_node(int lv, Args&& ...args) noexcept
+    {
+        Node *n = (Node*) ma_alloc(_alloc, Node::alloc_size(lv));
+        assert(nullptr != n);
+        new (n) Node(lv, std::forward<Args>(args)...);
+        return n;
+    }
+
+    void delete_node(Node *n) noexcept
+    {
+        assert(nullptr != n);
+        const size_t sz = Node::alloc_size(n->get_level());
+        n->~Node();
+        ma_free(_alloc, n, sz);
+    }
+
+    /**
+     * 在表尾添加节点
+     *
+     * @param tail_lv 各层的尾节点
+     * @param rank_lv 各层尾节点的排名
+     */
+    void append_node(Node *n, Node **tail_lv, size_t *rank_lv) noexcept
+    {
+        assert(nullptr != n && _level >= 0);
+        algo_type::insert_node(n, *this, tail_lv, rank_lv);
         ++_size;
-        return true;
+        for (int i = 0, level = n->get_level(); i <= level; ++i)
+        {
+            tail_lv[i] = n;
+            rank_lv[i] = _size;
+        }
     }
 
     /**
-     * @return 删除成功返回 true; 否则表示未找到数据, 返回 false
+     * 按顺序复制 x 的所有节点，各节点保持原有层数
      */
-    bool remove(const T& k) noexcept
+    void copy_nodes(const self_type& x) noexcept
     {
-        if (0 == _size)
-            return false;
-        assert(nullptr != _head && _level >= 0);
+        assert(0 == _size);
+        if (0 == x._size)
+            return;
+        assert(x._level >= 0);
+
+        set_level(0);
+        Node *tail_lv[algo_type::MAX_LEVEL + 1];
+        size_t rank_lv[algo_type::MAX_LEVEL + 1];
+        ::memset(tail_lv, 0, sizeof(tail_lv));
+        ::memset(rank_lv, 0, sizeof(rank_lv));
+        for (Node *n = x._head[0].next; nullptr != n; n = n->get_next(0))
+            append_node(new_node(n->get_level(), n->get_key()), tail_lv, rank_lv);
+        assert(_size == x._size);
+    }
+
+    template <typename TT>
+    bool add_node(TT&& k) noexcept
+    {
+        if (_level < 0)
+            set_level(0);
 
         // Search
-        Node **pre_lv = (Node **) ::malloc(sizeof(Node*) * (_level + 1));
-        Node *n = algo_type::search_node(k, *this, pre_lv);
-        if (nullptr == n)
-        {
-            ::free(pre_lv);
+        Node *pre_lv[algo_type::MAX_LEVEL + 1];
+        size_t rank_lv[algo_type::MAX_LEVEL + 1];
+        Node *n = algo_type::search_node(k, *this, pre_lv, rank_lv);
+        if (nullptr != n)
             return false;
-        }
 
-        // Remove
-        algo_type::remove_node(n, *this, pre_lv);
-        ::free(pre_lv);
-        n->~Node();
-        ::free(n);
-        --_size;
+        // Insert
+        n = new_node(algo_type::random_level(), std::forward<TT>(k));
+        algo_type::insert_node(n, *this, pre_lv, rank_lv);
+        ++_size;
         return true;
     }
 
-private:
     int get_level() const noexcept
     {
         return _level;
@@ -462,38 +544,40 @@ private:
 
     void set_level(int lv) noexcept
     {
-        assert(lv >= 0);
-        if (nullptr != _head)
-        {
-            assert(_level >= 0);
-            _head = (Node**) ::realloc(_head, sizeof(Node*) * (lv + 1));
-            if (lv > _level)
-                ::memset(_head + _level + 1, 0, sizeof(Node*) * (lv - _level));
-        }
-        else
-        {
-            assert(_level < 0);
-            _head = (Node**) ::malloc(sizeof(Node*) * (lv + 1));
-            ::memset(_head, 0, sizeof(Node*) * (lv + 1));
-        }
+        assert(lv >= 0 && lv <= algo_type::MAX_LEVEL);
+        if (lv > _level)
+            ::memset(_head + _level + 1, 0, sizeof(Link) * (lv - _level));
         _level = lv;
     }
 
     Node* get_head(int lv) const noexcept
     {
-        assert(nullptr != _head && 0 <= lv && lv <= _level);
-        return _head[lv];
+        assert(0 <= lv && lv <= _level);
+        return _head[lv].next;
     }
 
     void set_head(int lv, Node *n) noexcept
     {
-        assert(nullptr != _head && 0 <= lv && lv <= _level);
-        _head[lv] = n;
+        assert(0 <= lv && lv <= _level);
+        _head[lv].next = n;
+    }
+
+    size_t get_head_span(int lv) const noexcept
+    {
+        assert(0 <= lv && lv <= _level);
+        return _head[lv].span;
+    }
+
+    void set_head_span(int lv, size_t span) noexcept
+    {
+        assert(0 <= lv && lv <= _level);
+        _head[lv].span = span;
     }
 
 private:
+    rc_ptr<memory_allocator> _alloc;
     int _level = algo_type::INVALID_LEVEL; // 0-based
-    Node **_head = nullptr;
+    Link _head[algo_type::MAX_LEVEL + 1];
     size_t _size = 0;
 };
 
@@ -3,6 +3,7 @@
 #define ___HEADFILE_CFEF4EB8_082C_417F_A58C_9D65C9F3DAD1_
 
 #include <assert.h>
+#include <stddef.h> // for size_t
 
 #include "../comparable.h"
 
@@ -10,6 +11,64 @@
 namespace nut
 {
 
+/**
+ * 维护子树大小(子树中的节点个数)的辅助操作
+ *
+ * SIZED 为 false 时均为空操作，节点无需实现 get_size()/set_size()
+ */
+template <typename NODE, bool SIZED>
+class BSTreeSizeOp
+{
+public:
+    static size_t size_of(const NODE *n) noexcept
+    {
+        return nullptr == n ? 0 : n->get_size();
+    }
+
+    static void set_size(NODE *n, size_t size) noexcept
+    {
+        assert(nullptr != n);
+        n->set_size(size);
+    }
+
+    /**
+     * 根据左右子树重新计算子树大小
+     */
+    static void update(NODE *n) noexcept
+    {
+        assert(nullptr != n);
+        n->set_size(size_of(n->get_left_child()) + size_of(n->get_right_child()) + 1);
+    }
+
+    /**
+     * 从 n 开始直到根，子树大小都加上 delta
+     */
+    static void add_to_root(NODE *n, long delta) noexcept
+    {
+        for (; nullptr != n; n = n->get_parent())
+            n->set_size(n->get_size() + delta);
+    }
+};
+
+template <typename NODE>
+class BSTreeSizeOp<NODE,false>
+{
+public:
+    static size_t size_of(const NODE*) noexcept
+    {
+        return 0;
+    }
+
+    static void set_size(NODE*, size_t) noexcept
+    {}
+
+    static void update(NODE*) noexcept
+    {}
+
+    static void add_to_root(NODE*, long) noexcept
+    {}
+};
+
 /**
  * 二叉查找树
  *
@@ -21,10 +80,16 @@ namespace nut
  *      void set_parent(NODE*)
  *      void set_left_child(NODE*)
  *      void set_right_child(NODE*)
+ * @param SIZED 是否维护子树大小，用于 rank()/select() 等顺序统计操作.
+ *      为 true 时 NODE 还要求实现以下方法
+ *      size_t get_size() const        获取以该节点为根的子树的节点个数
+ *      void set_size(size_t)          设置以该节点为根的子树的节点个数
  */
-template <typename K, typename NODE>
+template <typename K, typename NODE, bool SIZED = false>
 class BSTree
 {
+    typedef BSTreeSizeOp<NODE,SIZED> size_op;
+
 public:
     /**
      * 查找数据所在的节点
@@ -78,6 +143,9 @@ public:
             parent->set_left_child(new_node);
         else
             parent->set_right_child(new_node);
+
+        size_op::set_size(new_node, 1);
+        size_op::add_to_root(parent, 1);
         return root;
     }
 
@@ -111,12 +179,18 @@ public:
             sublink_parent->set_left_child(sublink);
         else
             sublink_parent->set_right_child(sublink);
+        size_op::add_to_root(sublink_parent, -1);
 
         if (escaper != to_be_del)
         {
             escaper->set_parent(to_be_del->get_parent());
             escaper->set_left_child(to_be_del->get_left_child());
             escaper->set_right_child(to_be_del->get_right_child());
+            if (nullptr != escaper->get_left_child())
+                escaper->get_left_child()->set_parent(escaper);
+            if (nullptr != escaper->get_right_child())
+                escaper->get_right_child()->set_parent(escaper);
+            size_op::update(escaper);
             if (nullptr == to_be_del->get_parent())
                 root = escaper;
             else if (to_be_del == to_be_del->get_parent()->get_left_child())
@@ -183,8 +257,151 @@ public:
         return parent;
     }
 
+    /**
+     * 找到第一个 >= key 的节点
+     *
+     * @return 没有找到则返回 nullptr
+     */
+    static NODE* lower_bound(NODE *sub_root, const K& key) noexcept
+    {
+        NODE *ret = nullptr;
+        while (nullptr != sub_root)
+        {
+            if (compare(sub_root->get_key(), key) < 0)
+            {
+                sub_root = sub_root->get_right_child();
+            }
+            else
+            {
+                ret = sub_root;
+                sub_root = sub_root->get_left_child();
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * 找到第一个 > key 的节点
+     *
+     * @return 没有找到则返回 nullptr
+     */
+    static NODE* upper_bound(NODE *sub_root, const K& key) noexcept
+    {
+        NODE *ret = nullptr;
+        while (nullptr != sub_root)
+        {
+            if (compare(key, sub_root->get_key()) < 0)
+            {
+                ret = sub_root;
+                sub_root = sub_root->get_left_child();
+            }
+            else
+            {
+                sub_root = sub_root->get_right_child();
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * 按升序访问 [lo, hi) 范围内的节点
+     *
+     * @param visitor 形如 bool visitor(NODE*), 返回 false 则终止遍历
+     * @return 访问的节点个数
+     */
+    template <typename VISITOR>
+    static size_t range(NODE *root, const K& lo, const K& hi, VISITOR&& visitor)
+    {
+        size_t count = 0;
+        for (NODE *n = lower_bound(root, lo); nullptr != n && compare(n->get_key(), hi) < 0;
+             n = successor(n))
+        {
+            ++count;
+            if (!visitor(n))
+                break;
+        }
+        return count;
+    }
+
+    /**
+     * 键值 < key 的节点个数, O(log n). 要求 SIZED 为 true
+     */
+    static size_t rank(NODE *root, const K& key) noexcept
+    {
+        static_assert(SIZED, "rank() requires a SIZED tree");
+        size_t ret = 0;
+        while (nullptr != root)
+        {
+            if (compare(root->get_key(), key) < 0)
+            {
+                ret += size_op::size_of(root->get_left_child()) + 1;
+                root = root->get_right_child();
+            }
+            else
+            {
+                root = root->get_left_child();
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * 按中序找到第 index 个节点, O(log n). 要求 SIZED 为 true
+     *
+     * @param index 0-based
+     * @return 越界则返回 nullptr
+     */
+    static NODE* select(NODE *root, size_t index) noexcept
+    {
+        static_assert(SIZED, "select() requires a SIZED tree");
+        while (nullptr != root)
+        {
+            const size_t left_size = size_op::size_of(root->get_left_child());
+            if (index < left_size)
+            {
+                root = root->get_left_child();
+            }
+            else if (index == left_size)
+            {
+                return root;
+            }
+            else
+            {
+                index -= left_size + 1;
+                root = root->get_right_child();
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * 用已按升序排列的节点构建平衡的二叉查找树, O(n)
+     *
+     * @param sorted 按键值升序排列的节点数组
+     * @return 新的根
+     */
+    static NODE* build(NODE **sorted, size_t n) noexcept
+    {
+        assert(nullptr != sorted || 0 == n);
+        return _build(sorted, n, nullptr);
+    }
+
 private:
     BSTree() = delete;
+
+    static NODE* _build(NODE **sorted, size_t n, NODE *parent) noexcept
+    {
+        if (0 == n)
+            return nullptr;
+
+        const size_t mid = n / 2;
+        NODE *ret = sorted[mid];
+        ret->set_parent(parent);
+        ret->set_left_child(_build(sorted, mid, ret));
+        ret->set_right_child(_build(sorted + mid + 1, n - mid - 1, ret));
+        size_op::set_size(ret, n);
+        return ret;
+    }
 };
 
 }
@@ -0,0 +1,326 @@
+﻿
+#ifndef ___HEADFILE_9C1F4E27_3A6B_4D0E_8E52_71B3C6A0D4F8_
+#define ___HEADFILE_9C1F4E27_3A6B_4D0E_8E52_71B3C6A0D4F8_
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm> // for std::reverse()
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../../platform/platform.h"
+#include "../../platform/int_type.h" // for ssize_t in Windows
+
+#if NUT_PLATFORM_SSE2
+#   include <emmintrin.h>
+#endif
+
+#include "../comparable.h"
+#include "binary_tree.h"
+#include "trie_tree.h"
+
+
+namespace nut
+{
+
+/**
+ * 只读的字典树, 由 TrieTree 构建, 用于查找密集的场合
+ *
+ * - 路径压缩: 没有数据且只有一个子节点的节点被合并到边上, 例如 "a/b/c" 中若 a、b
+ *   都没有数据, 则只需要一个标签为 "abc" 的节点
+ * - 扁平布局: 按广度优先顺序存放在同一个数组中, 同一个节点的子节点连续存放, 各子节点
+ *   标签的首个元素也单独连续存放, 查找子节点时只需扫描一段连续内存. 单字节的
+ *   ENTRY 使用 SSE2 每次比较 16 个, 子节点较多的其他类型则使用二分查找
+ *
+ * 构建之后与原 TrieTree 不再有联系
+ */
+template <typename ENTRY, typename DATA>
+class FrozenTrieTree
+{
+private:
+    typedef TrieTree<ENTRY,DATA> trie_type;
+    typedef typename trie_type::Node trie_node_type;
+
+    static constexpr uint32_t NO_DATA = 0xffffffff;
+
+    /* 子节点个数不超过该值时直接顺序查找 */
+    static constexpr uint32_t LINEAR_SEARCH_LIMIT = 8;
+
+    /**
+     * 节点, 标签为 _labels[label_begin, label_begin + label_len), 首个元素同时存放在
+     * _first_entries[] 中与节点下标相同的位置
+     */
+    struct Node
+    {
+        uint32_t label_begin;
+        uint32_t label_len; // 除根节点外都 > 0
+        uint32_t children_begin; // 子节点在节点数组中的下标
+        uint32_t children_count;
+        uint32_t data_index; // 在数据数组中的下标，没有数据则为 NO_DATA
+    };
+
+public:
+    FrozenTrieTree() = default;
+
+    explicit FrozenTrieTree(const trie_type& trie)
+    {
+        build(trie);
+    }
+
+    /**
+     * 从 TrieTree 构建, 原有数据被清除
+     */
+    void build(const trie_type& trie)
+    {
+        clear();
+
+        Node root;
+        root.label_begin = 0;
+        root.label_len = 0;
+        root.children_begin = 0;
+        root.children_count = 0;
+        root.data_index = NO_DATA;
+        _nodes.push_back(root);
+        _first_entries.emplace_back(); // 根节点没有标签，占位
+
+        // 广度优先，使同一节点的子节点连续存放
+        std::queue<std::pair<const trie_node_type*,uint32_t>> q;
+        q.emplace(nullptr, 0);
+        while (!q.empty())
+        {
+            const trie_node_type *src = q.front().first;
+            const uint32_t index = q.front().second;
+            q.pop();
+
+            trie_node_type *const child_tree = (nullptr == src ? trie._child_tree : src->_child_tree);
+            _nodes[index].children_begin = (uint32_t) _nodes.size();
+            for (auto iter = BinaryTree<trie_node_type>::inorder_traversal_begin(child_tree),
+                     end = BinaryTree<trie_node_type>::inorder_traversal_end(child_tree);
+                 iter != end; ++iter)
+            {
+                // 压缩路径
+                const trie_node_type *tail = &*iter;
+                Node n;
+                n.label_begin = (uint32_t) _labels.size();
+                _labels.push_back(tail->get_entry());
+                while (!tail->has_data() && is_single_child(tail->_child_tree))
+                {
+                    tail = tail->_child_tree;
+                    _labels.push_back(tail->get_entry());
+                }
+                n.label_len = (uint32_t) _labels.size() - n.label_begin;
+                n.children_begin = 0;
+                n.children_count = 0;
+                n.data_index = NO_DATA;
+                if (tail->has_data())
+                {
+                    n.data_index = (uint32_t) _data.size();
+                    _data.push_back(tail->get_data());
+                }
+
+                q.emplace(tail, (uint32_t) _nodes.size());
+                _nodes.push_back(n);
+                _first_entries.push_back(iter->get_entry());
+                ++_nodes[index].children_count;
+            }
+        }
+        assert(_data.size() == trie.size());
+    }
+
+    void clear() noexcept
+    {
+        _nodes.clear();
+        _first_entries.clear();
+        _labels.clear();
+        _data.clear();
+    }
+
+    size_t size() const noexcept
+    {
+        return _data.size();
+    }
+
+    /**
+     * 获取数据
+     */
+    const DATA* get(const ENTRY *path, size_t path_len) const noexcept
+    {
+        assert(nullptr != path || 0 == path_len);
+        const DATA *ret = nullptr;
+        size_t matched = 0;
+        walk(path, path_len, [&] (size_t len, const DATA *data) {
+                matched = len;
+                ret = data;
+            });
+        return matched == path_len ? ret : nullptr;
+    }
+
+    /**
+     * 最长前缀匹配: 在 path 的所有前缀(包含自身)中找到最长的一个有数据的
+     *
+     * @param matched_len 存放返回值, 可以是 nullptr. 匹配的前缀长度
+     * @return 没有匹配则返回 nullptr
+     */
+    const DATA* longest_prefix(const ENTRY *path, size_t path_len,
+                               size_t *matched_len = nullptr) const noexcept
+    {
+        assert(nullptr != path || 0 == path_len);
+        const DATA *ret = nullptr;
+        size_t matched = 0;
+        walk(path, path_len, [&] (size_t len, const DATA *data) {
+                matched = len;
+                ret = data;
+            });
+        if (nullptr != matched_len)
+            *matched_len = (nullptr == ret ? 0 : matched);
+        return ret;
+    }
+
+    /**
+     * 获取先祖节点中的数据(包含指定的节点自身)，由近及远排列
+     */
+    std::vector<DATA> get_ancestors(const ENTRY *path, size_t path_len) const noexcept
+    {
+        assert(nullptr != path || 0 == path_len);
+        std::vector<DATA> ret;
+        walk(path, path_len, [&] (size_t, const DATA *data) {
+                ret.push_back(*data);
+            });
+        std::reverse(ret.begin(), ret.end());
+        return ret;
+    }
+
+private:
+    static bool is_single_child(const trie_node_type *child_tree) noexcept
+    {
+        return nullptr != child_tree && nullptr == child_tree->_rb_left &&
+            nullptr == child_tree->_rb_right;
+    }
+
+    /**
+     * 沿 path 向下走, 依次对经过的每个有数据的节点调用 visitor
+     *
+     * @param visitor 形如 void visitor(size_t prefix_len, const DATA*)
+     */
+    template <typename VISITOR>
+    void walk(const ENTRY *path, size_t path_len, VISITOR&& visitor) const noexcept
+    {
+        if (_nodes.empty())
+            return;
+
+        const Node *n = &_nodes[0];
+        size_t pos = 0;
+        while (pos < path_len)
+        {
+            const ssize_t child = find_child(*n, path[pos]);
+            if (child < 0)
+                return;
+
+            n = &_nodes[child];
+            if (pos + n->label_len > path_len)
+                return;
+            const ENTRY *label = &_labels[n->label_begin];
+            for (size_t i = 1; i < n->label_len; ++i)
+            {
+                if (!(label[i] == path[pos + i]))
+                    return;
+            }
+            pos += n->label_len;
+
+            if (NO_DATA != n->data_index)
+                visitor(pos, &_data[n->data_index]);
+        }
+    }
+
+    /**
+     * @return 子节点在节点数组中的下标, 没有找到则返回 -1
+     */
+    ssize_t find_child(const Node& n, const ENTRY& entry) const noexcept
+    {
+        if (0 == n.children_count)
+            return -1;
+        const ENTRY *first = &_first_entries[n.children_begin];
+        const ssize_t i = find_entry(
+            first, n.children_count, entry,
+            std::integral_constant<bool, std::is_integral<ENTRY>::value && 1 == sizeof(ENTRY)>());
+        return i < 0 ? -1 : (ssize_t) n.children_begin + i;
+    }
+
+    static ssize_t find_entry(const ENTRY *first, uint32_t count, const ENTRY& entry,
+                              std::false_type) noexcept
+    {
+        if (count <= LINEAR_SEARCH_LIMIT)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if (first[i] == entry)
+                    return i;
+            }
+            return -1;
+        }
+
+        // 子节点按升序排列
+        uint32_t left = 0, right = count;
+        while (left < right)
+        {
+            const uint32_t mid = (left + right) / 2;
+            const int rs = compare(first[mid], entry);
+            if (rs < 0)
+                left = mid + 1;
+            else if (rs > 0)
+                right = mid;
+            else
+                return mid;
+        }
+        return -1;
+    }
+
+    /**
+     * 单字节 ENTRY, 可以按字节比较
+     */
+    static ssize_t find_entry(const ENTRY *first, uint32_t count, const ENTRY& entry,
+                              std::true_type) noexcept
+    {
+        const uint8_t *bytes = (const uint8_t*) first;
+        const uint8_t b = (uint8_t) entry;
+        uint32_t i = 0;
+#if NUT_PLATFORM_SSE2
+        const __m128i vb = _mm_set1_epi8((char) b);
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i v = _mm_loadu_si128((const __m128i*) (bytes + i));
+            const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, vb));
+            if (0 != mask)
+            {
+#   if NUT_PLATFORM_CC_GCC
+                return i + __builtin_ctz((unsigned) mask);
+#   else
+                for (uint32_t j = 0; j < 16; ++j)
+                {
+                    if (0 != (mask & (1 << j)))
+                        return i + j;
+                }
+#   endif
+            }
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            if (bytes[i] == b)
+                return i;
+        }
+        return -1;
+    }
+
+private:
+    std::vector<Node> _nodes; // 第一个是根节点
+    std::vector<ENTRY> _first_entries; // 各节点标签的首个元素, 与 _nodes 一一对应
+    std::vector<ENTRY> _labels;
+    std::vector<DATA> _data;
+};
+
+}
+
+#endif
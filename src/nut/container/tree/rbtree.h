@@ -3,6 +3,7 @@
 #define ___HEADFILE_16D8579F_C3D1_4CE7_ACA2_3C4B4B82E45D_
 
 #include <assert.h>
+#include <stddef.h> // for size_t
 
 #include "../comparable.h"
 #include "bstree.h"
@@ -24,10 +25,15 @@ namespace nut
  *      void set_parent(NODE*)
  *      void set_left_child(NODE*)
  *      void set_right_child(NODE*)
+ * @param SIZED 是否维护子树大小, 参见 BSTree. 红黑树本身也是二叉查找树, 查找、
+ *      lower_bound()、rank()、select() 等只读操作使用 BSTree<K,NODE,SIZED> 即可
  */
-template <typename K, typename NODE>
+template <typename K, typename NODE, bool SIZED = false>
 class RBTree
 {
+    typedef BSTree<K,NODE,SIZED>       bstree_type;
+    typedef BSTreeSizeOp<NODE,SIZED>   size_op;
+
 public:
     /**
      * 插入新节点到红黑树
@@ -61,6 +67,8 @@ public:
             parent->set_left_child(new_node);
         else
             parent->set_right_child(new_node);
+        size_op::set_size(new_node, 1);
+        size_op::add_to_root(parent, 1);
 
         new_node->set_red(true);
         root = _insert_fixup(root, new_node);
@@ -80,7 +88,7 @@ public:
         if (nullptr == to_be_del->get_left_child() || nullptr == to_be_del->get_right_child())
             escaper = to_be_del;
         else
-            escaper = BSTree<K,NODE>::successor(to_be_del);
+            escaper = bstree_type::successor(to_be_del);
 
         NODE *sublink = nullptr;
         if (nullptr != escaper->get_left_child())
@@ -98,6 +106,7 @@ public:
             sublink_parent->set_left_child(sublink);
         else
             sublink_parent->set_right_child(sublink);
+        size_op::add_to_root(sublink_parent, -1);
 
         const bool red_escaper = escaper->is_red();
         if (escaper != to_be_del)
@@ -107,6 +116,13 @@ public:
             escaper->set_right_child(to_be_del->get_right_child());
             escaper->set_parent(to_be_del->get_parent());
             escaper->set_red(to_be_del->is_red());
+            if (nullptr != escaper->get_left_child())
+                escaper->get_left_child()->set_parent(escaper);
+            if (nullptr != escaper->get_right_child())
+                escaper->get_right_child()->set_parent(escaper);
+            size_op::update(escaper);
+            if (sublink_parent == to_be_del)
+                sublink_parent = escaper;
             if (nullptr == to_be_del->get_parent())
                 root = escaper;
             else if (to_be_del == to_be_del->get_parent()->get_left_child())
@@ -121,9 +137,44 @@ public:
         return root;
     }
 
+    /**
+     * 用已按升序排列的节点构建红黑树, O(n)
+     *
+     * 构建出的树左右子树大小至多相差 1, 因而所有叶子的深度至多相差 1; 将最深一层
+     * 不满的节点染红, 其余染黑即满足红黑树性质
+     *
+     * @param sorted 按键值升序排列的节点数组
+     * @return 新的根
+     */
+    static NODE* build(NODE **sorted, size_t n) noexcept
+    {
+        assert(nullptr != sorted || 0 == n);
+        // 深度 < floor(log2(n+1)) 的各层是满的
+        size_t red_depth = 0;
+        while (((size_t) 2 << red_depth) <= n + 1)
+            ++red_depth;
+        return _build(sorted, n, nullptr, 0, red_depth);
+    }
+
 private:
     RBTree() = delete;
 
+    static NODE* _build(NODE **sorted, size_t n, NODE *parent, size_t depth,
+                        size_t red_depth) noexcept
+    {
+        if (0 == n)
+            return nullptr;
+
+        const size_t mid = n / 2;
+        NODE *ret = sorted[mid];
+        ret->set_parent(parent);
+        ret->set_red(depth >= red_depth);
+        ret->set_left_child(_build(sorted, mid, ret, depth + 1, red_depth));
+        ret->set_right_child(_build(sorted + mid + 1, n - mid - 1, ret, depth + 1, red_depth));
+        size_op::set_size(ret, n);
+        return ret;
+    }
+
     /**
      * 左旋转
      */
@@ -152,6 +203,8 @@ private:
         y->set_left_child(x);
         x->set_parent(y);
 
+        size_op::set_size(y, size_op::size_of(x));
+        size_op::update(x);
         return root;
     }
 
@@ -182,6 +235,8 @@ private:
         y->set_right_child(x);
         x->set_parent(y);
 
+        size_op::set_size(y, size_op::size_of(x));
+        size_op::update(x);
         return root;
     }
 
@@ -226,6 +281,7 @@ private:
                          */
                         x = parent;
                         root = _left_rotate(root, x);
+                        parent = x->get_parent();
                     }
 
                     /* case 3:
@@ -276,6 +332,7 @@ private:
                          */
                         x = parent;
                         root = _right_rotate(root, x);
+                        parent = x->get_parent();
                     }
 
                     /* case 3:
@@ -104,6 +104,51 @@ public:
         return acr;
     }
 
+    /**
+     * 各维度边长之和
+     */
+    float_type margin() const noexcept
+    {
+        float_type ret = 0;
+        for (size_t i = 0; i < DIMENSIONS; ++i)
+            ret += (float_type) higher[i] - (float_type) lower[i];
+        return ret;
+    }
+
+    /**
+     * 与另一个区域相交部分所占的空间，不相交则为 0
+     */
+    float_type intersection_acreage(const self_type& x) const noexcept
+    {
+        float_type acr = 1;
+        for (size_t i = 0; i < DIMENSIONS; ++i)
+        {
+            const num_type l = std::max(lower[i], x.lower[i]), h = std::min(higher[i], x.higher[i]);
+            if (l >= h)
+                return 0;
+            acr *= (float_type) h - (float_type) l;
+        }
+        return acr;
+    }
+
+    /**
+     * 与另一个区域之间最短距离的平方，相交则为 0
+     */
+    float_type distance_square(const self_type& x) const noexcept
+    {
+        float_type ret = 0;
+        for (size_t i = 0; i < DIMENSIONS; ++i)
+        {
+            float_type gap = 0;
+            if (x.higher[i] < lower[i])
+                gap = (float_type) lower[i] - (float_type) x.higher[i];
+            else if (higher[i] < x.lower[i])
+                gap = (float_type) x.lower[i] - (float_type) higher[i];
+            ret += gap * gap;
+        }
+        return ret;
+    }
+
     /**
      * 查看是否完全包含另一个区域
      */
@@ -0,0 +1,772 @@
+﻿
+#ifndef ___HEADFILE_5E0B7A42_61C4_4F1E_9B37_2D8A0F6C13B9_
+#define ___HEADFILE_5E0B7A42_61C4_4F1E_9B37_2D8A0F6C13B9_
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h> // for ::memcpy()
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility> // for std::pair
+#include <vector>
+
+#include "../../../platform/platform.h"
+
+#if NUT_PLATFORM_SSE2
+#   include <emmintrin.h>
+#endif
+
+#include "../../bytestream/output_stream.h"
+#include "mdarea.h"
+
+
+namespace nut
+{
+
+/**
+ * 静态的、批量构建的紧凑 rtree
+ *
+ * 与动态的 RTree 相比:
+ * - 使用 Sort-Tile-Recursive (STR) 算法一次性从全部数据构建，之后只读
+ * - 所有节点存放在同一个数组中，按层从叶子到根依次排列，子节点在下一层中连续，
+ *   因而节点只需记录首个子节点的下标
+ * - 节点内各子区域按维度分开存放(SoA)，相交测试可以一次比较多个子区域(SSE2)
+ * - 可以序列化为连续的内存块，之后通过 attach() 直接在 mmap 的内存上查询
+ *
+ * 参考资料：
+ *      STR: A Simple and Efficient Algorithm for R-Tree Packing.
+ *  Scott T. Leutenegger, Mario A. Lopez, Jeffrey Edgington.
+ *
+ * @param DATA_TYPE 数据类型; 要序列化则必须是 trivially copyable 的
+ * @param NUM_TYPE 数字类型; 可以是 int、float 等
+ * @param DIMENSIONS 区域维数; 大于等于1
+ * @param FLOAT_TYPE 实数，避免乘法运算溢出，常用的是float，double等
+ * @param NODE_CAPACITY 节点最大孩子数; 4 的倍数且不大于 32
+ */
+template <typename DATA_TYPE, typename NUM_TYPE, size_t DIMENSIONS = 2,
+          typename FLOAT_TYPE = double, size_t NODE_CAPACITY = 16>
+class PackedRTree
+{
+    static_assert(DIMENSIONS >= 1, "packed rtree 空间维数");
+    static_assert(NODE_CAPACITY >= 4 && NODE_CAPACITY <= 32 && 0 == NODE_CAPACITY % 4,
+                  "packed rtree 节点最大孩子数");
+
+public:
+    typedef typename std::enable_if<std::is_integral<NUM_TYPE>::value ||
+                                    std::is_floating_point<NUM_TYPE>::value,
+                                    NUM_TYPE>::type num_type;
+
+    typedef typename std::enable_if<std::is_floating_point<FLOAT_TYPE>::value,
+                                    FLOAT_TYPE>::type float_type;
+
+    typedef MDArea<num_type, DIMENSIONS, float_type> area_type;
+    typedef DATA_TYPE data_type;
+
+private:
+    typedef PackedRTree<data_type, num_type, DIMENSIONS, float_type, NODE_CAPACITY> self_type;
+
+    /**
+     * 节点, 直接作为序列化格式，不能包含指针
+     */
+    struct Node
+    {
+        // 子区域，按维度分开存放. 未使用的位置填充为空区域
+        num_type lower[DIMENSIONS][NODE_CAPACITY];
+        num_type higher[DIMENSIONS][NODE_CAPACITY];
+
+        // 叶子节点为首个数据的下标，否则为首个子节点在节点数组中的下标
+        uint32_t first;
+        uint32_t count;
+    };
+
+    /**
+     * 序列化头部
+     */
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t dimensions;
+        uint32_t num_size;
+        uint32_t node_capacity;
+        uint32_t node_size;
+        uint32_t data_size;
+        uint32_t height;
+        uint64_t node_count;
+        uint64_t leaf_count;
+        uint64_t data_count;
+        uint64_t data_offset;
+    };
+
+    /**
+     * 构建过程中的待打包项
+     */
+    struct Entry
+    {
+        area_type area;
+        uint32_t index;
+    };
+
+    static constexpr uint32_t MAGIC = 0x5452504e; // "NPRT" in little-endian
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t MAX_HEIGHT = 32;
+    static constexpr size_t ALIGNMENT = 16;
+
+public:
+    PackedRTree() = default;
+
+    PackedRTree(const self_type& x)
+        : _own_nodes(x._own_nodes), _own_data(x._own_data), _nodes(x._nodes),
+          _data(x._data), _node_count(x._node_count), _leaf_count(x._leaf_count),
+          _size(x._size), _height(x._height)
+    {
+        rebind();
+    }
+
+    PackedRTree(self_type&& x) noexcept
+    {
+        *this = std::move(x);
+    }
+
+    self_type& operator=(const self_type& x)
+    {
+        if (this != &x)
+        {
+            self_type tmp(x);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+
+    self_type& operator=(self_type&& x) noexcept
+    {
+        if (this == &x)
+            return *this;
+
+        const bool attached = x.is_attached();
+        _own_nodes = std::move(x._own_nodes);
+        _own_data = std::move(x._own_data);
+        _nodes = x._nodes;
+        _data = x._data;
+        _node_count = x._node_count;
+        _leaf_count = x._leaf_count;
+        _size = x._size;
+        _height = x._height;
+        if (!attached)
+            rebind();
+
+        x.clear();
+        return *this;
+    }
+
+    /**
+     * 用 STR 算法批量构建, 原有数据被清除
+     */
+    void build(std::vector<std::pair<area_type,data_type>>&& items)
+    {
+        clear();
+        if (items.empty())
+            return;
+        assert(items.size() < std::numeric_limits<uint32_t>::max());
+
+        std::vector<Entry> entries(items.size());
+        for (size_t i = 0, sz = items.size(); i < sz; ++i)
+        {
+            entries[i].area = items[i].first;
+            entries[i].index = (uint32_t) i;
+        }
+
+        // 叶子层，数据按打包顺序重排
+        str_sort(entries.begin(), entries.end(), 0);
+        _own_data.reserve(items.size());
+        for (size_t i = 0, sz = entries.size(); i < sz; ++i)
+            _own_data.push_back(std::move(items[entries[i].index].second));
+        items.clear();
+
+        std::vector<std::vector<Node>> levels;
+        levels.emplace_back();
+        pack_level(&entries, &levels.back());
+
+        // 逐层向上构建，直到只剩根节点. 下层节点按打包顺序重排后依然连续
+        while (levels.back().size() > 1)
+        {
+            str_sort(entries.begin(), entries.end(), 0);
+            std::vector<Node>& children = levels.back();
+            std::vector<Node> sorted;
+            sorted.reserve(children.size());
+            for (size_t i = 0, sz = entries.size(); i < sz; ++i)
+                sorted.push_back(children[entries[i].index]);
+            children.swap(sorted);
+
+            levels.emplace_back();
+            pack_level(&entries, &levels.back());
+        }
+        assert(levels.size() <= MAX_HEIGHT);
+
+        // 合并各层, 并将子节点下标转换为在整个数组中的下标
+        size_t offset = 0;
+        for (size_t lv = 0, lvs = levels.size(); lv < lvs; ++lv)
+        {
+            std::vector<Node>& level = levels[lv];
+            if (lv > 0)
+            {
+                const size_t child_offset = offset - levels[lv - 1].size();
+                for (size_t i = 0, sz = level.size(); i < sz; ++i)
+                    level[i].first += (uint32_t) child_offset;
+            }
+            _own_nodes.insert(_own_nodes.end(), level.begin(), level.end());
+            offset += level.size();
+        }
+
+        _leaf_count = levels.front().size();
+        _size = _own_data.size();
+        _height = levels.size();
+        rebind();
+    }
+
+    void build(const std::vector<std::pair<area_type,data_type>>& items)
+    {
+        build(std::vector<std::pair<area_type,data_type>>(items));
+    }
+
+    /**
+     * 清除所有数据, 或者解除对外部内存的引用
+     */
+    void clear() noexcept
+    {
+        _own_nodes.clear();
+        _own_data.clear();
+        _nodes = nullptr;
+        _data = nullptr;
+        _node_count = 0;
+        _leaf_count = 0;
+        _size = 0;
+        _height = 0;
+    }
+
+    /**
+     * 元素个数
+     */
+    size_t size() const noexcept
+    {
+        return _size;
+    }
+
+    /**
+     * 树高, 空树为 0
+     */
+    size_t height() const noexcept
+    {
+        return _height;
+    }
+
+    /**
+     * 是否引用的外部内存 (通过 attach() 加载)
+     */
+    bool is_attached() const noexcept
+    {
+        return nullptr != _nodes && _nodes != _own_nodes.data();
+    }
+
+    /**
+     * 查找与指定区域相交的数据
+     */
+    void search_intersect(
+        const area_type& rect,
+        std::vector<std::pair<area_type,data_type>> *appended) const
+    {
+        assert(nullptr != appended);
+        visit_intersect(rect, [=] (const area_type& area, const data_type& data) {
+                appended->emplace_back(area, data);
+                return true;
+            });
+    }
+
+    /**
+     * 查找包含在指定区域内的数据
+     */
+    void search_contains(
+        const area_type& rect,
+        std::vector<std::pair<area_type,data_type>> *appended) const
+    {
+        assert(nullptr != appended);
+        visit_contains(rect, [=] (const area_type& area, const data_type& data) {
+                appended->emplace_back(area, data);
+                return true;
+            });
+    }
+
+    /**
+     * 访问与指定区域相交的数据
+     *
+     * @param visitor 形如 bool visitor(const area_type&, const data_type&),
+     *      返回 false 则终止查找
+     * @return 访问的数据个数
+     */
+    template <typename VISITOR>
+    size_t visit_intersect(const area_type& rect, VISITOR&& visitor) const
+    {
+        return search<false>(rect, std::forward<VISITOR>(visitor));
+    }
+
+    /**
+     * 访问包含在指定区域内的数据
+     *
+     * @param visitor 参见 visit_intersect()
+     */
+    template <typename VISITOR>
+    size_t visit_contains(const area_type& rect, VISITOR&& visitor) const
+    {
+        return search<true>(rect, std::forward<VISITOR>(visitor));
+    }
+
+    /**
+     * 检查结构是否错误
+     */
+    bool is_valid() const noexcept
+    {
+        if (0 == _node_count)
+            return 0 == _size && 0 == _height;
+        if (_leaf_count > _node_count || _height < 1 || _height > MAX_HEIGHT)
+            return false;
+
+        size_t data_total = 0;
+        for (size_t i = 0; i < _node_count; ++i)
+        {
+            const Node& n = _nodes[i];
+            if (0 == n.count || n.count > NODE_CAPACITY)
+                return false;
+            if (i < _leaf_count)
+            {
+                if (n.first + (size_t) n.count > _size)
+                    return false;
+                data_total += n.count;
+                continue;
+            }
+
+            // 子节点在前面的层中，且区域被包含
+            if (n.first + (size_t) n.count > i)
+                return false;
+            for (size_t j = 0; j < n.count; ++j)
+            {
+                const area_type child_area = node_area(_nodes[n.first + j]);
+                if (!lane_area(n, j).contains(child_area))
+                    return false;
+            }
+        }
+        return data_total == _size;
+    }
+
+    /**
+     * 序列化后所占的字节数
+     */
+    size_t serialized_size() const noexcept
+    {
+        return data_offset() + sizeof(data_type) * _size;
+    }
+
+    /**
+     * 序列化. 数据按本机字节序原样写出，加载时可以直接使用 attach()
+     */
+    void serialize(OutputStream *os) const
+    {
+        static_assert(std::is_trivially_copyable<data_type>::value,
+                      "serializable data type should be trivially copyable");
+        assert(nullptr != os);
+
+        Header header;
+        ::memset(&header, 0, sizeof(header));
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.dimensions = DIMENSIONS;
+        header.num_size = sizeof(num_type);
+        header.node_capacity = NODE_CAPACITY;
+        header.node_size = sizeof(Node);
+        header.data_size = sizeof(data_type);
+        header.height = (uint32_t) _height;
+        header.node_count = _node_count;
+        header.leaf_count = _leaf_count;
+        header.data_count = _size;
+        header.data_offset = data_offset();
+
+        size_t written = 0;
+        written += os->write(&header, sizeof(header));
+        written += write_padding(os, written, nodes_offset());
+        if (_node_count > 0)
+            written += os->write(_nodes, sizeof(Node) * _node_count);
+        written += write_padding(os, written, data_offset());
+        if (_size > 0)
+            written += os->write(_data, sizeof(data_type) * _size);
+        assert(written == serialized_size());
+        UNUSED(written);
+    }
+
+    /**
+     * 直接引用序列化后的内存，不做任何复制. 内存(例如 mmap 映射的文件)在解除
+     * 引用之前必须一直有效
+     *
+     * 会用 is_valid() 检查所有节点, 以免损坏的数据使查询越界
+     *
+     * @param buf 需要按 16 字节对齐
+     * @return 格式或者对齐不匹配、结构错误则返回 false
+     */
+    bool attach(const void *buf, size_t len) noexcept
+    {
+        static_assert(std::is_trivially_copyable<data_type>::value,
+                      "serializable data type should be trivially copyable");
+
+        clear();
+        if (nullptr == buf || len < sizeof(Header) || 0 != ((uintptr_t) buf) % ALIGNMENT)
+            return false;
+
+        Header header;
+        ::memcpy(&header, buf, sizeof(header));
+        if (MAGIC != header.magic || VERSION != header.version ||
+            DIMENSIONS != header.dimensions || sizeof(num_type) != header.num_size ||
+            NODE_CAPACITY != header.node_capacity || sizeof(Node) != header.node_size ||
+            sizeof(data_type) != header.data_size || header.height > MAX_HEIGHT ||
+            header.leaf_count > header.node_count || header.node_count > len / sizeof(Node) ||
+            header.data_count > len / sizeof(data_type))
+            return false;
+
+        _node_count = (size_t) header.node_count;
+        _leaf_count = (size_t) header.leaf_count;
+        _size = (size_t) header.data_count;
+        _height = header.height;
+        if (data_offset() != header.data_offset || serialized_size() > len)
+        {
+            clear();
+            return false;
+        }
+
+        const uint8_t *base = (const uint8_t*) buf;
+        _nodes = (const Node*) (base + nodes_offset());
+        _data = (const data_type*) (base + data_offset());
+        if (!is_valid())
+        {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    /**
+     * 在 [begin, end) 上递归执行 STR 排序: 按第 dim 维中心排序后切分成若干片，
+     * 每片再按下一维排序
+     */
+    template <typename ITER>
+    static void str_sort(ITER begin, ITER end, size_t dim)
+    {
+        const size_t count = end - begin;
+        if (count <= NODE_CAPACITY)
+            return;
+
+        std::sort(begin, end, [=] (const Entry& x, const Entry& y) {
+                return center2(x.area, dim) < center2(y.area, dim);
+            });
+        if (dim + 1 >= DIMENSIONS)
+            return;
+
+        // 叶子数 P, 每一维切分成 ceil(P^(1/剩余维数)) 片
+        const size_t leaves = (count + NODE_CAPACITY - 1) / NODE_CAPACITY;
+        size_t slabs = (size_t) std::ceil(std::pow((double) leaves, 1.0 / (DIMENSIONS - dim)));
+        slabs = std::max<size_t>(1, slabs);
+        const size_t slab_size = NODE_CAPACITY * ((leaves + slabs - 1) / slabs);
+        for (size_t i = 0; i < count; i += slab_size)
+            str_sort(begin + i, begin + std::min(count, i + slab_size), dim + 1);
+    }
+
+    /**
+     * 中心坐标的两倍，避免整数除法的精度损失
+     */
+    static float_type center2(const area_type& area, size_t dim) noexcept
+    {
+        return (float_type) area.lower[dim] + (float_type) area.higher[dim];
+    }
+
+    /**
+     * 将已排序的 entries 按顺序打包成节点, 并将 entries 替换为新节点的区域
+     */
+    static void pack_level(std::vector<Entry> *entries, std::vector<Node> *level)
+    {
+        assert(nullptr != entries && nullptr != level);
+        const size_t count = entries->size();
+        level->reserve((count + NODE_CAPACITY - 1) / NODE_CAPACITY);
+        std::vector<Entry> parents;
+        parents.reserve(level->capacity());
+        for (size_t i = 0; i < count; i += NODE_CAPACITY)
+        {
+            Node n;
+            for (size_t d = 0; d < DIMENSIONS; ++d)
+            {
+                std::fill_n(n.lower[d], NODE_CAPACITY, std::numeric_limits<num_type>::max());
+                std::fill_n(n.higher[d], NODE_CAPACITY, std::numeric_limits<num_type>::lowest());
+            }
+            n.first = (uint32_t) i;
+            n.count = (uint32_t) std::min<size_t>(NODE_CAPACITY, count - i);
+
+            Entry parent;
+            parent.area = entries->at(i).area;
+            parent.index = (uint32_t) level->size();
+            for (size_t j = 0; j < n.count; ++j)
+            {
+                const area_type& area = entries->at(i + j).area;
+                for (size_t d = 0; d < DIMENSIONS; ++d)
+                {
+                    n.lower[d][j] = area.lower[d];
+                    n.higher[d][j] = area.higher[d];
+                }
+                parent.area.expand_to_contain(area);
+            }
+            level->push_back(n);
+            parents.push_back(parent);
+        }
+        entries->swap(parents);
+    }
+
+    template <bool CONTAINS, typename VISITOR>
+    size_t search(const area_type& rect, VISITOR&& visitor) const
+    {
+        if (0 == _node_count)
+            return 0;
+
+        // 深度优先，栈深度不超过 MAX_HEIGHT * NODE_CAPACITY
+        uint32_t stack[MAX_HEIGHT * NODE_CAPACITY];
+        size_t top = 0, count = 0;
+        stack[top++] = (uint32_t) (_node_count - 1);
+        while (top > 0)
+        {
+            const uint32_t index = stack[--top];
+            const Node& n = _nodes[index];
+            const bool is_leaf = index < _leaf_count;
+            uint32_t mask = (CONTAINS && is_leaf) ? contains_mask(n, rect) : intersect_mask(n, rect);
+            while (0 != mask)
+            {
+                const unsigned j = lowest_bit(mask);
+                mask &= mask - 1;
+                if (is_leaf)
+                {
+                    ++count;
+                    if (!visitor(lane_area(n, j), _data[n.first + j]))
+                        return count;
+                }
+                else if (top < MAX_HEIGHT * NODE_CAPACITY)
+                {
+                    stack[top++] = n.first + j;
+                }
+                else
+                {
+                    // 结构错误, 实际深度超过了 MAX_HEIGHT
+                    return count;
+                }
+            }
+        }
+        return count;
+    }
+
+    /**
+     * 节点中与 rect 相交的子区域掩码
+     */
+    static uint32_t intersect_mask(const Node& n, const area_type& rect) noexcept
+    {
+        uint32_t mask = count_mask(n.count);
+        for (size_t d = 0; d < DIMENSIONS && 0 != mask; ++d)
+            mask &= le_mask(n.lower[d], rect.higher[d]) & ge_mask(n.higher[d], rect.lower[d]);
+        return mask;
+    }
+
+    /**
+     * 节点中被 rect 包含的子区域掩码
+     */
+    static uint32_t contains_mask(const Node& n, const area_type& rect) noexcept
+    {
+        uint32_t mask = count_mask(n.count);
+        for (size_t d = 0; d < DIMENSIONS && 0 != mask; ++d)
+            mask &= ge_mask(n.lower[d], rect.lower[d]) & le_mask(n.higher[d], rect.higher[d]);
+        return mask;
+    }
+
+    static uint32_t count_mask(uint32_t count) noexcept
+    {
+        assert(count <= 32);
+        return count >= 32 ? 0xffffffff : (((uint32_t) 1) << count) - 1;
+    }
+
+    static unsigned lowest_bit(uint32_t mask) noexcept
+    {
+        assert(0 != mask);
+#if NUT_PLATFORM_CC_GCC
+        return (unsigned) __builtin_ctz(mask);
+#else
+        unsigned ret = 0;
+        while (0 == (mask & 1))
+        {
+            mask >>= 1;
+            ++ret;
+        }
+        return ret;
+#endif
+    }
+
+    /**
+     * a[j] <= b 的掩码
+     */
+    template <typename T>
+    static uint32_t le_mask(const T *a, T b) noexcept
+    {
+        uint32_t mask = 0;
+        for (size_t j = 0; j < NODE_CAPACITY; ++j)
+            mask |= ((uint32_t) (a[j] <= b)) << j;
+        return mask;
+    }
+
+    /**
+     * a[j] >= b 的掩码
+     */
+    template <typename T>
+    static uint32_t ge_mask(const T *a, T b) noexcept
+    {
+        uint32_t mask = 0;
+        for (size_t j = 0; j < NODE_CAPACITY; ++j)
+            mask |= ((uint32_t) (a[j] >= b)) << j;
+        return mask;
+    }
+
+#if NUT_PLATFORM_SSE2
+    static uint32_t le_mask(const float *a, float b) noexcept
+    {
+        const __m128 vb = _mm_set1_ps(b);
+        uint32_t mask = 0;
+        for (size_t j = 0; j < NODE_CAPACITY; j += 4)
+            mask |= ((uint32_t) _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(a + j), vb))) << j;
+        return mask;
+    }
+
+    static uint32_t ge_mask(const float *a, float b) noexcept
+    {
+        const __m128 vb = _mm_set1_ps(b);
+        uint32_t mask = 0;
+        for (size_t j = 0; j < NODE_CAPACITY; j += 4)
+            mask |= ((uint32_t) _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(a + j), vb))) << j;
+        return mask;
+    }
+
+    static uint32_t le_mask(const double *a, double b) noexcept
+    {
+        const __m128d vb = _mm_set1_pd(b);
+        uint32_t mask = 0;
+        for (size_t j = 0; j < NODE_CAPACITY; j += 2)
+            mask |= ((uint32_t) _mm_movemask_pd(_mm_cmple_pd(_mm_loadu_pd(a + j), vb))) << j;
+        return mask;
+    }
+
+    static uint32_t ge_mask(const double *a, double b) noexcept
+    {
+        const __m128d vb = _mm_set1_pd(b);
+        uint32_t mask = 0;
+        for (size_t j = 0; j < NODE_CAPACITY; j += 2)
+            mask |= ((uint32_t) _mm_movemask_pd(_mm_cmpge_pd(_mm_loadu_pd(a + j), vb))) << j;
+        return mask;
+    }
+
+    static uint32_t le_mask(const int32_t *a, int32_t b) noexcept
+    {
+        // a <= b 即 !(a > b)
+        const __m128i vb = _mm_set1_epi32(b);
+        uint32_t gt = 0;
+        for (size_t j = 0; j < NODE_CAPACITY; j += 4)
+        {
+            const __m128i va = _mm_loadu_si128((const __m128i*) (a + j));
+            gt |= ((uint32_t) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(va, vb)))) << j;
+        }
+        return ~gt & count_mask(NODE_CAPACITY);
+    }
+
+    static uint32_t ge_mask(const int32_t *a, int32_t b) noexcept
+    {
+        // a >= b 即 !(b > a)
+        const __m128i vb = _mm_set1_epi32(b);
+        uint32_t lt = 0;
+        for (size_t j = 0; j < NODE_CAPACITY; j += 4)
+        {
+            const __m128i va = _mm_loadu_si128((const __m128i*) (a + j));
+            lt |= ((uint32_t) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(vb, va)))) << j;
+        }
+        return ~lt & count_mask(NODE_CAPACITY);
+    }
+#endif
+
+    static area_type lane_area(const Node& n, size_t j) noexcept
+    {
+        assert(j < NODE_CAPACITY);
+        area_type ret;
+        for (size_t d = 0; d < DIMENSIONS; ++d)
+        {
+            ret.lower[d] = n.lower[d][j];
+            ret.higher[d] = n.higher[d][j];
+        }
+        return ret;
+    }
+
+    static area_type node_area(const Node& n) noexcept
+    {
+        assert(n.count > 0);
+        area_type ret = lane_area(n, 0);
+        for (size_t j = 1; j < n.count; ++j)
+            ret.expand_to_contain(lane_area(n, j));
+        return ret;
+    }
+
+    static size_t align_up(size_t v) noexcept
+    {
+        return (v + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    static size_t nodes_offset() noexcept
+    {
+        return align_up(sizeof(Header));
+    }
+
+    size_t data_offset() const noexcept
+    {
+        return align_up(nodes_offset() + sizeof(Node) * _node_count);
+    }
+
+    static size_t write_padding(OutputStream *os, size_t pos, size_t target)
+    {
+        assert(pos <= target && target - pos < ALIGNMENT);
+        const uint8_t zeros[ALIGNMENT] = {0};
+        return pos < target ? os->write(zeros, target - pos) : 0;
+    }
+
+    /**
+     * 使指针指向自身持有的数组
+     */
+    void rebind() noexcept
+    {
+        if (_own_nodes.empty())
+            return;
+        _nodes = _own_nodes.data();
+        _data = _own_data.data();
+        _node_count = _own_nodes.size();
+    }
+
+private:
+    // 构建得到的数据由自身持有; attach() 得到的数据则引用外部内存
+    std::vector<Node> _own_nodes;
+    std::vector<data_type> _own_data;
+
+    const Node *_nodes = nullptr; // 从叶子层到根依次存放，最后一个是根
+    const data_type *_data = nullptr;
+    size_t _node_count = 0;
+    size_t _leaf_count = 0; // 前 _leaf_count 个节点是叶子节点
+    size_t _size = 0; // 数据个数
+    size_t _height = 0; // 层数
+};
+
+}
+
+#endif
@@ -2,11 +2,15 @@
 #ifndef ___HEADFILE_160547E9_5A30_4A78_A5FF_76E0C5EBE229_
 #define ___HEADFILE_160547E9_5A30_4A78_A5FF_76E0C5EBE229_
 
-#include <list>
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h> // for ::malloc()
+#include <string.h> // for ::memset()
+#include <algorithm>
 #include <vector>
 #include <stack>
+#include <queue>
 #include <map> // for pair
-#include <assert.h>
 
 #include "../../../platform/platform.h"
 
@@ -26,6 +30,11 @@ namespace nut
  * 参考资料：
  *      R-Trees - A Dynamic index structure for spatial searching. Antonin Guttman.
  *  University of California Berkeley
+ *      The R*-tree: An Efficient and Robust Access Method for Points and Rectangles.
+ *  Norbert Beckmann, Hans-Peter Kriegel, Ralf Schneider, Bernhard Seeger.
+ *
+ * 插入使用 R*-tree 的算法: 叶子层按重叠扩展最小选取子树，节点溢出时先强制
+ * 重新插入，再按边长之和与重叠最小分裂
  *
  * @param DATA_TYPE 数据类型; 可以是 int、void*, obj* 等
  * @param NUM_TYPE 数字类型; 可以是 int、float 等
@@ -339,6 +348,7 @@ public:
         DataNode *data_node = (DataNode*) ::malloc(sizeof(DataNode));
         assert(nullptr != data_node);
         new (data_node) DataNode(rect, std::forward<data_type>(data));
+        _reinserted = 0;
         insert(data_node, _height);
         ++_size;
     }
@@ -351,6 +361,7 @@ public:
         DataNode *data_node = (DataNode*) ::malloc(sizeof(DataNode));
         assert(nullptr != data_node);
         new (data_node) DataNode(rect, data);
+        _reinserted = 0;
         insert(data_node, _height);
         ++_size;
     }
@@ -544,12 +555,51 @@ public:
                 else if (rect.contains(c->area))
                 {
                     DataNode *dn = dynamic_cast<DataNode*>(c);
-                    appended->push_back(dn->data);
+                    appended->emplace_back(dn->area, dn->data);
                 }
             }
         }
     }
 
+    /**
+     * 查找离指定区域最近的 k 个数据，按距离由近到远排列
+     *
+     * 距离为两个区域之间的最短欧氏距离，相交的区域距离为 0. 查询点时使用上下边界
+     * 相同的区域即可
+     */
+    void search_nearest(
+        const area_type& rect, size_t k,
+        std::vector<std::pair<area_type,data_type>> *appended) noexcept
+    {
+        assert(nullptr != appended);
+        if (0 == k)
+            return;
+
+        size_t count = 0;
+        best_first(rect, [&] (float_type, DataNode *dn) {
+                appended->emplace_back(dn->area, dn->data);
+                return ++count < k;
+            });
+    }
+
+    /**
+     * 查找与指定区域距离不超过 distance 的数据，按距离由近到远排列
+     */
+    void search_within_distance(
+        const area_type& rect, float_type distance,
+        std::vector<std::pair<area_type,data_type>> *appended) noexcept
+    {
+        assert(nullptr != appended && distance >= 0);
+
+        const float_type max_dist2 = distance * distance;
+        best_first(rect, [&] (float_type dist2, DataNode *dn) {
+                if (dist2 > max_dist2)
+                    return false;
+                appended->emplace_back(dn->area, dn->data);
+                return true;
+            });
+    }
+
     /**
      * 返回所有的数据
      */
@@ -640,6 +690,49 @@ public:
     }
 
 private:
+    /**
+     * 按照与 rect 的距离由近到远访问数据节点 (best-first)
+     *
+     * @param visitor 形如 bool visitor(float_type dist2, DataNode*), 参数为距离
+     *      的平方. 返回 false 则终止
+     */
+    template <typename VISITOR>
+    void best_first(const area_type& rect, VISITOR&& visitor) noexcept
+    {
+        typedef std::pair<float_type,Node*> item_type;
+        struct Greater
+        {
+            bool operator()(const item_type& x, const item_type& y) const noexcept
+            {
+                return x.first > y.first;
+            }
+        };
+
+        std::priority_queue<item_type,std::vector<item_type>,Greater> q;
+        q.emplace(0, _root);
+        while (!q.empty())
+        {
+            const item_type item = q.top();
+            q.pop();
+
+            if (!item.second->is_tree_node())
+            {
+                if (!visitor(item.first, dynamic_cast<DataNode*>(item.second)))
+                    return;
+                continue;
+            }
+
+            TreeNode *n = dynamic_cast<TreeNode*>(item.second);
+            for (size_t i = 0; i < MAX_ENTRY_COUNT; ++i)
+            {
+                Node *c = n->child_at(i);
+                if (nullptr == c)
+                    break;
+                q.emplace(rect.distance_square(c->area), c);
+            }
+        }
+    }
+
     /**
      * 扩展到包容指定的区域所需要扩展的空间
      */
@@ -656,272 +749,311 @@ private:
 
     /**
      * 将节点插入深度为 depth 的位置
+     *
+     * NOTE 每次从外部发起插入前都要清除 _reinserted 标记
      */
     void insert(Node *node, size_t depth) noexcept
     {
-        assert(nullptr != node);
+        assert(nullptr != node && 1 <= depth && depth <= _height);
 
         TreeNode *n = choose_node(node->area, depth);
-        TreeNode *ll = n->append_child(node) ? nullptr : split_node(n, node);
-        TreeNode *r = adjust_tree(n, ll);
-        if (nullptr != r)
-        {
-            // new root
-            TreeNode *nln = (TreeNode*) ::malloc(sizeof(TreeNode));
-            assert(nullptr != nln);
-            new (nln) TreeNode();
-            nln->append_child(_root);
-            nln->append_child(r);
-            nln->fit_rect();
-            _root = nln;
-            ++_height;
-        }
+        if (n->append_child(node))
+            fit_to_root(n);
+        else
+            overflow_treatment(n, node, depth);
     }
 
     /**
      * 根据目标区域选区适合的节点
+     *
+     * 子节点为叶子层时选取重叠扩展最小的，否则选取面积扩展最小的
      */
     TreeNode* choose_node(const area_type& rect_to_add, size_t depth) noexcept
     {
         TreeNode *ret = _root;
-        while (depth > 1)
+        for (size_t current = 1; current < depth; ++current)
         {
+            const bool children_are_leaves = (current + 1 == _height);
             TreeNode *nn = nullptr;
-
-            // choose the least enlargement child
-            float_type least = 0;
+            float_type least_overlap = 0, least_enlarge = 0, least_acreage = 0;
             for (size_t i = 0; i < MAX_ENTRY_COUNT; ++i)
             {
                 Node *e = ret->child_at(i);
                 if (nullptr == e)
                     break;
-                float_type el = acreage_needed(e->area, rect_to_add);
-                if (0 == i || el < least)
+
+                const float_type overlap = children_are_leaves ?
+                    overlap_needed(ret, i, rect_to_add) : 0;
+                const float_type enlarge = acreage_needed(e->area, rect_to_add);
+                const float_type acreage = e->area.acreage();
+                if (0 == i || overlap < least_overlap ||
+                    (overlap == least_overlap && (enlarge < least_enlarge ||
+                                                  (enlarge == least_enlarge && acreage < least_acreage))))
                 {
                     nn = dynamic_cast<TreeNode*>(e); // 因为 depth > 1，这里应当是成功的
                     assert(nullptr != nn);
-                    least = el;
+                    least_overlap = overlap;
+                    least_enlarge = enlarge;
+                    least_acreage = acreage;
                 }
             }
             ret = nn;
-            --depth;
         }
         return ret;
     }
 
     /**
-     * 拆分节点
-     *
-     * @param parent The parent node to add a child, (it is full now)
-     * @param child The child to be added
+     * 第 k 个子节点扩展到包容指定区域后，与其他兄弟节点的重叠所增加的空间
      */
-    TreeNode* split_node(TreeNode *parent, Node *child) noexcept
+    static float_type overlap_needed(TreeNode *parent, size_t k, const area_type& rect_to_add) noexcept
     {
-        assert(nullptr != parent && nullptr != child);
-
-        typedef typename std::list<Node*>::const_iterator iter_type;
+        const area_type& old_area = parent->child_at(k)->area;
+        area_type new_area = old_area;
+        new_area.expand_to_contain(rect_to_add);
 
-        // 收集所有的子节点
-        std::list<Node*> remained;
-        remained.push_back(child);
+        float_type ret = 0;
         for (size_t i = 0; i < MAX_ENTRY_COUNT; ++i)
         {
-            assert(nullptr != parent->child_at(i));
-            remained.push_back(parent->child_at(i));
+            Node *e = parent->child_at(i);
+            if (nullptr == e)
+                break;
+            if (i == k)
+                continue;
+            ret += new_area.intersection_acreage(e->area) - old_area.intersection_acreage(e->area);
         }
+        return ret;
+    }
 
-        // 挑选两个种子，并分别作为 parent 和 uncle (parent的兄弟节点) 的一个子节点
-        Node *seed1 = nullptr, *seed2 = nullptr;
-        liner_pick_seeds(&remained, &seed1, &seed2);
-        assert(nullptr != seed1 && nullptr != seed2);
-        parent->clear_children();
-        parent->area = seed1->area;
-        parent->append_child(seed1);
-        TreeNode *uncle = (TreeNode*) ::malloc(sizeof(TreeNode));
-        assert(nullptr != uncle);
-        new (uncle) TreeNode();
-        uncle->append_child(seed2);
-        uncle->fit_rect();
-
-        size_t count1 = 1, count2 = 1;
-        while (!remained.empty())
+    /**
+     * 处理节点溢出
+     *
+     * 每次插入过程中，非根节点的每一层第一次溢出时做强制重新插入，之后则分裂节点，
+     * 分裂产生的新节点加入父节点可能导致父节点继续溢出
+     *
+     * @param n     已满的节点
+     * @param extra 要加入 n 的节点
+     * @param depth n 的深度
+     */
+    void overflow_treatment(TreeNode *n, Node *extra, size_t depth) noexcept
+    {
+        assert(nullptr != n && nullptr != extra);
+        while (true)
         {
-            if (remained.size() == MIN_ENTRY_COUNT - count1)
-            {
-                for (iter_type iter = remained.begin(), end = remained.end();
-                    iter != end; ++iter)
-                {
-                    parent->append_child(*iter);
-                    parent->area.expand_to_contain((*iter)->area);
-                }
-                break;
-            }
-            else if (remained.size() == MIN_ENTRY_COUNT - count2)
+            // 以叶子层为 0 计算层数，根节点分裂时保持不变
+            const size_t level = _height - depth;
+            if (depth > 1 && 0 == (_reinserted & (((uint64_t) 1) << level)))
             {
-                for (iter_type iter = remained.begin(), end = remained.end();
-                    iter != end; ++iter)
-                {
-                    uncle->append_child(*iter);
-                    uncle->area.expand_to_contain((*iter)->area);
-                }
-                break;
+                _reinserted |= ((uint64_t) 1) << level;
+                reinsert(n, extra, depth);
+                return;
             }
 
-            Node *e = pick_next(&remained, parent->area, uncle->area);
-            assert(nullptr != e);
-            float_type el1 = acreage_needed(parent->area, e->area),
-                el2 = acreage_needed(uncle->area, e->area);
-            if (el1 < el2 || (el1 == el2 && count1 < count2))
+            TreeNode *uncle = split_node(n, extra);
+            TreeNode *parent = n->parent;
+            if (nullptr == parent)
             {
-                parent->append_child(e);
-                parent->area.expand_to_contain(e->area);
-                ++count1;
+                // new root
+                TreeNode *nln = (TreeNode*) ::malloc(sizeof(TreeNode));
+                assert(nullptr != nln);
+                new (nln) TreeNode();
+                nln->append_child(_root);
+                nln->append_child(uncle);
+                nln->fit_rect();
+                _root = nln;
+                ++_height;
+                return;
             }
-            else
+
+            if (parent->append_child(uncle))
             {
-                uncle->append_child(e);
-                uncle->area.expand_to_contain(e->area);
-                ++count2;
+                fit_to_root(parent);
+                return;
             }
+            n = parent;
+            extra = uncle;
+            --depth;
         }
-
-        return uncle;
     }
 
     /**
-     * 从一堆子节点中选取两个合适的作为种子
+     * 强制重新插入: 从溢出的节点中移除离中心最远的一部分子节点，再重新插入到树中
      */
-    void liner_pick_seeds(std::list<Node*> *children, Node **pseed1, Node **pseed2) noexcept
+    void reinsert(TreeNode *n, Node *extra, size_t depth) noexcept
     {
-        assert(nullptr != children && children->size() >= 2 &&
-               nullptr != pseed1 && nullptr != pseed2);
+        assert(nullptr != n && nullptr != extra);
 
-        typedef std::list<Node*> list_type;
-        typedef typename list_type::iterator iter_type;
+        const size_t total = MAX_ENTRY_COUNT + 1;
+        Node *entries[MAX_ENTRY_COUNT + 1];
+        area_type all = extra->area;
+        for (size_t i = 0; i < MAX_ENTRY_COUNT; ++i)
+        {
+            entries[i] = n->child_at(i);
+            assert(nullptr != entries[i]);
+            all.expand_to_contain(entries[i]->area);
+        }
+        entries[MAX_ENTRY_COUNT] = extra;
+
+        // 按中心距离由远到近排序
+        std::sort(entries, entries + total, [&all] (Node *x, Node *y) {
+                return center_distance_square(x->area, all) > center_distance_square(y->area, all);
+            });
+
+        // 重新插入 30% 的子节点
+        const size_t count = std::max<size_t>(1, total * 3 / 10);
+        n->clear_children();
+        for (size_t i = count; i < total; ++i)
+            n->append_child(entries[i]);
+        fit_to_root(n);
+
+        const size_t level = _height - depth;
+        for (size_t i = count; i > 0; --i)
+            insert(entries[i - 1], _height - level);
+    }
 
-        // 下面两组变量用来求各个维度中 children 占用的 range
-        iter_type highest_high_side[DIMENSIONS];
-        iter_type lowest_low_side[DIMENSIONS];
+    /**
+     * 两个区域中心之间距离的平方
+     */
+    static float_type center_distance_square(const area_type& x, const area_type& y) noexcept
+    {
+        float_type ret = 0;
+        for (size_t i = 0; i < DIMENSIONS; ++i)
+        {
+            const float_type diff = ((float_type) x.lower[i] + (float_type) x.higher[i]) -
+                ((float_type) y.lower[i] + (float_type) y.higher[i]);
+            ret += diff * diff;
+        }
+        return ret / 4;
+    }
 
-        // 下面两组变量用来求 children 在各个维度中分的最开的两个 child
-        iter_type highest_low_side[DIMENSIONS];
-        iter_type lowest_high_side[DIMENSIONS];
+    /**
+     * 从 n 开始直到根节点，重新调整区域
+     */
+    static void fit_to_root(TreeNode *n) noexcept
+    {
+        for (; nullptr != n; n = n->parent)
+            n->fit_rect();
+    }
 
-        // 初始化
-        const iter_type end = children->end();
-        for (size_t i = 0; i < DIMENSIONS; ++i)
+    /**
+     * 拆分节点 (R*-tree)
+     *
+     * 先选取各种分配方案的边长之和最小的维度，然后在该维度上选取重叠最小的分配方案
+     *
+     * @param parent The parent node to add a child, (it is full now)
+     * @param child The child to be added
+     * @return 新的兄弟节点
+     */
+    TreeNode* split_node(TreeNode *parent, Node *child) noexcept
+    {
+        assert(nullptr != parent && nullptr != child);
+
+        // 收集所有的子节点
+        const size_t total = MAX_ENTRY_COUNT + 1;
+        Node *entries[MAX_ENTRY_COUNT + 1];
+        for (size_t i = 0; i < MAX_ENTRY_COUNT; ++i)
         {
-            highest_high_side[i] = end;
-            lowest_low_side[i] = end;
-            highest_low_side[i] = end;
-            lowest_high_side[i] = end;
+            entries[i] = parent->child_at(i);
+            assert(nullptr != entries[i]);
         }
+        entries[MAX_ENTRY_COUNT] = child;
 
-        // 给上述四组变量取值
-        for (iter_type iter = children->begin(); iter != end; ++iter)
+        // 选取分裂的维度
+        size_t best_axis = 0;
+        float_type least_margin = 0;
+        for (size_t axis = 0; axis < DIMENSIONS; ++axis)
         {
-            assert(nullptr != *iter);
-            for (size_t i = 0; i < DIMENSIONS; ++i)
+            float_type margin = 0;
+            for (int by_higher = 0; by_higher < 2; ++by_higher)
+            {
+                sort_entries(entries, axis, 0 != by_higher);
+                area_type prefix[MAX_ENTRY_COUNT + 1], suffix[MAX_ENTRY_COUNT + 1];
+                bound_entries(entries, prefix, suffix);
+                for (size_t s = MIN_ENTRY_COUNT; s <= total - MIN_ENTRY_COUNT; ++s)
+                    margin += prefix[s - 1].margin() + suffix[s].margin();
+            }
+            if (0 == axis || margin < least_margin)
             {
-                const area_type& area = (*iter)->area;
-
-                if (highest_high_side[i] == end || area.higher[i] > (*(highest_high_side[i]))->area.higher[i])
-                    highest_high_side[i] = iter;
-
-                if (lowest_low_side[i] == end || area.lower[i] < (*(lowest_low_side[i]))->area.lower[i])
-                    lowest_low_side[i] = iter;
-
-                // 这两组变量在各个维度中不能取相同的值
-                if (highest_low_side[i] == end)
-                    highest_low_side[i] = iter;
-                else if (lowest_high_side[i] == end)
-                    lowest_high_side[i] = iter;
-                else if (area.lower[i] > (*(highest_low_side[i]))->area.lower[i])
-                    highest_low_side[i] = iter;
-                else if (area.higher[i] < (*(lowest_high_side[i]))->area.higher[i])
-                    lowest_high_side[i] = iter;
+                best_axis = axis;
+                least_margin = margin;
             }
         }
 
-        // 对比各个维度的分离度，取分离度最大的维度对应的一组数据
-        int greatest_separation_idx = 0;
-        float_type greatest_separation = 0;
-        for (size_t i = 0; i < DIMENSIONS; ++i)
+        // 选取分配方案
+        bool best_by_higher = false;
+        size_t best_split = MIN_ENTRY_COUNT;
+        float_type least_overlap = 0, least_acreage = 0;
+        for (int by_higher = 0; by_higher < 2; ++by_higher)
         {
-            float_type width = (*(highest_high_side[i]))->area.higher[i] -
-                (*(lowest_low_side[i]))->area.lower[i];
-            assert(width > 0);
-            float_type separation = (*(highest_low_side[i]))->area.lower[i] -
-                (*(lowest_high_side[i]))->area.higher[i];
-            if (separation < 0)
-                separation = -separation;
-            float_type nomalize = separation / width;
-            if (i == 0 || nomalize > greatest_separation)
+            sort_entries(entries, best_axis, 0 != by_higher);
+            area_type prefix[MAX_ENTRY_COUNT + 1], suffix[MAX_ENTRY_COUNT + 1];
+            bound_entries(entries, prefix, suffix);
+            for (size_t s = MIN_ENTRY_COUNT; s <= total - MIN_ENTRY_COUNT; ++s)
             {
-                greatest_separation_idx = (int) i;
-                greatest_separation = nomalize;
+                const float_type overlap = prefix[s - 1].intersection_acreage(suffix[s]);
+                const float_type acreage = prefix[s - 1].acreage() + suffix[s].acreage();
+                if ((0 == by_higher && MIN_ENTRY_COUNT == s) || overlap < least_overlap ||
+                    (overlap == least_overlap && acreage < least_acreage))
+                {
+                    best_by_higher = (0 != by_higher);
+                    best_split = s;
+                    least_overlap = overlap;
+                    least_acreage = acreage;
+                }
             }
         }
-        assert(highest_low_side[greatest_separation_idx] != lowest_high_side[greatest_separation_idx]);
+        sort_entries(entries, best_axis, best_by_higher);
+
+        // 前一部分留在 parent 中，后一部分移到 uncle (parent的兄弟节点) 中
+        parent->clear_children();
+        for (size_t i = 0; i < best_split; ++i)
+            parent->append_child(entries[i]);
+        parent->fit_rect();
 
-        // 构造返回值，并从列表中删除选中的项
-        *pseed1 = *(highest_low_side[greatest_separation_idx]);
-        *pseed2 = *(lowest_high_side[greatest_separation_idx]);
-        children->erase(highest_low_side[greatest_separation_idx]);
-        children->erase(lowest_high_side[greatest_separation_idx]); // 由于是list，上次删除操作后迭代器还未失效
+        TreeNode *uncle = (TreeNode*) ::malloc(sizeof(TreeNode));
+        assert(nullptr != uncle);
+        new (uncle) TreeNode();
+        for (size_t i = best_split; i < total; ++i)
+            uncle->append_child(entries[i]);
+        uncle->fit_rect();
+
+        return uncle;
     }
 
     /**
-     * 从剩余的零散节点中找到下一个适合添加到树上的节点
+     * 按指定维度的下边界(或上边界)排序
      */
-    Node* pick_next(std::list<Node*> *remained, const area_type& r1, const area_type& r2) noexcept
+    static void sort_entries(Node **entries, size_t axis, bool by_higher) noexcept
     {
-        assert(nullptr != remained);
-
-        typedef typename std::list<Node*>::iterator iter_type;
-
-        iter_type max_diff_index = remained->begin();
-        float_type max_diff = 0;
-        for (iter_type iter = remained->begin(), end = remained->end();
-            iter != end; ++iter)
-        {
-            float_type diff = acreage_needed(r1, (*iter)->area) - acreage_needed(r2, (*iter)->area);
-            if (diff < 0)
-                diff = -diff;
-            if (diff > max_diff)
-            {
-                max_diff_index = iter;
-                max_diff = diff;
-            }
-        }
-        Node *ret = *max_diff_index;
-        assert(nullptr != ret);
-        remained->erase(max_diff_index);
-        return ret;
+        std::sort(entries, entries + MAX_ENTRY_COUNT + 1, [=] (Node *x, Node *y) {
+                const area_type &a = x->area, &b = y->area;
+                if (by_higher)
+                    return a.higher[axis] < b.higher[axis] ||
+                        (a.higher[axis] == b.higher[axis] && a.lower[axis] < b.lower[axis]);
+                return a.lower[axis] < b.lower[axis] ||
+                    (a.lower[axis] == b.lower[axis] && a.higher[axis] < b.higher[axis]);
+            });
     }
 
     /**
-     * 添加节点后调整 rtree
+     * 计算前缀和后缀的包围区域
      *
-     * @param n The parent node which has appended a new child
-     * @param nn 可以为 nullptr
+     * @param prefix prefix[i] 为 entries[0..i] 的包围区域
+     * @param suffix suffix[i] 为 entries[i..] 的包围区域
      */
-    TreeNode* adjust_tree(TreeNode *n, TreeNode *nn) noexcept
+    static void bound_entries(Node **entries, area_type *prefix, area_type *suffix) noexcept
     {
-        assert(nullptr != n);
-        while (true)
+        const size_t total = MAX_ENTRY_COUNT + 1;
+        prefix[0] = entries[0]->area;
+        for (size_t i = 1; i < total; ++i)
         {
-            // adjust range of N
-            n->fit_rect();
-
-            // if N is root, stop
-            TreeNode *parent = dynamic_cast<TreeNode*>(n->parent);
-            if (nullptr == parent)
-                return nn;
-
-            if (nullptr != nn)
-                nn = parent->append_child(nn) ? nullptr : split_node(parent, nn);
-            n = parent;
+            prefix[i] = prefix[i - 1];
+            prefix[i].expand_to_contain(entries[i]->area);
+        }
+        suffix[total - 1] = entries[total - 1]->area;
+        for (size_t i = total - 1; i > 0; --i)
+        {
+            suffix[i - 1] = suffix[i];
+            suffix[i - 1].expand_to_contain(entries[i - 1]->area);
         }
     }
 
@@ -1011,7 +1143,7 @@ private:
             {
                 n->parent->remove_child(n);
                 q.push(n);
-                qd.push(depth);
+                qd.push(_height - depth); // 以叶子层为 0 的层数，重新插入时树高可能变化
             }
             else
             {
@@ -1026,7 +1158,7 @@ private:
             q.pop();
             assert(nullptr != n);
 
-            depth = qd.top();
+            const size_t level = qd.top();
             qd.pop();
 
             for (size_t i = 0; i < MAX_ENTRY_COUNT; ++i)
@@ -1034,7 +1166,8 @@ private:
                 Node *e = n->child_at(i);
                 if (nullptr == e)
                     break;
-                insert(e, depth);
+                _reinserted = 0;
+                insert(e, _height - level);
             }
 
             // 释放内存
@@ -1048,6 +1181,9 @@ private:
     TreeNode *_root = nullptr; // 根节点
     size_t _height = 0; // 高度，TreeNode的层数
     size_t _size = 0; // 容量
+
+    // 插入过程中已经做过强制重新插入的层, 以叶子层为第 0 位
+    uint64_t _reinserted = 0;
 };
 
 }
@@ -38,6 +38,9 @@ namespace nut
 template <typename ENTRY, typename DATA>
 class TrieTree
 {
+    // 只读形式，直接读取节点进行构建
+    template <typename E, typename D> friend class FrozenTrieTree;
+
 private:
     /**
      * 字典树中的节点, 同时其子节点组成一颗红黑树
@@ -1,8 +1,13 @@
 ﻿
 #include <assert.h>
 #include <string>
-#include <algorithm> // for std::reverse()
+#include <stdlib.h> // for ::malloc(), ::free()
+#include <string.h> // for ::memcpy()
+#include <algorithm> // for std::reverse(), std::min(), std::max()
+#include <atomic>
+#include <mutex>
 #include <random>
+#include <vector>
 
 #include "../platform/sys.h"
 #include "../util/string/string_utils.h"
@@ -12,7 +17,19 @@
 #include "word_array_integer/div_op.h"
 #include "word_array_integer/shift_op.h"
 #include "word_array_integer/bit_op.h"
-#include "numeric_algo/karatsuba.h"
+#include "numeric_algo/fast_multiply.h"
+#include "numeric_algo/recursive_divide.h"
+
+
+/**
+ * 规模(字)不小于该值时, 非 2 的幂次的进制转换使用分治算法
+ */
+#define NUT_RADIX_CONVERSION_THRESHOLD 32
+
+/**
+ * 缓存的 radix 的幂次的最大级数, 第 i 级为 radix ^ (k * 2^i)
+ */
+#define NUT_RADIX_POWER_MAX_LEVEL 48
 
 
 namespace nut
@@ -310,7 +327,7 @@ BigInteger BigInteger::operator*(const BigInteger& x) const noexcept
     const size_type siglen = significant_words_length(), x_siglen = x.significant_words_length(),
         ret_siglen = siglen + x_siglen;
     ret.ensure_cap(ret_siglen);
-    signed_karatsuba_multiply(data(), siglen, x.data(), x_siglen, ret.data(), ret_siglen);
+    signed_fast_multiply(data(), siglen, x.data(), x_siglen, ret.data(), ret_siglen);
     ret.set_significant_len(ret_siglen);
     ret.minimize_significant_len();
     return ret;
@@ -435,7 +452,7 @@ BigInteger& BigInteger::operator*=(const BigInteger& x) noexcept
         new_siglen = siglen + x_siglen;
     ensure_cap(new_siglen);
     word_type *const raw_data = data();
-    signed_karatsuba_multiply(raw_data, siglen, x.data(), x_siglen, raw_data, new_siglen);
+    signed_fast_multiply(raw_data, siglen, x.data(), x_siglen, raw_data, new_siglen);
     set_significant_len(new_siglen);
     minimize_significant_len();
     return *this;
@@ -591,6 +608,12 @@ void BigInteger::divide(const BigInteger& a, const BigInteger& b,
     assert(!b.is_zero());
 
     const size_type a_siglen = a.significant_words_length(), b_siglen = b.significant_words_length();
+    if (b_siglen >= 2 * NUT_BURNIKEL_ZIEGLER_THRESHOLD && a_siglen >= b_siglen + NUT_BURNIKEL_ZIEGLER_OFFSET)
+    {
+        burnikel_ziegler_divide(a, b, result, remainder);
+        return;
+    }
+
     if (nullptr != result)
         result->ensure_cap(a_siglen);
     if (nullptr != remainder)
@@ -720,9 +743,9 @@ void BigInteger::multiply_to_len(const BigInteger& a, size_type bit_len) noexcep
     const size_type new_siglen = (bit_len + 8 * sizeof(word_type) - 1) / (8 * sizeof(word_type));
     ensure_cap(new_siglen);
     word_type *const raw_data = data();
-    signed_karatsuba_multiply(raw_data, significant_words_length(),
-                              a.data(), a.significant_words_length(),
-                              raw_data, new_siglen);
+    signed_fast_multiply(raw_data, significant_words_length(),
+                         a.data(), a.significant_words_length(),
+                         raw_data, new_siglen);
     set_significant_len(new_siglen);
     limit_positive_bits_to(bit_len);
 }
@@ -939,86 +962,211 @@ static constexpr bool is_valid_radix(size_t radix) noexcept
 }
 #endif
 
-std::string BigInteger::to_string(size_type radix) const noexcept
+template <typename C>
+static C digit_to_char(int d) noexcept;
+
+template <>
+char digit_to_char<char>(int d) noexcept
 {
-    assert(is_valid_radix(radix));
+    return int_to_char(d, true);
+}
 
-    BigInteger tmp(*this);
-    const bool negative = tmp.is_negative();
-    if (negative)
-        tmp = -tmp;
+template <>
+wchar_t digit_to_char<wchar_t>(int d) noexcept
+{
+    return int_to_wchar(d, true);
+}
 
-    std::string s;
-    if (1 == nut::bit1_count((uint32_t) radix))
+/**
+ * 单字能容纳的 radix 的最高幂次
+ *
+ * @param digits 幂次
+ * @return radix ^ digits
+ */
+static BigInteger::word_type max_radix_power(size_t radix, size_t *digits) noexcept
+{
+    typedef BigInteger::word_type word_type;
+
+    word_type power = (word_type) radix;
+    size_t k = 1;
+    while (power <= (~(word_type) 0) / radix)
     {
-        // 进制是 2 的幂次，可以通过移位优化
-        const unsigned shift_count = nut::lowest_bit1((uint32_t) radix);
-        assert(shift_count <= 8 * sizeof(word_type));
-        const word_type mask = ~((~(word_type)0) << shift_count);
-        do
+        power *= (word_type) radix;
+        ++k;
+    }
+    *digits = k;
+    return power;
+}
+
+// 分治进制转换用到的 radix 的幂次, 一直缓存到进程退出
+static std::atomic<BigInteger*> radix_powers[37][NUT_RADIX_POWER_MAX_LEVEL];
+static std::mutex radix_powers_lock;
+
+/**
+ * radix ^ (k * 2^level), 其中 radix ^ k 为单字能容纳的 radix 的最高幂次
+ *
+ * 每级由上一级平方得到, 计算过的各级在不同的调用之间复用
+ */
+static const BigInteger& radix_power(size_t radix, size_t level) noexcept
+{
+    assert(is_valid_radix(radix) && level < NUT_RADIX_POWER_MAX_LEVEL);
+    std::atomic<BigInteger*> *const powers = radix_powers[radix];
+    BigInteger *power = powers[level].load(std::memory_order_acquire);
+    if (nullptr != power)
+        return *power;
+
+    std::lock_guard<std::mutex> guard(radix_powers_lock);
+    for (size_t i = 0; i <= level; ++i)
+    {
+        if (nullptr != powers[i].load(std::memory_order_relaxed))
+            continue;
+        if (0 == i)
         {
-            s.push_back(int_to_char((int) (tmp.data()[0] & mask), true));
-            tmp >>= shift_count;
-        } while (!tmp.is_zero());
+            size_t k;
+            const BigInteger::word_type big_radix = max_radix_power(radix, &k);
+            power = new BigInteger(&big_radix, sizeof(big_radix), false);
+        }
+        else
+        {
+            const BigInteger& prev = *powers[i - 1].load(std::memory_order_relaxed);
+            power = new BigInteger(prev * prev);
+        }
+        powers[i].store(power, std::memory_order_release);
     }
-    else
+    return *powers[level].load(std::memory_order_relaxed);
+}
+
+/**
+ * 非负数逐字除以 radix 的幂次, 输出各位数字(低位在前)
+ *
+ * @param width 输出的位数, 不足则补 0; 为 0 则不补齐
+ */
+template <typename C>
+static void to_digits_base(const BigInteger& x, size_t radix, size_t width, std::basic_string<C> *s) noexcept
+{
+    typedef BigInteger::word_type word_type;
+
+    size_t k;
+    const word_type big_radix = max_radix_power(radix, &k);
+
+    size_t len = x.significant_words_length();
+    word_type *const buf = (word_type*) ::malloc(sizeof(word_type) * len);
+    ::memcpy(buf, x.data(), sizeof(word_type) * len);
+    const size_t start = s->size();
+    do
     {
-        // 朴素算法
-        const BigInteger RADIX(radix);
-        do
+        word_type rem = unsigned_divide_word(buf, len, big_radix, buf);
+        while (len > 1 && 0 == buf[len - 1])
+            --len;
+        for (size_t i = 0; i < k; ++i)
         {
-            BigInteger n;
-            BigInteger::divide(tmp, RADIX, &tmp, &n);
-            s.push_back(int_to_char((int) n.to_integer(), true));
-        } while (!tmp.is_zero());
+            s->push_back(digit_to_char<C>((int) (rem % radix)));
+            rem /= radix;
+        }
+    } while (len > 1 || 0 != buf[0]);
+    ::free(buf);
+
+    // 去掉(或补齐)高位的 0
+    if (width > 0)
+    {
+        s->resize(start + width, (C) '0');
     }
+    else
+    {
+        while (s->size() > start + 1 && (C) '0' == s->back())
+            s->pop_back();
+    }
+}
 
-    if (negative)
-        s.push_back('-');
-    std::reverse(s.begin(), s.end());
-    return s;
+/**
+ * 分治进制转换: 除以 radix 的幂次, 分别转换商和余数
+ *
+ * @param level x < radix_power(radix, level - 1) ^ 2
+ * @param width 输出的位数, 不足则补 0; 为 0 则不补齐
+ */
+template <typename C>
+static void to_digits(const BigInteger& x, size_t radix, size_t k, size_t level, size_t width,
+                      std::basic_string<C> *s) noexcept
+{
+    if (0 == level || x.significant_words_length() < NUT_RADIX_CONVERSION_THRESHOLD)
+    {
+        to_digits_base(x, radix, width, s);
+        return;
+    }
+
+    --level;
+    BigInteger q, r;
+    BigInteger::divide(x, radix_power(radix, level), &q, &r);
+    if (0 == width && q.is_zero())
+    {
+        to_digits(r, radix, k, level, 0, s);
+        return;
+    }
+    const size_t low_width = k << level;
+    to_digits(r, radix, k, level, low_width, s);
+    to_digits(q, radix, k, level, (width > low_width ? width - low_width : 0), s);
 }
 
-std::wstring BigInteger::to_wstring(size_type radix) const noexcept
+template <typename C>
+static std::basic_string<C> to_chars(const BigInteger& x, size_t radix) noexcept
 {
+    typedef BigInteger::word_type word_type;
     assert(is_valid_radix(radix));
 
-    BigInteger tmp(*this);
-    const bool negative = tmp.is_negative();
-    if (negative)
-        tmp = -tmp;
+    const bool negative = x.is_negative();
+    const BigInteger tmp(negative ? -x : x);
 
-    std::wstring s;
+    std::basic_string<C> s;
     if (1 == nut::bit1_count((uint32_t) radix))
     {
-        // 进制是 2 的幂次，可以通过移位优化
+        // 进制是 2 的幂次，直接按比特截取
         const unsigned shift_count = nut::lowest_bit1((uint32_t) radix);
         assert(shift_count <= 8 * sizeof(word_type));
         const word_type mask = ~((~(word_type)0) << shift_count);
-        do
+        const word_type *const data = tmp.data();
+        const size_t siglen = tmp.significant_words_length();
+        const size_t count = std::max<size_t>(1, (tmp.bit_length() + shift_count - 1) / shift_count);
+        s.reserve(count + 1);
+        for (size_t i = 0; i < count; ++i)
         {
-            s.push_back(int_to_wchar((int) (tmp.data()[0] & mask), true));
-            tmp >>= shift_count;
-        } while (!tmp.is_zero());
+            const size_t pos = i * shift_count, word_index = pos / (8 * sizeof(word_type)),
+                offset = pos % (8 * sizeof(word_type));
+            word_type v = data[word_index] >> offset;
+            if (offset + shift_count > 8 * sizeof(word_type) && word_index + 1 < siglen)
+                v |= data[word_index + 1] << (8 * sizeof(word_type) - offset);
+            s.push_back(digit_to_char<C>((int) (v & mask)));
+        }
     }
     else
     {
-        // 朴素算法
-        const BigInteger RADIX(radix);
-        do
+        // 规模较大时, 用 radix 的 k * 2^i 次幂分治转换
+        size_t k, levels = 0;
+        max_radix_power(radix, &k);
+        if (tmp.significant_words_length() >= NUT_RADIX_CONVERSION_THRESHOLD)
         {
-            BigInteger n;
-            BigInteger::divide(tmp, RADIX, &tmp, &n);
-            s.push_back(int_to_wchar((int) n.to_integer(), true));
-        } while (!tmp.is_zero());
+            levels = 1;
+            while (2 * radix_power(radix, levels - 1).bit_length() - 1 <= tmp.bit_length())
+                ++levels;
+        }
+        to_digits(tmp, radix, k, levels, 0, &s);
     }
 
     if (negative)
-        s.push_back(L'-');
+        s.push_back((C) '-');
     std::reverse(s.begin(), s.end());
     return s;
 }
 
+std::string BigInteger::to_string(size_type radix) const noexcept
+{
+    return to_chars<char>(*this, radix);
+}
+
+std::wstring BigInteger::to_wstring(size_type radix) const noexcept
+{
+    return to_chars<wchar_t>(*this, radix);
+}
+
 static constexpr bool is_blank(char c) noexcept
 {
     return ' ' == c || '\t' == c;
@@ -1065,86 +1213,119 @@ static bool is_valid_char(wchar_t c, size_t radix) noexcept
     return L'a' <= c && c <= L'a' + (int) radix - 10 - 1;
 }
 
-BigInteger BigInteger::value_of(const std::string& s, size_type radix) noexcept
+/**
+ * 各位数字(高位在前)逐字乘以 radix 的幂次再累加
+ */
+static BigInteger from_digits_base(const uint8_t *digits, size_t n, size_t radix) noexcept
 {
-    assert(radix > 1 && radix <= 36);
-    BigInteger ret;
-
-    // 略过空白
-    size_type index = skip_blank(s, 0);
-    if (index >= s.length())
-        return ret;
+    typedef BigInteger::word_type word_type;
 
-    // 正负号
-    bool negative = ('-' == s[index]);
-    if ('+' == s[index] || '-' == s[index])
-    {
-        index = skip_blank(s, index + 1);
-        if (index >= s.length())
-            return ret;
-    }
+    size_t k;
+    const word_type big_radix = max_radix_power(radix, &k);
 
-    // 数字值
-    const unsigned radix_bc = nut::bit1_count((uint32_t) radix),
-        shift_count = nut::lowest_bit1((uint32_t) radix);
-    assert(shift_count <= 8 * sizeof(word_type));
-    while (index < s.length() && is_valid_char(s[index], radix))
+    word_type *const buf = (word_type*) ::malloc(sizeof(word_type) * (n / k + 2));
+    size_t len = 1;
+    buf[0] = 0;
+    for (size_t i = 0; i < n; i += k)
     {
-        if (1 == radix_bc)
-        {
-            ret <<= shift_count;
-            ret.data()[0] |= char_to_int(s[index]);
-        }
-        else
+        // 取 k 位数字
+        const size_t c = std::min(k, n - i);
+        word_type carry = 0, mult = 1;
+        for (size_t j = 0; j < c; ++j)
         {
-            ret *= radix;
-            ret += char_to_int(s[index]);
+            carry = carry * radix + digits[i + j];
+            mult *= (word_type) radix;
         }
-
-        index = skip_blank(s, index + 1);
+        if (c == k)
+            mult = big_radix;
+
+        // buf = buf * mult + carry
+        for (size_t j = 0; j < len; ++j)
+            buf[j] = multiply_add<word_type>(buf[j], mult, carry, 0, &carry);
+        if (0 != carry)
+            buf[len++] = carry;
     }
 
-    if (negative)
-        ret = -ret;
+    BigInteger ret(buf, sizeof(word_type) * len, false);
+    ::free(buf);
     return ret;
 }
 
-BigInteger BigInteger::value_of(const std::wstring& s, size_type radix) noexcept
+/**
+ * 分治进制转换: 高位部分乘以 radix 的幂次, 再加上低位部分
+ */
+static BigInteger from_digits(const uint8_t *digits, size_t n, size_t radix, size_t k) noexcept
+{
+    if (n <= k * NUT_RADIX_CONVERSION_THRESHOLD)
+        return from_digits_base(digits, n, radix);
+
+    // 低位部分取 k * 2^level 位, 为小于 n 的最大者
+    size_t level = 0;
+    while ((k << (level + 1)) < n)
+        ++level;
+
+    const size_t low = k << level;
+    BigInteger ret = from_digits(digits, n - low, radix, k);
+    ret *= radix_power(radix, level);
+    ret += from_digits(digits + n - low, low, radix, k);
+    return ret;
+}
+
+template <typename C>
+static BigInteger value_of_chars(const std::basic_string<C>& s, size_t radix) noexcept
 {
-    assert(radix > 1 && radix <= 36);
+    typedef BigInteger::word_type word_type;
+    assert(is_valid_radix(radix));
     BigInteger ret;
 
     // 略过空白
-    size_type index = skip_blank(s, 0);
+    size_t index = skip_blank(s, 0);
     if (index >= s.length())
         return ret;
 
     // 正负号
-    bool negative = (L'-' == s[index]);
-    if (L'+' == s[index] || L'-' == s[index])
+    const bool negative = ((C) '-' == s[index]);
+    if ((C) '+' == s[index] || (C) '-' == s[index])
     {
         index = skip_blank(s, index + 1);
         if (index >= s.length())
             return ret;
     }
 
-    // 数字值
-    const unsigned radix_bc = nut::bit1_count((uint32_t) radix),
-        shift_count = nut::lowest_bit1((uint32_t) radix);
+    // 数字值, 高位在前
+    std::vector<uint8_t> digits;
     while (index < s.length() && is_valid_char(s[index], radix))
     {
-        if (1 == radix_bc)
-        {
-            ret <<= shift_count;
-            ret.data()[0] |= char_to_int(s[index]);
-        }
-        else
+        digits.push_back((uint8_t) char_to_int(s[index]));
+        index = skip_blank(s, index + 1);
+    }
+    if (digits.empty())
+        return ret;
+
+    const size_t n = digits.size();
+    if (1 == nut::bit1_count((uint32_t) radix))
+    {
+        // 进制是 2 的幂次，直接按比特填充
+        const unsigned shift_count = nut::lowest_bit1((uint32_t) radix);
+        assert(shift_count <= 8 * sizeof(word_type));
+        const size_t len = (n * shift_count + 8 * sizeof(word_type) - 1) / (8 * sizeof(word_type)) + 1;
+        std::vector<word_type> buf(len, 0);
+        for (size_t i = 0; i < n; ++i)
         {
-            ret *= radix;
-            ret += char_to_int(s[index]);
+            const word_type v = digits[n - 1 - i];
+            const size_t pos = i * shift_count, word_index = pos / (8 * sizeof(word_type)),
+                offset = pos % (8 * sizeof(word_type));
+            buf[word_index] |= v << offset;
+            if (offset + shift_count > 8 * sizeof(word_type))
+                buf[word_index + 1] |= v >> (8 * sizeof(word_type) - offset);
         }
-
-        index = skip_blank(s, index + 1);
+        ret.set(buf.data(), sizeof(word_type) * len, false);
+    }
+    else
+    {
+        size_t k;
+        max_radix_power(radix, &k);
+        ret = from_digits(digits.data(), n, radix, k);
     }
 
     if (negative)
@@ -1152,6 +1333,16 @@ BigInteger BigInteger::value_of(const std::wstring& s, size_type radix) noexcept
     return ret;
 }
 
+BigInteger BigInteger::value_of(const std::string& s, size_type radix) noexcept
+{
+    return value_of_chars(s, radix);
+}
+
+BigInteger BigInteger::value_of(const std::wstring& s, size_type radix) noexcept
+{
+    return value_of_chars(s, radix);
+}
+
 bool operator==(BigInteger::cast_int_type a, const BigInteger& b) noexcept
 {
     return b == a;
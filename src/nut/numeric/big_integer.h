@@ -13,6 +13,19 @@
 #include "../platform/int_type.h"
 
 
+/**
+ * BigInteger 的字(word)长度, 可以在编译时指定为 32 或者 64
+ *
+ * NOTE 64 位字依赖于 128 位整数类型来计算乘除法
+ */
+#if !defined(NUT_BIGINTEGER_WORD_BITS)
+#   if NUT_HAS_INT128
+#       define NUT_BIGINTEGER_WORD_BITS 64
+#   else
+#       define NUT_BIGINTEGER_WORD_BITS 32
+#   endif
+#endif
+
 namespace nut
 {
 
@@ -29,13 +42,17 @@ namespace nut
 class NUT_API BigInteger
 {
 public:
-    typedef unsigned int                            word_type;
+#if NUT_BIGINTEGER_WORD_BITS == 64
+    typedef uint64_t                                word_type;
+#else
+    typedef uint32_t                                word_type;
+#endif
     typedef StdInt<word_type>::double_unsigned_type dword_type;
     typedef long long                               cast_int_type;
     typedef size_t                                  size_type;
 
     static_assert(std::is_unsigned<word_type>::value, "Unexpected integer type");
-    static_assert(std::is_unsigned<dword_type>::value, "Unexpected integer type");
+    static_assert(sizeof(dword_type) == 2 * sizeof(word_type), "Unexpected integer type"); // NOTE 严格 c++11 下 std::is_unsigned<uint128_t> 为 false
     static_assert(std::is_signed<cast_int_type>::value, "Unexpected integer type");
     static_assert(sizeof(cast_int_type) % sizeof(word_type) == 0, "Unexpected integer size");
 
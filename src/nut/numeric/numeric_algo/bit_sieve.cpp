@@ -1,4 +1,12 @@
 ﻿
+#include <assert.h>
+#include <stdlib.h> // for ::malloc(), ::free()
+#include <string.h> // for ::memset()
+#include <algorithm> // for std::min(), std::max()
+#include <vector>
+
+#include "../../threading/thread_pool.h"
+#include "../word_array_integer/bit_op.h"
 #include "bit_sieve.h"
 #include "prime.h"
 
@@ -11,17 +19,39 @@ BitSieve BitSieve::_small_sieve;
 /**
  * Given a bit index return unit index containing it.
  */
-static int unit_index(int bit_index) noexcept
+static size_t unit_index(size_t bit_index) noexcept
 {
-    return (int) (((unsigned) bit_index) >> 6);
+    return bit_index >> 6;
 }
 
 /**
  * Return a unit that masks the specified bit in its unit.
  */
-static int64_t bit(int bit_index) noexcept
+static uint64_t bit(size_t bit_index) noexcept
 {
-    return ((int64_t) 1) << (bit_index & ((1 << 6) - 1));
+    return ((uint64_t) 1) << (bit_index & ((1 << 6) - 1));
+}
+
+/**
+ * 非负数 a 对 d 取模
+ *
+ * 逐个 32 位半字做除法, 只需要 64 位整数运算
+ */
+static uint32_t mod_uint32(const BigInteger& a, uint32_t d) noexcept
+{
+    assert(a.is_positive() && 0 != d);
+    const BigInteger::word_type *const words = a.data();
+    uint64_t rem = 0;
+    for (size_t i = a.significant_words_length(); i > 0; --i)
+    {
+        const BigInteger::word_type w = words[i - 1];
+        for (size_t j = sizeof(w) / sizeof(uint32_t); j > 0; --j)
+        {
+            const uint32_t half = (uint32_t) (w >> (32 * (j - 1) % (8 * sizeof(w))));
+            rem = ((rem << 32) | half) % d;
+        }
+    }
+    return (uint32_t) rem;
 }
 
 /**
@@ -39,20 +69,20 @@ BitSieve::BitSieve() noexcept
 {
     _length = 150 * 64;
     _bits_cap = unit_index(_length - 1) + 1;
-    _bits = (int64_t*) ::malloc(sizeof(int64_t) * _bits_cap);
-    ::memset(_bits, 0, sizeof(int64_t) * _bits_cap);
+    _bits = (uint64_t*) ::malloc(sizeof(uint64_t) * _bits_cap);
+    ::memset(_bits, 0, sizeof(uint64_t) * _bits_cap);
 
     // Mark 1 as composite
     set(0);
-    int next_index = 1;
-    int next_prime = 3;
+    ssize_t next_index = 1;
+    size_t next_prime = 3;
 
     // Find primes and remove their multiples from sieve
     do
     {
         sieve_single(_length, next_index + next_prime, next_prime);
         next_index = sieve_search(_length, next_index + 1);
-        next_prime = 2 * next_index + 1;
+        next_prime = 2 * (size_t) next_index + 1;
     } while((next_index > 0) && (next_prime < _length));
 }
 
@@ -61,8 +91,10 @@ BitSieve::BitSieve() noexcept
  * candidates. The new sieve begins at the specified base, which must
  * be even.
  */
-BitSieve::BitSieve(const BigInteger& base, int search_len) noexcept
+BitSieve::BitSieve(const BigInteger& base, size_t search_len) noexcept
 {
+    assert(search_len > 0 && base.is_positive() && 0 == base.bit_at(0));
+
     /*
      * Candidates are indicated by clear bits in the sieve. As a candidates
      * nonprimality is calculated, a bit is set in the sieve to eliminate
@@ -71,30 +103,37 @@ BitSieve::BitSieve(const BigInteger& base, int search_len) noexcept
      * odd number).
      */
     _bits_cap = unit_index(search_len - 1) + 1;
-    _bits = (int64_t*) ::malloc(sizeof(int64_t) * _bits_cap);
-    ::memset(_bits, 0, _bits_cap * sizeof(int64_t));
+    _bits = (uint64_t*) ::malloc(sizeof(uint64_t) * _bits_cap);
+    ::memset(_bits, 0, _bits_cap * sizeof(uint64_t));
     _length = search_len;
 
-    int start = 0;
-    int step = _small_sieve.sieve_search(_small_sieve._length, start);
-    int converted_step = (step * 2) + 1;
-
-    // Construct the large sieve at an even offset specified by base
-    do
+    // 小素数每若干个一组, 乘积不超过 32 位; 每组只对 base 做一次多精度取模, 再由
+    // 余数得到 base 对组内各素数的余数
+    std::vector<uint32_t> group;
+    uint64_t group_product = 1;
+    ssize_t step = _small_sieve.sieve_search(_small_sieve._length, 0);
+    while (step > 0)
     {
-        // Calculate base mod converted_step
-        start = (int) (base % converted_step).to_integer();
-
-        // Take each multiple of step out of sieve
-        start = converted_step - start;
-        if (0 == start % 2)
-            start += converted_step;
-        sieve_single(search_len, (start - 1) / 2, converted_step);
-
-        // Find next prime from small sieve
-        step = _small_sieve.sieve_search(_small_sieve._length, step + 1);
-        converted_step = (step * 2) + 1;
-    } while (step > 0);
+        group.clear();
+        group_product = 1;
+        while (step > 0 && group_product * (2 * (size_t) step + 1) <= 0xffffffff)
+        {
+            group.push_back((uint32_t) (2 * step + 1));
+            group_product *= group.back();
+            step = _small_sieve.sieve_search(_small_sieve._length, step + 1);
+        }
+        assert(!group.empty());
+
+        const uint32_t group_rem = mod_uint32(base, (uint32_t) group_product);
+        for (uint32_t converted_step : group)
+        {
+            // Take each multiple of step out of sieve
+            size_t start = converted_step - group_rem % converted_step;
+            if (0 == start % 2)
+                start += converted_step;
+            sieve_single(search_len, (start - 1) / 2, converted_step);
+        }
+    }
 }
 
 BitSieve::~BitSieve() noexcept
@@ -108,18 +147,18 @@ BitSieve::~BitSieve() noexcept
 /**
  * Get the value of the bit at the specified index.
  */
-bool BitSieve::get(int bit_index) noexcept
+bool BitSieve::get(size_t bit_index) const noexcept
 {
-    int ui = unit_index(bit_index);
+    const size_t ui = unit_index(bit_index);
     return ((_bits[ui] & bit(bit_index)) != 0);
 }
 
 /**
  * Set the bit at the specified index.
  */
-void BitSieve::set(int bit_index) noexcept
+void BitSieve::set(size_t bit_index) noexcept
 {
-    int ui = unit_index(bit_index);
+    const size_t ui = unit_index(bit_index);
     _bits[ui] |= bit(bit_index);
 }
 
@@ -128,16 +167,16 @@ void BitSieve::set(int bit_index) noexcept
  * array that occurs at or after start. It will not search past the
  * specified limit. It returns -1 if there is no such clear bit.
  */
-int BitSieve::sieve_search(int limit, int start) noexcept
+ssize_t BitSieve::sieve_search(size_t limit, size_t start) const noexcept
 {
     if (start >= limit)
         return -1;
 
-    int index = start;
+    size_t index = start;
     do
     {
         if (!get(index))
-            return index;
+            return (ssize_t) index;
         ++index;
     } while (index < limit - 1);
     return -1;
@@ -148,7 +187,7 @@ int BitSieve::sieve_search(int limit, int start) noexcept
  * multiples of the specified step starting at the specified start index,
  * up to the specified limit.
  */
-void BitSieve::sieve_single(int limit, int start, int step) noexcept
+void BitSieve::sieve_single(size_t limit, size_t start, size_t step) noexcept
 {
     while (start < limit)
     {
@@ -160,28 +199,49 @@ void BitSieve::sieve_single(int limit, int start, int step) noexcept
 /**
  * Test probable primes in the sieve and return successful candidates.
  */
-BigInteger BitSieve::retrieve(const BigInteger& init_value, int certainty) noexcept
+BigInteger BitSieve::retrieve(const BigInteger& init_value, unsigned certainty,
+                              ThreadPool *pool) noexcept
 {
-    // Examine the sieve one long at a time to find possible primes
-    BigInteger candidate = init_value;
-    ++candidate;
-    for (int i = 0; i < _bits_cap; ++i)
+    // 候选数, 即未被筛去的比特对应的奇数
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < _bits_cap; ++i)
+    {
+        for (uint64_t next_long = ~_bits[i]; 0 != next_long; next_long &= next_long - 1)
+        {
+            const size_t index = 64 * i + lowest_bit1(next_long);
+            if (index < _length)
+                offsets.push_back(2 * index + 1);
+        }
+    }
+
+    // 每批测试的候选数个数
+    size_t batch = 1;
+    if (nullptr != pool)
+    {
+        batch = pool->get_max_thread_number();
+        if (0 == batch)
+            batch = std::thread::hardware_concurrency();
+        batch = std::max<size_t>(1, batch + 1); // 当前线程也参与计算
+    }
+
+    std::vector<BigInteger> candidates(batch);
+    std::vector<char> passed(batch);
+    for (size_t first = 0; first < offsets.size(); first += batch)
     {
-        uint64_t next_long = ~_bits[i];
-        for (int j = 0; j < 64; ++j)
+        const size_t count = std::min(batch, offsets.size() - first);
+        for (size_t i = 0; i < count; ++i)
+            candidates[i] = init_value + offsets[first + i];
+        parallel_for(count, pool, [&] (size_t i) {
+            passed[i] = miller_rabin(candidates[i], certainty);
+        });
+        for (size_t i = 0; i < count; ++i)
         {
-            if ((next_long & 1) == 1)
-            {
-                if (miller_rabin(candidate, certainty))
-                    return candidate;
-            }
-            next_long >>= 1;
-            candidate += 2;
+            if (passed[i])
+                return candidates[i];
         }
     }
 
-    candidate.set_zero();
-    return candidate;
+    return BigInteger();
 }
 
 }
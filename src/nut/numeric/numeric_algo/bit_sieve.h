@@ -2,12 +2,15 @@
 #ifndef ___HEADFILE_B3D1D8B6_CD77_4FB3_A62E_A83D30BA0451_
 #define ___HEADFILE_B3D1D8B6_CD77_4FB3_A62E_A83D30BA0451_
 
+#include "../../nut_config.h"
 #include "../big_integer.h"
 
 
 namespace nut
 {
 
+class ThreadPool;
+
 /**
  * A simple bit sieve used for finding prime number candidates. Allows setting
  * and clearing of bits in a storage array. The size of the sieve is assumed to
@@ -36,14 +39,18 @@ public:
      * candidates. The new sieve begins at the specified base, which must
      * be even.
      */
-    BitSieve(const BigInteger& base, int search_len) noexcept;
+    BitSieve(const BigInteger& base, size_t search_len) noexcept;
 
     ~BitSieve() noexcept;
 
     /**
      * Test probable primes in the sieve and return successful candidates.
+     *
+     * @param pool 不为 nullptr 时, 每次取若干个候选数分摊到线程池中测试, 仍然返回
+     *        其中最小的素数
      */
-    BigInteger retrieve(const BigInteger& init_value, int certainty) noexcept;
+    BigInteger retrieve(const BigInteger& init_value, unsigned certainty,
+                        ThreadPool *pool = nullptr) noexcept;
 
 private:
     BitSieve(const BitSieve&) = delete;
@@ -65,38 +72,38 @@ private:
     /**
      * Get the value of the bit at the specified index.
      */
-    bool get(int bit_index) noexcept;
+    bool get(size_t bit_index) const noexcept;
 
     /**
      * Set the bit at the specified index.
      */
-    void set(int bit_index) noexcept;
+    void set(size_t bit_index) noexcept;
 
     /**
      * This method returns the index of the first clear bit in the search
      * array that occurs at or after start. It will not search past the
      * specified limit. It returns -1 if there is no such clear bit.
      */
-    int sieve_search(int limit, int start) noexcept;
+    ssize_t sieve_search(size_t limit, size_t start) const noexcept;
 
     /**
      * Sieve a single set of multiples out of the sieve. Begin to remove
      * multiples of the specified step starting at the specified start index,
      * up to the specified limit.
      */
-    void sieve_single(int limit, int start, int step) noexcept;
+    void sieve_single(size_t limit, size_t start, size_t step) noexcept;
 
 private:
     /**
      * Stores the bits in this BitSieve.
      */
-    int64_t *_bits = nullptr;
-    int _bits_cap = 0;
+    uint64_t *_bits = nullptr;
+    size_t _bits_cap = 0;
 
     /**
      * Length is how many bits this sieve holds.
      */
-    int _length = 0;
+    size_t _length = 0;
 
     /**
      * A small sieve used to filter out multiples of small primes in a search
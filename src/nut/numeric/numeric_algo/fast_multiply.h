@@ -0,0 +1,389 @@
+﻿
+#ifndef ___HEADFILE_4E7A2C91_0B5D_4F38_9C16_D83A5F02B7E4_
+#define ___HEADFILE_4E7A2C91_0B5D_4F38_9C16_D83A5F02B7E4_
+
+#include <assert.h>
+#include <stdlib.h> // for ::malloc(), ::free()
+#include <string.h> // for ::memset(), ::memcpy()
+#include <algorithm> // for std::min(), std::max(), std::swap()
+
+#include "../../platform/platform.h"
+#include "../word_array_integer/word_array_integer.h"
+#include "../word_array_integer/mul_op.h"
+#include "../word_array_integer/shift_op.h"
+#include "karatsuba.h"
+#include "ntt.h"
+
+
+/**
+ * 乘法算法的切换边界(以字为单位, 取较短的乘数), 由 TestFastMultiplyBenchmark::test_calibrate
+ * 测得:
+ *
+ *   乘法: 一般算法 --NUT_KARATSUBA_FALLBACK_THRESHOLD--> karatsuba
+ *         --NUT_NTT_MULTIPLY_THRESHOLD--> NTT
+ *   平方: 一般算法 --NUT_KARATSUBA_SQUARE_FALLBACK_THRESHOLD--> karatsuba
+ *         --NUT_NTT_SQUARE_THRESHOLD--> NTT
+ *
+ * NOTE
+ * - NTT 的变换长度按 2 的幂次增长, 乘积长度刚超过 2 的幂次时耗时几乎翻倍, 边界值
+ *   取在这种最坏情况下仍不慢于前一种算法的位置
+ * - 多模数 NTT 没有实际的规模限制; 在 NTT 胜出之前的区间内, toom-3 与 karatsuba
+ *   (包括平方)互有快慢, 没有稳定的优势, 故自动选择时不经过 toom-3, 需要时直接调用
+ *   unsigned_toom3_multiply() 或 unsigned_toom3_square()
+ */
+#define NUT_NTT_MULTIPLY_THRESHOLD 768
+#define NUT_NTT_SQUARE_THRESHOLD 1024
+
+namespace nut
+{
+
+template <typename T>
+void unsigned_fast_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) noexcept;
+
+template <typename T>
+void unsigned_fast_square(const T *a, size_t M, T *x, size_t P) noexcept;
+
+/**
+ * 有符号数精确除以 3
+ */
+template <typename T>
+void _signed_divide_by_3(T *x, size_t N) noexcept
+{
+    typedef typename StdInt<T>::double_unsigned_type dword_type;
+
+    const bool neg = is_negative(x, N);
+    if (neg)
+        signed_negate(x, N, x, N);
+
+    dword_type rem = 0;
+    for (size_t i = N; i > 0; --i)
+    {
+        const dword_type cur = (rem << (8 * sizeof(T))) | x[i - 1];
+        x[i - 1] = static_cast<T>(cur / 3);
+        rem = cur % 3;
+    }
+    assert(0 == rem);
+
+    if (neg)
+        signed_negate(x, N, x, N);
+}
+
+/**
+ * 有符号数相乘(或平方), 乘数取绝对值后递归调用
+ *
+ * @param a,b 长度为 W1, 补码形式
+ * @param abs_buf 长度为 2 * W1 的临时空间
+ * @param x 长度为 W2
+ */
+template <typename T>
+void _toom3_point_multiply(const T *a, const T *b, size_t W1, T *abs_buf, T *x, size_t W2) noexcept
+{
+    const bool a_neg = is_negative(a, W1), b_neg = (nullptr != b && is_negative(b, W1));
+    const T *aa = a, *bb = b;
+    if (a_neg)
+    {
+        signed_negate(a, W1, abs_buf, W1);
+        aa = abs_buf;
+    }
+    if (nullptr == b)
+    {
+        unsigned_fast_square(aa, W1, x, W2);
+        return;
+    }
+    if (b_neg)
+    {
+        signed_negate(b, W1, abs_buf + W1, W1);
+        bb = abs_buf + W1;
+    }
+    unsigned_fast_multiply(aa, W1, bb, W1, x, W2);
+    if (a_neg != b_neg)
+        signed_negate(x, W2, x, W2);
+}
+
+/**
+ * 在点 0, 1, -1, -2, ∞ 上求 a0 + a1*X + a2*X^2 的值
+ *
+ * @param p1,pm1,pm2 长度为 W1, 补码形式
+ * @param tmp 长度为 W1 的临时空间
+ */
+template <typename T>
+void _toom3_evaluate(const T *a, size_t M, size_t k, size_t W1, T *p0, T *p1, T *pm1, T *pm2,
+                     T *tmp) noexcept
+{
+    // 各部分先扩展成 W1 长度的正数
+    T *const a0 = pm2; // 复用 pm2 的存储空间
+    unsigned_expand(a, std::min(k, M), a0, W1);
+    T *const a1 = p1;
+    if (M > k)
+        unsigned_expand(a + k, std::min(k, M - k), a1, W1);
+    else
+        ::memset(a1, 0, sizeof(T) * W1);
+    T *const a2 = pm1;
+    if (M > 2 * k)
+        unsigned_expand(a + 2 * k, M - 2 * k, a2, W1);
+    else
+        ::memset(a2, 0, sizeof(T) * W1);
+
+    // p0 = a0 + a2
+    signed_add(a0, W1, a2, W1, p0, W1);
+
+    // p(-2) = (p0 - a1 + a2) * 2 - a0
+    //       = (p(-1) + a2) * 2 - a0
+    // NOTE 依次覆盖 a2(pm1)、a0(pm2)、a1(p1) 的存储空间
+    signed_sub(p0, W1, a1, W1, tmp, W1);     // tmp = p(-1)
+    signed_add(tmp, W1, a2, W1, pm1, W1);    // pm1 = p(-1) + a2
+    signed_shift_left(pm1, W1, pm1, W1, 1);
+    signed_sub(pm1, W1, a0, W1, pm2, W1);    // pm2 = p(-2)
+    ::memcpy(pm1, tmp, sizeof(T) * W1);      // pm1 = p(-1)
+
+    // p(1) = p0 + a1
+    signed_add(p0, W1, a1, W1, p1, W1);
+}
+
+/**
+ * toom-3 乘法(Bodrato 插值序列), 时间复杂度为 O(n**(log3 5)) = O(n**1.46)
+ *
+ * a = a2 * X^2 + a1 * X + a0 (其中 X = 2 ^ (k * word_bits) )
+ * b = b2 * X^2 + b1 * X + b0
+ * 在 0, 1, -1, -2, ∞ 五个点上求值后相乘, 再插值得到 a * b 的五个系数
+ *
+ * @param b 为 nullptr 时计算 a 的平方
+ */
+template <typename T>
+void _unsigned_toom3_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) noexcept
+{
+    assert(nullptr != a && M > 0 && nullptr != x && P > 0);
+    assert(nullptr == b || (N > 0 && N <= M));
+
+    const size_t k = (M + 2) / 3;
+    const size_t W1 = k + 2, W2 = 2 * W1;
+
+    // 临时空间:
+    //   a 的求值 p0/p1/pm1/pm2, b 的求值 q0/q1/qm1/qm2, 各 W1
+    //   取绝对值的缓冲区 2 * W1
+    //   五个乘积 r0/r1/rm1/rm2/rinf, 各 W2
+    T *const buf = (T*) ::malloc(sizeof(T) * (W1 * 10 + W2 * 5));
+    T *const p0 = buf, *const p1 = p0 + W1, *const pm1 = p1 + W1, *const pm2 = pm1 + W1;
+    T *const q0 = pm2 + W1, *const q1 = q0 + W1, *const qm1 = q1 + W1, *const qm2 = qm1 + W1;
+    T *const abs_buf = qm2 + W1;
+    T *const r0 = abs_buf + 2 * W1, *const r1 = r0 + W2, *const rm1 = r1 + W2,
+        *const rm2 = rm1 + W2, *const rinf = rm2 + W2;
+
+    // 求值(此时 r0 尚未使用, 借作临时空间)
+    _toom3_evaluate(a, M, k, W1, p0, p1, pm1, pm2, r0);
+    if (nullptr != b)
+        _toom3_evaluate(b, N, k, W1, q0, q1, qm1, qm2, r0);
+
+    // 逐点相乘
+    // r0 = a0 * b0, rinf = a2 * b2
+    if (nullptr == b)
+        unsigned_fast_square(a, std::min(k, M), r0, W2);
+    else
+        unsigned_fast_multiply(a, std::min(k, M), b, std::min(k, N), r0, W2);
+    if (nullptr == b && M > 2 * k)
+        unsigned_fast_square(a + 2 * k, M - 2 * k, rinf, W2);
+    else if (nullptr != b && N > 2 * k)
+        unsigned_fast_multiply(a + 2 * k, M - 2 * k, b + 2 * k, N - 2 * k, rinf, W2);
+    else
+        ::memset(rinf, 0, sizeof(T) * W2);
+    _toom3_point_multiply(p1, (nullptr == b ? nullptr : q1), W1, abs_buf, r1, W2);
+    _toom3_point_multiply(pm1, (nullptr == b ? nullptr : qm1), W1, abs_buf, rm1, W2);
+    _toom3_point_multiply(pm2, (nullptr == b ? nullptr : qm2), W1, abs_buf, rm2, W2);
+
+    // 插值
+    // r3 = (rm2 - r1) / 3
+    // r1 = (r1 - rm1) / 2
+    // r2 = rm1 - r0
+    // r3 = (r2 - r3) / 2 + 2 * rinf
+    // r2 = r2 + r1 - rinf
+    // r1 = r1 - r3
+    T *const r3 = rm2, *const r2 = rm1;
+    signed_sub(rm2, W2, r1, W2, r3, W2);
+    _signed_divide_by_3(r3, W2);
+    signed_sub(r1, W2, rm1, W2, r1, W2);
+    signed_shift_right(r1, W2, r1, W2, 1);
+    signed_sub(rm1, W2, r0, W2, r2, W2);
+    signed_sub(r2, W2, r3, W2, r3, W2);
+    signed_shift_right(r3, W2, r3, W2, 1);
+    signed_add(r3, W2, rinf, W2, r3, W2);
+    signed_add(r3, W2, rinf, W2, r3, W2);
+    signed_add(r2, W2, r1, W2, r2, W2);
+    signed_sub(r2, W2, rinf, W2, r2, W2);
+    signed_sub(r1, W2, r3, W2, r1, W2);
+
+    // 生成最终结果, 五个系数都是非负的
+    // NOTE 所有乘积都已算出, 此时才写入 x, 因此 a、b、x 可以有交叉区域
+    unsigned_expand(r0, std::min(W2, P), x, P);
+    const T *const coefs[4] = {r1, r2, r3, rinf};
+    for (size_t i = 0; i < 4; ++i)
+    {
+        const size_t off = k * (i + 1);
+        if (off >= P)
+            break;
+        unsigned_add(x + off, P - off, coefs[i], std::min(W2, P - off), x + off, P - off);
+    }
+
+    ::free(buf);
+}
+
+template <typename T>
+void unsigned_toom3_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) noexcept
+{
+    assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
+    if (M < N)
+    {
+        std::swap(a, b);
+        std::swap(M, N);
+    }
+    _unsigned_toom3_multiply(a, M, b, N, x, P);
+}
+
+template <typename T>
+void unsigned_toom3_square(const T *a, size_t M, T *x, size_t P) noexcept
+{
+    _unsigned_toom3_multiply<T>(a, M, nullptr, 0, x, P);
+}
+
+/**
+ * 不平衡乘法: 将较长的乘数按较短乘数的长度分块相乘后累加
+ *
+ * @pre M >= N
+ */
+template <typename T>
+void _unsigned_unbalanced_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) noexcept
+{
+    assert(M >= N);
+
+    // 避免区域交叉覆盖
+    T *retx = x;
+    if ((a - P < x && x < a + M) || (b - P < x && x < b + N))
+        retx = (T*) ::malloc(sizeof(T) * P);
+
+    const size_t chunk_cap = 2 * N;
+    T *const chunk = (T*) ::malloc(sizeof(T) * chunk_cap);
+    ::memset(retx, 0, sizeof(T) * P);
+    for (size_t off = 0; off < M && off < P; off += N)
+    {
+        const size_t len = std::min(N, M - off);
+        const size_t chunk_len = std::min(chunk_cap, P - off);
+        unsigned_fast_multiply(a + off, len, b, N, chunk, chunk_len);
+        unsigned_add(retx + off, P - off, chunk, chunk_len, retx + off, P - off);
+    }
+    ::free(chunk);
+
+    if (retx != x)
+    {
+        ::memcpy(x, retx, sizeof(T) * P);
+        ::free(retx);
+    }
+}
+
+/**
+ * 按规模选择乘法算法
+ * x<P> = a<M> * b<N>
+ */
+template <typename T>
+void unsigned_fast_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) noexcept
+{
+    assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
+
+    // 去除无效位长
+    M = std::min(unsigned_significant_size(a, M), P);
+    N = std::min(unsigned_significant_size(b, N), P);
+    if (a == b && M == N)
+    {
+        unsigned_fast_square(a, M, x, P);
+        return;
+    }
+    if (M < N)
+    {
+        std::swap(a, b);
+        std::swap(M, N);
+    }
+
+    if (N < NUT_KARATSUBA_FALLBACK_THRESHOLD)
+        unsigned_multiply(a, M, b, N, x, P);
+    else if (M >= 2 * N)
+        _unsigned_unbalanced_multiply(a, M, b, N, x, P);
+    else if (N >= NUT_NTT_MULTIPLY_THRESHOLD && can_use_ntt_multiply(8 * sizeof(T) * M))
+        unsigned_ntt_multiply(a, M, b, N, x, P);
+    else
+        unsigned_karatsuba_multiply(a, M, b, N, x, P);
+}
+
+/**
+ * 按规模选择平方算法
+ * x<P> = a<M> * a<M>
+ */
+template <typename T>
+void unsigned_fast_square(const T *a, size_t M, T *x, size_t P) noexcept
+{
+    assert(nullptr != a && M > 0 && nullptr != x && P > 0);
+
+    M = std::min(unsigned_significant_size(a, M), P);
+    if (M < NUT_KARATSUBA_SQUARE_FALLBACK_THRESHOLD)
+        _unsigned_square(a, M, x, P);
+    else if (M >= NUT_NTT_SQUARE_THRESHOLD && can_use_ntt_multiply(8 * sizeof(T) * M))
+        unsigned_ntt_multiply(a, M, a, M, x, P);
+    else
+        unsigned_karatsuba_square(a, M, x, P);
+}
+
+/**
+ * (有符号数)相乘, 按规模选择算法
+ * x<P> = a<M> * b<N>
+ */
+template <typename T>
+void signed_fast_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) noexcept
+{
+    assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
+
+    // 规模较小时直接使用补数形式的一般算法
+    if (M < NUT_KARATSUBA_FALLBACK_THRESHOLD ||
+        N < NUT_KARATSUBA_FALLBACK_THRESHOLD ||
+        P < NUT_KARATSUBA_FALLBACK_THRESHOLD)
+    {
+        signed_multiply(a, M, b, N, x, P);
+        return;
+    }
+
+    // 快速算法不能处理负数的补数形式, 先取绝对值
+    const bool square = (a == b && M == N);
+    const bool a_neg = is_negative(a, M), b_neg = (square ? a_neg : is_negative(b, N));
+    T *buf = nullptr;
+    const T *aa = a, *bb = b;
+    size_t MM = M, NN = N;
+    if (a_neg || b_neg)
+        buf = (T*) ::malloc(sizeof(T) * (M + N + 2));
+    if (a_neg)
+    {
+        ++MM;
+        signed_negate(a, M, buf, MM);
+        aa = buf;
+    }
+    if (square)
+    {
+        bb = aa;
+        NN = MM;
+    }
+    else if (b_neg)
+    {
+        ++NN;
+        signed_negate(b, N, buf + MM, NN);
+        bb = buf + MM;
+    }
+
+    if (square)
+        unsigned_fast_square(aa, MM, x, P);
+    else
+        unsigned_fast_multiply(aa, MM, bb, NN, x, P);
+    ::free(buf);
+
+    // 还原符号
+    if (a_neg != b_neg)
+        signed_negate(x, P, x, P);
+}
+
+}
+
+#endif
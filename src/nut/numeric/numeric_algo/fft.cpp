@@ -1,65 +1,177 @@
-﻿
-#include <math.h>
+﻿#include <math.h>
+#include <string.h> // for ::memcpy()
+#include <algorithm> // for std::reverse()
+#include <atomic>
+#include <mutex>
+
+#if defined(__AVX__)
+#   include <immintrin.h>
+#endif
 
 #include "fft.h"
 
 
+#define NUT_FFT_MAX_LOGLEN 32
+
 namespace nut
 {
 
 static const double PI = ::acos(-1.0); // 定义Pi的值
 
-static void bit_rev(fft_complex_type *a, unsigned loglen, size_t len) noexcept
+// 已经计算的方案, 一直缓存到进程退出
+static std::atomic<FFTPlan*> plans[NUT_FFT_MAX_LOGLEN + 1];
+static std::mutex plans_lock;
+
+const FFTPlan& FFTPlan::get(unsigned loglen) noexcept
 {
-    assert(nullptr != a);
-    for (size_t i = 0; i < len; ++i)
+    assert(loglen <= NUT_FFT_MAX_LOGLEN);
+    FFTPlan *plan = plans[loglen].load(std::memory_order_acquire);
+    if (nullptr != plan)
+        return *plan;
+
+    std::lock_guard<std::mutex> guard(plans_lock);
+    plan = plans[loglen].load(std::memory_order_relaxed);
+    if (nullptr == plan)
     {
-        size_t t = i, p = 0;
-        for (unsigned j = 0; j < loglen; ++j)
-        {
-            p <<= 1;
-            p |= (t & 1);
-            t >>= 1;
-        }
-        if (p < i)
-        {
-            const fft_complex_type temp = a[p];
-            a[p] = a[i];
-            a[i] = temp;
-        }
+        plan = new FFTPlan(loglen);
+        plans[loglen].store(plan, std::memory_order_release);
     }
+    return *plan;
 }
 
-NUT_API void FFT(fft_complex_type *a, unsigned loglen, size_t len, bool dft) noexcept
+FFTPlan::FFTPlan(unsigned loglen) noexcept
+    : _loglen(loglen), _len(1ULL << loglen)
+{
+    _roots = (fft_complex_type*) ::malloc(sizeof(fft_complex_type) * _len);
+    _rev = (uint32_t*) ::malloc(sizeof(uint32_t) * _len);
+    assert(nullptr != _roots && nullptr != _rev);
+
+    // 最后一层的单位根直接由三角函数计算, 避免累乘误差; 其他层是其子集
+    const size_t half = _len >> 1;
+    for (size_t j = 0; j < half; ++j)
+        new (_roots + half + j) fft_complex_type(::cos(2 * PI * j / _len), ::sin(2 * PI * j / _len));
+    for (size_t m = half >> 1; m > 0; m >>= 1)
+    {
+        for (size_t j = 0; j < m; ++j)
+            new (_roots + m + j) fft_complex_type(_roots[2 * m + 2 * j]);
+    }
+    new (_roots) fft_complex_type(0, 0); // 未使用
+
+    _rev[0] = 0;
+    for (size_t i = 1; i < _len; ++i)
+        _rev[i] = (uint32_t) ((_rev[i >> 1] >> 1) | ((i & 1) << (loglen - 1)));
+}
+
+FFTPlan::~FFTPlan() noexcept
+{
+    ::free(_roots);
+    ::free(_rev);
+}
+
+unsigned FFTPlan::get_loglen() const noexcept
+{
+    return _loglen;
+}
+
+size_t FFTPlan::size() const noexcept
+{
+    return _len;
+}
+
+void FFTPlan::transform(fft_complex_type *a, bool dft) const noexcept
 {
-    bit_rev(a, loglen, len);
+    assert(nullptr != a);
+
+    // 二进制倒序
+    for (size_t i = 1; i < _len; ++i)
+    {
+        const size_t p = _rev[i];
+        if (p < i)
+            std::swap(a[p], a[i]);
+    }
 
-    size_t m = 2;
-    for (unsigned s = 1; s <= loglen; ++s, m <<= 1)
+    // 蝴蝶运算
+    // NOTE 手工展开复数乘法, 避免 std::complex 对 inf/nan 的检查(__muldc3)
+    double *const d = reinterpret_cast<double*>(a);
+    const double *const rt = reinterpret_cast<const double*>(_roots);
+    for (size_t half = 1; half < _len; half <<= 1)
     {
-        const fft_complex_type wn(::cos(2 * PI * (dft ? 1 : -1) / m),
-                                  ::sin(2 * PI * (dft ? 1 : -1) / m));
-        for (size_t i = 0; i < len; i += m)
+        const size_t m = half << 1;
+        for (size_t i = 0; i < _len; i += m)
         {
-            fft_complex_type w(1.0, 0);
-            for (size_t j = 0; j < m / 2; ++j)
+            double *const x = d + 2 * i, *const y = d + 2 * (i + half);
+            const double *const w = rt + 2 * half;
+            size_t j = 0;
+#if defined(__AVX__)
+            // 每次处理两个复数
+            for (; j + 2 <= half; j += 2)
             {
-                const fft_complex_type u = a[i + j];
-                const fft_complex_type v = w * a[i + j + m / 2];
-                a[i + j] = u + v;
-                a[i + j + m / 2]= u - v;
-                w = w * wn;
+                const __m256d wv = _mm256_loadu_pd(w + 2 * j);
+                const __m256d yv = _mm256_loadu_pd(y + 2 * j);
+                const __m256d wr = _mm256_movedup_pd(wv), wi = _mm256_permute_pd(wv, 0xf);
+                const __m256d ys = _mm256_permute_pd(yv, 0x5);
+                const __m256d v = _mm256_addsub_pd(_mm256_mul_pd(wr, yv), _mm256_mul_pd(wi, ys));
+                const __m256d u = _mm256_loadu_pd(x + 2 * j);
+                _mm256_storeu_pd(x + 2 * j, _mm256_add_pd(u, v));
+                _mm256_storeu_pd(y + 2 * j, _mm256_sub_pd(u, v));
+            }
+#endif
+            for (; j < half; ++j)
+            {
+                const double wr = w[2 * j], wi = w[2 * j + 1];
+                const double yr = y[2 * j], yi = y[2 * j + 1];
+                const double vr = wr * yr - wi * yi, vi = wr * yi + wi * yr;
+                const double ur = x[2 * j], ui = x[2 * j + 1];
+                x[2 * j] = ur + vr;
+                x[2 * j + 1] = ui + vi;
+                y[2 * j] = ur - vr;
+                y[2 * j + 1] = ui - vi;
             }
         }
     }
+
     if (!dft)
     {
-        for (size_t i = 0; i < len; ++i)
-        {
-            a[i].real(a[i].real() / len);
-            a[i].imag(a[i].imag() / len);
-        }
+        // IDFT(a)[k] = DFT(a)[-k] / len
+        std::reverse(a + 1, a + _len);
+        const double scale = 1.0 / _len;
+        for (size_t i = 0; i < 2 * _len; ++i)
+            d[i] *= scale;
     }
 }
 
+NUT_API void FFT(fft_complex_type *a, unsigned loglen, size_t len, bool dft) noexcept
+{
+    assert(nullptr != a && len == (1ULL << loglen));
+    (void) len;
+    FFTPlan::get(loglen).transform(a, dft);
+}
+
+NUT_API void fft_real_convolution(fft_complex_type *a, unsigned loglen) noexcept
+{
+    assert(nullptr != a);
+    const FFTPlan& plan = FFTPlan::get(loglen);
+    const size_t len = plan.size();
+
+    plan.transform(a, true);
+
+    // 设 c = x + i*y, 则 X[k] = (C[k] + conj(C[-k])) / 2,
+    // Y[k] = (C[k] - conj(C[-k])) / 2i, 于是
+    // X[k] * Y[k] = (C[k]**2 - conj(C[-k])**2) / 4i
+    // NOTE k 与 len-k 成对计算, 以便原地写回
+    for (size_t k = 0; k <= len / 2; ++k)
+    {
+        const size_t nk = (len - k) & (len - 1);
+        const fft_complex_type ck = a[k], cnk = std::conj(a[nk]);
+        const fft_complex_type ck2 = std::conj(ck); // conj(C[-(len-k)])
+        const fft_complex_type cnk2 = a[nk];
+        const fft_complex_type quarter_i(0, -0.25); // 1 / 4i
+        a[k] = (ck * ck - cnk * cnk) * quarter_i;
+        if (nk != k)
+            a[nk] = (cnk2 * cnk2 - ck2 * ck2) * quarter_i;
+    }
+
+    plan.transform(a, false);
+}
+
 }
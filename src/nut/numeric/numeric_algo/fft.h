@@ -3,16 +3,10 @@
 #define ___HEADFILE_583C901E_7939_41C8_A24C_AF094D969CD9_
 
 #include <assert.h>
+#include <stdlib.h> // for ::malloc(), ::free()
 #include <complex>
 
-#include "../../platform/platform.h"
-
-#if NUT_PLATFORM_OS_WINDOWS
-#   include <malloc.h> // for ::alloca()
-#else
-#   include <alloca.h>
-#endif
-
+#include "../../nut_config.h"
 #include "../word_array_integer/word_array_integer.h"
 #include "../word_array_integer/bit_op.h"
 
@@ -31,6 +25,48 @@ static_assert(std::is_unsigned<fft_word_type>::value, "Unexpected integer type")
 static_assert(sizeof(fft_word_type) > 2 * NUT_FFT_BASE_BYTES,
               "Unexpected integer type");
 
+/**
+ * 预计算的 FFT 方案, 包括各层的单位根以及二进制倒序表
+ *
+ * 每个规模的方案只计算一次并一直缓存, 之后只读, 可以在多个线程中共享
+ */
+class NUT_API FFTPlan
+{
+public:
+    /**
+     * 取得规模为 2**loglen 的方案
+     */
+    static const FFTPlan& get(unsigned loglen) noexcept;
+
+    unsigned get_loglen() const noexcept;
+    size_t size() const noexcept;
+
+    /**
+     * 原地变换
+     *
+     * @param a 长度为 size()
+     * @param dft DFT / IDFT, 后者包含除以长度
+     */
+    void transform(fft_complex_type *a, bool dft = true) const noexcept;
+
+private:
+    explicit FFTPlan(unsigned loglen) noexcept;
+    ~FFTPlan() noexcept;
+
+    FFTPlan(const FFTPlan&) = delete;
+    FFTPlan& operator=(const FFTPlan&) = delete;
+
+private:
+    unsigned _loglen = 0;
+    size_t _len = 0;
+
+    // _roots[2**(s-1) + j] = exp(2πi * j / 2**s), 第 s 层蝴蝶运算使用
+    fft_complex_type *_roots = nullptr;
+
+    // 二进制倒序
+    uint32_t *_rev = nullptr;
+};
+
 /**
  * 快速傅立叶变换
  *
@@ -38,6 +74,15 @@ static_assert(sizeof(fft_word_type) > 2 * NUT_FFT_BASE_BYTES,
  */
 NUT_API void FFT(fft_complex_type *a, unsigned loglen, size_t len, bool dft = true) noexcept;
 
+/**
+ * 实数序列的卷积
+ *
+ * 两个实数序列打包为一个复数序列的实部和虚部, 只需一次正变换和一次逆变换
+ *
+ * @param a 长度为 2**loglen, 实部、虚部分别为两个输入; 输出卷积结果到实部
+ */
+NUT_API void fft_real_convolution(fft_complex_type *a, unsigned loglen) noexcept;
+
 /**
  * 利用快速傅立叶变换求大数的成绩，时间复杂度为 O(nlogn)
  */
@@ -55,12 +100,13 @@ void unsigned_fft_multiply(const T *a, size_t M, const T *b, size_t N, T *x, siz
     assert((1ULL << loglen) >= wc_len);
     wc_len = (1ULL << loglen);
 
-    // 准备复数向量
+    // 准备复数向量, 实部、虚部分别为两个乘数
+    // NOTE 规模较大时栈空间不足, 从堆上分配
     const size_t ans_len = std::min(wc_len, (sizeof(T) * P + NUT_FFT_BASE_BYTES - 1) / NUT_FFT_BASE_BYTES);
-    fft_complex_type *aa = (fft_complex_type*) ::alloca(sizeof(fft_complex_type) * wc_len * 2 +
+    fft_complex_type *aa = (fft_complex_type*) ::malloc(sizeof(fft_complex_type) * wc_len +
                                                         sizeof(fft_word_type) * ans_len);
-    fft_complex_type *bb = aa + wc_len;
-    fft_word_type *ans = (fft_word_type *) (bb + wc_len);
+    assert(nullptr != aa);
+    fft_word_type *ans = (fft_word_type *) (aa + wc_len);
     for (size_t i = 0; i < wc_len; ++i)
     {
         fft_word_type va = 0, vb = 0;
@@ -72,21 +118,16 @@ void unsigned_fft_multiply(const T *a, size_t M, const T *b, size_t N, T *x, siz
             if (in_byte_index < sizeof(T) * N)
                 set_byte_le(&vb, j, get_byte_le(b, in_byte_index));
         }
-        new (aa + i) fft_complex_type(va, 0);
-        new (bb + i) fft_complex_type(vb, 0);
+        new (aa + i) fft_complex_type((double) va, (double) vb);
     }
 
     // FFT 变换、逆变换
-    FFT(aa, loglen, wc_len, true);
-    FFT(bb, loglen, wc_len, true);
-    for (size_t i = 0; i < wc_len; ++i)
-        aa[i] = aa[i] * bb[i];
-    FFT(aa, loglen, wc_len, false);
+    fft_real_convolution(aa, loglen);
 
     // 将结果转换为整数，并计算进位
     for (size_t i = 0; i < ans_len; ++i)
-        ans[i] = aa[i].real() + 0.5;
-    for (size_t i = 0; i < ans_len - 1; ++i)
+        ans[i] = (fft_word_type) (aa[i].real() + 0.5);
+    for (size_t i = 0; i + 1 < ans_len; ++i)
     {
         ans[i + 1] += ans[i] >> (8 * NUT_FFT_BASE_BYTES);
         ans[i] &= ~((~(fft_word_type)0) << (8 * NUT_FFT_BASE_BYTES));
@@ -105,6 +146,7 @@ void unsigned_fft_multiply(const T *a, size_t M, const T *b, size_t N, T *x, siz
     }
     for (size_t i = ans_len * NUT_FFT_BASE_BYTES; i < sizeof(T) * P; ++i)
         set_byte_le(x, i, 0);
+    ::free(aa);
 }
 
 template <typename T>
@@ -116,26 +158,22 @@ void signed_fft_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_
     const bool a_neg = is_negative(a, M), b_neg = is_negative(b, N);
     T *aa = nullptr, *bb = nullptr;
     size_t MM = M, NN = N;
-    if (a_neg && b_neg)
-    {
-        ++MM;
-        ++NN;
-        aa = (T*) ::alloca(sizeof(T) * (MM + NN));
-        bb = aa + MM;
-        signed_negate(a, M, aa, MM);
-        signed_negate(b, N, bb, NN);
-    }
-    else if (a_neg)
-    {
-        ++MM;
-        aa = (T*) ::alloca(sizeof(T) * MM);
-        signed_negate(a, M, aa, MM);
-    }
-    else if (b_neg)
+    if (a_neg || b_neg)
     {
-        ++NN;
-        bb = (T*) ::alloca(sizeof(T) * NN);
-        signed_negate(b, N, bb, NN);
+        MM += (a_neg ? 1 : 0);
+        NN += (b_neg ? 1 : 0);
+        T *const buf = (T*) ::malloc(sizeof(T) * (MM + NN));
+        assert(nullptr != buf);
+        if (a_neg)
+        {
+            aa = buf;
+            signed_negate(a, M, aa, MM);
+        }
+        if (b_neg)
+        {
+            bb = buf + MM;
+            signed_negate(b, N, bb, NN);
+        }
     }
 
     // 调用 FFT 算法
@@ -145,6 +183,10 @@ void signed_fft_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_
     // 还原符号
     if (a_neg != b_neg)
         signed_negate(x, P, x, P);
+    if (nullptr != aa)
+        ::free(aa);
+    else if (nullptr != bb)
+        ::free(bb - MM);
 }
 
 }
@@ -1,12 +1,554 @@
 ﻿
+#include <assert.h>
+#include <stdlib.h> // for ::malloc(), ::free()
+#include <string.h> // for ::memcpy()
+#include <algorithm> // for std::min(), std::max(), std::swap()
 #include <stack>
 
+#include "../word_array_integer/word_array_integer.h"
+#include "../word_array_integer/mul_op.h"
+#include "../word_array_integer/div_op.h"
+#include "../word_array_integer/bit_op.h"
+#include "../word_array_integer/word_op.h"
 #include "gcd.h"
 
 
+#define WORD_BITS (8 * sizeof(BigInteger::word_type))
+
 namespace nut
 {
 
+typedef BigInteger::word_type word_type;
+
+/**
+ * Lehmer 算法中用于推算商序列的最高比特数
+ *
+ * NOTE 推算过程中的余数及系数都小于 2**LEHMER_BITS, 系数可以用一个字表示; 两者之和
+ *      不超过 2**(LEHMER_BITS+1), 用 int64_t 计算不会溢出
+ */
+#define LEHMER_BITS (WORD_BITS - 3)
+
+/**
+ * 取 a<N> 的第 [shift, shift + 64) 位
+ */
+static uint64_t bits_at(const word_type *a, size_t N, size_t shift) noexcept
+{
+    const size_t w = shift / WORD_BITS, s = shift % WORD_BITS;
+    uint64_t ret = 0;
+    for (size_t i = w; i < N && (i - w) * WORD_BITS < 64 + s; ++i)
+    {
+        const size_t pos = (i - w) * WORD_BITS;
+        if (pos < s)
+            ret |= ((uint64_t) a[i]) >> (s - pos);
+        else
+            ret |= ((uint64_t) a[i]) << (pos - s);
+    }
+    return ret;
+}
+
+/**
+ * x<P> = c0 * a0<M> + c1 * a1<N>, subtract 为 true 时 x<P> = c0 * a0<M> - c1 * a1<N>
+ * (要求结果非负)
+ *
+ * 一趟完成乘法与加减, 不需要临时空间
+ *
+ * @return x 的有效字数
+ */
+static size_t linear_combine(word_type c0, const word_type *a0, size_t M,
+                             word_type c1, const word_type *a1, size_t N,
+                             bool subtract, word_type *x, size_t P) noexcept
+{
+    word_type hi0 = 0, hi1 = 0;
+    uint8_t carry = (subtract ? 1 : 0);
+    for (size_t i = 0; i < P; ++i)
+    {
+        const word_type p0 = multiply_add<word_type>(c0, (i < M ? a0[i] : 0), hi0, 0, &hi0),
+            p1 = multiply_add<word_type>(c1, (i < N ? a1[i] : 0), hi1, 0, &hi1);
+        x[i] = add_with_carry<word_type>(p0, (subtract ? static_cast<word_type>(~p1) : p1), &carry);
+    }
+    return unsigned_significant_size(x, P);
+}
+
+/**
+ * 在字数组上原地进行的 Lehmer 算法
+ *
+ * 维护余数 r0 > r1 >= 0 (Euclid 余数序列中相邻的两项), 以及它们关于原始输入 (a, b)
+ * 的系数:
+ *     r0 = (+/-)(u0 * a - v0 * b)
+ *     r1 = (-/+)(u1 * a - v1 * b)
+ * 系数的符号交替出现, 只需保存系数的绝对值及 r0 中 a 的系数的符号
+ *
+ * 参考文献：
+ *     [1] Knuth D E. The Art of Computer Programming, Volume 2, 3rd ed. 4.5.2, Algorithm L
+ */
+class LehmerGcd
+{
+public:
+    /**
+     * @param a 非负数
+     * @param b 非负数
+     * @param track_u 是否计算 a 的系数
+     * @param track_v 是否计算 b 的系数
+     */
+    LehmerGcd(const BigInteger& a, const BigInteger& b, bool track_u, bool track_v) noexcept
+        : _track_u(track_u), _track_v(track_v)
+    {
+        assert(a.is_positive() && b.is_positive());
+
+        const size_t na = a.significant_words_length(), nb = b.significant_words_length();
+        _cap = std::max(na, nb) + 2;
+
+        // 每组数都有一份备用空间, 计算完成后交换指针
+        const size_t arrays = (track_u || track_v ? 14 : 6);
+        _buf = (word_type*) ::malloc(sizeof(word_type) * _cap * arrays);
+        word_type **const all[] = {&_tmp, &_quotient, &_r[0], &_r[1], &_spare_r[0], &_spare_r[1],
+                                   &_u[0], &_u[1], &_spare_u[0], &_spare_u[1],
+                                   &_v[0], &_v[1], &_spare_v[0], &_spare_v[1]};
+        for (size_t i = 0; i < 14; ++i)
+            *all[i] = (i < arrays ? _buf + _cap * i : nullptr);
+
+        // 保证 r0 >= r1
+        const bool swap = (a < b);
+        const BigInteger& r0 = (swap ? b : a), & r1 = (swap ? a : b);
+        // NOTE 有符号数的有效字数可能包含最高位的 0 字, 去掉后才是无符号数的有效字数
+        _len_r[0] = unsigned_significant_size(r0.data(), r0.significant_words_length());
+        _len_r[1] = unsigned_significant_size(r1.data(), r1.significant_words_length());
+        ::memcpy(_r[0], r0.data(), sizeof(word_type) * _len_r[0]);
+        ::memcpy(_r[1], r1.data(), sizeof(word_type) * _len_r[1]);
+
+        _len_u[0] = _len_u[1] = _len_v[0] = _len_v[1] = 1;
+        if (track_u || track_v)
+        {
+            _u[0][0] = _v[1][0] = (swap ? 0 : 1);
+            _u[1][0] = _v[0][0] = (swap ? 1 : 0);
+        }
+        _u0_negative = swap;
+    }
+
+    ~LehmerGcd() noexcept
+    {
+        ::free(_buf);
+    }
+
+    /**
+     * 约简到 r1 的比特长度不超过 stop_bits 为止; stop_bits 为 0 时求得最大公约数 r0
+     */
+    void reduce(size_t stop_bits) noexcept
+    {
+        while (true)
+        {
+            const size_t bits1 = bit1_length(_r[1], _len_r[1]);
+            if (bits1 <= stop_bits)
+                return;
+
+            // 取对齐的最高位推算商序列
+            const size_t bits0 = bit1_length(_r[0], _len_r[0]),
+                shift = (bits0 > LEHMER_BITS ? bits0 - LEHMER_BITS : 0);
+            int64_t x = (int64_t) bits_at(_r[0], _len_r[0], shift),
+                y = (int64_t) bits_at(_r[1], _len_r[1], shift);
+            int64_t A = 1, B = 0, C = 0, D = 1;
+            unsigned steps = 0;
+            while (y + C > 0 && y + D > 0)
+            {
+                const int64_t q = (x + A) / (y + C);
+                if (q != (x + B) / (y + D))
+                    break;
+
+                int64_t t = A - q * C;
+                A = C;
+                C = t;
+                t = B - q * D;
+                B = D;
+                D = t;
+                t = x - q * y;
+                x = y;
+                y = t;
+                ++steps;
+            }
+
+            if (0 == steps)
+                divide_step();
+            else
+                matrix_step(A, B, C, D, steps);
+        }
+    }
+
+    BigInteger get_r0() const noexcept
+    {
+        return BigInteger(_r[0], sizeof(word_type) * _len_r[0], false);
+    }
+
+    BigInteger get_r1() const noexcept
+    {
+        return BigInteger(_r[1], sizeof(word_type) * _len_r[1], false);
+    }
+
+    /**
+     * r0 中 a 的系数
+     */
+    BigInteger get_u0() const noexcept
+    {
+        assert(_track_u);
+        BigInteger ret(_u[0], sizeof(word_type) * _len_u[0], false);
+        return _u0_negative ? -ret : ret;
+    }
+
+    /**
+     * 求得矩阵 m, 使 (r0, r1) = m (a, b)
+     */
+    void get_matrix(BigInteger *m00, BigInteger *m01, BigInteger *m10, BigInteger *m11) const noexcept
+    {
+        assert(_track_u && _track_v);
+        m00->set(_u[0], sizeof(word_type) * _len_u[0], false);
+        m01->set(_v[0], sizeof(word_type) * _len_v[0], false);
+        m10->set(_u[1], sizeof(word_type) * _len_u[1], false);
+        m11->set(_v[1], sizeof(word_type) * _len_v[1], false);
+        if (_u0_negative)
+        {
+            *m00 = -*m00;
+            *m11 = -*m11;
+        }
+        else
+        {
+            *m01 = -*m01;
+            *m10 = -*m10;
+        }
+    }
+
+private:
+    /**
+     * 按最高位推算出的 steps 步商序列, 一次更新余数及系数:
+     *     (r0, r1) = (A r0 + B r1, C r0 + D r1)
+     * 其中 A、B 异号, C、D 异号, 且 A 的符号为 (-1)**steps
+     */
+    void matrix_step(int64_t A, int64_t B, int64_t C, int64_t D, unsigned steps) noexcept
+    {
+        const word_type abs_a = (word_type) (A < 0 ? -A : A), abs_b = (word_type) (B < 0 ? -B : B),
+            abs_c = (word_type) (C < 0 ? -C : C), abs_d = (word_type) (D < 0 ? -D : D);
+        const bool even = (0 == (steps & 1));
+        const size_t P = std::min(_cap, _len_r[0] + 1);
+
+        if (even)
+        {
+            _len_spare_r[0] = linear_combine(abs_a, _r[0], _len_r[0], abs_b, _r[1], _len_r[1],
+                                             true, _spare_r[0], P);
+            _len_spare_r[1] = linear_combine(abs_d, _r[1], _len_r[1], abs_c, _r[0], _len_r[0],
+                                             true, _spare_r[1], P);
+        }
+        else
+        {
+            _len_spare_r[0] = linear_combine(abs_b, _r[1], _len_r[1], abs_a, _r[0], _len_r[0],
+                                             true, _spare_r[0], P);
+            _len_spare_r[1] = linear_combine(abs_c, _r[0], _len_r[0], abs_d, _r[1], _len_r[1],
+                                             true, _spare_r[1], P);
+        }
+        swap_spare(_r, _spare_r, _len_r, _len_spare_r);
+
+        // 系数的绝对值只增不减
+        if (_track_u)
+        {
+            const size_t Q = std::min(_cap, std::max(_len_u[0], _len_u[1]) + 1);
+            _len_spare_u[0] = linear_combine(abs_a, _u[0], _len_u[0], abs_b, _u[1], _len_u[1],
+                                             false, _spare_u[0], Q);
+            _len_spare_u[1] = linear_combine(abs_c, _u[0], _len_u[0], abs_d, _u[1], _len_u[1],
+                                             false, _spare_u[1], Q);
+            swap_spare(_u, _spare_u, _len_u, _len_spare_u);
+        }
+        if (_track_v)
+        {
+            const size_t Q = std::min(_cap, std::max(_len_v[0], _len_v[1]) + 1);
+            _len_spare_v[0] = linear_combine(abs_a, _v[0], _len_v[0], abs_b, _v[1], _len_v[1],
+                                             false, _spare_v[0], Q);
+            _len_spare_v[1] = linear_combine(abs_c, _v[0], _len_v[0], abs_d, _v[1], _len_v[1],
+                                             false, _spare_v[1], Q);
+            swap_spare(_v, _spare_v, _len_v, _len_spare_v);
+        }
+        if (!even)
+            _u0_negative = !_u0_negative;
+    }
+
+    /**
+     * 商无法由最高位推算时(通常是商很大), 做一步完整的除法:
+     *     (r0, r1) = (r1, r0 - q r1)
+     */
+    void divide_step() noexcept
+    {
+        size_t len_q;
+        if (1 == _len_r[1])
+        {
+            _spare_r[0][0] = unsigned_divide_word(_r[0], _len_r[0], _r[1][0], _quotient);
+            _len_spare_r[0] = 1;
+            len_q = _len_r[0];
+        }
+        else
+        {
+            len_q = _len_r[0] - _len_r[1] + 1;
+            unsigned_divide(_r[0], _len_r[0], _r[1], _len_r[1], _quotient, len_q,
+                            _spare_r[0], _len_r[1]);
+            _len_spare_r[0] = unsigned_significant_size(_spare_r[0], _len_r[1]);
+        }
+        len_q = unsigned_significant_size(_quotient, len_q);
+
+        // r0 <- r1, r1 <- 余数
+        std::swap(_r[0], _spare_r[0]);
+        std::swap(_len_r[0], _len_spare_r[0]);
+        std::swap(_r[0], _r[1]);
+        std::swap(_len_r[0], _len_r[1]);
+
+        if (_track_u)
+            divide_step_cofactors(_u, _spare_u, _len_u, len_q);
+        if (_track_v)
+            divide_step_cofactors(_v, _spare_v, _len_v, len_q);
+        _u0_negative = !_u0_negative;
+    }
+
+    /**
+     * (c0, c1) = (c1, c0 + q c1)
+     */
+    void divide_step_cofactors(word_type **c, word_type **spare, size_t *len, size_t len_q) noexcept
+    {
+        const size_t P = std::min(_cap, std::max(len_q + len[1], len[0] + 1));
+        unsigned_multiply(_quotient, len_q, c[1], len[1], _tmp, P);
+        unsigned_add(_tmp, P, c[0], len[0], spare[0], P);
+        const size_t len_sum = unsigned_significant_size(spare[0], P);
+        std::swap(c[0], spare[0]);
+        len[0] = len_sum;
+        std::swap(c[0], c[1]);
+        std::swap(len[0], len[1]);
+    }
+
+    static void swap_spare(word_type **x, word_type **spare, size_t *len, size_t *len_spare) noexcept
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            std::swap(x[i], spare[i]);
+            std::swap(len[i], len_spare[i]);
+        }
+    }
+
+private:
+    const bool _track_u, _track_v;
+    size_t _cap = 0;
+    word_type *_buf = nullptr, *_tmp = nullptr, *_quotient = nullptr;
+    word_type *_r[2], *_spare_r[2], *_u[2], *_spare_u[2], *_v[2], *_spare_v[2];
+    size_t _len_r[2], _len_spare_r[2], _len_u[2], _len_spare_u[2], _len_v[2], _len_spare_v[2];
+    bool _u0_negative = false;
+};
+
+/**
+ * 2x2 变换矩阵, 行列式为 +1 或 -1
+ */
+class GcdMatrix
+{
+public:
+    GcdMatrix() noexcept
+        : m00(1), m11(1)
+    {}
+
+    bool is_identity() const noexcept
+    {
+        return m00 == 1 && m01.is_zero() && m10.is_zero() && m11 == 1;
+    }
+
+    /**
+     * this = m * this
+     */
+    void left_multiply(const GcdMatrix& m) noexcept
+    {
+        BigInteger x00 = m.m00 * m00 + m.m01 * m10, x01 = m.m00 * m01 + m.m01 * m11,
+            x10 = m.m10 * m00 + m.m11 * m10, x11 = m.m10 * m01 + m.m11 * m11;
+        m00 = std::move(x00);
+        m01 = std::move(x01);
+        m10 = std::move(x10);
+        m11 = std::move(x11);
+    }
+
+    /**
+     * 交换两行
+     */
+    void swap_rows() noexcept
+    {
+        BigInteger::swap(&m00, &m10);
+        BigInteger::swap(&m01, &m11);
+    }
+
+    /**
+     * (row0, row1) = (row1, row0 - q row1)
+     */
+    void divide_step(const BigInteger& q) noexcept
+    {
+        m00 -= q * m10;
+        m01 -= q * m11;
+        swap_rows();
+    }
+
+public:
+    BigInteger m00, m01, m10, m11;
+};
+
+/**
+ * 整数 a, b 的 Euclid 余数序列的 (a, b) -> (r0, r1) 由一个行列式为 +/-1 的整数矩阵给出,
+ * 变换前后的最大公约数相同
+ */
+static bool half_gcd(BigInteger *a, BigInteger *b, GcdMatrix *m) noexcept;
+
+/**
+ * 由 a、b 去掉低 k 位后的 half-GCD 矩阵约简 a、b
+ *
+ * 高位部分的商序列只有前一半是可靠的, 所得矩阵作用于完整的 a、b 后可能偏离 Euclid
+ * 余数序列, 甚至出现负数; 取绝对值(同时对矩阵的该行取反)后行列式仍为 +/-1, 不影响
+ * 最大公约数及扩展欧几里得算法的系数
+ */
+static bool reduce_by_high_part(BigInteger *a, BigInteger *b, size_t k, GcdMatrix *m) noexcept
+{
+    BigInteger a0 = *a >> k, b0 = *b >> k;
+    GcdMatrix m1;
+    if (!half_gcd(&a0, &b0, &m1))
+        return false;
+
+    BigInteger c = m1.m00 * *a + m1.m01 * *b, d = m1.m10 * *a + m1.m11 * *b;
+    if (c.is_negative())
+    {
+        c = -c;
+        m1.m00 = -m1.m00;
+        m1.m01 = -m1.m01;
+    }
+    if (d.is_negative())
+    {
+        d = -d;
+        m1.m10 = -m1.m10;
+        m1.m11 = -m1.m11;
+    }
+    *a = std::move(c);
+    *b = std::move(d);
+    m->left_multiply(m1);
+    return true;
+}
+
+/**
+ * half-GCD: 求得矩阵 m, 使 (a, b) 约简为 m (a, b), 其中较大者的比特长度约为原来的一半
+ *
+ * 参考文献：
+ *     [1] Möller N. On Schönhage's algorithm and subquadratic integer gcd computation[J].
+ *         Mathematics of Computation, 2008, 77(261): 589-607
+ *
+ * @return 是否有约简
+ */
+static bool half_gcd(BigInteger *a, BigInteger *b, GcdMatrix *m) noexcept
+{
+    assert(a->is_positive() && b->is_positive() && m->is_identity());
+
+    const size_t n = std::max(a->bit_length(), b->bit_length()), h = n / 2;
+    if (std::min(a->bit_length(), b->bit_length()) <= h + 1)
+        return false;
+
+    // 规模较小时用 Lehmer 算法
+    if (n < NUT_HALF_GCD_EXTENDED_THRESHOLD * WORD_BITS)
+    {
+        LehmerGcd lehmer(*a, *b, true, true);
+        lehmer.reduce(h);
+        *a = lehmer.get_r0();
+        *b = lehmer.get_r1();
+        lehmer.get_matrix(&m->m00, &m->m01, &m->m10, &m->m11);
+        return true;
+    }
+
+    // 由高一半约简, 约为 3n/4 位
+    bool reduced = reduce_by_high_part(a, b, h, m);
+    if (std::min(a->bit_length(), b->bit_length()) <= h + 1)
+        return reduced;
+
+    // 做一步除法, 保证有进展
+    if (*a < *b)
+    {
+        BigInteger::swap(a, b);
+        m->swap_rows();
+    }
+    BigInteger q, r;
+    BigInteger::divide(*a, *b, &q, &r);
+    *a = std::move(r);
+    BigInteger::swap(a, b);
+    m->divide_step(q);
+    if (std::min(a->bit_length(), b->bit_length()) <= h + 1)
+        return true;
+
+    // 再由高位约简到约 n/2 位: 去掉低 k 位后余下 n2 - k 位, 约简后约为 k + (n2 - k) / 2 = h 位
+    const size_t n2 = std::max(a->bit_length(), b->bit_length());
+    size_t k = (2 * h > n2 ? 2 * h - n2 : 0);
+    if (n2 - k >= n)
+        k = n2 - n / 2; // 保证递归规模减小
+    reduce_by_high_part(a, b, k, m);
+    return true;
+}
+
+/**
+ * 非负数的最大公约数, 以及扩展欧几里得算法的系数 d = ax + by
+ */
+static void unsigned_gcd(const BigInteger& a, const BigInteger& b, BigInteger *d,
+                         BigInteger *x, BigInteger *y, bool use_half_gcd) noexcept
+{
+    assert(a.is_positive() && b.is_positive());
+
+    // 超大规模时, 交替使用 half-GCD 和一步除法约简, (aa, bb) = m (a, b)
+    const bool track = (nullptr != x || nullptr != y);
+    const size_t threshold = (track ? NUT_HALF_GCD_EXTENDED_THRESHOLD : NUT_HALF_GCD_THRESHOLD);
+    BigInteger aa(a), bb(b);
+    GcdMatrix m;
+    while (use_half_gcd && !aa.is_zero() && !bb.is_zero() &&
+           std::max(aa.significant_words_length(), bb.significant_words_length()) >= threshold)
+    {
+        GcdMatrix m1;
+        if (half_gcd(&aa, &bb, &m1) && track)
+            m.left_multiply(m1);
+
+        if (aa < bb)
+        {
+            BigInteger::swap(&aa, &bb);
+            m.swap_rows();
+        }
+        if (bb.is_zero())
+            break;
+        BigInteger q, r;
+        BigInteger::divide(aa, bb, &q, &r);
+        aa = std::move(r);
+        BigInteger::swap(&aa, &bb);
+        if (track)
+            m.divide_step(q);
+    }
+
+    LehmerGcd lehmer(aa, bb, track, false);
+    lehmer.reduce(0);
+    BigInteger g = lehmer.get_r0();
+    if (track)
+    {
+        // g = xx * aa + yy * bb
+        const BigInteger xx = lehmer.get_u0();
+        if (m.is_identity())
+        {
+            if (nullptr != y)
+                *y = (bb.is_zero() ? BigInteger() : (g - xx * aa) / bb);
+            if (nullptr != x)
+                *x = xx;
+        }
+        else
+        {
+            const BigInteger yy = (bb.is_zero() ? BigInteger() : (g - xx * aa) / bb);
+            if (nullptr != x)
+                *x = xx * m.m00 + yy * m.m10;
+            if (nullptr != y)
+                *y = xx * m.m01 + yy * m.m11;
+        }
+    }
+    if (nullptr != d)
+        *d = std::move(g);
+}
+
+NUT_API void lehmer_gcd(const BigInteger& a, const BigInteger& b, BigInteger *d,
+                        BigInteger *x, BigInteger *y) noexcept
+{
+    unsigned_gcd(a, b, d, x, y, false);
+}
+
 NUT_API BigInteger gcd(const BigInteger& a, const BigInteger& b) noexcept
 {
     /// 下面几个算法，随着规模增大，优化后的优势越明显。
@@ -118,7 +660,7 @@ NUT_API BigInteger gcd(const BigInteger& a, const BigInteger& b) noexcept
             bb = (bb - aa) >> 1;
         }
     }
-#else
+#elif 0 // unoptimized
     /**
      * 综合两种算法，小规模时用一种，较大规模时用另一种
      */
@@ -178,6 +720,26 @@ NUT_API BigInteger gcd(const BigInteger& a, const BigInteger& b) noexcept
             bb >>= 1;
         }
     }
+#else
+    /**
+     * 小规模时直接运算; 较大规模时使用 Lehmer 算法, 超大规模时使用 half-GCD
+     */
+    const size_t EMPIRICAL_BOUND = 10; /// 经验数据，根据性能测试结果得来
+    if (sizeof(BigInteger::word_type) * a.significant_words_length() < EMPIRICAL_BOUND ||
+        sizeof(BigInteger::word_type) * b.significant_words_length() < EMPIRICAL_BOUND)
+    {
+        BigInteger aa(a), bb(b);
+        while (!bb.is_zero())
+        {
+            aa %= bb;
+            BigInteger::swap(&aa, &bb); // 交换 a, b
+        }
+        return aa;
+    }
+
+    BigInteger d;
+    unsigned_gcd(a.is_negative() ? -a : a, b.is_negative() ? -b : b, &d, nullptr, nullptr, true);
+    return d;
 #endif
 }
 
@@ -480,7 +1042,7 @@ NUT_API void extended_euclid(const BigInteger& a, const BigInteger& b,
         }
         return;
     }
-#else
+#elif 0 // unoptimized
     /**
      * 综合优化，并去除递归调用(处理超大规模数时导致栈溢出)
      */
@@ -688,6 +1250,43 @@ NUT_API void extended_euclid(const BigInteger& a, const BigInteger& b,
     if (nullptr != y)
         *y = std::move(yy);
     return;
+#else
+    /**
+     * 小规模或者有负数时直接运算; 否则使用 Lehmer 算法, 超大规模时使用 half-GCD
+     */
+    const size_t EMPIRICAL_BOUND = 10; /// 经验数据，根据性能测试结果得来
+    if (a.is_negative() || b.is_negative() ||
+        sizeof(BigInteger::word_type) * a.significant_words_length() < EMPIRICAL_BOUND ||
+        sizeof(BigInteger::word_type) * b.significant_words_length() < EMPIRICAL_BOUND)
+    {
+        BigInteger aa(a), bb(b);
+        std::stack<BigInteger> as;
+        while (!bb.is_zero())
+        {
+            as.push(aa);
+            aa %= bb;
+            BigInteger::swap(&aa, &bb);
+        }
+        if (nullptr != d)
+            *d = aa;
+
+        BigInteger xx(1), yy; // yy = 0
+        while (!as.empty())
+        {
+            BigInteger::swap(&xx, &yy);
+            BigInteger::swap(&aa, &bb);
+            aa = as.top();
+            as.pop();
+            yy -= aa / bb * xx;
+        }
+        if (nullptr != x)
+            *x = std::move(xx);
+        if (nullptr != y)
+            *y = std::move(yy);
+        return;
+    }
+
+    unsigned_gcd(a, b, d, x, y, true);
 #endif
 }
 
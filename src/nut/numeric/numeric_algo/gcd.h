@@ -7,6 +7,19 @@
 #include "../big_integer.h"
 
 
+/**
+ * 操作数规模(以字为单位, 取较大的操作数)不小于该值时, 先用 half-GCD 递归地约简操作数,
+ * 直到低于该值后再使用 Lehmer 算法
+ *
+ * 只求最大公约数时, Lehmer 算法原地计算、不需要维护矩阵, half-GCD 要到更大的规模才
+ * 占优; 求扩展欧几里得算法的系数时, Lehmer 算法也要逐步更新系数, half-GCD 的边界低得多.
+ * half-GCD 递归到底时同样要求出约简矩阵, 故递归的边界也使用后者
+ *
+ * NOTE 这两个边界值由 TestGcdBenchmark::test_calibrate 测得
+ */
+#define NUT_HALF_GCD_THRESHOLD 2400
+#define NUT_HALF_GCD_EXTENDED_THRESHOLD 1200
+
 namespace nut
 {
 
@@ -20,6 +33,11 @@ constexpr T gcd(T a, T b) noexcept
     return (0 == b ? a : gcd(b, a % b));
 }
 
+/**
+ * 大整数的最大公约数
+ *
+ * 规模较大时使用 Lehmer 算法(在字数组上原地计算), 超大规模时使用 half-GCD
+ */
 NUT_API BigInteger gcd(const BigInteger& a, const BigInteger& b) noexcept;
 
 /**
@@ -62,9 +80,25 @@ T extended_euclid(T a, T b, typename StdInt<T>::signed_type *x,
     return gcd;
 }
 
+/**
+ * 大整数的扩展欧几里得算法, 算法选择同 gcd()
+ *
+ * @param d 可以为 nullptr
+ * @param x 可以为 nullptr
+ * @param y 可以为 nullptr
+ */
 NUT_API void extended_euclid(const BigInteger& a, const BigInteger& b,
                              BigInteger *d, BigInteger *x, BigInteger *y) noexcept;
 
+/**
+ * 不使用 half-GCD, 只用 Lehmer 算法求非负数的最大公约数及系数 d = ax + by
+ *
+ * @param x 可以为 nullptr
+ * @param y 可以为 nullptr
+ */
+NUT_API void lehmer_gcd(const BigInteger& a, const BigInteger& b, BigInteger *d,
+                        BigInteger *x = nullptr, BigInteger *y = nullptr) noexcept;
+
 }
 
 #endif
@@ -13,6 +13,7 @@
 #endif
 
 #include "../word_array_integer/word_array_integer.h"
+#include "../word_array_integer/mul_op.h"
 #include "ntt.h"
 
 
@@ -28,6 +29,16 @@
 #   define NUT_KARATSUBA_FALLBACK_THRESHOLD 128
 #endif
 
+/**
+ * 规模较小时 karatsuba 平方退化使用一般算法; 一般平方算法只需约一半的乘法, 因此边
+ * 界值比乘法的大
+ */
+#if NUT_PLATFORM_CC_VC
+#   define NUT_KARATSUBA_SQUARE_FALLBACK_THRESHOLD 384
+#else
+#   define NUT_KARATSUBA_SQUARE_FALLBACK_THRESHOLD 192
+#endif
+
 namespace nut
 {
 
@@ -152,6 +163,62 @@ void unsigned_karatsuba_multiply(const T *a, size_t M, const T *b, size_t N, T *
         unsigned_add(x + base_len * 2, P - base_len * 2, AC, ac_len, x + base_len * 2, P - base_len * 2);
 }
 
+/**
+ * karatsuba 平方
+ *
+ * a = A * base + B
+ * a * a = AA * (base^2) + ((A+B)(A+B) - AA - BB) * base + BB
+ */
+template <typename T>
+void unsigned_karatsuba_square(const T *a, size_t M, T *x, size_t P) noexcept
+{
+    assert(nullptr != a && M > 0 && nullptr != x && P > 0);
+
+    // 去除无效位长
+    M = std::min(unsigned_significant_size(a, M), P);
+
+    // 退化
+    if (M < NUT_KARATSUBA_SQUARE_FALLBACK_THRESHOLD)
+    {
+        _unsigned_square(a, M, x, P);
+        return;
+    }
+
+    const size_t base_len = (M + 1) / 2;
+    const T *A = a + base_len, *B = a;
+    const size_t a_len = M - base_len, b_len = base_len;
+
+    // 所有中间结果都先算出来, 最后才写入 x, 因此 a、x 可以有交叉区域
+    //
+    // AB = A + B,  ab_len = b_len + 1
+    // ABAB = AB * AB,  abab_len = 2 * ab_len
+    // AA = A * A,  aa_len = 2 * a_len
+    // BB = B * B,  bb_len = 2 * b_len
+    const size_t ab_len = b_len + 1, abab_len = 2 * ab_len, aa_len = 2 * a_len, bb_len = 2 * b_len;
+    T *const AB = (T*) ::alloca(sizeof(T) * (ab_len + abab_len + aa_len + bb_len));
+    T *const ABAB = AB + ab_len;
+    T *const AA = ABAB + abab_len;
+    T *const BB = AA + aa_len;
+
+    unsigned_add(A, a_len, B, b_len, AB, ab_len);
+    unsigned_karatsuba_square(AB, ab_len, ABAB, abab_len);
+    unsigned_karatsuba_square(A, a_len, AA, aa_len);
+    unsigned_karatsuba_square(B, b_len, BB, bb_len);
+
+    // ABAB -= AA + BB
+    unsigned_sub(ABAB, abab_len, AA, aa_len, ABAB, abab_len);
+    unsigned_sub(ABAB, abab_len, BB, bb_len, ABAB, abab_len);
+
+    // 生成最终结果
+    unsigned_expand(BB, std::min(bb_len, P), x, P);
+    if (P > base_len)
+        unsigned_add(x + base_len, P - base_len, ABAB, std::min(abab_len, P - base_len),
+                     x + base_len, P - base_len);
+    if (P > base_len * 2)
+        unsigned_add(x + base_len * 2, P - base_len * 2, AA, std::min(aa_len, P - base_len * 2),
+                     x + base_len * 2, P - base_len * 2);
+}
+
 /**
  * karatsuba 乘法，时间复杂度为 O(n**(log2 3)) = O(n**1.58)
  *
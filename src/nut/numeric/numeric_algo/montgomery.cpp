@@ -0,0 +1,382 @@
+﻿
+#include <assert.h>
+#include <stdlib.h> // for ::malloc(), ::free()
+#include <string.h> // for ::memcpy(), ::memset()
+#include <algorithm> // for std::min()
+
+#include "../word_array_integer/word_array_integer.h"
+#include "../word_array_integer/word_op.h"
+#include "fast_multiply.h"
+#include "montgomery.h"
+
+
+namespace nut
+{
+
+typedef MontgomeryContext::word_type word_type;
+
+/**
+ * 牛顿迭代求 -n^(-1) mod β
+ *
+ * @param n0 奇数
+ */
+static word_type neg_inverse_word(word_type n0) noexcept
+{
+    assert(0 != (n0 & 1));
+
+    // x = n0 时已有 3 个比特正确, 每次迭代正确的比特数翻倍
+    word_type x = n0;
+    for (size_t bits = 3; bits < 8 * sizeof(word_type); bits <<= 1)
+        x *= 2 - n0 * x;
+    assert(1 == (word_type) (n0 * x));
+    return (word_type) (0 - x);
+}
+
+/**
+ * 计算滑动窗口算法的最佳窗口大小
+ */
+static unsigned best_window_size(size_t bit_len) noexcept
+{
+    // 参考 java 的 BigInteger.bnExpModThreshTable
+    static const size_t TBL[] = {
+        7, 25, 81, 241, 673, 1793
+    };
+
+    int left = -1, right = sizeof(TBL) / sizeof(TBL[0]);
+    while (right - left > 1)
+    {
+        const int mid = (left + right) / 2;
+        if (TBL[mid] == bit_len)
+            return mid + 1;
+        else if (TBL[mid] < bit_len)
+            left = mid;
+        else
+            right = mid;
+    }
+    return left + 2;
+}
+
+MontgomeryContext::MontgomeryContext(const BigInteger& n) noexcept
+    : _modulus(n)
+{
+    assert(n.is_positive() && 1 == n.bit_at(0) && n > 1);
+
+    _words_len = unsigned_significant_size(n.data(), n.significant_words_length());
+    const size_t N = _words_len;
+    _buf = (word_type*) ::malloc(sizeof(word_type) * 3 * N);
+    assert(nullptr != _buf);
+    ::memcpy(_buf, n.data(), sizeof(word_type) * N);
+    _n0_inv = neg_inverse_word(_buf[0]);
+
+    // R^2 mod n, R mod n
+    BigInteger r(1);
+    r <<= 8 * sizeof(word_type) * N;
+    const BigInteger r1 = r % n, r2 = (r1 * r1) % n;
+    unsigned_expand(r2.data(), std::min(N, r2.significant_words_length()), _buf + N, N);
+    unsigned_expand(r1.data(), std::min(N, r1.significant_words_length()), _buf + 2 * N, N);
+}
+
+MontgomeryContext::MontgomeryContext(const MontgomeryContext& x) noexcept
+    : _modulus(x._modulus), _words_len(x._words_len), _n0_inv(x._n0_inv)
+{
+    _buf = (word_type*) ::malloc(sizeof(word_type) * 3 * _words_len);
+    assert(nullptr != _buf);
+    ::memcpy(_buf, x._buf, sizeof(word_type) * 3 * _words_len);
+}
+
+MontgomeryContext::MontgomeryContext(MontgomeryContext&& x) noexcept
+    : _modulus(std::move(x._modulus)), _words_len(x._words_len), _buf(x._buf), _n0_inv(x._n0_inv)
+{
+    x._words_len = 0;
+    x._buf = nullptr;
+}
+
+MontgomeryContext::~MontgomeryContext() noexcept
+{
+    if (nullptr != _buf)
+        ::free(_buf);
+    _buf = nullptr;
+    _words_len = 0;
+}
+
+MontgomeryContext& MontgomeryContext::operator=(const MontgomeryContext& x) noexcept
+{
+    if (this == &x)
+        return *this;
+
+    _modulus = x._modulus;
+    if (_words_len != x._words_len)
+    {
+        _buf = (word_type*) ::realloc(_buf, sizeof(word_type) * 3 * x._words_len);
+        assert(nullptr != _buf);
+    }
+    _words_len = x._words_len;
+    ::memcpy(_buf, x._buf, sizeof(word_type) * 3 * _words_len);
+    _n0_inv = x._n0_inv;
+    return *this;
+}
+
+MontgomeryContext& MontgomeryContext::operator=(MontgomeryContext&& x) noexcept
+{
+    if (this == &x)
+        return *this;
+
+    if (nullptr != _buf)
+        ::free(_buf);
+    _modulus = std::move(x._modulus);
+    _words_len = x._words_len;
+    _buf = x._buf;
+    _n0_inv = x._n0_inv;
+
+    x._words_len = 0;
+    x._buf = nullptr;
+    return *this;
+}
+
+const BigInteger& MontgomeryContext::get_modulus() const noexcept
+{
+    return _modulus;
+}
+
+size_t MontgomeryContext::words_length() const noexcept
+{
+    return _words_len;
+}
+
+size_t MontgomeryContext::scratch_length() const noexcept
+{
+    return 2 * _words_len + 1;
+}
+
+const word_type* MontgomeryContext::one() const noexcept
+{
+    return _buf + 2 * _words_len;
+}
+
+void MontgomeryContext::to_montgomery(const word_type *a, word_type *x, word_type *scratch) const noexcept
+{
+    mul(a, _buf + _words_len, x, scratch);
+}
+
+void MontgomeryContext::from_montgomery(const word_type *a, word_type *x, word_type *scratch) const noexcept
+{
+    assert(nullptr != a && nullptr != x && nullptr != scratch);
+    const size_t N = _words_len;
+    ::memcpy(scratch, a, sizeof(word_type) * N);
+    ::memset(scratch + N, 0, sizeof(word_type) * (N + 1));
+    reduce(scratch, x);
+}
+
+void MontgomeryContext::mul(const word_type *a, const word_type *b, word_type *x,
+                            word_type *scratch) const noexcept
+{
+    assert(nullptr != a && nullptr != b && nullptr != x && nullptr != scratch);
+
+    /**
+     * CIOS(Coarsely Integrated Operand Scanning): 每乘一个字就约简一个字,
+     * 中间结果 t 只需要 N + 2 个字
+     */
+    const size_t N = _words_len;
+    const word_type *const n = _buf;
+    word_type *const t = scratch;
+    ::memset(t, 0, sizeof(word_type) * (N + 2));
+    for (size_t i = 0; i < N; ++i)
+    {
+        // t += a * b[i]
+        word_type carry = 0;
+        const word_type bi = b[i];
+        for (size_t j = 0; j < N; ++j)
+            t[j] = multiply_add<word_type>(a[j], bi, t[j], carry, &carry);
+        uint8_t c = 0;
+        t[N] = add_with_carry<word_type>(t[N], carry, &c);
+        t[N + 1] = c;
+
+        // t = (t + m * n) / β, 其中 m 使得 t + m * n 的最低字为 0
+        const word_type m = (word_type) (t[0] * _n0_inv);
+        multiply_add<word_type>(m, n[0], t[0], 0, &carry);
+        for (size_t j = 1; j < N; ++j)
+            t[j - 1] = multiply_add<word_type>(m, n[j], t[j], carry, &carry);
+        c = 0;
+        t[N - 1] = add_with_carry<word_type>(t[N], carry, &c);
+        t[N] = t[N + 1] + c;
+    }
+
+    // t < 2n
+    if (0 != t[N] || unsigned_compare(t, N, n, N) >= 0)
+        unsigned_sub(t, N, n, N, x, N);
+    else
+        ::memcpy(x, t, sizeof(word_type) * N);
+}
+
+void MontgomeryContext::sqr(const word_type *a, word_type *x, word_type *scratch) const noexcept
+{
+    assert(nullptr != a && nullptr != x && nullptr != scratch);
+
+    // 平方可以省去约一半的乘法, 先平方再约简
+    const size_t N = _words_len;
+    unsigned_fast_square(a, N, scratch, 2 * N);
+    scratch[2 * N] = 0;
+    reduce(scratch, x);
+}
+
+void MontgomeryContext::reduce(word_type *t, word_type *x) const noexcept
+{
+    const size_t N = _words_len;
+    const word_type *const n = _buf;
+    for (size_t i = 0; i < N; ++i)
+    {
+        // t += m * n * β^i, 其中 m 使得 t 的第 i 个字为 0
+        const word_type m = (word_type) (t[i] * _n0_inv);
+        word_type carry = 0;
+        for (size_t j = 0; j < N; ++j)
+            t[i + j] = multiply_add<word_type>(m, n[j], t[i + j], carry, &carry);
+        uint8_t c = 0;
+        t[i + N] = add_with_carry<word_type>(t[i + N], carry, &c);
+        for (size_t j = i + N + 1; 0 != c && j <= 2 * N; ++j)
+            t[j] = add_with_carry<word_type>(t[j], 0, &c);
+    }
+
+    // t / R < 2n
+    word_type *const rs = t + N;
+    if (0 != rs[N] || unsigned_compare(rs, N, n, N) >= 0)
+        unsigned_sub(rs, N, n, N, x, N);
+    else
+        ::memcpy(x, rs, sizeof(word_type) * N);
+}
+
+/**
+ * 分配模幂运算需要的空间, 依次为预算表、累积值、临时空间, 由调用者 ::free()
+ *
+ * 预算表的第 0 项填入 a 的蒙哥马利表示
+ */
+static word_type* alloc_pow_buffer(const MontgomeryContext& ctx, const BigInteger& a,
+                                   size_t table_size) noexcept
+{
+    const size_t N = ctx.words_length();
+    word_type *const buf = (word_type*) ::malloc(
+        sizeof(word_type) * ((table_size + 1) * N + ctx.scratch_length()));
+    assert(nullptr != buf);
+    word_type *const scratch = buf + (table_size + 1) * N;
+
+    // a mod n
+    const BigInteger& n = ctx.get_modulus();
+    if (a.is_negative() || a >= n)
+    {
+        BigInteger r = a % n;
+        if (r.is_negative())
+            r += n;
+        unsigned_expand(r.data(), std::min(N, r.significant_words_length()), buf, N);
+    }
+    else
+    {
+        unsigned_expand(a.data(), std::min(N, a.significant_words_length()), buf, N);
+    }
+    ctx.to_montgomery(buf, buf, scratch);
+    return buf;
+}
+
+/**
+ * 从蒙哥马利表示转换出结果
+ */
+static BigInteger finish_pow(const MontgomeryContext& ctx, word_type *acc, word_type *scratch) noexcept
+{
+    ctx.from_montgomery(acc, acc, scratch);
+    return BigInteger(acc, sizeof(word_type) * ctx.words_length(), false);
+}
+
+BigInteger MontgomeryContext::pow(const BigInteger& a, const BigInteger& b) const noexcept
+{
+    assert(b.is_positive());
+
+    const size_t N = _words_len, bits = b.bit_length();
+    if (0 == bits)
+        return BigInteger(1) % _modulus;
+
+    // 预算表为 a 的奇数次幂 a^1, a^3, ..., a^(2^w - 1)
+    const unsigned wnd = best_window_size(bits - 1);
+    const size_t table_size = ((size_t) 1) << (wnd - 1);
+    word_type *const table = alloc_pow_buffer(*this, a, table_size);
+    word_type *const acc = table + table_size * N, *const scratch = acc + N;
+    if (table_size > 1)
+    {
+        sqr(table, acc, scratch); // a^2
+        for (size_t i = 1; i < table_size; ++i)
+            mul(table + (i - 1) * N, acc, table + i * N, scratch);
+    }
+
+    // 从高位向低位扫描, 每个窗口以 1 开头、以 1 结尾, 窗口之间的 0 只需平方
+    bool first = true;
+    size_t i = bits;
+    while (i > 0)
+    {
+        if (0 == b.bit_at(i - 1))
+        {
+            sqr(acc, acc, scratch);
+            --i;
+            continue;
+        }
+
+        // 窗口为 [low, i)
+        size_t low = (i > wnd ? i - wnd : 0);
+        while (0 == b.bit_at(low))
+            ++low;
+        size_t value = 0;
+        for (size_t j = i; j > low; --j)
+            value = (value << 1) | (size_t) b.bit_at(j - 1);
+
+        const word_type *const entry = table + (value >> 1) * N;
+        if (first)
+        {
+            ::memcpy(acc, entry, sizeof(word_type) * N);
+            first = false;
+        }
+        else
+        {
+            for (size_t j = low; j < i; ++j)
+                sqr(acc, acc, scratch);
+            mul(acc, entry, acc, scratch);
+        }
+        i = low;
+    }
+
+    BigInteger ret = finish_pow(*this, acc, scratch);
+    ::free(table);
+    return ret;
+}
+
+BigInteger MontgomeryContext::pow_fixed_window(const BigInteger& a, const BigInteger& b) const noexcept
+{
+    assert(b.is_positive());
+
+    const size_t N = _words_len, bits = b.bit_length();
+    if (0 == bits)
+        return BigInteger(1) % _modulus;
+
+    // 预算表为 a^1, a^2, ..., a^(2^w - 1), 另外 a^0 即 one()
+    const unsigned wnd = best_window_size(bits - 1);
+    const size_t table_size = (((size_t) 1) << wnd) - 1;
+    word_type *const table = alloc_pow_buffer(*this, a, table_size);
+    word_type *const acc = table + table_size * N, *const scratch = acc + N;
+    for (size_t i = 1; i < table_size; ++i)
+        mul(table + (i - 1) * N, table, table + i * N, scratch);
+
+    // 从高位向低位, 每 w 个比特做 w 次平方和一次乘法(窗口为 0 时乘以 1)
+    ::memcpy(acc, one(), sizeof(word_type) * N);
+    const size_t windows = (bits + wnd - 1) / wnd;
+    for (size_t w = windows; w > 0; --w)
+    {
+        size_t value = 0;
+        for (size_t j = w * wnd; j > (w - 1) * wnd; --j)
+        {
+            sqr(acc, acc, scratch);
+            value = (value << 1) | (size_t) b.bit_at(j - 1);
+        }
+        mul(acc, (0 == value ? one() : table + (value - 1) * N), acc, scratch);
+    }
+
+    BigInteger ret = finish_pow(*this, acc, scratch);
+    ::free(table);
+    return ret;
+}
+
+}
@@ -0,0 +1,123 @@
+﻿
+#ifndef ___HEADFILE_928626F6_1A4F_4C87_85AC_6A425C7F3FCF_
+#define ___HEADFILE_928626F6_1A4F_4C87_85AC_6A425C7F3FCF_
+
+#include <stddef.h>
+
+#include "../../nut_config.h"
+#include "../big_integer.h"
+
+
+namespace nut
+{
+
+/**
+ * 蒙哥马利模乘的上下文
+ *
+ * 构造时预先计算 R^2 mod n 以及 n' = -n^(-1) mod β (其中 R = β^N, β 为字的基数,
+ * N 为模的字长), 之后同一个模下的模乘、模平方、模幂都可以复用, 例如 RSA 的多次加解密
+ *
+ * 字数组接口的操作数都是 N 个字的非负数, 小于模且处于蒙哥马利表示下(即 a * R mod n),
+ * 由调用者提供 scratch_length() 个字的临时空间, 运算过程中不分配内存
+ *
+ * 参考文献：
+ *      [1]Ç. K. Koç, T. Acar, B. S. Kaliski. Analyzing and Comparing Montgomery
+ *         Multiplication Algorithms[J]. IEEE Micro, 1996, 16(3). 26-33
+ */
+class NUT_API MontgomeryContext
+{
+public:
+    typedef BigInteger::word_type word_type;
+
+public:
+    /**
+     * @param n 模, 必须是大于 1 的奇数
+     */
+    explicit MontgomeryContext(const BigInteger& n) noexcept;
+    MontgomeryContext(const MontgomeryContext& x) noexcept;
+    MontgomeryContext(MontgomeryContext&& x) noexcept;
+    ~MontgomeryContext() noexcept;
+
+    MontgomeryContext& operator=(const MontgomeryContext& x) noexcept;
+    MontgomeryContext& operator=(MontgomeryContext&& x) noexcept;
+
+    const BigInteger& get_modulus() const noexcept;
+
+    /**
+     * 模的字长 N, 也是字数组接口中各操作数的长度
+     */
+    size_t words_length() const noexcept;
+
+    /**
+     * 字数组接口需要的临时空间的字数
+     */
+    size_t scratch_length() const noexcept;
+
+    /**
+     * 1 的蒙哥马利表示, 即 R mod n
+     */
+    const word_type* one() const noexcept;
+
+    /**
+     * x = a * R mod n, 转换为蒙哥马利表示
+     *
+     * @param a 小于模
+     */
+    void to_montgomery(const word_type *a, word_type *x, word_type *scratch) const noexcept;
+
+    /**
+     * x = a * R^(-1) mod n, 从蒙哥马利表示转换回来
+     */
+    void from_montgomery(const word_type *a, word_type *x, word_type *scratch) const noexcept;
+
+    /**
+     * x = a * b * R^(-1) mod n
+     *
+     * NOTE x 可以与 a、b 重叠
+     */
+    void mul(const word_type *a, const word_type *b, word_type *x, word_type *scratch) const noexcept;
+
+    /**
+     * x = a * a * R^(-1) mod n
+     *
+     * NOTE x 可以与 a 重叠
+     */
+    void sqr(const word_type *a, word_type *x, word_type *scratch) const noexcept;
+
+    /**
+     * 滑动窗口法求 (a ** b) mod n, 窗口大小根据 b 的比特长度选取
+     *
+     * @param a 非负数, 可以不小于模
+     * @param b 非负数
+     */
+    BigInteger pow(const BigInteger& a, const BigInteger& b) const noexcept;
+
+    /**
+     * 固定窗口(k-ary)法求 (a ** b) mod n
+     *
+     * 平方与乘法的次序只与 b 的比特长度有关, 而与其中各比特的值无关, 适合私钥运算
+     */
+    BigInteger pow_fixed_window(const BigInteger& a, const BigInteger& b) const noexcept;
+
+private:
+    /**
+     * 对 2N+1 个字的 t (t < n * R) 做蒙哥马利约简, x = t * R^(-1) mod n
+     *
+     * NOTE t 会被改写
+     */
+    void reduce(word_type *t, word_type *x) const noexcept;
+
+private:
+    BigInteger _modulus;
+    size_t _words_len = 0;
+
+    // 依次为 n、R^2 mod n、R mod n, 各 N 个字
+    word_type *_buf = nullptr;
+
+    // -n^(-1) mod β
+    word_type _n0_inv = 0;
+};
+
+}
+
+#endif
@@ -8,10 +8,17 @@
  *   操作, 负数 a 被错误转成无符号正数, b == 3
  */
 
+#include <stdlib.h> // for ::malloc(), ::free()
+#include <atomic>
 #include <mutex> // for std::call_once()
+#include <system_error>
+#include <thread>
 
 #include "../../platform/endian.h"
 #include "../../platform/int_type.h"
+#include "../../threading/thread_pool.h"
+#include "../word_array_integer/div_op.h"
+#include "../word_array_integer/word_op.h"
 #include "gcd.h"
 #include "mod.h"
 #include "ntt.h"
@@ -21,7 +28,7 @@
 namespace nut
 {
 
-NUT_API bool can_use_ntt_multiply(size_t bits) noexcept
+NUT_API bool can_use_single_modulus_ntt(size_t bits) noexcept
 {
     const size_t word_siglen = (bits + NUT_NTT_BASE_BITS - 1) / NUT_NTT_BASE_BITS;
     unsigned word_count_bits = highest_bit1((uint64_t) word_siglen) + 1; // word_count 必须是 2 的幂次
@@ -45,10 +52,39 @@ NUT_API bool can_use_ntt_multiply(size_t bits) noexcept
     return true;
 }
 
- // omega[k]、inv_omega[K] 是模 M 的 2^k 次单位根，其中 omega[] 用于正变换,
+NUT_API bool can_use_ntt_multiply(size_t bits) noexcept
+{
+    if (can_use_single_modulus_ntt(bits))
+        return true;
+
+    // 多模数 NTT 以 2**64 为基数, 卷积的每一项不超过 n * (2**64)**2, 需要小于模数
+    // 之积 2**179.9; 同时乘积的长度 2n 不能超过最大变换规模 2**54
+    const size_t words = (bits + 63) / 64;
+    return (uint64_t) words <= (1ULL << 51);
+}
+
+// 模数表 m = r * 2 ** k + 1, 参见 ntt.h 中的原根表
+static const struct
+{
+    ntt_word_type r;
+    unsigned k;
+    ntt_word_type g;
+} moduli[NUT_NTT_PRIME_COUNT] = {
+    {NUT_NTT_R, NUT_NTT_K, NUT_NTT_G}, // 4179340454199820289
+    {27, 56, 5},                       // 1945555039024054273
+    {5, 55, 6},                        // 180143985094819841
+};
+
+static ntt_word_type modulus_of(unsigned prime) noexcept
+{
+    assert(prime < NUT_NTT_PRIME_COUNT);
+    return moduli[prime].r * (1ULL << moduli[prime].k) + 1;
+}
+
+// omega[p][k]、inv_omega[p][k] 是模 p 的 2^k 次单位根，其中 omega[] 用于正变换,
 // inv_omega[] 用于逆变换
-static ntt_word_type omega[NUT_NTT_K] = {0};
-static ntt_word_type inv_omega[NUT_NTT_K] = {0};
+static ntt_word_type omega[NUT_NTT_PRIME_COUNT][NUT_NTT_K] = {{0}};
+static ntt_word_type inv_omega[NUT_NTT_PRIME_COUNT][NUT_NTT_K] = {{0}};
 static std::once_flag amega_init_flag;
 
 static void init_omega() noexcept
@@ -56,113 +92,252 @@ static void init_omega() noexcept
     std::call_once(
         amega_init_flag,
         [&] {
-            // => w[k-1] = pow_mod(g, 2 * r, m)
-            omega[NUT_NTT_K - 1] = pow_mod<ntt_word_type>(NUT_NTT_G, 2 * NUT_NTT_R, NUT_NTT_M);
+            for (unsigned p = 0; p < NUT_NTT_PRIME_COUNT; ++p)
+            {
+                const ntt_word_type m = modulus_of(p);
+                const unsigned k = moduli[p].k;
+                assert(k <= NUT_NTT_K);
 
-            // => inv_w[k-1] = w[k-1] ** -1 (mod m)
-            inv_omega[NUT_NTT_K - 1] = inverse_of_coprime_mod<ntt_word_type>(omega[NUT_NTT_K - 1], NUT_NTT_M);
+                // => w[k-1] = pow_mod(g, 2 * r, m)
+                omega[p][k - 1] = pow_mod<ntt_word_type>(moduli[p].g, 2 * moduli[p].r, m);
 
-            assert(mul_mod<ntt_word_type>(omega[NUT_NTT_K - 1], inv_omega[NUT_NTT_K - 1], NUT_NTT_M) == 1);
+                // => inv_w[k-1] = w[k-1] ** -1 (mod m)
+                inv_omega[p][k - 1] = inverse_of_coprime_mod<ntt_word_type>(omega[p][k - 1], m);
 
-            for (int i = NUT_NTT_K - 2; i >= 0; --i)
-            {
-                omega[i] = mul_mod<ntt_word_type>(omega[i + 1], omega[i + 1], NUT_NTT_M);
-                inv_omega[i] = mul_mod<ntt_word_type>(inv_omega[i + 1], inv_omega[i + 1], NUT_NTT_M);
+                assert(mul_mod<ntt_word_type>(omega[p][k - 1], inv_omega[p][k - 1], m) == 1);
+
+                for (int i = k - 2; i >= 0; --i)
+                {
+                    omega[p][i] = mul_mod<ntt_word_type>(omega[p][i + 1], omega[p][i + 1], m);
+                    inv_omega[p][i] = mul_mod<ntt_word_type>(inv_omega[p][i + 1], inv_omega[p][i + 1], m);
+                }
+                assert(1 == omega[p][0] && 1 == inv_omega[p][0]);
+                assert(m - 1 == omega[p][1]); // 原根
             }
-            assert(1 == omega[0] && 1 == inv_omega[0]);
         });
 }
 
-// DIF-FFT: 输入为自然顺序，输出为二进制倒序
-static void NTT_N2R(ntt_word_type *a, unsigned bits) noexcept
+/**
+ * Shoup 预计算值 floor(w * 2**64 / m)
+ */
+static ntt_word_type shoup_of(ntt_word_type w, ntt_word_type m) noexcept
 {
-    const size_t len = 1ULL << bits;
+    assert(w < m);
+    const uint64_t num[2] = {0, w};
+    uint64_t q[2];
+    unsigned_divide_word<uint64_t>(num, 2, m, q);
+    assert(0 == q[1]);
+    return q[0];
+}
 
-    // butterfly operation
-    for (int layer = bits; layer > 0; --layer)
+/**
+ * 计算 x * w % m, 其中 w_shoup = shoup_of(w, m)
+ *
+ * 商的估计值至多偏小 1, 只需要一次乘法取高位、两次低位乘法以及一次条件减法,
+ * 避免了双字长除法
+ */
+static inline ntt_word_type shoup_mul(ntt_word_type x, ntt_word_type w, ntt_word_type w_shoup,
+                                      ntt_word_type m) noexcept
+{
+    uint64_t q;
+    multiply_add<uint64_t>(x, w_shoup, 0, 0, &q);
+    ntt_word_type r = x * w - q * m; // 截断到 64 位, 结果在 [0, 2m) 之间
+    if (r >= m)
+        r -= m;
+    return r;
+}
+
+/**
+ * 蒙哥马利乘法, 计算 a * b * 2**-64 % m
+ *
+ * @param m_inv -(m ** -1) mod 2**64
+ */
+static inline ntt_word_type montgomery_mul(ntt_word_type a, ntt_word_type b, ntt_word_type m,
+                                           ntt_word_type m_inv) noexcept
+{
+    // t = a * b, u = (t + (t * m_inv mod 2**64) * m) / 2**64
+    // NOTE m < 2**62, 故 u < 2m, 不会溢出
+    uint64_t t_hi, tm_hi;
+    const uint64_t t_lo = multiply_add<uint64_t>(a, b, 0, 0, &t_hi);
+    multiply_add<uint64_t>(t_lo * m_inv, m, 0, 0, &tm_hi);
+    ntt_word_type u = t_hi + tm_hi + (0 != t_lo ? 1 : 0);
+    if (u >= m)
+        u -= m;
+    return u;
+}
+
+// 已经计算的方案, 一直缓存到进程退出
+static std::atomic<NTTPlan*> plans[NUT_NTT_PRIME_COUNT][NUT_NTT_K];
+static std::mutex plans_lock;
+
+const NTTPlan& NTTPlan::get(unsigned bits, unsigned prime) noexcept
+{
+    assert(prime < NUT_NTT_PRIME_COUNT && bits > 0 && bits <= max_bits(prime));
+    NTTPlan *plan = plans[prime][bits].load(std::memory_order_acquire);
+    if (nullptr != plan)
+        return *plan;
+
+    std::lock_guard<std::mutex> guard(plans_lock);
+    plan = plans[prime][bits].load(std::memory_order_relaxed);
+    if (nullptr == plan)
     {
-        const size_t group = 1ULL << layer, brother = group >> 1;
-        assert(layer < NUT_NTT_K);
-        const ntt_word_type kernel = omega[layer];
+        plan = new NTTPlan(bits, prime);
+        plans[prime][bits].store(plan, std::memory_order_release);
+    }
+    return *plan;
+}
+
+unsigned NTTPlan::max_bits(unsigned prime) noexcept
+{
+    assert(prime < NUT_NTT_PRIME_COUNT);
+    return moduli[prime].k - 1;
+}
+
+NTTPlan::NTTPlan(unsigned bits, unsigned prime) noexcept
+    : _bits(bits), _len(1ULL << bits), _modulus(modulus_of(prime))
+{
+    init_omega();
 
-        for (size_t k = 0; k < len; k += group)
+    const ntt_word_type m = _modulus;
+    _roots = (ntt_word_type*) ::malloc(sizeof(ntt_word_type) * _len * 4);
+    assert(nullptr != _roots);
+    _roots_shoup = _roots + _len;
+    _inv_roots = _roots_shoup + _len;
+    _inv_roots_shoup = _inv_roots + _len;
+
+    _roots[0] = _roots_shoup[0] = _inv_roots[0] = _inv_roots_shoup[0] = 0; // 未使用
+    for (unsigned layer = 1; layer <= bits; ++layer)
+    {
+        const size_t brother = 1ULL << (layer - 1);
+        ntt_word_type w = 1, inv_w = 1;
+        for (size_t j = 0; j < brother; ++j)
         {
-            // 遍历每一组
-            ntt_word_type w = 1;
+            _roots[brother + j] = w;
+            _roots_shoup[brother + j] = shoup_of(w, m);
+            _inv_roots[brother + j] = inv_w;
+            _inv_roots_shoup[brother + j] = shoup_of(inv_w, m);
+            w = mul_mod<ntt_word_type>(w, omega[prime][layer], m);
+            inv_w = mul_mod<ntt_word_type>(inv_w, inv_omega[prime][layer], m);
+        }
+    }
+
+    // x = m 时已有 3 个比特正确, 每次迭代正确的比特数翻倍
+    ntt_word_type x = m;
+    for (unsigned i = 3; i < 64; i <<= 1)
+        x *= 2 - m * x;
+    assert(1 == (ntt_word_type) (m * x));
+    _mont_inv = 0 - x;
+
+    // 除以 len 操作变成乘以逆元
+    _inv_len = inverse_of_coprime_mod<ntt_word_type>(_len, m);
+    _inv_len_shoup = shoup_of(_inv_len, m);
+    const ntt_word_type r = (0 - m) % m; // 2**64 mod m
+    _inv_len_r = mul_mod<ntt_word_type>(_inv_len, r, m);
+    _inv_len_r_shoup = shoup_of(_inv_len_r, m);
+}
+
+NTTPlan::~NTTPlan() noexcept
+{
+    ::free(_roots); // 其他数组在同一个内存块中
+}
+
+unsigned NTTPlan::get_bits() const noexcept
+{
+    return _bits;
+}
 
+size_t NTTPlan::size() const noexcept
+{
+    return _len;
+}
+
+ntt_word_type NTTPlan::get_modulus() const noexcept
+{
+    return _modulus;
+}
+
+void NTTPlan::forward(ntt_word_type *a) const noexcept
+{
+    assert(nullptr != a);
+
+    // butterfly operation
+    const ntt_word_type m = _modulus;
+    for (size_t brother = _len >> 1; brother > 0; brother >>= 1)
+    {
+        const size_t group = brother << 1;
+        const ntt_word_type *const w = _roots + brother, *const ws = _roots_shoup + brother;
+        for (size_t k = 0; k < _len; k += group)
+        {
+            ntt_word_type *const x = a + k, *const y = x + brother;
             for (size_t j = 0; j < brother; ++j)
             {
-                // 对每一个元素，找到它的兄弟（和它进行蝴蝶操作的那个元素）
-                const size_t cur = k + j, next = cur + brother;
-                const ntt_word_type u = a[cur], v = a[next];
+                const ntt_word_type u = x[j], v = y[j];
 
-                // => a[cur] = (u + v) % M;
-                a[cur] = u + v;
-                if (a[cur] >= NUT_NTT_M)
-                    a[cur] -= NUT_NTT_M;
+                // => x[j] = (u + v) % m;
+                ntt_word_type s = u + v;
+                if (s >= m)
+                    s -= m;
+                x[j] = s;
 
-                // => a[next] = (u + M - v) * w % M;
-                if (u >= v)
-                {
-                    a[next] = mul_mod<ntt_word_type>(u - v, w, NUT_NTT_M);
-                }
-                else
-                {
-                    a[next] = mul_mod<ntt_word_type>(NUT_NTT_M - v + u, w, NUT_NTT_M);
-                }
-
-                // => w = w * kernel % M;
-                w = mul_mod<ntt_word_type>(w, kernel, NUT_NTT_M);
+                // => y[j] = (u + m - v) * w % m;
+                y[j] = shoup_mul(u + m - v, w[j], ws[j], m);
             }
         }
     }
 }
 
-// DIT-FFT: 输入为二进制倒序，输出为自然顺序的FFT
-static void NTT_R2N(ntt_word_type* a, unsigned bits) noexcept
+void NTTPlan::inverse_butterfly(ntt_word_type *a) const noexcept
 {
-    const size_t len = 1 << bits;
+    assert(nullptr != a);
 
     // butterfly operation
-    for (unsigned layer = 1; layer <= bits; ++layer)
+    const ntt_word_type m = _modulus;
+    for (size_t brother = 1; brother < _len; brother <<= 1)
     {
-        const size_t group = 1 << layer, brother = group >> 1;
-        assert(layer < NUT_NTT_K);
-        const ntt_word_type kernel = inv_omega[layer];
-
-        for (size_t k = 0; k < len; k += group)
+        const size_t group = brother << 1;
+        const ntt_word_type *const w = _inv_roots + brother, *const ws = _inv_roots_shoup + brother;
+        for (size_t k = 0; k < _len; k += group)
         {
-            // 遍历每一组
-            ntt_word_type w = 1;
-
+            ntt_word_type *const x = a + k, *const y = x + brother;
             for (size_t j = 0; j < brother; ++j)
             {
-                // 对每一个元素，找到它的兄弟（和它进行蝴蝶操作的那个元素）
-                size_t cur = k + j, next = cur + brother;
-                const ntt_word_type u = a[cur],
-                    t = mul_mod<ntt_word_type>(w, a[next], NUT_NTT_M);
-
-                // => a[cur] = (u + t) % M;
-                a[cur] = u + t;
-                if (a[cur] >= NUT_NTT_M)
-                    a[cur] -= NUT_NTT_M;
-
-                // => a[next] = (u + M - t) % M;
-                if (u >= t)
-                    a[next] = u - t;
-                else
-                    a[next] = NUT_NTT_M - t + u;
-
-                // => w = w * kernel % M_M;
-                w = mul_mod<ntt_word_type>(w, kernel, NUT_NTT_M);
+                const ntt_word_type u = x[j], t = shoup_mul(y[j], w[j], ws[j], m);
+
+                // => x[j] = (u + t) % m;
+                ntt_word_type s = u + t;
+                if (s >= m)
+                    s -= m;
+                x[j] = s;
+
+                // => y[j] = (u + m - t) % m;
+                y[j] = (u >= t ? u - t : u + m - t);
             }
         }
     }
+}
 
-    // 除以 len 操作变成乘以逆元
-    const uint64_t inv_len = inverse_of_coprime_mod<ntt_word_type>(len, NUT_NTT_M);
-    for (size_t i = 0; i < len; ++i)
-        a[i] = mul_mod<ntt_word_type>(a[i], inv_len, NUT_NTT_M);
+void NTTPlan::inverse(ntt_word_type *a) const noexcept
+{
+    inverse_butterfly(a);
+    for (size_t i = 0; i < _len; ++i)
+        a[i] = shoup_mul(a[i], _inv_len, _inv_len_shoup, _modulus);
+}
+
+void NTTPlan::convolve(ntt_word_type *a, ntt_word_type *b) const noexcept
+{
+    assert(nullptr != a && nullptr != b);
+
+    forward(a);
+    if (b != a)
+        forward(b);
+
+    // 逐点相乘的结果带有因子 2**-64, 在逆变换最后与除以 len 一并抵消
+    for (size_t i = 0; i < _len; ++i)
+        a[i] = montgomery_mul(a[i], b[i], _modulus, _mont_inv);
+
+    inverse_butterfly(a);
+    for (size_t i = 0; i < _len; ++i)
+        a[i] = shoup_mul(a[i], _inv_len_r, _inv_len_r_shoup, _modulus);
 }
 
 NUT_API void ntt_convolution(ntt_word_type *a, ntt_word_type *b, unsigned bit_len,
@@ -170,16 +345,172 @@ NUT_API void ntt_convolution(ntt_word_type *a, ntt_word_type *b, unsigned bit_le
 {
     assert(nullptr != a && nullptr != b && bit_len > 0 && nullptr != rs);
 
-    init_omega();
+    const NTTPlan& plan = NTTPlan::get(bit_len);
+    plan.convolve(a, b);
+    ::memcpy(rs, a, sizeof(ntt_word_type) * plan.size());
+}
+
+/**
+ * 中国余数定理(Garner 算法)所需的常量
+ */
+namespace
+{
+
+class CRTConstants
+{
+public:
+    CRTConstants() noexcept
+    {
+        for (unsigned i = 0; i < NUT_NTT_PRIME_COUNT; ++i)
+        {
+            m[i] = modulus_of(i);
+            one_shoup[i] = shoup_of(1, m[i]);
+        }
+
+        // c1 = m0 ** -1 mod m1
+        c1 = inverse_of_coprime_mod<ntt_word_type>(m[0] % m[1], m[1]);
+        c1_shoup = shoup_of(c1, m[1]);
+
+        // c2 = (m0 * m1) ** -1 mod m2
+        m0_mod_m2 = m[0] % m[2];
+        m0_mod_m2_shoup = shoup_of(m0_mod_m2, m[2]);
+        c2 = inverse_of_coprime_mod<ntt_word_type>(
+            mul_mod<ntt_word_type>(m0_mod_m2, m[1] % m[2], m[2]), m[2]);
+        c2_shoup = shoup_of(c2, m[2]);
+
+        // m0 * m1
+        m01[0] = multiply_add<uint64_t>(m[0], m[1], 0, 0, m01 + 1);
+    }
+
+public:
+    ntt_word_type m[NUT_NTT_PRIME_COUNT], one_shoup[NUT_NTT_PRIME_COUNT];
+    ntt_word_type c1, c1_shoup, c2, c2_shoup, m0_mod_m2, m0_mod_m2_shoup;
+    uint64_t m01[2];
+};
 
-    NTT_N2R(a, bit_len);
-    NTT_N2R(b, bit_len);
+}
+
+static_assert(3 == NUT_NTT_PRIME_COUNT, "CRT recombination assumes three moduli");
+
+NUT_API void ntt_crt_multiply(const uint64_t *a, size_t M, const uint64_t *b, size_t N,
+                              uint64_t *x, size_t P, unsigned max_threads, ThreadPool *pool) noexcept
+{
+    assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
+    assert(can_use_ntt_multiply(64 * std::min(M, N)));
+
+    static const CRTConstants crt;
+
+    // 变换规模不小于乘积的长度
+    M = std::min(M, P);
+    N = std::min(N, P);
+    const bool square = (a == b && M == N);
+    const size_t conv_len = std::min(M + N - 1, P);
+    unsigned bits = highest_bit1((uint64_t) (M + N - 1));
+    if ((1ULL << bits) < M + N - 1)
+        ++bits;
+    bits = std::max(bits, 1U);
+    assert(bits <= NTTPlan::max_bits(NUT_NTT_PRIME_COUNT - 1));
+    const size_t len = 1ULL << bits;
+
+    ntt_word_type *const buf = (ntt_word_type*) ::malloc(
+        sizeof(ntt_word_type) * len * NUT_NTT_PRIME_COUNT * (square ? 1 : 2));
+    assert(nullptr != buf);
+
+    // 各模数的变换相互独立
+    auto convolve = [=] (size_t p) {
+        const NTTPlan& plan = NTTPlan::get(bits, p);
+        const ntt_word_type m = crt.m[p], one_shoup = crt.one_shoup[p];
+        ntt_word_type *const aa = buf + len * p * (square ? 1 : 2),
+            *const bb = (square ? aa : aa + len);
+        for (size_t i = 0; i < M; ++i)
+            aa[i] = shoup_mul(a[i], 1, one_shoup, m);
+        ::memset(aa + M, 0, sizeof(ntt_word_type) * (len - M));
+        if (!square)
+        {
+            for (size_t i = 0; i < N; ++i)
+                bb[i] = shoup_mul(b[i], 1, one_shoup, m);
+            ::memset(bb + N, 0, sizeof(ntt_word_type) * (len - N));
+        }
+        plan.convolve(aa, bb);
+    };
 
-    const size_t len = 1 << bit_len;
-    for (size_t i = 0; i < len; ++i)
-        rs[i] = mul_mod<ntt_word_type>(a[i], b[i], NUT_NTT_M);
+    if (nullptr != pool)
+    {
+        parallel_for(NUT_NTT_PRIME_COUNT, pool, convolve);
+    }
+    else
+    {
+        unsigned threads = max_threads;
+        if (0 == threads)
+            threads = (len >= NUT_NTT_PARALLEL_THRESHOLD ? std::thread::hardware_concurrency() : 1);
+        threads = std::max(1U, std::min<unsigned>(threads, NUT_NTT_PRIME_COUNT));
+
+        // 各线程依次领取尚未变换的模数, 线程创建失败时由已有的线程(至少有当前线程)完成
+        std::atomic<unsigned> next(0);
+        auto work = [&] {
+            for (unsigned p = next++; p < NUT_NTT_PRIME_COUNT; p = next++)
+                convolve(p);
+        };
+        std::thread workers[NUT_NTT_PRIME_COUNT];
+        for (unsigned i = 1; i < threads; ++i)
+        {
+            try
+            {
+                workers[i] = std::thread(work);
+            }
+            catch (const std::system_error&)
+            {
+                break;
+            }
+        }
+        work();
+        for (unsigned i = 1; i < threads; ++i)
+        {
+            if (workers[i].joinable())
+                workers[i].join();
+        }
+    }
 
-    NTT_R2N(rs, bit_len);
+    // 合并: x = r0 + m0 * v1 + m0 * m1 * v2, 其中
+    //   v1 = (r1 - r0) * m0**-1 mod m1
+    //   v2 = (r2 - r0 - m0 * v1) * (m0 * m1)**-1 mod m2
+    const size_t stride = (square ? 1 : 2) * len;
+    const ntt_word_type *const r0 = buf, *const r1 = buf + stride, *const r2 = buf + 2 * stride;
+    const ntt_word_type m0 = crt.m[0], m1 = crt.m[1], m2 = crt.m[2];
+    uint64_t carry0 = 0, carry1 = 0; // 向高位的进位, 不超过 2 个字
+    for (size_t i = 0; i < conv_len; ++i)
+    {
+        const ntt_word_type v1 = shoup_mul(r1[i] + m1 - shoup_mul(r0[i], 1, crt.one_shoup[1], m1),
+                                           crt.c1, crt.c1_shoup, m1);
+        ntt_word_type s = shoup_mul(r0[i], 1, crt.one_shoup[2], m2) +
+            shoup_mul(v1, crt.m0_mod_m2, crt.m0_mod_m2_shoup, m2);
+        if (s >= m2)
+            s -= m2;
+        const ntt_word_type v2 = shoup_mul(r2[i] + m2 - s, crt.c2, crt.c2_shoup, m2);
+
+        // [l0 l1] = r0 + m0 * v1, [h0 h1 h2] = m0 * m1 * v2
+        uint64_t l1, h1, h2;
+        const uint64_t l0 = multiply_add<uint64_t>(m0, v1, r0[i], 0, &l1);
+        const uint64_t h0 = multiply_add<uint64_t>(crt.m01[0], v2, 0, 0, &h1);
+        h1 = multiply_add<uint64_t>(crt.m01[1], v2, h1, 0, &h2);
+
+        uint8_t c = 0;
+        const uint64_t s0 = add_with_carry<uint64_t>(l0, h0, &c);
+        const uint64_t s1 = add_with_carry<uint64_t>(l1, h1, &c);
+        const uint64_t s2 = add_with_carry<uint64_t>(0, h2, &c);
+        c = 0;
+        x[i] = add_with_carry<uint64_t>(s0, carry0, &c);
+        carry0 = add_with_carry<uint64_t>(s1, carry1, &c);
+        carry1 = add_with_carry<uint64_t>(s2, 0, &c);
+    }
+    ::free(buf);
+
+    if (conv_len < P)
+        x[conv_len] = carry0;
+    if (conv_len + 1 < P)
+        x[conv_len + 1] = carry1;
+    if (conv_len + 2 < P)
+        ::memset(x + conv_len + 2, 0, sizeof(uint64_t) * (P - conv_len - 2));
 }
 
 }
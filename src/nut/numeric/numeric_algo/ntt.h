@@ -55,15 +55,10 @@
 
 #include <stdint.h>
 #include <stddef.h> // for size_t
+#include <stdlib.h> // for ::malloc(), ::free()
+#include <string.h> // for ::memset()
 #include <algorithm> // for std::max()
-
-#include "../../platform/platform.h"
-
-#if NUT_PLATFORM_OS_WINDOWS
-#   include <malloc.h> // for ::alloca()
-#else
-#   include <alloca.h>
-#endif
+#include <type_traits>
 
 #include "../../nut_config.h"
 #include "../word_array_integer/word_array_integer.h"
@@ -76,6 +71,14 @@
 #define NUT_NTT_G 3
 #define NUT_NTT_M (NUT_NTT_R * (1ULL << NUT_NTT_K) + 1)
 
+// 多模数 NTT 使用的模数个数, 第 0 个模数即 M, 其余见 ntt.cpp 中的模数表
+// - 各模数之积约为 2**179.9, 64 位系数作卷积, 只要较短的乘数不超过 2**51 个字
+//   就不会溢出
+#define NUT_NTT_PRIME_COUNT 3
+
+// 多模数 NTT 中, 各模数在不同线程中分别变换的最小规模(点数)
+#define NUT_NTT_PARALLEL_THRESHOLD (1 << 15)
+
 // - 大整数拆成多项式, = a0 + a1*base + a2*pow(base,2) + a3*pow(base, 3) + ...
 // - NUT_NTT_BASE_BITS 越小, 能够处理越大的大整数, 但是多项式越长, 消耗的时间越长
 #define NUT_NTT_BASE_BYTES 3
@@ -89,6 +92,8 @@ static_assert(NUT_NTT_BASE_MAX * NUT_NTT_BASE_MAX + 1 <= NUT_NTT_M,
 namespace nut
 {
 
+class ThreadPool;
+
 typedef uint64_t ntt_word_type;
 
 static_assert(std::is_unsigned<ntt_word_type>::value,
@@ -97,7 +102,82 @@ static_assert(NUT_NTT_M <= ((~(ntt_word_type)0) >> 1), // 避免加减法操作
               "NTT word type is too short or modulo is too big");
 
 /**
- * 能否使用 NTT 乘法
+ * 预计算的 NTT 方案, 包括各层的单位根及其 Shoup 预计算值
+ *
+ * 每个模数、每个规模的方案只计算一次并一直缓存, 之后只读, 可以在多个线程中共享
+ */
+class NUT_API NTTPlan
+{
+public:
+    /**
+     * 取得规模为 2**bits 的方案
+     *
+     * @param prime 模数序号, 取值范围 [0, NUT_NTT_PRIME_COUNT)
+     */
+    static const NTTPlan& get(unsigned bits, unsigned prime = 0) noexcept;
+
+    /**
+     * 模数支持的最大变换规模 2**max_bits
+     */
+    static unsigned max_bits(unsigned prime = 0) noexcept;
+
+    unsigned get_bits() const noexcept;
+    size_t size() const noexcept;
+    ntt_word_type get_modulus() const noexcept;
+
+    /**
+     * DIF 正变换: 输入为自然顺序, 输出为二进制倒序
+     */
+    void forward(ntt_word_type *a) const noexcept;
+
+    /**
+     * DIT 逆变换: 输入为二进制倒序, 输出为自然顺序, 包含除以长度
+     */
+    void inverse(ntt_word_type *a) const noexcept;
+
+    /**
+     * 循环卷积, 逐点相乘使用蒙哥马利乘法
+     *
+     * @param a 输入, 并输出结果; 元素取值范围 [0, 模数)
+     * @param b 输入, 内容会被改写; 与 a 相同时计算平方
+     */
+    void convolve(ntt_word_type *a, ntt_word_type *b) const noexcept;
+
+private:
+    NTTPlan(unsigned bits, unsigned prime) noexcept;
+    ~NTTPlan() noexcept;
+
+    NTTPlan(const NTTPlan&) = delete;
+    NTTPlan& operator=(const NTTPlan&) = delete;
+
+    void inverse_butterfly(ntt_word_type *a) const noexcept;
+
+private:
+    unsigned _bits = 0;
+    size_t _len = 0;
+    ntt_word_type _modulus = 0;
+
+    // 蒙哥马利乘法使用的 -(modulus ** -1) mod 2**64
+    ntt_word_type _mont_inv = 0;
+
+    // _roots[2**(layer-1) + j] = omega[layer] ** j, 第 layer 层蝴蝶运算使用;
+    // _roots_shoup[i] = floor(_roots[i] * 2**64 / M). _inv_roots 用于逆变换
+    ntt_word_type *_roots = nullptr, *_roots_shoup = nullptr,
+        *_inv_roots = nullptr, *_inv_roots_shoup = nullptr;
+
+    // 长度的逆元; _inv_len_r = _inv_len * 2**64, 用于抵消蒙哥马利乘法引入的因子
+    ntt_word_type _inv_len = 0, _inv_len_shoup = 0, _inv_len_r = 0, _inv_len_r_shoup = 0;
+};
+
+/**
+ * 能否使用单模数 NTT 乘法
+ *
+ * @param bits 乘数最大 bit 数
+ */
+NUT_API bool can_use_single_modulus_ntt(size_t bits) noexcept;
+
+/**
+ * 能否使用 NTT 乘法(单模数或者多模数)
  *
  * @param bits 乘数最大 bit 数
  */
@@ -161,8 +241,85 @@ void _merge_base_bits(const ntt_word_type *src, size_t M, T *dst, size_t P) noex
 NUT_API void ntt_convolution(ntt_word_type *a, ntt_word_type *b, unsigned bit_len,
                              ntt_word_type *rs) noexcept;
 
+/**
+ * 多模数 NTT 乘法
+ *
+ * 以 2**64 为基数拆分系数, 分别在 NUT_NTT_PRIME_COUNT 个模数下作卷积, 再用中国
+ * 余数定理(Garner 算法)合并结果
+ *
+ * @param max_threads 最多使用的线程数(包括当前线程); 0 表示根据 CPU 核数以及
+ *        NUT_NTT_PARALLEL_THRESHOLD 自动决定. 新线程创建失败时, 余下的变换由已有的
+ *        线程完成
+ * @param pool 不为 nullptr 时, 各模数的变换分摊到线程池与当前线程中, 不再创建新线程,
+ *        max_threads 被忽略; 在线程池的任务中调用时应传入该线程池, 以免线程数过多
+ */
+NUT_API void ntt_crt_multiply(const uint64_t *a, size_t M, const uint64_t *b, size_t N,
+                              uint64_t *x, size_t P, unsigned max_threads = 0,
+                              ThreadPool *pool = nullptr) noexcept;
+
+/**
+ * 将 T 类型的字转换为 64 位字
+ *
+ * @return 如果不需要转换, 直接返回 a, 否则返回新分配的内存
+ */
+template <typename T>
+const uint64_t* _to_words64(const T *a, size_t M, size_t *len) noexcept
+{
+    static_assert(sizeof(T) <= sizeof(uint64_t) && 0 == sizeof(uint64_t) % sizeof(T),
+                  "Unexpected integer type");
+    if (std::is_same<T, uint64_t>::value)
+    {
+        *len = M;
+        return reinterpret_cast<const uint64_t*>(a);
+    }
+
+    const size_t per_word = sizeof(uint64_t) / sizeof(T);
+    *len = (M + per_word - 1) / per_word;
+    uint64_t *const ret = (uint64_t*) ::malloc(sizeof(uint64_t) * *len);
+    ::memset(ret, 0, sizeof(uint64_t) * *len);
+    for (size_t i = 0; i < M; ++i)
+        ret[i / per_word] |= static_cast<uint64_t>(a[i]) << (8 * sizeof(T) * (i % per_word) % 64);
+    return ret;
+}
+
+/**
+ * 多模数 NTT 乘法
+ */
+template <typename T>
+void unsigned_ntt_crt_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P,
+                               unsigned max_threads = 0, ThreadPool *pool = nullptr) noexcept
+{
+    static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
+    assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
+
+    size_t MM, NN;
+    const uint64_t *const aa = _to_words64(a, M, &MM);
+    const uint64_t *const bb = (a == b && M == N ? aa : _to_words64(b, N, &NN));
+    if (bb == aa)
+        NN = MM;
+
+    if (std::is_same<T, uint64_t>::value)
+    {
+        ntt_crt_multiply(aa, MM, bb, NN, reinterpret_cast<uint64_t*>(x), P, max_threads, pool);
+        return;
+    }
+
+    const size_t per_word = sizeof(uint64_t) / sizeof(T), PP = (P + per_word - 1) / per_word;
+    uint64_t *const xx = (uint64_t*) ::malloc(sizeof(uint64_t) * PP);
+    ntt_crt_multiply(aa, MM, bb, NN, xx, PP, max_threads, pool);
+    for (size_t i = 0; i < P; ++i)
+        x[i] = static_cast<T>(xx[i / per_word] >> (8 * sizeof(T) * (i % per_word) % 64));
+    ::free(xx);
+    if (bb != aa)
+        ::free(const_cast<uint64_t*>(bb));
+    ::free(const_cast<uint64_t*>(aa));
+}
+
 /**
  * 快速数论变换(NTT) 乘法, 时间复杂度为 O(n(log2 n))
+ *
+ * NOTE 多模数 NTT 的系数为 64 位, 变换长度只有单模数的 3/8, 三次变换的总耗时反而
+ *      更少, 且没有单模数的规模限制, 故总是使用多模数 NTT
  */
 template <typename T>
 void unsigned_ntt_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) noexcept
@@ -171,6 +328,19 @@ void unsigned_ntt_multiply(const T *a, size_t M, const T *b, size_t N, T *x, siz
     assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
 
     assert(can_use_ntt_multiply(8 * sizeof(T) * std::max(M, N)));
+    unsigned_ntt_crt_multiply(a, M, b, N, x, P);
+}
+
+/**
+ * 单模数 NTT 乘法, 乘数规模受 can_use_single_modulus_ntt() 限制
+ */
+template <typename T>
+void unsigned_single_modulus_ntt_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) noexcept
+{
+    static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
+    assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
+
+    assert(can_use_single_modulus_ntt(8 * sizeof(T) * std::max(M, N)));
 
     ntt_word_type *aa, *bb, *rs;
     const size_t wc_bits = _split_base_bits(a, M, b, N, &aa, &bb, &rs);
@@ -195,26 +365,22 @@ void signed_ntt_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_
     const bool a_neg = is_negative(a, M), b_neg = is_negative(b, N);
     T *aa = nullptr, *bb = nullptr;
     size_t MM = M, NN = N;
-    if (a_neg && b_neg)
-    {
-        ++MM;
-        ++NN;
-        aa = (T*) ::alloca(sizeof(T) * (MM + NN));
-        bb = aa + MM;
-        signed_negate(a, M, aa, MM);
-        signed_negate(b, N, bb, NN);
-    }
-    else if (a_neg)
-    {
-        ++MM;
-        aa = (T*) ::alloca(sizeof(T) * MM);
-        signed_negate(a, M, aa, MM);
-    }
-    else if (b_neg)
+    if (a_neg || b_neg)
     {
-        ++NN;
-        bb = (T*) ::alloca(sizeof(T) * NN);
-        signed_negate(b, N, bb, NN);
+        MM += (a_neg ? 1 : 0);
+        NN += (b_neg ? 1 : 0);
+        T *const buf = (T*) ::malloc(sizeof(T) * (MM + NN));
+        assert(nullptr != buf);
+        if (a_neg)
+        {
+            aa = buf;
+            signed_negate(a, M, aa, MM);
+        }
+        if (b_neg)
+        {
+            bb = buf + MM;
+            signed_negate(b, N, bb, NN);
+        }
     }
 
     // 调用 NTT 算法
@@ -224,6 +390,10 @@ void signed_ntt_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_
     // 还原符号
     if (a_neg != b_neg)
         signed_negate(x, P, x, P);
+    if (nullptr != aa)
+        ::free(aa);
+    else if (nullptr != bb)
+        ::free(bb - MM);
 }
 
 }
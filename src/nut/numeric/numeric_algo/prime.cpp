@@ -1,7 +1,18 @@
 ﻿
+#include <assert.h>
+#include <stdlib.h> // for ::malloc(), ::free()
+#include <string.h> // for ::memset(), ::memcpy(), ::memcmp()
+#include <algorithm> // for std::min(), std::lower_bound()
+#include <mutex> // for std::call_once()
+#include <vector>
+
+#include "../../threading/thread_pool.h"
+#include "../word_array_integer/word_array_integer.h"
 #include "prime.h"
 #include "bit_sieve.h"
 #include "mod.h"
+#include "montgomery.h"
+#include "prime_sieve.h"
 
 
 namespace nut
@@ -72,39 +83,181 @@ bool miller_rabin(const BigInteger& n, unsigned s) noexcept
      * Miller-Rabin 素数测试
      * 参见java语言BigInteger.passesMillerRabin()实现
      */
-    const BigInteger ONE(1), TWO(2);
+    typedef BigInteger::word_type word_type;
+
+    if (n <= 3)
+        return n >= 2;
+    else if (0 == n.bit_at(0))
+        return false;
 
     // Find a and m such that m is odd and n == 1 + 2**a * m
+    const BigInteger ONE(1);
     BigInteger this_minus_one(n);
     --this_minus_one;
     BigInteger m(this_minus_one);
-    const int a = m.lowest_bit();
+    const size_t a = m.lowest_bit();
     m >>= a;
 
+    // 各轮共用同一个蒙哥马利上下文, 后续的平方也在蒙哥马利表示下进行; 1 与 n - 1 的
+    // 蒙哥马利表示分别为 R mod n 与 n - (R mod n)
+    const MontgomeryContext ctx(n);
+    const size_t N = ctx.words_length();
+    word_type *const buf = (word_type*) ::malloc(sizeof(word_type) * (3 * N + ctx.scratch_length()));
+    word_type *const minus_one = buf, *const z = minus_one + N, *const zm = z + N,
+        *const scratch = zm + N;
+    unsigned_sub(n.data(), N, ctx.one(), N, minus_one, N);
+
     // Do the tests
-    for (size_t i = 0; i < s; ++i)
+    bool ret = true;
+    for (size_t i = 0; i < s && ret; ++i)
     {
         // Generate a uniform random in [1, n)
-        const BigInteger b = BigInteger::rand_between(ONE, n); // _rand_1_n(n);
+        const BigInteger b = BigInteger::rand_between(ONE, n);
+
+        const BigInteger y = ctx.pow(b, m);
+        if (y == ONE || y == this_minus_one)
+            continue;
 
-        int j = 0;
-        BigInteger z = pow_mod(b, m, n);
-        while (!((j == 0 && z == ONE) || z == this_minus_one))
+        ::memset(z, 0, sizeof(word_type) * N);
+        ::memcpy(z, y.data(), sizeof(word_type) * std::min<size_t>(N, y.significant_words_length()));
+        ctx.to_montgomery(z, zm, scratch);
+        size_t j = 1;
+        for (; j < a; ++j)
         {
-            if ((j > 0 && z == ONE) || ++j == a)
-                return false;
-            z = pow_mod(z, TWO, n);
+            ctx.sqr(zm, zm, scratch);
+            if (0 == ::memcmp(zm, minus_one, sizeof(word_type) * N))
+                break;
+            if (0 == ::memcmp(zm, ctx.one(), sizeof(word_type) * N))
+                j = a; // 1 的非平凡平方根, 一定是合数
         }
+        if (j >= a)
+            ret = false;
     }
-    return true;
+    ::free(buf);
+    return ret;
 #endif
 }
 
+/**
+ * 积树: 第 0 层为叶子, 之后每一层为上一层相邻两项之积, 最后一层只有一项
+ */
+static std::vector<std::vector<BigInteger>> product_tree(std::vector<BigInteger>&& leaves) noexcept
+{
+    assert(!leaves.empty());
+    std::vector<std::vector<BigInteger>> tree;
+    tree.push_back(std::move(leaves));
+    while (tree.back().size() > 1)
+    {
+        const std::vector<BigInteger>& below = tree.back();
+        std::vector<BigInteger> level((below.size() + 1) / 2);
+        for (size_t i = 0; i + 1 < below.size(); i += 2)
+            level[i / 2] = below[i] * below[i + 1];
+        if (0 != below.size() % 2)
+            level.back() = below.back();
+        tree.push_back(std::move(level));
+    }
+    return tree;
+}
+
+/**
+ * 余数树: 自顶向下依次取模, 求得 x 对各叶子的余数
+ */
+static std::vector<BigInteger> remainder_tree(const BigInteger& x,
+                                              const std::vector<std::vector<BigInteger>>& tree) noexcept
+{
+    std::vector<BigInteger> rems(1, x % tree.back().front());
+    for (size_t k = tree.size() - 1; k > 0; --k)
+    {
+        const std::vector<BigInteger>& below = tree[k - 1];
+        std::vector<BigInteger> next(below.size());
+        for (size_t i = 0; i < below.size(); ++i)
+            next[i] = rems[i / 2] % below[i];
+        rems = std::move(next);
+    }
+    return rems;
+}
+
+/**
+ * NUT_TRIAL_DIVISION_BOUND 以内的素数, 及其乘积
+ */
+static const std::vector<uint64_t>& small_primes() noexcept
+{
+    static std::vector<uint64_t> primes;
+    static std::once_flag flag;
+    std::call_once(flag, [] { primes = sieve_primes(0, NUT_TRIAL_DIVISION_BOUND); });
+    return primes;
+}
+
+static const BigInteger& small_primes_product() noexcept
+{
+    static BigInteger product;
+    static std::once_flag flag;
+    std::call_once(
+        flag,
+        [] {
+            const std::vector<uint64_t>& primes = small_primes();
+            std::vector<BigInteger> leaves;
+            leaves.reserve(primes.size());
+            for (uint64_t p : primes)
+                leaves.emplace_back((BigInteger::cast_int_type) p);
+            product = product_tree(std::move(leaves)).back().front();
+        });
+    return product;
+}
+
+NUT_API void miller_rabin(const BigInteger *candidates, size_t count, unsigned s,
+                          bool *results, ThreadPool *pool) noexcept
+{
+    assert((nullptr != candidates && nullptr != results) || 0 == count);
+    assert(s > 0);
+
+    // 小于上界的候选数直接查表; 其他的候选数用余数树试除
+    const std::vector<uint64_t>& primes = small_primes();
+    const BigInteger bound(NUT_TRIAL_DIVISION_BOUND), bound_square = bound * bound;
+    std::vector<size_t> large;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (candidates[i] < bound)
+        {
+            const BigInteger::cast_int_type v = candidates[i].to_integer();
+            results[i] = (v >= 2 && std::binary_search(primes.begin(), primes.end(), (uint64_t) v));
+        }
+        else
+        {
+            large.push_back(i);
+        }
+    }
+    if (large.empty())
+        return;
+
+    std::vector<BigInteger> leaves;
+    leaves.reserve(large.size());
+    for (size_t i : large)
+        leaves.push_back(candidates[i]);
+    const std::vector<BigInteger> rems = remainder_tree(small_primes_product(),
+                                                        product_tree(std::move(leaves)));
+
+    // 没有小素因子的候选数; 其中小于上界的平方的一定是素数
+    std::vector<size_t> survivors;
+    for (size_t k = 0; k < large.size(); ++k)
+    {
+        const size_t i = large[k];
+        results[i] = (gcd(rems[k], candidates[i]) == 1);
+        if (results[i] && candidates[i] >= bound_square)
+            survivors.push_back(i);
+    }
+
+    parallel_for(survivors.size(), pool, [&] (size_t k) {
+        const size_t i = survivors[k];
+        results[i] = miller_rabin(candidates[i], s);
+    });
+}
+
 /**
  * 取下一个可能的素数
  * 参见java语言BigInteger.nextProbablePrime()实现
  */
-NUT_API BigInteger next_prime(const BigInteger& n) noexcept
+NUT_API BigInteger next_prime(const BigInteger& n, ThreadPool *pool) noexcept
 {
     if (n <= 1)
         return BigInteger(2);
@@ -160,8 +313,8 @@ NUT_API BigInteger next_prime(const BigInteger& n) noexcept
 
     while (true)
     {
-        BitSieve search_sieve(result, (int) search_len);
-        const BigInteger candidate = search_sieve.retrieve(result, DEFAULT_PRIME_CERTAINTY);
+        BitSieve search_sieve(result, search_len);
+        const BigInteger candidate = search_sieve.retrieve(result, DEFAULT_PRIME_CERTAINTY, pool);
         if (!candidate.is_zero())
             return candidate;
         result += 2 * search_len;
@@ -11,9 +11,14 @@
 #include "gcd.h"
 
 
+// 批量素数测试中, 试除所用小素数的上界
+#define NUT_TRIAL_DIVISION_BOUND (1 << 14)
+
 namespace nut
 {
 
+class ThreadPool;
+
 /**
  * 费马小定理素数测试法, 伪素数测试
  *
@@ -24,14 +29,32 @@ NUT_API bool psedoprime(const BigInteger& n) noexcept;
 
 /**
  * 米勒-拉宾(Miller-Rabin)素数测试
+ *
+ * 各轮测试共用同一个蒙哥马利上下文
+ *
+ * @param s 测试轮数
  */
 NUT_API bool miller_rabin(const BigInteger& n, unsigned s) noexcept;
 
+/**
+ * 批量米勒-拉宾(Miller-Rabin)素数测试
+ *
+ * 先用积树一次求出 NUT_TRIAL_DIVISION_BOUND 以内的素数之积对各候选数的余数, 再与
+ * 候选数求最大公约数, 筛去含有小素因子的候选数; 余下的候选数分摊到线程池中测试
+ *
+ * @param results 输出各候选数是否(可能)为素数
+ * @param pool 为 nullptr 时在当前线程中测试
+ */
+NUT_API void miller_rabin(const BigInteger *candidates, size_t count, unsigned s,
+                          bool *results, ThreadPool *pool = nullptr) noexcept;
+
 /**
  * 取下一个可能的素数
  * 参见java语言BigInteger.nextProbablePrime()实现
+ *
+ * @param pool 不为 nullptr 时, 筛选后的候选数分摊到线程池中测试
  */
-NUT_API BigInteger next_prime(const BigInteger& n) noexcept;
+NUT_API BigInteger next_prime(const BigInteger& n, ThreadPool *pool = nullptr) noexcept;
 
 /**
  * a, n 互质，计算 a 的乘法逆元 (mod n)
@@ -0,0 +1,150 @@
+﻿
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h> // for ::malloc(), ::free()
+#include <string.h> // for ::memset()
+#include <algorithm> // for std::min(), std::max()
+
+#include "../../threading/thread_pool.h"
+#include "../word_array_integer/bit_op.h"
+#include "prime_sieve.h"
+
+
+// 以下规模的基础素数直接用普通的奇数筛法求得
+#define SIMPLE_SIEVE_LIMIT (1 << 16)
+
+namespace nut
+{
+
+// 与 30 互质的余数, 及其在字节中对应的比特
+static const uint8_t WHEEL[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+static const int8_t WHEEL_INDEX[30] = {
+    -1, 0, -1, -1, -1, -1, -1, 1, -1, -1, -1, 2, -1, 3, -1,
+    -1, -1, 4, -1, 5, -1, -1, -1, 6, -1, -1, -1, -1, -1, 7,
+};
+
+/**
+ * 普通的奇数筛法, 求 [7, limit) 之间的素数
+ */
+static std::vector<uint64_t> simple_sieve(uint64_t limit) noexcept
+{
+    std::vector<uint64_t> ret;
+    if (limit <= 7)
+        return ret;
+
+    // composite[i] 表示 2 * i + 1 是否为合数
+    std::vector<bool> composite(limit / 2, false);
+    for (uint64_t i = 1; (2 * i + 1) * (2 * i + 1) < limit; ++i)
+    {
+        if (composite[i])
+            continue;
+        const uint64_t p = 2 * i + 1;
+        for (uint64_t j = p * p / 2; j < limit / 2; j += p)
+            composite[j] = true;
+    }
+    for (uint64_t i = 3; i < limit / 2; ++i)
+    {
+        if (!composite[i] && 2 * i + 1 < limit)
+            ret.push_back(2 * i + 1);
+    }
+    return ret;
+}
+
+/**
+ * 筛选一段, 第 i 个字节的第 j 个比特表示 seg_lo + 30 * i + WHEEL[j] 是否为素数
+ *
+ * @param seg_lo 30 的倍数
+ * @param base [7, sqrt(seg_lo + 30 * bytes)] 之间的所有素数
+ */
+static void sieve_segment(uint64_t seg_lo, size_t bytes, const std::vector<uint64_t>& base,
+                          uint8_t *seg) noexcept
+{
+    assert(0 == seg_lo % 30);
+    ::memset(seg, 0xff, bytes);
+    if (0 == seg_lo)
+        seg[0] &= ~1; // 1 不是素数
+
+    const uint64_t seg_hi = seg_lo + 30 * bytes;
+    for (uint64_t p : base)
+    {
+        if (p * p >= seg_hi)
+            break;
+
+        // 筛去 p * k, 其中 k >= p 且 k 与 30 互质; k 按余数分为 8 类, 每一类中相邻
+        // 的倍数相差 30 * p, 即 p 个字节, 且落在同一个比特上
+        const uint64_t k0 = std::max(p, (seg_lo + p - 1) / p);
+        for (unsigned i = 0; i < 8; ++i)
+        {
+            uint64_t k = k0 - k0 % 30 + WHEEL[i];
+            if (k < k0)
+                k += 30;
+            const uint64_t m = p * k;
+            if (m >= seg_hi)
+                continue;
+
+            const uint8_t mask = ~(1 << WHEEL_INDEX[m % 30]);
+            for (size_t j = (m - seg_lo) / 30; j < bytes; j += p)
+                seg[j] &= mask;
+        }
+    }
+}
+
+NUT_API std::vector<uint64_t> sieve_primes(uint64_t lo, uint64_t hi, ThreadPool *pool) noexcept
+{
+    assert(hi <= (1ULL << 63));
+
+    std::vector<uint64_t> ret;
+    for (uint64_t p : {2, 3, 5})
+    {
+        if (lo <= p && p < hi)
+            ret.push_back(p);
+    }
+    if (hi <= 7 || lo >= hi)
+        return ret;
+
+    // 基础素数, 不超过 sqrt(hi)
+    uint64_t sqrt_hi = (uint64_t) ::sqrt((double) hi);
+    while (sqrt_hi * sqrt_hi > hi)
+        --sqrt_hi;
+    while ((sqrt_hi + 1) * (sqrt_hi + 1) <= hi)
+        ++sqrt_hi;
+    std::vector<uint64_t> base;
+    if (sqrt_hi < SIMPLE_SIEVE_LIMIT)
+    {
+        base = simple_sieve(sqrt_hi + 1);
+    }
+    else
+    {
+        base = sieve_primes(7, sqrt_hi + 1, pool);
+        assert(base.empty() || 7 == base.front());
+    }
+
+    // 分段; 各段的结果分别存放, 最后按顺序合并
+    const uint64_t first = lo / 30 * 30, segment_span = 30 * (uint64_t) NUT_SIEVE_SEGMENT_BYTES;
+    const size_t segments = (size_t) ((hi - first + segment_span - 1) / segment_span);
+    std::vector<std::vector<uint64_t>> results(segments);
+    parallel_for(segments, pool, [&] (size_t i) {
+        const uint64_t seg_lo = first + i * segment_span;
+        const size_t bytes = (size_t) std::min<uint64_t>(NUT_SIEVE_SEGMENT_BYTES, (hi - seg_lo + 29) / 30);
+        uint8_t *const seg = (uint8_t*) ::malloc(bytes);
+        sieve_segment(seg_lo, bytes, base, seg);
+
+        std::vector<uint64_t>& primes = results[i];
+        for (size_t j = 0; j < bytes; ++j)
+        {
+            for (uint8_t b = seg[j]; 0 != b; b &= b - 1)
+            {
+                const uint64_t n = seg_lo + 30 * j + WHEEL[lowest_bit1(b)];
+                if (lo <= n && n < hi)
+                    primes.push_back(n);
+            }
+        }
+        ::free(seg);
+    });
+
+    for (std::vector<uint64_t>& primes : results)
+        ret.insert(ret.end(), primes.begin(), primes.end());
+    return ret;
+}
+
+}
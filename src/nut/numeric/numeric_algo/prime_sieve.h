@@ -0,0 +1,34 @@
+﻿
+#ifndef ___HEADFILE_096D559D_626A_4FE9_BC09_CEFFBDBF551F_
+#define ___HEADFILE_096D559D_626A_4FE9_BC09_CEFFBDBF551F_
+
+#include <stdint.h>
+#include <vector>
+
+#include "../../nut_config.h"
+
+
+// 分段筛法每段的字节数, 取 L1 数据缓存的大小; 每个字节对应 30 个整数
+#define NUT_SIEVE_SEGMENT_BYTES (32 * 1024)
+
+namespace nut
+{
+
+class ThreadPool;
+
+/**
+ * 分段埃拉托斯特尼(Eratosthenes)筛法, 求 [lo, hi) 之间的所有素数
+ *
+ * - 以 30 为轮(wheel-30)压缩: 每个字节表示 30 个连续整数中与 30 互质的 8 个,
+ *   只需普通位图的 8/30 的内存, 且不用筛 2、3、5 的倍数
+ * - 按 L1 缓存大小分段, 各段相互独立, 可以分摊到线程池中并行筛选
+ *
+ * @param hi 不超过 2**63
+ * @param pool 为 nullptr 时在当前线程中筛选
+ * @return 从小到大排列的素数
+ */
+NUT_API std::vector<uint64_t> sieve_primes(uint64_t lo, uint64_t hi, ThreadPool *pool = nullptr) noexcept;
+
+}
+
+#endif
@@ -0,0 +1,170 @@
+﻿
+#include <assert.h>
+#include <stdlib.h> // for ::malloc(), ::free()
+#include <string.h> // for ::memset(), ::memcpy()
+#include <algorithm> // for std::min(), std::max()
+
+#include "../word_array_integer/div_op.h"
+#include "recursive_divide.h"
+
+
+#define WORD_BITS (8 * sizeof(BigInteger::word_type))
+
+namespace nut
+{
+
+typedef BigInteger::word_type word_type;
+
+/**
+ * 取非负数 a 的 [lo, lo + len) 字组成的非负数
+ */
+static BigInteger words_of(const BigInteger& a, size_t lo, size_t len) noexcept
+{
+    assert(a.is_positive());
+    const size_t siglen = a.significant_words_length();
+    if (lo >= siglen)
+        return BigInteger();
+    len = std::min(len, siglen - lo);
+    return BigInteger(a.data() + lo, sizeof(word_type) * len, false);
+}
+
+/**
+ * 非负数逐字试商
+ */
+static void schoolbook_divide(const BigInteger& a, const BigInteger& b, BigInteger *q, BigInteger *r) noexcept
+{
+    assert(a.is_positive() && b.is_positive());
+    const size_t M = a.significant_words_length(), N = b.significant_words_length();
+    word_type *const buf = (word_type*) ::malloc(sizeof(word_type) * (M + N));
+    unsigned_divide(a.data(), M, b.data(), N, buf, M, buf + M, N);
+    q->set(buf, sizeof(word_type) * M, false);
+    r->set(buf + M, sizeof(word_type) * N, false);
+    ::free(buf);
+}
+
+static void divide_3n_2n(const BigInteger& a, const BigInteger& b, size_t half,
+                         BigInteger *q, BigInteger *r) noexcept;
+
+/**
+ * 2n/n 字的除法
+ *
+ * @pre b 恰好 n 个字且最高位为 1(规格化), a < b * β^n
+ */
+static void divide_2n_1n(const BigInteger& a, const BigInteger& b, size_t n,
+                         BigInteger *q, BigInteger *r) noexcept
+{
+    if (0 != (n & 1) || n < NUT_BURNIKEL_ZIEGLER_THRESHOLD)
+    {
+        schoolbook_divide(a, b, q, r);
+        return;
+    }
+
+    // a = [a1 a2 a3 a4], 每块 n/2 个字
+    const size_t half = n / 2;
+    BigInteger q1, r1, q2;
+    divide_3n_2n(a >> (half * WORD_BITS), b, half, &q1, &r1);
+    divide_3n_2n((r1 << (half * WORD_BITS)) + words_of(a, 0, half), b, half, &q2, r);
+    *q = (q1 << (half * WORD_BITS)) + q2;
+}
+
+/**
+ * 3/2 分块的除法
+ *
+ * @pre a = [a1 a2 a3], b = [b1 b2], 每块 half 个字; b 规格化, a < b * β^half
+ */
+static void divide_3n_2n(const BigInteger& a, const BigInteger& b, size_t half,
+                         BigInteger *q, BigInteger *r) noexcept
+{
+    const size_t shift = half * WORD_BITS;
+    const BigInteger a12 = a >> shift, b1 = b >> shift;
+
+    // 用 [a1 a2] / b1 估商, 至多偏大 2
+    BigInteger qq, r1;
+    if ((a12 >> shift) < b1)
+    {
+        divide_2n_1n(a12, b1, half, &qq, &r1);
+    }
+    else
+    {
+        // qq = β^half - 1
+        qq = (BigInteger(1) << shift) - 1;
+        r1 = a12 - (b1 << shift) + b1;
+    }
+
+    BigInteger rr = (r1 << shift) + words_of(a, 0, half) - qq * words_of(b, 0, half);
+    while (rr.is_negative())
+    {
+        rr += b;
+        qq -= 1;
+    }
+    *q = std::move(qq);
+    *r = std::move(rr);
+}
+
+/**
+ * 非负数的递归除法
+ */
+static void unsigned_bz_divide(const BigInteger& a, const BigInteger& b, BigInteger *q, BigInteger *r) noexcept
+{
+    assert(a.is_positive() && b.is_positive() && !b.is_zero());
+
+    // 分块大小 n = j * 2^k, 其中 j < NUT_BURNIKEL_ZIEGLER_THRESHOLD, 保证递归到底层
+    // 之前 n 都是偶数
+    const size_t s = (b.bit_length() + WORD_BITS - 1) / WORD_BITS;
+    size_t m = 1;
+    while (m * NUT_BURNIKEL_ZIEGLER_THRESHOLD <= s)
+        m <<= 1;
+    const size_t n = (s + m - 1) / m * m;
+
+    // 规格化, 使除数恰好 n 个字且最高位为 1
+    const size_t sigma = n * WORD_BITS - b.bit_length();
+    const BigInteger bs = b << sigma, as = a << sigma;
+
+    // 被除数拆分为 t 块, 最高块的最高位为 0, 保证 z < bs * β^n
+    const size_t t = std::max<size_t>(2, (as.bit_length() + 1 + n * WORD_BITS - 1) / (n * WORD_BITS));
+
+    word_type *const qbuf = (word_type*) ::malloc(sizeof(word_type) * (t - 1) * n);
+    ::memset(qbuf, 0, sizeof(word_type) * (t - 1) * n);
+    BigInteger z = words_of(as, (t - 2) * n, 2 * n), qi, ri;
+    for (size_t i = t - 1; i > 0; --i)
+    {
+        divide_2n_1n(z, bs, n, &qi, &ri);
+
+        // 商的第 i - 1 块
+        assert(qi.is_positive());
+        const size_t qlen = std::min(qi.significant_words_length(), n);
+        ::memcpy(qbuf + (i - 1) * n, qi.data(), sizeof(word_type) * qlen);
+
+        if (i > 1)
+            z = (ri << (n * WORD_BITS)) + words_of(as, (i - 2) * n, n);
+    }
+
+    if (nullptr != q)
+        q->set(qbuf, sizeof(word_type) * (t - 1) * n, false);
+    if (nullptr != r)
+        *r = ri >> sigma;
+    ::free(qbuf);
+}
+
+NUT_API void burnikel_ziegler_divide(const BigInteger& a, const BigInteger& b, BigInteger *result,
+                                     BigInteger *remainder) noexcept
+{
+    assert(nullptr != result || nullptr != remainder);
+    assert(!b.is_zero());
+
+    // 取绝对值; NOTE result、remainder 可能与 a、b 相同
+    const bool a_neg = a.is_negative(), b_neg = b.is_negative();
+    BigInteger q, r;
+    if (a_neg || b_neg)
+        unsigned_bz_divide(a_neg ? -a : a, b_neg ? -b : b, &q, &r);
+    else
+        unsigned_bz_divide(a, b, &q, &r);
+
+    // 商向 0 取整, 余数与被除数同号
+    if (nullptr != result)
+        *result = (a_neg != b_neg ? -q : std::move(q));
+    if (nullptr != remainder)
+        *remainder = (a_neg ? -r : std::move(r));
+}
+
+}
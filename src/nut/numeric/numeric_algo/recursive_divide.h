@@ -0,0 +1,42 @@
+﻿
+#ifndef ___HEADFILE_E05562F4_2B00_464A_AEAB_1C7096F235CC_
+#define ___HEADFILE_E05562F4_2B00_464A_AEAB_1C7096F235CC_
+
+#include "../../nut_config.h"
+#include "../big_integer.h"
+
+
+/**
+ * 除数规模(以字为单位)较小时, 递归除法退化使用 Knuth 算法 D; BigInteger::divide()
+ * 在除数不小于该值的两倍时(至少递归一层)才使用递归除法
+ *
+ * NOTE 这个边界值由 TestRecursiveDivideBenchmark::test_calibrate 测得
+ */
+#define NUT_BURNIKEL_ZIEGLER_THRESHOLD 320
+
+/**
+ * 被除数比除数多出的字数较少时, 商很短, 直接使用 Knuth 算法 D
+ */
+#define NUT_BURNIKEL_ZIEGLER_OFFSET 40
+
+namespace nut
+{
+
+/**
+ * Burnikel-Ziegler 递归除法, 时间复杂度为 O(K(n) log n), 其中 K(n) 为乘法的时间
+ * 复杂度
+ *
+ * 将 2n/n 字的除法拆分为两次 3/2 分块的除法, 后者又拆分为一次 2n/n 字的除法和一次
+ * 乘法, 从而利用快速乘法
+ *
+ * 商向 0 取整, 余数与被除数同号
+ *
+ * @param result 商, 可以为 nullptr
+ * @param remainder 余数, 可以为 nullptr
+ */
+NUT_API void burnikel_ziegler_divide(const BigInteger& a, const BigInteger& b, BigInteger *result,
+                                     BigInteger *remainder) noexcept;
+
+}
+
+#endif
@@ -3,19 +3,16 @@
 #define ___HEADFILE_1D880997_973C_431B_AC94_E18F107D26F1_
 
 #include <assert.h>
+#include <stdlib.h> // for ::malloc(), ::free()
 #include <string.h> // for memset(), memcpy(), memmove()
 #include <algorithm>
 #include <type_traits>
 
 #include "../../platform/platform.h"
 
-#if NUT_PLATFORM_OS_WINDOWS
-#   include <malloc.h> // for ::alloca()
-#else
-#   include <alloca.h>
-#endif
-
 #include "shift_op.h"
+#include "bit_op.h"
+#include "word_op.h"
 #include "word_array_integer.h"
 
 
@@ -23,128 +20,139 @@ namespace nut
 {
 
 /**
- * (有符号数)相除
+ * (无符号数)除以单字
+ * x<N> = a<N> / b
+ *
+ * @param x 商, 可以与 a 相同
+ * @return 余数
+ */
+template <typename T>
+T unsigned_divide_word(const T *a, size_t N, T b, T *x) noexcept
+{
+    static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
+    assert(nullptr != a && N > 0 && 0 != b && nullptr != x);
+    typedef typename StdInt<T>::double_unsigned_type dword_type;
+
+    T rem = 0;
+    for (size_t i = N; i > 0; --i)
+    {
+        const dword_type cur = (static_cast<dword_type>(rem) << (8 * sizeof(T))) | a[i - 1];
+        x[i - 1] = static_cast<T>(cur / b);
+        rem = static_cast<T>(cur % b);
+    }
+    return rem;
+}
+
+/**
+ * (无符号数)相除, Knuth 算法 D, 逐字试商
  * x<P> = a<M> / b<N>
  * y<Q> = a<M> % b<N>
  *
- * @param x 商
- * @param y 余数
+ * @param x 商, 可以为 nullptr
+ * @param y 余数, 可以为 nullptr
  */
 template <typename T>
-void signed_divide(const T *a, size_t M, const T *b, size_t N, T *x, size_t P, T *y, size_t Q) noexcept
+void unsigned_divide(const T *a, size_t M, const T *b, size_t N, T *x, size_t P, T *y, size_t Q) noexcept
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != a && M > 0 && nullptr != b && N > 0);
     assert((nullptr != x && P > 0) || (nullptr != y && Q > 0));
     assert(nullptr == x || P == 0 || nullptr == y || Q == 0 || y >= x + P || x >= y + Q); // 避免区域交叉覆盖
     assert(!is_zero(b, N)); // 被除数不能为0
+    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
-    // 常量
-    const size_t dividend_len = signed_significant_size(a, M);
-    const size_t divisor_len = signed_significant_size(b, N);
-    const bool dividend_positive = is_positive(a, M); /// 先把变量算出来，避免操作数被破坏
-    const bool divisor_positive = is_positive(b, N);
-    const size_t quotient_len = std::min(P, dividend_len);
-
-    // 避免输入数据在计算中途被破坏
-    const bool alloc_quotient = (nullptr != x &&
-                                 ((a - P < x && x < a) ||
-                                  (b - P < x && x < b + N))); // 兼容 x==a 的情况
-    const bool alloc_remainder = (nullptr == y || Q < divisor_len ||
-                                  (a - Q < y && y < a + M) ||
-                                  (b - Q < y && y < b + N));
-    T *quotient = x; // 商, 可以为 nullptr
-    T *remainder = y; // 余数, 不能为 nullptr
-    if (alloc_quotient && alloc_remainder)
-    {
-        quotient = (T*) ::alloca(sizeof(T) * (quotient_len + divisor_len));
-        remainder = quotient + quotient_len;
-    }
-    else if (alloc_quotient)
+    const size_t m = unsigned_significant_size(a, M), n = unsigned_significant_size(b, N);
+
+    // 被除数小于除数
+    if (m < n || (m == n && unsigned_compare(a, m, b, n) < 0))
     {
-        quotient = (T*) ::alloca(sizeof(T) * (quotient_len));
+        // NOTE 先写余数, 兼容 x==a 的情况
+        if (nullptr != y)
+            unsigned_expand(a, m, y, Q);
+        if (nullptr != x)
+            ::memset(x, 0, sizeof(T) * P);
+        return;
     }
-    else if (alloc_remainder)
+
+    // 临时空间: 商 q, 规格化后的被除数 u 和除数 v
+    // NOTE 规模不受限制, 不使用 alloca()
+    const size_t qlen = m - n + 1;
+    T *const q = (T*) ::malloc(sizeof(T) * (qlen + m + 1 + n));
+    T *const u = q + qlen, *const v = u + m + 1;
+
+    if (1 == n)
     {
-        remainder = (T*) ::alloca(sizeof(T) * divisor_len);
+        // 除数只有一个字
+        const T rem = unsigned_divide_word(a, m, b[0], u);
+        if (nullptr != y)
+        {
+            ::memset(y, 0, sizeof(T) * Q);
+            y[0] = rem;
+        }
+        if (nullptr != x)
+            unsigned_expand(u, qlen, x, P);
+        ::free(q);
+        return;
     }
 
-    // 逐位试商
-    ::memset(remainder, (dividend_positive ? 0 : 0xFF), sizeof(T) * divisor_len); // 初始化余数
-    bool remainder_positive = dividend_positive; // 余数的符号
-    bool quotient_positive = true; // 商的符号
-    for (size_t i = 0; i < dividend_len; ++i)
+    // 规格化, 使除数最高位为 1, 试商至多偏大 2
+    const int shift = 8 * sizeof(T) - 1 - highest_bit1(b[n - 1]);
+    unsigned_shift_left(b, n, v, n, shift);
+    unsigned_shift_left(a, m, u, m + 1, shift);
+
+    const T vh = v[n - 1], vl = v[n - 2];
+    for (size_t j = qlen; j > 0; --j)
     {
-        const size_t dividend_word_pos = dividend_len - i - 1;
-        const T next_dividend_word = a[dividend_word_pos]; // 余数左移时的低位补位部分
-        if (nullptr != quotient && dividend_word_pos < P)
-            quotient[dividend_word_pos] = 0; // 初始化商，注意，兼容 x==a 的情况
+        T *const uj = u + j - 1;
 
-        for (size_t j = 0; j < 8 * sizeof(T); ++j)
+        // 试商
+        const dword_type num = (static_cast<dword_type>(uj[n]) << (8 * sizeof(T))) | uj[n - 1];
+        dword_type qhat = num / vh, rhat = num % vh;
+        while ((qhat >> (8 * sizeof(T))) != 0 ||
+               qhat * vl > ((rhat << (8 * sizeof(T))) | uj[n - 2]))
         {
-            // 余数左移1位
-            signed_shift_left(remainder, divisor_len, remainder, divisor_len, 1);
-            remainder[0] |= (next_dividend_word >> (8 * sizeof(T) - 1 - j)) & 0x01;
-
-            // 加上/减去除数
-            if (remainder_positive == divisor_positive)
-                signed_sub(remainder, divisor_len, b, divisor_len, remainder, divisor_len);
-            else
-                signed_add(remainder, divisor_len, b, divisor_len, remainder, divisor_len);
-
-            // 试商结果
-            remainder_positive = is_positive(remainder, divisor_len);
-            if (remainder_positive == divisor_positive)
-            {
-                if (nullptr != quotient && dividend_word_pos < P)
-                    quotient[dividend_word_pos] |= (1 << (8 * sizeof(T) - 1 - j));
-                if (0 == i && 0 == j)
-                    quotient_positive = false;
-            }
+            --qhat;
+            rhat += vh;
+            if ((rhat >> (8 * sizeof(T))) != 0)
+                break;
         }
-    }
 
-    /**
-        修正补数形式的商:
-        如果除尽且除数为负数，则商加1
-        如果未除尽且商为负数，则商加1
-    */
-    const bool remainder_is_zero = is_zero(remainder, divisor_len);
-    if (nullptr != x)
-    {
-        assert(nullptr != quotient);
-        if (remainder_is_zero)
+        // 乘减: uj<n+1> -= qhat * v<n>
+        const T qw = static_cast<T>(qhat);
+        T mul_carry = 0;
+        uint8_t carry = 1;
+        for (size_t i = 0; i < n; ++i)
         {
-            if (!divisor_positive)
-                increase(quotient, quotient_len);
+            const T p = multiply_add<T>(qw, v[i], mul_carry, 0, &mul_carry);
+            uj[i] = add_with_carry<T>(uj[i], static_cast<T>(~p), &carry);
         }
-        else
+        uj[n] = add_with_carry<T>(uj[n], static_cast<T>(~mul_carry), &carry);
+
+        // 试商偏大 1, 加回
+        q[j - 1] = qw;
+        if (0 == carry)
         {
-            if (!quotient_positive)
-                increase(quotient, quotient_len);
+            --q[j - 1];
+            carry = 0;
+            for (size_t i = 0; i < n; ++i)
+                uj[i] = add_with_carry<T>(uj[i], v[i], &carry);
+            uj[n] += carry;
         }
-        signed_expand(quotient, quotient_len, x, P);
     }
 
-    /**
-        恢复余数:
-        如果未除尽且余数符号与被除数不一致，余数需加修正
-    */
+    // NOTE 先写余数, 兼容 x==a 的情况
     if (nullptr != y)
     {
-        if (!remainder_is_zero && remainder_positive != dividend_positive)
-        {
-            if (divisor_positive == dividend_positive)
-                signed_add(remainder, divisor_len, b, divisor_len, remainder, divisor_len);
-            else
-                signed_sub(remainder, divisor_len, b, divisor_len, remainder, divisor_len);
-        }
-        signed_expand(remainder, divisor_len, y, Q);
+        unsigned_shift_right(u, n, u, n, shift);
+        unsigned_expand(u, n, y, Q);
     }
+    if (nullptr != x)
+        unsigned_expand(q, qlen, x, P);
+    ::free(q);
 }
 
 /**
- * (无符号数)相除
+ * (有符号数)相除, 商向 0 取整, 余数与被除数同号
  * x<P> = a<M> / b<N>
  * y<Q> = a<M> % b<N>
  *
@@ -152,7 +160,7 @@ void signed_divide(const T *a, size_t M, const T *b, size_t N, T *x, size_t P, T
  * @param y 余数
  */
 template <typename T>
-void unsigned_divide(const T *a, size_t M, const T *b, size_t N, T *x, size_t P, T *y, size_t Q) noexcept
+void signed_divide(const T *a, size_t M, const T *b, size_t N, T *x, size_t P, T *y, size_t Q) noexcept
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != a && M > 0 && nullptr != b && N > 0);
@@ -160,77 +168,40 @@ void unsigned_divide(const T *a, size_t M, const T *b, size_t N, T *x, size_t P,
     assert(nullptr == x || P == 0 || nullptr == y || Q == 0 || y >= x + P || x >= y + Q); // 避免区域交叉覆盖
     assert(!is_zero(b, N)); // 被除数不能为0
 
-    // 常量
-    const size_t dividend_len = unsigned_significant_size(a, M);
-    const size_t divisor_len = unsigned_significant_size(b, N);
-    const size_t quotient_len = std::min(P, dividend_len);
-
-    // 避免数据在计算中途被破坏
-    const bool alloc_quotient = (nullptr != x &&
-                                 ((a - P < x && x < a) ||
-                                  (b - P < x && x < b + N))); // 兼容 x==a 的情况
-    const bool alloc_remainder = (nullptr == y || Q < divisor_len ||
-                                  (a - Q < y && y < a + M) ||
-                                  (b - Q < y && y < b + N));
-    T *quotient = x; // 商，可以为 nullptr
-    T *remainder = y; // 余数，不能为 nullptr
-    if (alloc_quotient && alloc_remainder)
-    {
-        quotient = (T*) ::alloca(sizeof(T) * (quotient_len + divisor_len));
-        remainder = quotient + quotient_len;
-    }
-    else if (alloc_quotient)
-    {
-        quotient = (T*) ::alloca(sizeof(T) * quotient_len);
-    }
-    else if (alloc_remainder)
-    {
-        remainder = (T*) ::alloca(sizeof(T) * divisor_len);
-    }
+    // 取绝对值后按无符号数相除
+    const bool dividend_positive = is_positive(a, M); /// 先把变量算出来，避免操作数被破坏
+    const bool divisor_positive = is_positive(b, N);
+    T *const buf = (T*) ::malloc(sizeof(T) * (M + N + 2));
+    T *const abs_a = buf, *const abs_b = buf + M + 1;
+    if (dividend_positive)
+        unsigned_expand(a, M, abs_a, M + 1);
+    else
+        signed_negate(a, M, abs_a, M + 1);
+    if (divisor_positive)
+        unsigned_expand(b, N, abs_b, N + 1);
+    else
+        signed_negate(b, N, abs_b, N + 1);
+
+    // NOTE 商和余数都是非负数, 多留一个字给符号位
+    unsigned_divide(abs_a, M + 1, abs_b, N + 1,
+                    (nullptr == x ? nullptr : abs_a), (nullptr == x ? 0 : M + 1),
+                    (nullptr == y ? nullptr : abs_b), (nullptr == y ? 0 : N + 1));
 
-    // 逐位试商
-    ::memset(remainder, 0, sizeof(T) * divisor_len); // 初始化余数
-    bool remainder_positive = true;
-    for (size_t i = 0; i < dividend_len; ++i)
+    if (nullptr != y)
     {
-        const size_t dividend_word_pos = dividend_len - i - 1;
-        const T next_dividend_word = a[dividend_word_pos]; // 余数左移时的低位补位部分
-        if (nullptr != quotient && dividend_word_pos < P)
-            quotient[dividend_word_pos] = 0; // 初始化商，注意，兼容 x==a 的情况
-
-        for (size_t j = 0; j < 8 * sizeof(T); ++j)
-        {
-            // 余数左移1位
-            unsigned_shift_left(remainder, divisor_len, remainder, divisor_len, 1);
-            remainder[0] |= (next_dividend_word >> (8 * sizeof(T) - 1 - j)) & 0x01;
-
-            // 加上/减去除数
-            if (remainder_positive)
-                unsigned_sub(remainder, divisor_len, b, divisor_len, remainder, divisor_len);
-            else
-                unsigned_add(remainder, divisor_len, b, divisor_len, remainder, divisor_len);
-
-            // 试商结果
-            remainder_positive = is_positive(remainder, divisor_len);
-            if (remainder_positive && nullptr != quotient && dividend_word_pos < P)
-                quotient[dividend_word_pos] |= (1 << (8 * sizeof(T) - 1 - j));
-        }
+        if (dividend_positive)
+            signed_expand(abs_b, N + 1, y, Q);
+        else
+            signed_negate(abs_b, N + 1, y, Q);
     }
-
-    // 商
     if (nullptr != x)
-        unsigned_expand(quotient, quotient_len, x, P);
-
-    /**
-        恢复余数:
-        如果未除尽且余数符号与被除数不一致，余数需加上除数
-    */
-    if (nullptr != y)
     {
-        if (!is_zero(remainder, divisor_len) && !remainder_positive)
-            unsigned_add(remainder, divisor_len, b, divisor_len, remainder, divisor_len);
-        unsigned_expand(remainder, divisor_len, y, Q);
+        if (dividend_positive == divisor_positive)
+            signed_expand(abs_a, M + 1, x, P);
+        else
+            signed_negate(abs_a, M + 1, x, P);
     }
+    ::free(buf);
 }
 
 }
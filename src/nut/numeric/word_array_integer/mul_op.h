@@ -27,6 +27,7 @@ namespace nut
 
 /**
  * (无符号数/正数)平方优化
+ * x<N> = a<M> * a<M>
  *
  *               a  b  c  d  e
  *          *    a  b  c  d  e
@@ -54,8 +55,6 @@ void _unsigned_square(const T *a, size_t M, T *x, size_t N) noexcept
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != a && M > 0 && nullptr != x && N > 0);
-    assert(is_positive(a, M));
-    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
     // 避免区域交叉覆盖
     T *retx = x;
@@ -69,25 +68,13 @@ void _unsigned_square(const T *a, size_t M, T *x, size_t N) noexcept
         if (i * 2 + 1 >= N)
             break;
 
-        const dword_type op1 = a[i];
+        const T op1 = a[i];
         if (0 == op1)
             continue;
 
         T carry = 0;
         for (size_t j = i + 1; j < M && i + j < N; ++j)
-        {
-            dword_type op2 = a[j];
-            op2 = op1 * op2 + retx[i + j] + carry;
-
-            retx[i + j] = static_cast<T>(op2);
-#if NUT_ENDIAN_LITTLE_BYTE
-            carry = reinterpret_cast<const T*>(&op2)[1];
-#elif NUT_ENDIAN_BIG_BYTE
-            carry = reinterpret_cast<const T*>(&op2)[0];
-#else
-            carry = static_cast<T>(op2 >> (8 * sizeof(T)));
-#endif
-        }
+            retx[i + j] = multiply_add<T>(op1, a[j], retx[i + j], carry, &carry);
         if (i + M < N)
             retx[i + M] = carry;
     }
@@ -103,31 +90,12 @@ void _unsigned_square(const T *a, size_t M, T *x, size_t N) noexcept
         if (i * 2 >= N)
             break;
 
-        dword_type op = a[i];
-        op = op * op + retx[i * 2] + carry;
-
-        retx[i * 2] = static_cast<T>(op);
-#if NUT_ENDIAN_LITTLE_BYTE
-        carry = reinterpret_cast<const T*>(&op)[1];
-#elif NUT_ENDIAN_BIG_BYTE
-        carry = reinterpret_cast<const T*>(&op)[0];
-#else
-        carry = static_cast<T>(op >> (8 * sizeof(T)));
-#endif
-
+        retx[i * 2] = multiply_add<T>(a[i], a[i], retx[i * 2], carry, &carry);
         if (0 != carry && i * 2 + 1 < N)
         {
-            op = retx[i * 2 + 1];
-            op += carry;
-
-            retx[i * 2 + 1] = static_cast<T>(op);
-#if NUT_ENDIAN_LITTLE_BYTE
-            carry = reinterpret_cast<const T*>(&op)[1];
-#elif NUT_ENDIAN_BIG_BYTE
-            carry = reinterpret_cast<const T*>(&op)[0];
-#else
-            carry = static_cast<T>(op >> (8 * sizeof(T)));
-#endif
+            uint8_t c = 0;
+            retx[i * 2 + 1] = add_with_carry<T>(retx[i * 2 + 1], carry, &c);
+            carry = c;
         }
     }
 
@@ -145,7 +113,6 @@ void signed_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P)
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
-    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
     if (a == b && M == N && is_positive(a, M))
     {
@@ -167,7 +134,7 @@ void signed_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P)
         if (i >= M && 0 == filla)
             break;
 
-        const dword_type mult1 = (i < M ? a[i] : filla);
+        const T mult1 = (i < M ? a[i] : filla);
         if (0 == mult1)
             continue;
 
@@ -177,17 +144,7 @@ void signed_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t P)
             if (j >= N && 0 == fillb && 0 == carry)
                 break;
 
-            dword_type mult2 = (j < N ? b[j] : fillb);
-            mult2 = mult1 * mult2 + retx[i + j] + carry;
-
-            retx[i + j] = static_cast<T>(mult2);
-#if NUT_ENDIAN_LITTLE_BYTE
-            carry = reinterpret_cast<const T*>(&mult2)[1];
-#elif NUT_ENDIAN_BIG_BYTE
-            carry = reinterpret_cast<const T*>(&mult2)[0];
-#else
-            carry = static_cast<T>(mult2 >> (8 * sizeof(T)));
-#endif
+            retx[i + j] = multiply_add<T>(mult1, (j < N ? b[j] : fillb), retx[i + j], carry, &carry);
         }
     }
 
@@ -205,7 +162,6 @@ void unsigned_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
-    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
     // 避免区域交叉覆盖
     T *retx = x;
@@ -219,7 +175,7 @@ void unsigned_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t
         if (i >= M)
             break;
 
-        const dword_type mult1 = a[i];
+        const T mult1 = a[i];
         if (0 == mult1)
             continue;
 
@@ -229,17 +185,7 @@ void unsigned_multiply(const T *a, size_t M, const T *b, size_t N, T *x, size_t
             if (j >= N && 0 == carry)
                 break;
 
-            dword_type mult2 = (j < N ? b[j] : 0);
-            mult2 = mult1 * mult2 + retx[i + j] + carry;
-
-            retx[i + j] = static_cast<T>(mult2);
-#if NUT_ENDIAN_LITTLE_BYTE
-            carry = reinterpret_cast<const T*>(&mult2)[1];
-#elif NUT_ENDIAN_BIG_BYTE
-            carry = reinterpret_cast<const T*>(&mult2)[0];
-#else
-            carry = static_cast<T>(mult2 >> (8 * sizeof(T)));
-#endif
+            retx[i + j] = multiply_add<T>(mult1, (j < N ? b[j] : 0), retx[i + j], carry, &carry);
         }
     }
 
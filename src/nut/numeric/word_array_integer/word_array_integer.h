@@ -28,6 +28,7 @@
 #include "../../platform/int_type.h"
 #include "../../platform/endian.h"
 #include "shift_op.h"
+#include "word_op.h"
 
 
 namespace nut
@@ -243,7 +244,6 @@ uint8_t signed_add(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) n
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
-    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
     // 避免区域交叉覆盖
     T *retx = x;
@@ -255,18 +255,7 @@ uint8_t signed_add(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) n
         fillb = (is_positive(b, N) ? 0 : ~(T)0);
     for (size_t i = 0; i < P; ++i)
     {
-        const dword_type pluser1 = (i < M ? a[i] : filla);
-        dword_type pluser2 = (i < N ? b[i] : fillb);
-        pluser2 += pluser1 + carry;
-
-        retx[i] = static_cast<T>(pluser2);
-#if NUT_ENDIAN_LITTLE_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser2)[1]);
-#elif NUT_ENDIAN_BIG_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser2)[0]);
-#else
-        carry = static_cast<uint8_t>(pluser2 >> (8 * sizeof(T))); // 稍慢
-#endif
+        retx[i] = add_with_carry<T>((i < M ? a[i] : filla), (i < N ? b[i] : fillb), &carry);
     }
 
     // 回写数据
@@ -286,7 +275,6 @@ uint8_t unsigned_add(const T *a, size_t M, const T *b, size_t N, T *x, size_t P)
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
-    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
     // 避免区域交叉覆盖
     T *retx = x;
@@ -296,18 +284,7 @@ uint8_t unsigned_add(const T *a, size_t M, const T *b, size_t N, T *x, size_t P)
     uint8_t carry = 0;
     for (size_t i = 0; i < P; ++i)
     {
-        const dword_type pluser1 = (i < M ? a[i] : 0);
-        dword_type pluser2 = (i < N ? b[i] : 0);
-        pluser2 += pluser1 + carry;
-
-        retx[i] = static_cast<T>(pluser2);
-#if NUT_ENDIAN_LITTLE_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser2)[1]);
-#elif NUT_ENDIAN_BIG_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser2)[0]);
-#else
-        carry = static_cast<uint8_t>(pluser2 >> (8 * sizeof(T)));
-#endif
+        retx[i] = add_with_carry<T>((i < M ? a[i] : 0), (i < N ? b[i] : 0), &carry);
     }
 
     // 回写数据
@@ -327,22 +304,11 @@ uint8_t increase(T *x, size_t N) noexcept
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != x && N > 0);
-    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
     uint8_t carry = 1;
     for (size_t i = 0; i < N && 0 != carry; ++i)
     {
-        dword_type pluser = x[i];
-        pluser += carry;
-
-        x[i] = static_cast<T>(pluser);
-#if NUT_ENDIAN_LITTLE_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser)[1]);
-#elif NUT_ENDIAN_BIG_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser)[0]);
-#else
-        carry = static_cast<uint8_t>(pluser >> (8 * sizeof(T)));
-#endif
+        x[i] = add_with_carry<T>(x[i], 0, &carry);
     }
     return carry;
 }
@@ -358,7 +324,6 @@ uint8_t signed_sub(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) n
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
-    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
     // 避免区域交叉覆盖
     T *retx = x;
@@ -370,18 +335,7 @@ uint8_t signed_sub(const T *a, size_t M, const T *b, size_t N, T *x, size_t P) n
     uint8_t carry = 1;
     for (size_t i = 0; i < P; ++i)
     {
-        const dword_type pluser1 = (i < M ? a[i] : filla);
-        dword_type pluser2 = static_cast<T>(~(i < N ? b[i] : fillb));
-        pluser2 += pluser1 + carry;
-
-        retx[i] = static_cast<T>(pluser2);
-#if NUT_ENDIAN_LITTLE_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser2)[1]);
-#elif NUT_ENDIAN_BIG_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser2)[0]);
-#else
-        carry = static_cast<uint8_t>(pluser2 >> (8 * sizeof(T)));
-#endif
+        retx[i] = add_with_carry<T>((i < M ? a[i] : filla), static_cast<T>(~(i < N ? b[i] : fillb)), &carry);
     }
 
     // 回写数据
@@ -401,7 +355,6 @@ uint8_t unsigned_sub(const T *a, size_t M, const T *b, size_t N, T *x, size_t P)
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != a && M > 0 && nullptr != b && N > 0 && nullptr != x && P > 0);
-    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
     // 避免区域交叉覆盖
     T *retx = x;
@@ -411,18 +364,7 @@ uint8_t unsigned_sub(const T *a, size_t M, const T *b, size_t N, T *x, size_t P)
     uint8_t carry = 1;
     for (size_t i = 0; i < P; ++i)
     {
-        const dword_type pluser1 = (i < M ? a[i] : 0);
-        dword_type pluser2 = static_cast<T>(~(i < N ? b[i] : 0));
-        pluser2 += pluser1 + carry;
-
-        retx[i] = static_cast<T>(pluser2);
-#if NUT_ENDIAN_LITTLE_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser2)[1]);
-#elif NUT_ENDIAN_BIG_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser2)[0]);
-#else
-        carry = static_cast<uint8_t>(pluser2 >> (8 * sizeof(T)));
-#endif
+        retx[i] = add_with_carry<T>((i < M ? a[i] : 0), static_cast<T>(~(i < N ? b[i] : 0)), &carry);
     }
 
     // 回写数据
@@ -442,22 +384,11 @@ uint8_t decrease(T *x, size_t N) noexcept
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != x && N > 0);
-    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
     uint8_t carry = 0;
     for (size_t i = 0; i < N && 1 != carry; ++i)
     {
-        dword_type pluser = x[i];
-        pluser += carry + (dword_type)(T) ~(T)0;
-
-        x[i] = static_cast<T>(pluser);
-#if NUT_ENDIAN_LITTLE_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser)[1]);
-#elif NUT_ENDIAN_BIG_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser)[0]);
-#else
-        carry = static_cast<uint8_t>(pluser >> (8 * sizeof(T)));
-#endif
+        x[i] = add_with_carry<T>(x[i], ~(T)0, &carry);
     }
     return carry;
 }
@@ -473,7 +404,6 @@ uint8_t signed_negate(const T *a, size_t M, T *x, size_t N) noexcept
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != a && M > 0 && nullptr != x && N > 0);
-    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
     // 避免区域交叉覆盖
     T *retx = x;
@@ -484,22 +414,12 @@ uint8_t signed_negate(const T *a, size_t M, T *x, size_t N) noexcept
     const T fill = (is_positive(a, M) ? 0 : ~(T)0);
     for (size_t i = 0; i < N; ++i)
     {
-        dword_type pluser = static_cast<T>(~(i < M ? a[i] : fill));
-        pluser += carry;
-
-        retx[i] = static_cast<T>(pluser);
-#if NUT_ENDIAN_LITTLE_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser)[1]);
-#elif NUT_ENDIAN_BIG_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser)[0]);
-#else
-        carry = static_cast<uint8_t>(pluser >> (8 * sizeof(T)));
-#endif
+        retx[i] = add_with_carry<T>(static_cast<T>(~(i < M ? a[i] : fill)), 0, &carry);
     }
 
     // 回写数据
     if (retx != x)
-        ::memcpy(x, retx, N);
+        ::memcpy(x, retx, sizeof(T) * N);
     return carry;
 }
 
@@ -514,7 +434,6 @@ uint8_t unsigned_negate(const T *a, size_t M, T *x, size_t N) noexcept
 {
     static_assert(std::is_unsigned<T>::value, "Unexpected integer type");
     assert(nullptr != a && M > 0 && nullptr != x && N > 0);
-    typedef typename StdInt<T>::double_unsigned_type dword_type;
 
     // 避免区域交叉覆盖
     T *retx = x;
@@ -524,22 +443,12 @@ uint8_t unsigned_negate(const T *a, size_t M, T *x, size_t N) noexcept
     uint8_t carry = 1;
     for (size_t i = 0; i < N; ++i)
     {
-        dword_type pluser = static_cast<T>(~(i < M ? a[i] : 0));
-        pluser += carry;
-
-        retx[i] = static_cast<T>(pluser);
-#if NUT_ENDIAN_LITTLE_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser)[1]);
-#elif NUT_ENDIAN_BIG_BYTE
-        carry = static_cast<uint8_t>(reinterpret_cast<const T*>(&pluser)[0]);
-#else
-        carry = static_cast<uint8_t>(pluser >> (8 * sizeof(T)));
-#endif
+        retx[i] = add_with_carry<T>(static_cast<T>(~(i < M ? a[i] : 0)), 0, &carry);
     }
 
     // 回写数据
     if (retx != x)
-        ::memcpy(x, retx, N);
+        ::memcpy(x, retx, sizeof(T) * N);
     return carry;
 }
 
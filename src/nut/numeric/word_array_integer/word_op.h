@@ -0,0 +1,124 @@
+﻿/**
+ * 单字(word)运算: 带进位加法、全字长乘法
+ *
+ * 64 位字优先使用编译器内建函数(_addcarry_u64、_mulx_u64、_umul128), 使进位链
+ * 直接映射为 adc/mulx 指令; 其他字长使用双字长整数计算
+ */
+
+#ifndef ___HEADFILE_93F1D6B2_7C4E_4A05_8E2B_61C0A57D3F98_
+#define ___HEADFILE_93F1D6B2_7C4E_4A05_8E2B_61C0A57D3F98_
+
+#include <stdint.h>
+
+#include "../../platform/platform.h"
+#include "../../platform/int_type.h"
+
+#if NUT_PLATFORM_CC_VC && defined(_M_X64)
+#   include <intrin.h> // for _addcarry_u64(), _umul128()
+#   define NUT_HAS_ADDCARRY_U64 1
+#   define NUT_HAS_UMUL128 1
+#elif NUT_PLATFORM_CC_GCC && defined(__x86_64__)
+#   include <immintrin.h> // for _addcarry_u64(), _mulx_u64()
+#   define NUT_HAS_ADDCARRY_U64 1
+#   define NUT_HAS_UMUL128 0
+#else
+#   define NUT_HAS_ADDCARRY_U64 0
+#   define NUT_HAS_UMUL128 0
+#endif
+
+/* mulx 需要 BMI2 指令集支持(例如 -mbmi2 或 -march=haswell) */
+#if NUT_HAS_ADDCARRY_U64 && defined(__BMI2__)
+#   define NUT_HAS_MULX_U64 1
+#else
+#   define NUT_HAS_MULX_U64 0
+#endif
+
+
+namespace nut
+{
+
+/**
+ * 带进位加法
+ *
+ * @param carry 输入并输出进位, 取值为 0 或者 1
+ * @return a + b + carry 的低位字
+ */
+template <typename T>
+inline T add_with_carry(T a, T b, uint8_t *carry) noexcept
+{
+    typedef typename StdInt<T>::double_unsigned_type dword_type;
+
+    const dword_type sum = static_cast<dword_type>(a) + b + *carry;
+    *carry = static_cast<uint8_t>(sum >> (8 * sizeof(T)));
+    return static_cast<T>(sum);
+}
+
+template <>
+inline uint64_t add_with_carry<uint64_t>(uint64_t a, uint64_t b, uint8_t *carry) noexcept
+{
+#if NUT_HAS_ADDCARRY_U64
+    unsigned long long sum;
+    *carry = _addcarry_u64(*carry, a, b, &sum);
+    return sum;
+#else
+    const uint64_t s1 = a + b, s2 = s1 + *carry;
+    *carry = static_cast<uint8_t>((s1 < a) | (s2 < s1));
+    return s2;
+#endif
+}
+
+/**
+ * 乘加, 结果不会溢出两个字
+ *
+ * @param hi 输出高位字
+ * @return a * b + c + d 的低位字
+ */
+template <typename T>
+inline T multiply_add(T a, T b, T c, T d, T *hi) noexcept
+{
+    typedef typename StdInt<T>::double_unsigned_type dword_type;
+
+    const dword_type rs = static_cast<dword_type>(a) * b + c + d;
+    *hi = static_cast<T>(rs >> (8 * sizeof(T)));
+    return static_cast<T>(rs);
+}
+
+template <>
+inline uint64_t multiply_add<uint64_t>(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t *hi) noexcept
+{
+#if NUT_HAS_MULX_U64 || NUT_HAS_UMUL128
+    unsigned long long h, l;
+#   if NUT_HAS_MULX_U64
+    l = _mulx_u64(a, b, &h);
+#   else
+    l = _umul128(a, b, &h);
+#   endif
+    uint8_t carry = _addcarry_u64(0, l, c, &l);
+    _addcarry_u64(carry, h, 0, &h);
+    carry = _addcarry_u64(0, l, d, &l);
+    _addcarry_u64(carry, h, 0, &h);
+    *hi = h;
+    return l;
+#elif NUT_HAS_INT128
+    const uint128_t rs = static_cast<uint128_t>(a) * b + c + d;
+    *hi = static_cast<uint64_t>(rs >> 64);
+    return static_cast<uint64_t>(rs);
+#else
+    // 拆成 32 位的半字相乘
+    const uint64_t a0 = a & 0xffffffff, a1 = a >> 32, b0 = b & 0xffffffff, b1 = b >> 32;
+    const uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    const uint64_t mid = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+    uint64_t l = (mid << 32) | (p00 & 0xffffffff);
+    uint64_t h = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+    l += c;
+    h += (l < c);
+    l += d;
+    h += (l < d);
+    *hi = h;
+    return l;
+#endif
+}
+
+}
+
+#endif
@@ -12,6 +12,7 @@
 #include "platform/path.h"
 #include "platform/sys.h"
 #include "platform/savefile.h"
+#include "platform/fd_io.h"
 
 // debugging
 #include "debugging/exception.h"
@@ -41,11 +42,20 @@
 #include "container/bit_stream.h"
 #include "container/lru_cache.h"
 #include "container/lru_data_cache.h"
+#include "container/roaring_chunk.h"
+#include "container/roaring_integer_set.h"
 #include "container/bytestream/input_stream.h"
+#include "container/bytestream/mapped_file_stream.h"
 #include "container/bytestream/output_stream.h"
 #include "container/bytestream/random_access_stream.h"
+#include "container/bytestream/varint.h"
 #include "container/bytestream/byte_array_stream.h"
+#include "container/bytestream/file_stream.h"
+#include "container/bytestream/serializer.h"
+#include "container/rwbuffer/mirrored_ring_buffer.h"
 #include "container/rwbuffer/ring_buffer.h"
+#include "container/rwbuffer/spsc_ring_buffer.h"
+#include "container/rwbuffer/mpsc_ring_buffer.h"
 #include "container/rwbuffer/fragment_buffer.h"
 #include "container/skiplist/skiplist.h"
 #include "container/skiplist/skiplist_set.h"
@@ -53,8 +63,10 @@
 #include "container/tree/binary_tree.h"
 #include "container/tree/bstree.h"
 #include "container/tree/rbtree.h"
+#include "container/tree/frozen_trie_tree.h"
 #include "container/tree/trie_tree.h"
 #include "container/tree/rtree/mdarea.h"
+#include "container/tree/rtree/packed_rtree.h"
 #include "container/tree/rtree/rtree.h"
 
 // numeric
@@ -64,11 +76,16 @@
 #include "numeric/word_array_integer/div_op.h"
 #include "numeric/word_array_integer/shift_op.h"
 #include "numeric/word_array_integer/bit_op.h"
+#include "numeric/word_array_integer/word_op.h"
 #include "numeric/numeric_algo/bit_sieve.h"
 #include "numeric/numeric_algo/gcd.h"
 #include "numeric/numeric_algo/mod.h"
+#include "numeric/numeric_algo/montgomery.h"
 #include "numeric/numeric_algo/prime.h"
+#include "numeric/numeric_algo/prime_sieve.h"
 #include "numeric/numeric_algo/karatsuba.h"
+#include "numeric/numeric_algo/fast_multiply.h"
+#include "numeric/numeric_algo/recursive_divide.h"
 #include "numeric/numeric_algo/fft.h"
 #include "numeric/numeric_algo/ntt.h"
 
@@ -94,6 +111,7 @@
 #include "threading/priority_thread_pool.h"
 #include "threading/lockfree/concurrent_stack.h"
 #include "threading/lockfree/concurrent_queue.h"
+#include "threading/lockfree/concurrent_skiplist_map.h"
 #include "threading/lockfree/hazard_pointer/hp_record.h"
 #include "threading/lockfree/hazard_pointer/hp_retire_list.h"
 #include "threading/sync/dummy_lock.h"
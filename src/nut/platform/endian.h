@@ -12,9 +12,14 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stddef.h> // for size_t in Linux
+#include <string.h> // for ::memcpy()
 
 #include "platform.h"
 
+#if NUT_PLATFORM_SSE2
+#   include <emmintrin.h>
+#endif
+
 #if NUT_PLATFORM_OS_LINUX
 #   include <endian.h> // for htole16() and so on
 #elif NUT_PLATFORM_OS_MACOS
@@ -97,6 +102,7 @@
  *    bswap_int64()
  *    bswap()
  *    wswap()
+ *    bswap_array()
  */
 namespace nut
 {
@@ -203,6 +209,110 @@ inline void bswap(void *dst, size_t cb) noexcept
     wswap<uint8_t>((uint8_t*) dst, cb);
 }
 
+/**
+ * 对 count 个 16/32/64 位元素逐个交换字节序, dst 与 src 可以相同, 不要求对齐
+ */
+inline void bswap_array16(void *dst, const void *src, size_t count) noexcept
+{
+    assert((nullptr != dst && nullptr != src) || 0 == count);
+    size_t i = 0;
+#if NUT_PLATFORM_SSE2
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*) ((const uint8_t*) src + i * 2));
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        _mm_storeu_si128((__m128i*) ((uint8_t*) dst + i * 2), x);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        uint16_t v;
+        ::memcpy(&v, (const uint8_t*) src + i * 2, 2);
+        v = bswap_uint16(v);
+        ::memcpy((uint8_t*) dst + i * 2, &v, 2);
+    }
+}
+
+inline void bswap_array32(void *dst, const void *src, size_t count) noexcept
+{
+    assert((nullptr != dst && nullptr != src) || 0 == count);
+    size_t i = 0;
+#if NUT_PLATFORM_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        // 先交换 16 位字, 再交换字内的字节
+        __m128i x = _mm_loadu_si128((const __m128i*) ((const uint8_t*) src + i * 4));
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        _mm_storeu_si128((__m128i*) ((uint8_t*) dst + i * 4), x);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        uint32_t v;
+        ::memcpy(&v, (const uint8_t*) src + i * 4, 4);
+        v = bswap_uint32(v);
+        ::memcpy((uint8_t*) dst + i * 4, &v, 4);
+    }
+}
+
+inline void bswap_array64(void *dst, const void *src, size_t count) noexcept
+{
+    assert((nullptr != dst && nullptr != src) || 0 == count);
+    size_t i = 0;
+#if NUT_PLATFORM_SSE2
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*) ((const uint8_t*) src + i * 8));
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+        x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        _mm_storeu_si128((__m128i*) ((uint8_t*) dst + i * 8), x);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        uint64_t v;
+        ::memcpy(&v, (const uint8_t*) src + i * 8, 8);
+        v = bswap_uint64(v);
+        ::memcpy((uint8_t*) dst + i * 8, &v, 8);
+    }
+}
+
+/**
+ * 对 count 个 elem_size 字节的元素逐个交换字节序, dst 与 src 可以相同
+ */
+inline void bswap_array(void *dst, const void *src, size_t elem_size, size_t count) noexcept
+{
+    assert((nullptr != dst && nullptr != src) || 0 == count);
+    switch (elem_size)
+    {
+    case 1:
+        if (dst != src)
+            ::memmove(dst, src, count);
+        break;
+
+    case 2:
+        bswap_array16(dst, src, count);
+        break;
+
+    case 4:
+        bswap_array32(dst, src, count);
+        break;
+
+    case 8:
+        bswap_array64(dst, src, count);
+        break;
+
+    default:
+        if (dst != src)
+            ::memmove(dst, src, elem_size * count);
+        for (size_t i = 0; i < count; ++i)
+            bswap((uint8_t*) dst + i * elem_size, elem_size);
+    }
+}
+
 }
 
 /**
@@ -0,0 +1,228 @@
+
+#include <assert.h>
+#include <errno.h>
+#include <algorithm> // for std::min()
+
+#include "platform.h"
+
+#if !NUT_PLATFORM_OS_WINDOWS
+#   include <unistd.h> // for ::read(), ::write(), ::close()
+#   include <sys/stat.h> // for ::fstat()
+#   include <poll.h>
+#endif
+
+#if NUT_PLATFORM_OS_LINUX
+#   include <fcntl.h> // for ::splice(), ::pipe2()
+#   include <sys/ioctl.h>
+#   include <sys/socket.h> // for ::getsockopt()
+#   include <sys/sendfile.h>
+#   include <linux/sockios.h> // for SIOCOUTQ
+#endif
+
+#include "../threading/threading.h" // for NUT_THREAD_LOCAL
+#include "fd_io.h"
+
+
+/* 没有零拷贝支持时，每次中转的最大字节数 */
+#define TRANSFER_BUFFER_SIZE 65536
+
+namespace nut
+{
+
+#if !NUT_PLATFORM_OS_WINDOWS
+
+/**
+ * 等待 fd 可写
+ *
+ * @param timeout_ms 0 表示只检查不等待，-1 表示一直等待
+ * @return 可写返回 true; 否则返回 false，错误码见 errno
+ */
+static bool wait_writable(int fd, int timeout_ms) noexcept
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+
+    int rs;
+    do
+    {
+        rs = ::poll(&pfd, 1, timeout_ms);
+    } while (rs < 0 && EINTR == errno);
+
+    if (0 == rs)
+        errno = EAGAIN;
+    else if (rs > 0 && 0 == (pfd.revents & POLLOUT))
+        errno = EPIPE;
+    return rs > 0 && 0 != (pfd.revents & POLLOUT);
+}
+
+#if !NUT_PLATFORM_OS_LINUX
+/**
+ * 已从 in_fd 读出的数据必须写出，否则会丢失. out_fd 是非阻塞的也要等待其可写
+ *
+ * @return 写出的字节数; 一个字节也没有写出时返回 -1
+ */
+static ssize_t write_all(int out_fd, const char *buf, size_t len) noexcept
+{
+    size_t wrote = 0;
+    while (wrote < len)
+    {
+        const ssize_t rs = ::write(out_fd, buf + wrote, len - wrote);
+        if (rs > 0)
+            wrote += rs;
+        else if (rs < 0 && EINTR == errno)
+            continue;
+        else if (rs < 0 && (EAGAIN == errno || EWOULDBLOCK == errno) && wait_writable(out_fd, -1))
+            continue;
+        else
+            break;
+    }
+    return wrote > 0 ? (ssize_t) wrote : -1;
+}
+#endif
+
+#if NUT_PLATFORM_OS_LINUX
+static bool is_pipe(int fd) noexcept
+{
+    struct stat info;
+    return 0 == ::fstat(fd, &info) && S_ISFIFO(info.st_mode);
+}
+
+namespace
+{
+
+/**
+ * 中转用的管道，每个线程一个，在多次传输之间复用. 每次传输结束时管道中不残留数据
+ */
+class RelayPipe
+{
+public:
+    ~RelayPipe() noexcept
+    {
+        reset();
+    }
+
+    bool open() noexcept
+    {
+        if (_fds[0] >= 0)
+            return true;
+        if (0 == ::pipe2(_fds, O_CLOEXEC))
+            return true;
+        _fds[0] = _fds[1] = -1;
+        return false;
+    }
+
+    /**
+     * 关闭管道，丢弃其中的数据
+     */
+    void reset() noexcept
+    {
+        if (_fds[0] < 0)
+            return;
+        const int err = errno;
+        ::close(_fds[0]);
+        ::close(_fds[1]);
+        _fds[0] = _fds[1] = -1;
+        errno = err;
+    }
+
+    int read_end() const noexcept
+    {
+        return _fds[0];
+    }
+
+    int write_end() const noexcept
+    {
+        return _fds[1];
+    }
+
+private:
+    int _fds[2] = {-1, -1};
+};
+
+}
+
+/**
+ * out_fd 是 socket 时，取发送缓冲区的剩余空间作为一次中转的上限，使读出的数据都能
+ * 立即写出; 其他类型不限制
+ */
+static size_t writable_limit(int out_fd, size_t len) noexcept
+{
+    int sndbuf = 0, outq = 0;
+    socklen_t optlen = sizeof(sndbuf);
+    if (0 != ::getsockopt(out_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &optlen) ||
+        0 != ::ioctl(out_fd, SIOCOUTQ, &outq) || sndbuf <= outq)
+        return len;
+    return std::min(len, (size_t) (sndbuf - outq));
+}
+
+static ssize_t splice_fd(int out_fd, int in_fd, size_t len) noexcept
+{
+    // 有一端是管道，可以直接 splice()
+    if (is_pipe(in_fd) || is_pipe(out_fd))
+        return ::splice(in_fd, nullptr, out_fd, nullptr, len, SPLICE_F_MOVE);
+
+    // 经过中转管道时，读出的数据只能在本次调用中写出; out_fd 暂时不可写就不要读,
+    // 并且只读出 out_fd 能够接收的量
+    if (!wait_writable(out_fd, 0))
+        return -1;
+    len = writable_limit(out_fd, len);
+
+    static NUT_THREAD_LOCAL RelayPipe relay;
+    if (!relay.open())
+        return -1;
+
+    const ssize_t readed = ::splice(in_fd, nullptr, relay.write_end(), nullptr, len, SPLICE_F_MOVE);
+    ssize_t drained = 0;
+    while (drained < readed)
+    {
+        const ssize_t rs = ::splice(relay.read_end(), nullptr, out_fd, nullptr, readed - drained,
+                                    SPLICE_F_MOVE);
+        if (rs > 0)
+            drained += rs;
+        else if (rs < 0 && EINTR == errno)
+            continue;
+        else if (rs < 0 && EAGAIN == errno && wait_writable(out_fd, -1))
+            continue;
+        else
+            break;
+    }
+
+    // out_fd 出错(例如对端已关闭)，剩余的数据已无处可写，随管道一起丢弃
+    if (readed > 0 && drained < readed)
+        relay.reset();
+
+    // 出错前已写出的部分也要报告
+    if (readed <= 0)
+        return readed;
+    return drained > 0 ? drained : -1;
+}
+#endif
+
+NUT_API ssize_t transfer_fd(int out_fd, int in_fd, size_t len) noexcept
+{
+    assert(out_fd >= 0 && in_fd >= 0);
+    if (0 == len)
+        return 0;
+
+#if NUT_PLATFORM_OS_LINUX
+    const ssize_t rs = ::sendfile(out_fd, in_fd, nullptr, len);
+    if (rs >= 0 || (EINVAL != errno && ENOSYS != errno))
+        return rs;
+    return splice_fd(out_fd, in_fd, len);
+#else
+    if (!wait_writable(out_fd, 0))
+        return -1;
+
+    char buf[TRANSFER_BUFFER_SIZE];
+    const ssize_t readed = ::read(in_fd, buf, len < sizeof(buf) ? len : sizeof(buf));
+    if (readed <= 0)
+        return readed;
+    return write_all(out_fd, buf, readed);
+#endif
+}
+
+#endif
+
+}
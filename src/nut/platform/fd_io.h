@@ -0,0 +1,37 @@
+﻿
+#ifndef ___HEADFILE_3F0C9A52_D81E_4B7A_96C3_5A2E7F14B08D_
+#define ___HEADFILE_3F0C9A52_D81E_4B7A_96C3_5A2E7F14B08D_
+
+#include <stddef.h> // for size_t
+
+#include "../nut_config.h"
+#include "platform.h"
+#include "int_type.h" // for ssize_t in windows VC
+
+
+namespace nut
+{
+
+#if !NUT_PLATFORM_OS_WINDOWS
+/**
+ * 在两个文件描述符之间直接传输数据，数据不经过用户态缓冲区
+ *
+ * Linux 上优先使用 sendfile(); in_fd 不支持时(例如 socket、管道)改用 splice()，
+ * 两端都不是管道时经过一个中转管道(每个线程一个，多次调用之间复用). 其他平台退化
+ * 为 read()/write()
+ *
+ * NOTE 经过中转管道或者退化为 read()/write() 时，out_fd 不可写则不读取 in_fd，
+ *      直接返回 -1 (errno 为 EAGAIN); out_fd 是 socket 时，一次只读出其发送缓冲区
+ *      能够容纳的量. 已读出的数据必须在本次调用中写出，因此非阻塞的 out_fd 写到
+ *      一半时会等待其可写; 只有 out_fd 本身出错(例如对端关闭)时，未写出的部分才会
+ *      被丢弃
+ *
+ * @return 实际写入 out_fd 的字节数，可能少于 len; 0 表示 in_fd 已到 EOF;
+ *         -1 表示出错且没有写出任何数据，错误码见 errno
+ */
+NUT_API ssize_t transfer_fd(int out_fd, int in_fd, size_t len) noexcept;
+#endif
+
+}
+
+#endif
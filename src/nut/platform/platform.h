@@ -87,6 +87,37 @@
 #   error Unknown compiler
 #endif
 
+/**
+ * 指令集
+ *
+ * 支持检测：
+ *  NUT_PLATFORM_SSE2
+ *  NUT_PLATFORM_AVX2
+ *  NUT_PLATFORM_POPCNT
+ */
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define NUT_PLATFORM_SSE2 1
+#else
+#   define NUT_PLATFORM_SSE2 0
+#endif
+
+#if defined(__AVX2__)
+#   define NUT_PLATFORM_AVX2 1
+#else
+#   define NUT_PLATFORM_AVX2 0
+#endif
+
+/* NOTE VC 没有单独的 popcnt 开关, 支持 AVX 的处理器都支持 popcnt */
+#if defined(__POPCNT__) || (NUT_PLATFORM_CC_VC && defined(__AVX__))
+#   define NUT_PLATFORM_POPCNT 1
+#else
+#   define NUT_PLATFORM_POPCNT 0
+#endif
+
+/** 缓存行大小, 用于隔离被不同线程频繁修改的数据 */
+#define NUT_CACHE_LINE_SIZE 64
+
 /** 模块 API 定义工具 */
 #define EXTERN_C extern "C"
 
@@ -344,6 +344,40 @@ NUT_API ssize_t der_read_pkcs1_private(const uint8_t *data, size_t available, RS
         return -1;
     sq_index += readed;
 
+    // CRT 参数可能缺失, 由 prepare_crt() 补齐
+    prikey->dp.set_zero();
+    prikey->dq.set_zero();
+    prikey->qinv.set_zero();
+
+    // d mod (p - 1)
+    if (sq_index < sq_size)
+    {
+        readed = der_read_integer(sq_begin + sq_index, sq_size - sq_index, &(prikey->dp));
+        if (readed < 0)
+            return -1;
+        sq_index += readed;
+    }
+
+    // d mod (q - 1)
+    if (sq_index < sq_size)
+    {
+        readed = der_read_integer(sq_begin + sq_index, sq_size - sq_index, &(prikey->dq));
+        if (readed < 0)
+            return -1;
+        sq_index += readed;
+    }
+
+    // (inverse of q) mod p
+    if (sq_index < sq_size)
+    {
+        readed = der_read_integer(sq_begin + sq_index, sq_size - sq_index, &(prikey->qinv));
+        if (readed < 0)
+            return -1;
+        sq_index += readed;
+    }
+
+    prikey->prepare_crt();
+
     return sq_total_size;
 }
 
@@ -480,6 +514,40 @@ NUT_API ssize_t der_read_pkcs8_private(const uint8_t *data, size_t available, RS
         return -1;
     sq3_index += readed;
 
+    // CRT 参数可能缺失, 由 prepare_crt() 补齐
+    prikey->dp.set_zero();
+    prikey->dq.set_zero();
+    prikey->qinv.set_zero();
+
+    // d mod (p - 1)
+    if (sq3_index < sq3_size)
+    {
+        readed = der_read_integer(sq3_begin + sq3_index, sq3_size - sq3_index, &(prikey->dp));
+        if (readed < 0)
+            return -1;
+        sq3_index += readed;
+    }
+
+    // d mod (q - 1)
+    if (sq3_index < sq3_size)
+    {
+        readed = der_read_integer(sq3_begin + sq3_index, sq3_size - sq3_index, &(prikey->dq));
+        if (readed < 0)
+            return -1;
+        sq3_index += readed;
+    }
+
+    // (inverse of q) mod p
+    if (sq3_index < sq3_size)
+    {
+        readed = der_read_integer(sq3_begin + sq3_index, sq3_size - sq3_index, &(prikey->qinv));
+        if (readed < 0)
+            return -1;
+        sq3_index += readed;
+    }
+
+    prikey->prepare_crt();
+
     return sq1_total_size;
 }
 
@@ -135,6 +135,16 @@ NUT_API void der_write_pkcs8_public(std::vector<uint8_t> *output, const RSA::Pub
     der_write_sequence(output, sq1);
 }
 
+/**
+ * 写入 CRT 参数, 密钥中缺失(为 0)的参数现算
+ */
+static void write_crt_params(std::vector<uint8_t> *output, const RSA::PrivateKey& prikey) noexcept
+{
+    der_write_integer(output, prikey.dp.is_zero() ? prikey.d % (prikey.p - 1) : prikey.dp);
+    der_write_integer(output, prikey.dq.is_zero() ? prikey.d % (prikey.q - 1) : prikey.dq);
+    der_write_integer(output, prikey.qinv.is_zero() ? inverse_of_coprime_mod(prikey.q, prikey.p) : prikey.qinv);
+}
+
 /**
  * 结构:
  *
@@ -160,11 +170,7 @@ NUT_API void der_write_pkcs1_private(std::vector<uint8_t> *output, const RSA::Pr
     der_write_integer(&sq, prikey.d);
     der_write_integer(&sq, prikey.p);
     der_write_integer(&sq, prikey.q);
-    der_write_integer(&sq, prikey.d % (prikey.p - 1));
-    der_write_integer(&sq, prikey.d % (prikey.q - 1));
-
-    const BigInteger iqmp = inverse_of_coprime_mod(prikey.q, prikey.p);
-    der_write_integer(&sq, iqmp);
+    write_crt_params(&sq, prikey);
 
     der_write_sequence(output, sq);
 }
@@ -206,11 +212,7 @@ NUT_API void der_write_pkcs8_private(std::vector<uint8_t> *output, const RSA::Pr
     der_write_integer(&sq3, prikey.d);
     der_write_integer(&sq3, prikey.p);
     der_write_integer(&sq3, prikey.q);
-    der_write_integer(&sq3, prikey.d % (prikey.p - 1));
-    der_write_integer(&sq3, prikey.d % (prikey.q - 1));
-
-    const BigInteger iqmp = inverse_of_coprime_mod(prikey.q, prikey.p);
-    der_write_integer(&sq3, iqmp);
+    write_crt_params(&sq3, prikey);
 
     std::vector<uint8_t> bs;
     der_write_sequence(&bs, sq3);
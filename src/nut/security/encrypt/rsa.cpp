@@ -3,13 +3,14 @@
 
 #include "../../numeric/numeric_algo/mod.h"
 #include "../../numeric/numeric_algo/prime.h"
+#include "../../threading/thread_pool.h"
 #include "rsa.h"
 
 
 namespace nut
 {
 
-RSA::PrivateKey RSA::gen_key(size_t max_bit_length) noexcept
+RSA::PrivateKey RSA::gen_key(size_t max_bit_length, ThreadPool *pool) noexcept
 {
     assert(max_bit_length >= 16);
 
@@ -18,24 +19,34 @@ RSA::PrivateKey RSA::gen_key(size_t max_bit_length) noexcept
     //  为了避免椭圆曲线因子分解算法，p、q应有大致相同的比特长度，且足够大。
     //  同时， p,q 不应太接近, 否则就容易分解, 保持几个比特长度差是可以的
     PrivateKey key;
-    const unsigned p_len = (max_bit_length + 1) / 2 - 2,
-        q_len = max_bit_length - p_len; // q_len - p_len = 3 or 4
-    key.p = BigInteger::rand_positive(p_len, true);
-    key.p = next_prime(key.p);
-
-    key.q = BigInteger::rand_positive(q_len, true);
-    key.q = next_prime(key.q);
 
     // 选取小奇数 e，使得 e 与 gamma_n 互质
     // NOTE:
     //  e 常取 3 和 65537，比特位中 bit1 少，利于提高计算速度
     key.e = 65537;
 
+    const unsigned p_len = (max_bit_length + 1) / 2 - 2,
+        q_len = max_bit_length - p_len; // q_len - p_len = 3 or 4
+
+    // e 为素数, 只要 p - 1、q - 1 都不是 e 的倍数, e 就与 gamma_n 互质
+    do
+    {
+        key.p = BigInteger::rand_positive(p_len, true);
+        key.p = next_prime(key.p, pool);
+    } while ((key.p - 1) % key.e == 0);
+
+    do
+    {
+        key.q = BigInteger::rand_positive(q_len, true);
+        key.q = next_prime(key.q, pool);
+    } while ((key.q - 1) % key.e == 0);
+
     // d 为 e 对模 gamma_n 的乘法逆元
     const BigInteger gamma_n = (key.p - 1) * (key.q - 1);
     key.d = inverse_of_coprime_mod(key.e, gamma_n);
 
     key.n = key.p * key.q;
+    key.prepare_crt();
 
     return key;
 }
@@ -47,7 +58,102 @@ BigInteger RSA::public_transfer(const BigInteger& m, const PublicKey& k) noexcep
 
 BigInteger RSA::private_transfer(const BigInteger& c, const PrivateKey& k) noexcept
 {
-    return pow_mod(c, k.d, k.n);
+    // 缺少 p、q 时直接在模 n 下求幂
+    if (k.p <= 2 || k.q <= 2 || 0 == k.p.bit_at(0) || 0 == k.q.bit_at(0))
+        return pow_mod(c, k.d, k.n);
+
+    // 密钥尚未预计算时, 临时构造 CRT 参数及上下文
+    if (k.crt_context.is_null())
+    {
+        PrivateKey tmp(k);
+        tmp.prepare_crt();
+        return private_transfer(c, tmp);
+    }
+
+    // m1 = c^dp mod p, m2 = c^dq mod q
+    const BigInteger m1 = k.crt_context->mont_p.pow_fixed_window(c, k.dp),
+        m2 = k.crt_context->mont_q.pow_fixed_window(c, k.dq);
+
+    // Garner: h = qinv * (m1 - m2) mod p, m = m2 + h * q
+    BigInteger h = (m1 - m2) % k.p;
+    if (h.is_negative())
+        h += k.p;
+    h *= k.qinv;
+    h %= k.p;
+    h *= k.q;
+    h += m2;
+    return h;
+}
+
+void RSA::PrivateKey::prepare_crt() noexcept
+{
+    if (p <= 2 || q <= 2 || 0 == p.bit_at(0) || 0 == q.bit_at(0))
+    {
+        crt_context.set_null();
+        return;
+    }
+
+    if (dp.is_zero())
+        dp = d % (p - 1);
+    if (dq.is_zero())
+        dq = d % (q - 1);
+    if (qinv.is_zero())
+        qinv = inverse_of_coprime_mod(q, p);
+    crt_context = rc_new<CRTContext>(p, q);
+}
+
+void RSA::batch_public_transfer(const BigInteger *inputs, size_t count, const PublicKey& k,
+                                BigInteger *outputs, ThreadPool *pool) noexcept
+{
+    assert((nullptr != inputs && nullptr != outputs) || 0 == count);
+
+    if (0 == count)
+        return;
+    if (k.n <= 1 || 0 == k.n.bit_at(0))
+    {
+        parallel_for(count, pool, [&] (size_t i) {
+            outputs[i] = public_transfer(inputs[i], k);
+        });
+        return;
+    }
+
+    const MontgomeryContext ctx(k.n);
+    parallel_for(count, pool, [&] (size_t i) {
+        outputs[i] = ctx.pow(inputs[i], k.e);
+    });
+}
+
+void RSA::batch_private_transfer(const BigInteger *inputs, size_t count, const PrivateKey& k,
+                                 BigInteger *outputs, ThreadPool *pool) noexcept
+{
+    assert((nullptr != inputs && nullptr != outputs) || 0 == count);
+
+    if (0 == count)
+        return;
+
+    // 预先准备好 CRT 上下文, 避免各运算各自构造
+    PrivateKey tmp;
+    const PrivateKey *key = &k;
+    if (k.crt_context.is_null())
+    {
+        tmp = k;
+        tmp.prepare_crt();
+        key = &tmp;
+    }
+
+    // 缺少 p、q 时共享模 n 的上下文
+    if (key->crt_context.is_null() && k.n > 1 && 1 == k.n.bit_at(0))
+    {
+        const MontgomeryContext ctx(k.n);
+        parallel_for(count, pool, [&] (size_t i) {
+            outputs[i] = ctx.pow_fixed_window(inputs[i], k.d);
+        });
+        return;
+    }
+
+    parallel_for(count, pool, [&] (size_t i) {
+        outputs[i] = private_transfer(inputs[i], *key);
+    });
 }
 
 }
@@ -4,11 +4,15 @@
 
 #include "../../nut_config.h"
 #include "../../numeric/big_integer.h"
+#include "../../numeric/numeric_algo/montgomery.h"
+#include "../../rc/rc_new.h"
 
 
 namespace nut
 {
 
+class ThreadPool;
+
 class NUT_API RSA
 {
 public:
@@ -20,8 +24,40 @@ public:
 
     class PrivateKey : public PublicKey
     {
+    public:
+        /**
+         * 模 p、q 的蒙哥马利上下文
+         */
+        class CRTContext
+        {
+            NUT_REF_COUNTABLE
+
+        public:
+            CRTContext(const BigInteger& p, const BigInteger& q) noexcept
+                : mont_p(p), mont_q(q)
+            {}
+
+        public:
+            const MontgomeryContext mont_p, mont_q;
+        };
+
+    public:
+        /**
+         * 补齐缺失(为 0)的 CRT 参数, 并生成蒙哥马利上下文
+         *
+         * NOTE 修改 d、p、q 之后需要将 CRT 参数清零并重新调用; 之后的私钥运算只读
+         *      访问上下文, 可以在多个线程中共享同一个密钥
+         */
+        void prepare_crt() noexcept;
+
     public:
         BigInteger d, p, q;
+
+        // CRT 参数: d mod (p - 1), d mod (q - 1), q 模 p 的逆元
+        BigInteger dp, dq, qinv;
+
+        // 由 prepare_crt() 生成, 拷贝的密钥之间共享
+        rc_ptr<CRTContext> crt_context;
     };
 
 public:
@@ -31,11 +67,34 @@ public:
      * @param max_bit_length 最大密钥长度，最终生成比特长度为 max_bit_length - 1
      *                       或者 max_bit_length (因为 M 位正整数乘以 N 位正整数
      *                       的结果为 M + N -1 位或者 M + N 位)
+     * @param pool 不为 nullptr 时, 素数搜索中的候选数分摊到线程池中测试
      */
-    static PrivateKey gen_key(size_t max_bit_length) noexcept;
+    static PrivateKey gen_key(size_t max_bit_length, ThreadPool *pool = nullptr) noexcept;
 
     static BigInteger public_transfer(const BigInteger& m, const PublicKey& k) noexcept;
+
+    /**
+     * 私钥运算
+     *
+     * 已知 p、q 时使用中国剩余定理, 分别在模 p、q 下求幂再用 Garner 算法合并, 约比
+     * 直接在模 n 下求幂快 3~4 倍
+     */
     static BigInteger private_transfer(const BigInteger& c, const PrivateKey& k) noexcept;
+
+    /**
+     * 批量运算, 各输入相互独立
+     *
+     * 输入被动态分摊到线程池的若干任务以及当前线程中并行计算, 当前线程阻塞直到全部
+     * 完成; 同一批中的运算共享模 n (或者 p、q)的蒙哥马利上下文
+     *
+     * @param inputs, count 输入
+     * @param outputs 输出 count 个结果, 可以与输入相同
+     * @param pool 线程池, 可以与其他任务共用; 为 nullptr 时在当前线程中顺序计算
+     */
+    static void batch_public_transfer(const BigInteger *inputs, size_t count, const PublicKey& k,
+                                      BigInteger *outputs, ThreadPool *pool = nullptr) noexcept;
+    static void batch_private_transfer(const BigInteger *inputs, size_t count, const PrivateKey& k,
+                                       BigInteger *outputs, ThreadPool *pool = nullptr) noexcept;
 };
 
 }
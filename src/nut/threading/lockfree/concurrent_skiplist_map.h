@@ -0,0 +1,435 @@
+﻿
+#ifndef ___HEADFILE_5B0E6D2C_8A4F_4E1B_9C37_2F6A1D84B3E9_
+#define ___HEADFILE_5B0E6D2C_8A4F_4E1B_9C37_2F6A1D84B3E9_
+
+#include <assert.h>
+#include <stdlib.h> // for ::malloc(), ::rand()
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "../../container/comparable.h"
+#include "../threading.h" // for NUT_THREAD_LOCAL
+#include "hazard_pointer/hp_record.h"
+#include "hazard_pointer/hp_retire_list.h"
+
+
+namespace nut
+{
+
+/**
+ * 无锁有序 map (lock-free skip-list)
+ *
+ * 算法参考 Fraser "Practical lock-freedom" 及 Herlihy & Shavit "The Art of
+ * Multiprocessor Programming" 中的 LockFreeSkipList:
+ * - 节点各层的 next 指针最低位作为删除标记，标记后该层指针不再改变
+ * - 删除时自顶向下逐层标记，level-0 标记成功者为真正的删除者
+ * - 查找时顺带把已标记节点从链表中摘除
+ *
+ * 内存回收使用 hazard pointer. 由于删除者完成摘除时，插入者可能还在链接高层指针，
+ * 用 Node::state 上的 LINKED/REMOVED 握手，保证由最后离开的一方把节点从所有层
+ * 摘除后再放入 retire list
+ */
+template <typename K, typename V>
+class ConcurrentSkipListMap
+{
+private:
+    /* 最大level数, 0-based */
+    static constexpr int MAX_LEVEL = 16;
+
+    /* Node::state 标记 */
+    static constexpr uint8_t STATE_LINKED = 0x01;  // 插入者已完成各层链接
+    static constexpr uint8_t STATE_REMOVED = 0x02; // 删除者已完成逻辑删除
+
+    typedef uintptr_t link_type;
+
+    class Node
+    {
+    public:
+        template <typename KK, typename VV>
+        Node(int lv, KK&& k, VV&& v) noexcept
+            : key(std::forward<KK>(k)), value(std::forward<VV>(v)), level(lv)
+        {
+            assert(0 <= lv && lv <= MAX_LEVEL);
+            for (int i = 0; i <= lv; ++i)
+                new (next + i) std::atomic<link_type>(0);
+        }
+
+        static size_t alloc_size(int lv) noexcept
+        {
+            assert(lv >= 0);
+            return sizeof(Node) + sizeof(std::atomic<link_type>) * lv;
+        }
+
+        // Only used by 'HPRetireList'
+        static void delete_node(void *p) noexcept
+        {
+            assert(nullptr != p);
+            ((Node*) p)->~Node();
+            ::free(p);
+        }
+
+    private:
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+
+    public:
+        const K key;
+        const V value;
+        const int level; // 0-based
+        std::atomic<uint8_t> state = ATOMIC_VAR_INIT(0);
+
+        // NOTE 这一部分是变长的，应该作为最后一个成员
+        std::atomic<link_type> next[1];
+    };
+
+public:
+    ConcurrentSkipListMap() noexcept
+    {
+        for (int i = 0; i <= MAX_LEVEL; ++i)
+            _head[i].store(0, std::memory_order_relaxed);
+    }
+
+    ~ConcurrentSkipListMap() noexcept
+    {
+        // NOTE 此时不应该有其他线程访问，链表中的节点都还没有放入 retire list
+        Node *n = ptr_of(_head[0].load(std::memory_order_acquire));
+        while (nullptr != n)
+        {
+            Node *next = ptr_of(n->next[0].load(std::memory_order_relaxed));
+            Node::delete_node(n);
+            n = next;
+        }
+    }
+
+    size_t size() const noexcept
+    {
+        return _size.load(std::memory_order_relaxed);
+    }
+
+    bool contains_key(const K& k) const noexcept
+    {
+        return get(k, nullptr);
+    }
+
+    bool get(const K& k, V *v) const noexcept
+    {
+        HPGuard guard;
+        Node *n = search_ge(&k);
+        if (nullptr == n || 0 != nut::compare(n->key, k))
+            return false;
+        if (nullptr != v)
+            *v = n->value;
+        return true;
+    }
+
+    /**
+     * @return true if insert success, else old data found
+     */
+    bool insert(const K& k, V&& v) noexcept
+    {
+        return insert_node(k, std::forward<V>(v));
+    }
+
+    bool insert(const K& k, const V& v) noexcept
+    {
+        return insert_node(k, v);
+    }
+
+    /**
+     * @return true if data removed, else nothing happened
+     */
+    bool remove(const K& k, V *v = nullptr) noexcept
+    {
+        HPGuard guard;
+        Node *preds[MAX_LEVEL + 1], *succs[MAX_LEVEL + 1];
+        if (!find(k, preds, succs))
+            return false;
+        Node *n = succs[0];
+
+        // Mark high levels, from top to bottom
+        for (int i = n->level; i > 0; --i)
+        {
+            link_type l = n->next[i].load(std::memory_order_relaxed);
+            while (!is_marked(l) &&
+                   !n->next[i].compare_exchange_weak(
+                       l, l | 1, std::memory_order_release, std::memory_order_relaxed))
+            {}
+        }
+
+        // Mark level-0, the winner is the actual remover
+        link_type l = n->next[0].load(std::memory_order_relaxed);
+        while (true)
+        {
+            if (is_marked(l))
+                return false; // Removed by some other thread
+            if (n->next[0].compare_exchange_weak(
+                    l, l | 1, std::memory_order_release, std::memory_order_relaxed))
+                break;
+        }
+
+        if (nullptr != v)
+            *v = n->value;
+        _size.fetch_sub(1, std::memory_order_relaxed);
+
+        // Unlink from all levels and retire
+        const uint8_t old_state = n->state.fetch_or(STATE_REMOVED, std::memory_order_acq_rel);
+        find(k, preds, succs);
+        if (0 != (old_state & STATE_LINKED))
+            HPRetireList::retire_any(Node::delete_node, n);
+        // else: the inserter is still linking high levels, it will retire 'n'
+        return true;
+    }
+
+    void clear() noexcept
+    {
+        while (true)
+        {
+            HPGuard guard;
+            Node *n = search_ge(nullptr);
+            if (nullptr == n)
+                return;
+            remove(n->key);
+        }
+    }
+
+    /**
+     * 按键值顺序访问 [lo, hi) 范围内的数据
+     *
+     * 遍历过程中其他线程的修改不一定可见，但每个被访问的数据在访问时都是有效的
+     *
+     * @param visitor 形如 bool visitor(const K&, const V&), 返回 false 则终止遍历
+     * @return 访问的数据个数
+     */
+    template <typename VISITOR>
+    size_t range(const K& lo, const K& hi, VISITOR&& visitor) const noexcept
+    {
+        HPGuard guard;
+        size_t count = 0;
+        Node *n = search_ge(&lo);
+        while (nullptr != n && nut::compare(n->key, hi) < 0)
+        {
+            const link_type l = n->next[0].load(std::memory_order_acquire);
+            if (!is_marked(l))
+            {
+                ++count;
+                if (!visitor(n->key, n->value))
+                    break;
+            }
+            n = ptr_of(l);
+        }
+        return count;
+    }
+
+private:
+    ConcurrentSkipListMap(const ConcurrentSkipListMap&) = delete;
+    ConcurrentSkipListMap& operator=(const ConcurrentSkipListMap&) = delete;
+
+    static Node* ptr_of(link_type l) noexcept
+    {
+        return reinterpret_cast<Node*>(l & ~(link_type) 1);
+    }
+
+    static bool is_marked(link_type l) noexcept
+    {
+        return 0 != (l & 1);
+    }
+
+    std::atomic<link_type>* link_of(Node *pred, int lv) const noexcept
+    {
+        assert(0 <= lv && lv <= MAX_LEVEL);
+        if (nullptr == pred)
+            return const_cast<std::atomic<link_type>*>(_head + lv);
+        assert(lv <= pred->level);
+        return pred->next + lv;
+    }
+
+    /**
+     * 随机化 level, 使用线程局部的 xorshift 随机数，避免 ::rand() 的全局锁
+     *
+     * @return 0-based
+     */
+    static int random_level() noexcept
+    {
+        static NUT_THREAD_LOCAL uint32_t seed = 0;
+        if (0 == seed)
+            seed = ((uint32_t) ::rand()) | 1;
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+
+        int level = 0;
+        for (uint32_t r = seed; 0 != (r & 1) && level < MAX_LEVEL; r >>= 1)
+            ++level;
+        return level;
+    }
+
+    /**
+     * 只读查找, 不摘除已标记节点
+     *
+     * NOTE 调用者需要持有 HPGuard
+     *
+     * @param k 为 nullptr 时返回第一个未删除节点
+     * @return 第一个键值 >= k 且未被删除的节点
+     */
+    Node* search_ge(const K *k) const noexcept
+    {
+        Node *pred = nullptr, *curr = nullptr;
+        for (int lv = MAX_LEVEL; lv >= 0; --lv)
+        {
+            curr = ptr_of(link_of(pred, lv)->load(std::memory_order_acquire));
+            while (nullptr != curr)
+            {
+                const link_type l = curr->next[lv].load(std::memory_order_acquire);
+                if (is_marked(l))
+                {
+                    curr = ptr_of(l); // Skip removed node
+                    continue;
+                }
+                if (nullptr == k || nut::compare(curr->key, *k) >= 0)
+                    break;
+                pred = curr;
+                curr = ptr_of(l);
+            }
+        }
+        return curr;
+    }
+
+    /**
+     * 查找各层前向、后向节点，顺带摘除已标记节点
+     *
+     * NOTE 调用者需要持有 HPGuard
+     *
+     * @param preds 各层前向节点, nullptr 表示表头
+     * @param succs 各层第一个键值 >= k 的节点
+     * @return 是否找到键值为 k 的节点
+     */
+    bool find(const K& k, Node **preds, Node **succs) noexcept
+    {
+        assert(nullptr != preds && nullptr != succs);
+
+    retry:
+        Node *pred = nullptr;
+        for (int lv = MAX_LEVEL; lv >= 0; --lv)
+        {
+            Node *curr = ptr_of(link_of(pred, lv)->load(std::memory_order_acquire));
+            while (nullptr != curr)
+            {
+                link_type l = curr->next[lv].load(std::memory_order_acquire);
+                if (is_marked(l))
+                {
+                    // Unlink 'curr' from this level
+                    // NOTE 这里 CAS 失败的可能原因：
+                    // - pred 也被标记删除了
+                    // - pred 后面插入了新节点
+                    link_type expected = reinterpret_cast<link_type>(curr);
+                    if (!link_of(pred, lv)->compare_exchange_strong(
+                            expected, l & ~(link_type) 1,
+                            std::memory_order_acq_rel, std::memory_order_relaxed))
+                        goto retry;
+                    curr = ptr_of(l);
+                    continue;
+                }
+
+                if (nut::compare(curr->key, k) >= 0)
+                    break;
+                pred = curr;
+                curr = ptr_of(l);
+            }
+            preds[lv] = pred;
+            succs[lv] = curr;
+        }
+        return nullptr != succs[0] && 0 == nut::compare(succs[0]->key, k);
+    }
+
+    template <typename VV>
+    bool insert_node(const K& k, VV&& v) noexcept
+    {
+        HPGuard guard;
+        Node *preds[MAX_LEVEL + 1], *succs[MAX_LEVEL + 1];
+        Node *n = nullptr;
+        while (true)
+        {
+            if (find(k, preds, succs))
+            {
+                // Delete temperory new node
+                if (nullptr != n)
+                    Node::delete_node(n);
+                return false;
+            }
+
+            if (nullptr == n)
+            {
+                // NOTE 'k' 在构建 'n' 之后，由于 while 循环还可能会在 find()
+                //      调用时使用，故不能用右值引用传入
+                const int level = random_level();
+                n = (Node*) ::malloc(Node::alloc_size(level));
+                new (n) Node(level, k, std::forward<VV>(v));
+            }
+            for (int i = 0; i <= n->level; ++i)
+                n->next[i].store(reinterpret_cast<link_type>(succs[i]), std::memory_order_relaxed);
+
+            // Link level-0, which makes 'n' visible
+            link_type expected = reinterpret_cast<link_type>(succs[0]);
+            if (link_of(preds[0], 0)->compare_exchange_strong(
+                    expected, reinterpret_cast<link_type>(n),
+                    std::memory_order_release, std::memory_order_relaxed))
+                break;
+        }
+        _size.fetch_add(1, std::memory_order_relaxed);
+
+        // Link high levels
+        for (int i = 1; i <= n->level; ++i)
+        {
+            bool stop = false;
+            while (true)
+            {
+                // Make sure 'n->next[i]' points to 'succs[i]', unless 'n' is being removed
+                link_type l = n->next[i].load(std::memory_order_acquire);
+                const link_type succ = reinterpret_cast<link_type>(succs[i]);
+                if (is_marked(l))
+                {
+                    stop = true;
+                    break;
+                }
+                if (l != succ && !n->next[i].compare_exchange_strong(
+                        l, succ, std::memory_order_release, std::memory_order_relaxed))
+                    continue;
+
+                link_type expected = succ;
+                if (link_of(preds[i], i)->compare_exchange_strong(
+                        expected, reinterpret_cast<link_type>(n),
+                        std::memory_order_release, std::memory_order_relaxed))
+                    break;
+
+                // 'preds' changed, search again
+                find(k, preds, succs);
+                if (succs[0] != n)
+                {
+                    stop = true; // 'n' removed
+                    break;
+                }
+            }
+            if (stop)
+                break;
+        }
+
+        const uint8_t old_state = n->state.fetch_or(STATE_LINKED, std::memory_order_acq_rel);
+        if (0 != (old_state & STATE_REMOVED))
+        {
+            // The remover gave up retiring, unlink and retire it ourself
+            find(k, preds, succs);
+            HPRetireList::retire_any(Node::delete_node, n);
+        }
+        return true;
+    }
+
+private:
+    std::atomic<link_type> _head[MAX_LEVEL + 1];
+    std::atomic<size_t> _size = ATOMIC_VAR_INIT(0);
+};
+
+}
+
+#endif
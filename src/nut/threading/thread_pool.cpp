@@ -1,5 +1,8 @@
 ﻿
 #include <assert.h>
+#include <atomic>
+#include <algorithm> // for std::min(), std::max()
+#include <memory>
 #include <vector>
 
 #include "thread_pool.h"
@@ -196,4 +199,85 @@ void ThreadPool::clean_dead_threads() noexcept
     }
 }
 
+namespace
+{
+
+/**
+ * parallel_for() 的共享状态. 排队中的任务可能在 parallel_for() 返回之后才开始执行,
+ * 故由各任务共同持有
+ */
+struct ParallelForState
+{
+    ParallelForState(size_t count_, const std::function<void(size_t)> *func_) noexcept
+        : count(count_), func(func_), next(0)
+    {}
+
+    /**
+     * 领取并执行输入, 直到全部被领取
+     */
+    void work() noexcept
+    {
+        for (size_t i = next++; i < count; i = next++)
+            (*func)(i);
+    }
+
+    const size_t count;
+
+    // 只在领取到有效输入时访问, 此时 parallel_for() 必然还在等待
+    const std::function<void(size_t)> *const func;
+
+    std::atomic<size_t> next;
+
+    // 正在领取输入的任务数; 在领取之前计入, 保证调用者看得到所有领取到输入的任务
+    size_t active = 0;
+    std::mutex lock;
+    std::condition_variable done_condition;
+};
+
+}
+
+/**
+ * 将 count 个相互独立的运算分摊到线程池与当前线程中
+ */
+NUT_API void parallel_for(size_t count, ThreadPool *pool, const std::function<void(size_t)>& func) noexcept
+{
+    // 任务数取线程池的最大线程数; 线程池不限线程数时, 取 CPU 核数(当前线程也参与计算)
+    size_t tasks = 0;
+    if (nullptr != pool && count > 1)
+    {
+        tasks = pool->get_max_thread_number();
+        if (0 == tasks)
+            tasks = std::max<unsigned>(1, std::thread::hardware_concurrency()) - 1;
+        tasks = std::min(tasks, count - 1);
+    }
+
+    // 各任务动态地领取下一个输入, 运算耗时不均匀时也能保持负载均衡.
+    // 线程池繁忙、已中断或者在池内任务中调用时, 辅助任务可能迟迟不执行; 当前线程会
+    // 独自完成全部输入, 之后才开始执行的辅助任务领取不到输入, 直接返回, 不必等待
+    const std::shared_ptr<ParallelForState> state =
+        std::make_shared<ParallelForState>(count, &func);
+    for (size_t i = 0; i < tasks; ++i)
+    {
+        const bool added = pool->add_task([state] {
+            {
+                std::lock_guard<std::mutex> guard(state->lock);
+                ++state->active;
+            }
+            state->work();
+            std::lock_guard<std::mutex> guard(state->lock);
+            if (0 == --state->active)
+                state->done_condition.notify_all();
+        });
+        if (!added)
+            break;
+    }
+
+    state->work();
+
+    // 此时所有输入都已被领取, 只需等待正在运算的任务
+    std::unique_lock<std::mutex> guard(state->lock);
+    while (0 != state->active)
+        state->done_condition.wait(guard);
+}
+
 }
@@ -98,6 +98,18 @@ private:
     std::condition_variable _wake_condition, _all_idle_condition;
 };
 
+/**
+ * 将 count 个相互独立的运算 func(0) ... func(count - 1) 分摊到线程池与当前线程中,
+ * 全部完成后返回
+ *
+ * 当前线程总是参与运算, 只等待已领取到输入的任务, 不等待排队中的任务. 因此线程池
+ * 繁忙、已被中断, 或者在该线程池的任务中调用时也不会死锁, 最坏情况下由当前线程
+ * 独自完成
+ *
+ * @param pool 为 nullptr 时在当前线程中依次运算
+ */
+NUT_API void parallel_for(size_t count, ThreadPool *pool, const std::function<void(size_t)>& func) noexcept;
+
 }
 
 #endif
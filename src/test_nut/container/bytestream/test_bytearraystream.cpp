@@ -15,6 +15,9 @@ class TestByteArrayStream : public TestFixture
         NUT_REGISTER_CASE(test_big_endian);
         NUT_REGISTER_CASE(test_operators);
         NUT_REGISTER_CASE(test_bug1);
+        NUT_REGISTER_CASE(test_varint);
+        NUT_REGISTER_CASE(test_array);
+        NUT_REGISTER_CASE(test_truncated);
     }
 
     void test_little_endian()
@@ -149,6 +152,114 @@ class TestByteArrayStream : public TestFixture
         uint16_t v = 0;
         bas->write(&v, sizeof(v)); // Will crash here if bug exists
     }
+
+    void test_varint()
+    {
+        rc_ptr<ByteArrayStream> bas = rc_new<ByteArrayStream>();
+        bas->write_varuint32(0);
+        bas->write_varuint32(127);
+        bas->write_varuint32(128);
+        bas->write_varuint64(0xffffffffffffffffULL);
+        bas->write_varint32(-1);
+        bas->write_varint64(-64);
+        bas->write_varint64(INT64_MIN);
+        bas->write_varstring("abc");
+        NUT_TA(bas->size() == 1 + 1 + 2 + 10 + 1 + 1 + 10 + 4);
+        NUT_TA(bas->byte_array()[2] == 0x80 && bas->byte_array()[3] == 0x01);
+
+        // 通过基类的通用实现读取, 两种实现的编码相同
+        bas->seek(0);
+        InputStream *is = bas.pointer();
+        NUT_TA(is->read_varuint32() == 0);
+        NUT_TA(is->read_varuint32() == 127);
+        NUT_TA(is->read_varuint32() == 128);
+        NUT_TA(is->read_varuint64() == 0xffffffffffffffffULL);
+        NUT_TA(is->read_varint32() == -1);
+        NUT_TA(is->read_varint64() == -64);
+        NUT_TA(is->read_varint64() == INT64_MIN);
+        NUT_TA(is->read_varstring() == "abc");
+        NUT_TA(bas->readable_size() == 0);
+
+        rc_ptr<ByteArrayStream> bas2 = rc_new<ByteArrayStream>();
+        OutputStream *os = bas2.pointer();
+        os->write_varint32(INT32_MAX);
+        os->write_varint32(INT32_MIN);
+        os->write_varuint64(300);
+        bas2->seek(0);
+        NUT_TA(bas2->read_varint32() == INT32_MAX);
+        NUT_TA(bas2->read_varint32() == INT32_MIN);
+        NUT_TA(bas2->read_varuint64() == 300);
+        NUT_TA(bas2->readable_size() == 0);
+    }
+
+    void test_array()
+    {
+        const uint16_t a16[11] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 0x1234, 0xabcd};
+        const uint32_t a32[5] = {1, 0x12345678, 3, 4, 0xdeadbeef};
+        const double ad[3] = {1.5, -2.25, 1e300};
+        for (int le = 0; le < 2; ++le)
+        {
+            rc_ptr<ByteArrayStream> bas = rc_new<ByteArrayStream>();
+            bas->set_little_endian(0 != le);
+            bas->write_array(a16, 11);
+            OutputStream *os = bas.pointer();
+            os->OutputStream::write_elements(a32, sizeof(uint32_t), 5); // 通用实现
+            bas->write_array(ad, 3);
+            NUT_TA(bas->size() == 22 + 20 + 24);
+
+            // 与逐个写入的结果相同
+            rc_ptr<ByteArrayStream> ref = rc_new<ByteArrayStream>();
+            ref->set_little_endian(0 != le);
+            for (size_t i = 0; i < 11; ++i)
+                ref->write_uint16(a16[i]);
+            for (size_t i = 0; i < 5; ++i)
+                ref->write_uint32(a32[i]);
+            for (size_t i = 0; i < 3; ++i)
+                ref->write_double(ad[i]);
+            NUT_TA(bas->byte_array() == ref->byte_array());
+
+            bas->seek(0);
+            uint16_t b16[11];
+            uint32_t b32[5];
+            double bd[3];
+            bas->read_array(b16, 11);
+            InputStream *is = bas.pointer();
+            is->InputStream::read_elements(b32, sizeof(uint32_t), 5); // 通用实现
+            bas->read_array(bd, 3);
+            NUT_TA(0 == ::memcmp(a16, b16, sizeof(a16)));
+            NUT_TA(0 == ::memcmp(a32, b32, sizeof(a32)));
+            NUT_TA(0 == ::memcmp(ad, bd, sizeof(ad)));
+        }
+    }
+
+    void test_truncated()
+    {
+        // 数组不完整: 只读出完整的元素, 其余填 0, 不越界
+        rc_ptr<ByteArrayStream> bas = rc_new<ByteArrayStream>();
+        const uint32_t a32[2] = {0x12345678, 0xdeadbeef};
+        bas->write_array(a32, 2);
+        bas->write_uint8(0xff);
+        bas->seek(0);
+        uint32_t b32[100];
+        ::memset(b32, 0xcc, sizeof(b32));
+        bas->read_array(b32, 100);
+        NUT_TA(b32[0] == a32[0] && b32[1] == a32[1] && b32[2] == 0 && b32[99] == 0);
+        NUT_TA(bas->readable_size() == 1);
+
+        // 截断的 varint: 返回 0 并跳过这些字节
+        bas->resize(0);
+        bas->write_uint8(0x80);
+        bas->write_uint8(0x80);
+        bas->seek(0);
+        NUT_TA(bas->read_varuint64() == 0);
+        NUT_TA(bas->readable_size() == 0);
+
+        uint64_t v = 0;
+        bas->seek(0);
+        NUT_TA(!bas->try_read_varuint64(&v));
+        NUT_TA(bas->readable_size() == 0);
+        NUT_TA(!bas->try_read_varuint64(&v));
+    }
 };
 
 NUT_REGISTER_FIXTURE(TestByteArrayStream, "container, quiet")
@@ -0,0 +1,230 @@
+﻿
+#include <iostream>
+
+#include <nut/unittest/unittest.h>
+
+#include <nut/rc/rc_new.h>
+#include <nut/container/bytestream/file_stream.h>
+
+#if !NUT_PLATFORM_OS_WINDOWS
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+#include <nut/platform/os.h>
+
+using namespace std;
+using namespace nut;
+
+class TestFileStream : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_small_buffer);
+        NUT_REGISTER_CASE(test_large_block);
+        NUT_REGISTER_CASE(test_pipe);
+        NUT_REGISTER_CASE(test_direct_io);
+        NUT_REGISTER_CASE(test_direct_io_fallback);
+        NUT_REGISTER_CASE(test_partial_write);
+    }
+
+    string _path;
+
+    virtual void set_up() override
+    {
+        _path = "/tmp/nut_test_file_stream_" + to_string(::getpid());
+    }
+
+    virtual void tear_down() override
+    {
+        OS::removefile(_path);
+    }
+
+    void test_small_buffer()
+    {
+        // 缓冲区很小, 定长读写频繁跨越缓冲区边界
+        {
+            rc_ptr<FileOutputStream> os = rc_new<FileOutputStream>(7);
+            NUT_TA(os->open(_path));
+            os->set_little_endian(false);
+            for (uint32_t i = 0; i < 100; ++i)
+            {
+                os->write_uint8((uint8_t) i);
+                os->write_uint32(i * 0x01010101);
+                os->write_int64(-(int64_t) i);
+            }
+            os->write_string("hello");
+            os->write_varuint64(300);
+            NUT_TA(os->close());
+        }
+
+        rc_ptr<FileInputStream> is = rc_new<FileInputStream>(7);
+        NUT_TA(is->open(_path));
+        NUT_TA(is->advise(FileInputStream::AccessHint::Sequential));
+        is->set_little_endian(false);
+        NUT_TA(is->readable_size() == 100 * 13 + 4 + 5 + 2);
+        for (uint32_t i = 0; i < 100; ++i)
+        {
+            NUT_TA(is->read_uint8() == (uint8_t) i);
+            NUT_TA(is->read_uint32() == i * 0x01010101);
+            NUT_TA(is->read_int64() == -(int64_t) i);
+        }
+        NUT_TA(is->read_string() == "hello");
+        NUT_TA(is->read_varuint64() == 300);
+        NUT_TA(is->readable_size() == 0);
+        char c;
+        NUT_TA(is->read(&c, 1) == 0);
+    }
+
+    void test_large_block()
+    {
+        vector<uint8_t> data(100000);
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = (uint8_t) (i * 7);
+
+        {
+            rc_ptr<FileOutputStream> os = rc_new<FileOutputStream>(4096);
+            NUT_TA(os->open(_path));
+            os->write_uint16(1);
+            NUT_TA(os->write(data.data(), data.size()) == data.size());
+            os->write_uint16(2);
+            NUT_TA(os->close());
+        }
+        {
+            rc_ptr<FileOutputStream> os = rc_new<FileOutputStream>(4096);
+            NUT_TA(os->open(_path, true));
+            os->write_uint16(3);
+        }
+
+        rc_ptr<FileInputStream> is = rc_new<FileInputStream>(4096);
+        NUT_TA(is->open(_path));
+        NUT_TA(is->prefetch(0, 4096));
+        NUT_TA(is->read_uint16() == 1);
+        vector<uint8_t> out(data.size());
+        NUT_TA(is->read(out.data(), 50000) == 50000);
+        is->skip_read(10000);
+        NUT_TA(is->read(out.data() + 60000, 40000) == 40000);
+        NUT_TA(0 == ::memcmp(out.data(), data.data(), 50000));
+        NUT_TA(0 == ::memcmp(out.data() + 60000, data.data() + 60000, 40000));
+        NUT_TA(is->read_uint16() == 2);
+        NUT_TA(is->read_uint16() == 3);
+        NUT_TA(is->readable_size() == 0);
+    }
+
+    void test_pipe()
+    {
+        int fds[2];
+        NUT_TA(0 == ::pipe(fds));
+
+        rc_ptr<FileOutputStream> os = rc_new<FileOutputStream>(16);
+        NUT_TA(os->attach(fds[1], true));
+        for (uint32_t i = 0; i < 10; ++i)
+            os->write_uint32(i);
+        NUT_TA(os->close());
+
+        rc_ptr<FileInputStream> is = rc_new<FileInputStream>(16);
+        NUT_TA(is->attach(fds[0], true));
+        uint32_t buf[10];
+        NUT_TA(is->read(buf, sizeof(buf)) == sizeof(buf));
+        for (uint32_t i = 0; i < 10; ++i)
+            NUT_TA(le32toh(buf[i]) == i);
+        NUT_TA(is->read(buf, 1) == 0);
+    }
+
+    void test_direct_io()
+    {
+        // 文件系统不支持 O_DIRECT(例如 tmpfs)时跳过
+        rc_ptr<FileOutputStream> os = rc_new<FileOutputStream>(1000);
+        if (!os->open(_path, false, true))
+            return;
+        for (uint32_t i = 0; i < 3000; ++i)
+            os->write_uint32(i);
+        NUT_TA(os->flush());
+        os->write_uint8(0xab);
+        NUT_TA(os->close());
+
+        rc_ptr<FileInputStream> is = rc_new<FileInputStream>(1000);
+        NUT_TA(is->open(_path, true));
+        NUT_TA(is->readable_size() == 3000 * 4 + 1);
+        is->skip_read(4);
+        for (uint32_t i = 1; i < 3000; ++i)
+            NUT_TA(is->read_uint32() == i);
+        NUT_TA(is->read_uint8() == 0xab);
+        NUT_TA(is->readable_size() == 0);
+    }
+
+    void test_direct_io_fallback()
+    {
+        {
+            rc_ptr<FileOutputStream> os = rc_new<FileOutputStream>(4096);
+            NUT_TA(os->open(_path));
+            for (uint32_t i = 0; i < 100; ++i)
+                os->write_uint32(i);
+            NUT_TA(os->close());
+        }
+
+        // 文件长度未按块对齐时追加
+        {
+            rc_ptr<FileOutputStream> os = rc_new<FileOutputStream>(4096);
+            if (!os->open(_path, true, true))
+                return; // 文件系统不支持 O_DIRECT
+            for (uint32_t i = 100; i < 2000; ++i)
+                os->write_uint32(i);
+            NUT_TA(os->close());
+        }
+
+#if defined(O_DIRECT)
+        // 带 O_APPEND 的文件描述符
+        {
+            const int fd = ::open(_path.c_str(), O_WRONLY | O_APPEND | O_DIRECT);
+            NUT_TA(fd >= 0);
+            rc_ptr<FileOutputStream> os = rc_new<FileOutputStream>(4096);
+            NUT_TA(os->attach(fd, true));
+            for (uint32_t i = 2000; i < 3000; ++i)
+                os->write_uint32(i);
+            NUT_TA(os->close());
+        }
+
+        // 从未对齐的位置开始读取
+        const int fd = ::open(_path.c_str(), O_RDONLY | O_DIRECT);
+        NUT_TA(fd >= 0);
+        NUT_TA(::lseek(fd, 40, SEEK_SET) == 40);
+        rc_ptr<FileInputStream> is = rc_new<FileInputStream>(4096);
+        NUT_TA(is->attach(fd, true));
+        NUT_TA(is->readable_size() == 3000 * 4 - 40);
+        for (uint32_t i = 10; i < 3000; ++i)
+            NUT_TA(is->read_uint32() == i);
+        NUT_TA(is->readable_size() == 0);
+#endif
+    }
+
+    void test_partial_write()
+    {
+        // 非阻塞的管道写满后出错, 返回值应当是实际写入管道的字节数
+        int fds[2];
+        NUT_TA(0 == ::pipe(fds));
+        NUT_TA(0 == ::fcntl(fds[1], F_SETFL, ::fcntl(fds[1], F_GETFL) | O_NONBLOCK));
+        NUT_TA(0 == ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK));
+
+        vector<uint8_t> data(1024 * 1024, 0x5a);
+        rc_ptr<FileOutputStream> os = rc_new<FileOutputStream>(4096);
+        NUT_TA(os->attach(fds[1], true));
+        const size_t written = os->write(data.data(), data.size());
+        NUT_TA(written > 0 && written < data.size());
+        NUT_TA(os->has_error());
+
+        size_t readed = 0;
+        ssize_t rs;
+        while ((rs = ::read(fds[0], data.data(), data.size())) > 0)
+            readed += (size_t) rs;
+        NUT_TA(readed == written);
+
+        os->close();
+        ::close(fds[0]);
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestFileStream, "container, quiet")
+
+#endif
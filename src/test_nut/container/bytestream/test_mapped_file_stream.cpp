@@ -0,0 +1,156 @@
+﻿
+#include <iostream>
+
+#include <nut/unittest/unittest.h>
+
+#include <nut/rc/rc_new.h>
+#include <nut/container/bytestream/mapped_file_stream.h>
+
+#if !NUT_PLATFORM_OS_WINDOWS
+
+#include <unistd.h>
+
+#include <nut/platform/os.h>
+
+using namespace std;
+using namespace nut;
+
+class TestMappedFileStream : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_write_read);
+        NUT_REGISTER_CASE(test_grow_append);
+        NUT_REGISTER_CASE(test_empty_file);
+        NUT_REGISTER_CASE(test_read_past_end);
+    }
+
+    string _path;
+
+    virtual void set_up() override
+    {
+        _path = "/tmp/nut_test_mapped_file_stream_" + to_string(::getpid());
+    }
+
+    virtual void tear_down() override
+    {
+        OS::removefile(_path);
+    }
+
+    void test_write_read()
+    {
+        {
+            rc_ptr<WritableMappedFileStream> ws = rc_new<WritableMappedFileStream>();
+            NUT_TA(ws->open(_path));
+            ws->set_little_endian(false);
+            ws->write_uint32(0x12345678);
+            ws->write_varint64(-300);
+            ws->write_string("abc");
+            const uint16_t arr[5] = {1, 2, 0x0304, 0xfffe, 5};
+            ws->write_array(arr, 5);
+            NUT_TA(ws->size() == ws->tell());
+
+            // 回写覆盖
+            ws->seek(0);
+            ws->write_uint8(0x11);
+            NUT_TA(ws->tell() == 1);
+        }
+
+        rc_ptr<MappedFileStream> rs = rc_new<MappedFileStream>();
+        NUT_TA(rs->open(_path));
+        NUT_TA(rs->advise(MappedFileStream::AccessHint::Sequential));
+        rs->set_little_endian(false);
+        NUT_TA(((const uint8_t*) rs->data())[0] == 0x11);
+        NUT_TA(rs->read_uint32() == 0x11345678);
+        NUT_TA(rs->read_varint64() == -300);
+        NUT_TA(rs->read_string() == "abc");
+        uint16_t arr[5];
+        rs->read_array(arr, 5);
+        NUT_TA(arr[0] == 1 && arr[2] == 0x0304 && arr[3] == 0xfffe && arr[4] == 5);
+        NUT_TA(rs->readable_size() == 0);
+
+        rs->seek(1);
+        NUT_TA(*(const uint8_t*) rs->readable_pointer() == 0x34);
+        NUT_TA(rs->advise(MappedFileStream::AccessHint::Random));
+    }
+
+    void test_grow_append()
+    {
+        // 跨越多个页面增长
+        const size_t count = 10000;
+        {
+            rc_ptr<WritableMappedFileStream> ws = rc_new<WritableMappedFileStream>();
+            NUT_TA(ws->open(_path));
+            for (size_t i = 0; i < count / 2; ++i)
+                ws->write_uint32((uint32_t) i);
+        }
+        {
+            rc_ptr<WritableMappedFileStream> ws = rc_new<WritableMappedFileStream>();
+            NUT_TA(ws->open(_path, true));
+            NUT_TA(ws->tell() == count / 2 * 4);
+            for (size_t i = count / 2; i < count; ++i)
+                ws->write_uint32((uint32_t) i);
+            NUT_TA(ws->flush());
+        }
+
+        rc_ptr<MappedFileStream> rs = rc_new<MappedFileStream>();
+        NUT_TA(rs->open(_path));
+        NUT_TA(rs->size() == count * 4);
+        for (size_t i = 0; i < count; ++i)
+            NUT_TA(rs->read_uint32() == i);
+    }
+
+    void test_empty_file()
+    {
+        {
+            rc_ptr<WritableMappedFileStream> ws = rc_new<WritableMappedFileStream>();
+            NUT_TA(ws->open(_path));
+        }
+
+        rc_ptr<MappedFileStream> rs = rc_new<MappedFileStream>();
+        NUT_TA(!rs->is_open());
+        NUT_TA(rs->open(_path));
+        NUT_TA(rs->is_open());
+        NUT_TA(rs->size() == 0 && rs->readable_size() == 0);
+        NUT_TA(nullptr == rs->readable_pointer());
+        char c;
+        NUT_TA(rs->read(&c, 1) == 0);
+
+        rs->close();
+        NUT_TA(!rs->is_open());
+        NUT_TA(!rs->open(_path + ".not_exist"));
+    }
+
+    void test_read_past_end()
+    {
+        {
+            rc_ptr<WritableMappedFileStream> ws = rc_new<WritableMappedFileStream>();
+            NUT_TA(ws->open(_path));
+            ws->set_little_endian(false);
+            const uint32_t arr[3] = {1, 2, 3};
+            ws->write_array(arr, 3);
+            ws->write_uint8(0xff); // 不完整的元素
+        }
+
+        // 截断的文件: 只读出完整的元素, 其余填 0, 不越过映射区域
+        rc_ptr<MappedFileStream> rs = rc_new<MappedFileStream>();
+        NUT_TA(rs->open(_path));
+        rs->set_little_endian(false);
+        rs->skip_read(4);
+        uint32_t arr[1000];
+        ::memset(arr, 0xcc, sizeof(arr));
+        rs->read_array(arr, 1000);
+        NUT_TA(arr[0] == 2 && arr[1] == 3 && arr[2] == 0 && arr[999] == 0);
+        NUT_TA(rs->tell() == 12 && rs->readable_size() == 1);
+
+        rs->skip_read(100);
+        NUT_TA(rs->readable_size() == 0);
+        uint16_t s = 7;
+        rs->read_array(&s, 1);
+        NUT_TA(0 == s);
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestMappedFileStream, "container, quiet")
+
+#endif
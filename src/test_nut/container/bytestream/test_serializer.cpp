@@ -0,0 +1,317 @@
+﻿
+#include <iostream>
+
+#include <nut/unittest/unittest.h>
+
+#include <nut/rc/rc_new.h>
+#include <nut/container/bytestream/serializer.h>
+
+using namespace std;
+using namespace nut;
+
+namespace
+{
+
+enum class Color : int8_t
+{
+    Red = -1,
+    Green = 1,
+};
+
+struct Inner
+{
+    int32_t id = 0;
+    string name;
+    vector<double> values;
+
+    NUT_SERIALIZABLE(
+        NUT_FIELD(1, id),
+        NUT_FIELD(2, name),
+        NUT_OPTIONAL_FIELD(3, values))
+};
+
+struct Outer
+{
+    bool flag = false;
+    uint8_t u8 = 0;
+    int64_t i64 = 0;
+    uint64_t u64 = 0;
+    float f = 0;
+    Color color = Color::Green;
+    vector<uint8_t> bytes;
+    vector<int32_t> ints;
+    vector<string> strs;
+    map<string, Inner> inners;
+    unordered_map<uint32_t, vector<bool>> bits;
+    Inner single;
+
+    NUT_SERIALIZABLE(
+        NUT_FIELD(1, flag),
+        NUT_FIELD(2, u8),
+        NUT_FIELD(3, i64),
+        NUT_FIELD(4, u64),
+        NUT_FIELD(5, f),
+        NUT_FIELD(6, color),
+        NUT_FIELD(7, bytes),
+        NUT_FIELD(8, ints),
+        NUT_FIELD(9, strs),
+        NUT_FIELD(10, inners),
+        NUT_FIELD(11, bits),
+        NUT_FIELD(12, single))
+};
+
+// 同一结构的两个版本: V2 删除了字段 2, 增加了字段 3、4
+struct RecordV1
+{
+    uint32_t a = 0;
+    string b;
+
+    NUT_SERIALIZABLE(
+        NUT_FIELD(1, a),
+        NUT_FIELD(2, b))
+};
+
+struct RecordV2
+{
+    uint32_t a = 0;
+    vector<Inner> c;
+    double d = 1.5;
+
+    NUT_SERIALIZABLE(
+        NUT_FIELD(1, a),
+        NUT_FIELD(3, c),
+        NUT_FIELD(4, d))
+};
+
+// 自定义的变长类型, 记录内容长度被计算的次数
+struct Counted
+{
+    string s;
+};
+
+int counted_sizes = 0;
+
+struct Nested
+{
+    vector<vector<Counted>> grid;
+    map<uint32_t, vector<Counted>> groups;
+
+    NUT_SERIALIZABLE(
+        NUT_FIELD(1, grid),
+        NUT_FIELD(2, groups))
+};
+
+}
+
+namespace nut
+{
+
+template <>
+struct Serializer<Counted> : public LengthDelimitedSerializer<Counted, Serializer<Counted>>
+{
+    static bool is_default(const Counted& v) noexcept
+    {
+        return v.s.empty();
+    }
+
+    static size_t payload_size(const Counted& v, SerialSizeCache *) noexcept
+    {
+        ++counted_sizes;
+        return v.s.length();
+    }
+
+    template <typename OS>
+    static void write_payload(OS& os, const Counted& v, SerialSizeCache *)
+    {
+        os.write(v.s.data(), v.s.length());
+    }
+
+    template <typename IS>
+    static bool read_payload(IS& is, size_t end, Counted *v)
+    {
+        v->s.resize(is.readable_size() - end);
+        return v->s.empty() || is.read(&v->s[0], v->s.length()) == v->s.length();
+    }
+};
+
+}
+
+class TestSerializer : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_roundtrip);
+        NUT_REGISTER_CASE(test_optional);
+        NUT_REGISTER_CASE(test_compatible);
+        NUT_REGISTER_CASE(test_malformed);
+        NUT_REGISTER_CASE(test_nested_size);
+    }
+
+    void test_roundtrip()
+    {
+        Outer o;
+        o.flag = true;
+        o.u8 = 200;
+        o.i64 = -1234567890123LL;
+        o.u64 = 0xfedcba9876543210ULL;
+        o.f = 3.25f;
+        o.color = Color::Red;
+        o.bytes = {0, 1, 0x80, 0xff};
+        o.ints = {-1, 0, 1, 0x7fffffff};
+        o.strs = {"", "abc", string(300, 'x')};
+        o.inners["k1"].id = 7;
+        o.inners["k1"].values = {1.5, -2.5};
+        o.inners["k2"].name = "n2";
+        o.bits[5] = {true, false, true};
+        o.single.id = -9;
+        o.single.name = "single";
+
+        rc_ptr<ByteArrayStream> bas = rc_new<ByteArrayStream>();
+        bas->set_little_endian(false);
+        serialize(*bas, o);
+        NUT_TA(bas->size() == serialized_size(o));
+
+        bas->seek(0);
+        Outer r;
+        NUT_TA(deserialize(*bas, &r));
+        NUT_TA(bas->readable_size() == 0);
+        NUT_TA(r.flag && r.u8 == 200 && r.i64 == o.i64 && r.u64 == o.u64);
+        NUT_TA(r.f == 3.25f && r.color == Color::Red);
+        NUT_TA(r.bytes == o.bytes && r.ints == o.ints && r.strs == o.strs);
+        NUT_TA(r.inners.size() == 2 && r.inners["k1"].id == 7 && r.inners["k1"].values == o.inners["k1"].values);
+        NUT_TA(r.inners["k2"].name == "n2");
+        NUT_TA(r.bits == o.bits);
+        NUT_TA(r.single.id == -9 && r.single.name == "single");
+
+        // 通过基类接口编解码
+        OutputStream& os = *bas;
+        bas->resize(0);
+        serialize(os, o);
+        NUT_TA(bas->size() == serialized_size(o));
+        bas->seek(0);
+        InputStream& is = *bas;
+        Outer r2;
+        NUT_TA(deserialize(is, &r2));
+        NUT_TA(r2.bytes == o.bytes && r2.single.name == "single");
+    }
+
+    void test_optional()
+    {
+        Inner i;
+        i.id = 1;
+        // values 为空, 不写出; name 为空仍写出
+        NUT_TA(serialized_size(i) == 1 + 2 + 2);
+        i.values.push_back(1);
+        NUT_TA(serialized_size(i) == 1 + 2 + 2 + 2 + 8);
+    }
+
+    void test_compatible()
+    {
+        rc_ptr<ByteArrayStream> bas = rc_new<ByteArrayStream>();
+
+        RecordV1 v1;
+        v1.a = 100;
+        v1.b = "dropped";
+        serialize(*bas, v1);
+
+        // 新版本读旧数据: 跳过未知字段, 新字段保持默认值
+        bas->seek(0);
+        RecordV2 v2;
+        NUT_TA(deserialize(*bas, &v2));
+        NUT_TA(v2.a == 100 && v2.c.empty() && v2.d == 1.5);
+
+        // 旧版本读新数据
+        v2.c.resize(2);
+        v2.c[1].name = "x";
+        v2.d = 2.5;
+        bas->resize(0);
+        serialize(*bas, v2);
+        bas->seek(0);
+        RecordV1 v1r;
+        NUT_TA(deserialize(*bas, &v1r));
+        NUT_TA(v1r.a == 100 && v1r.b.empty());
+        NUT_TA(bas->readable_size() == 0);
+    }
+
+    void test_malformed()
+    {
+        Inner i;
+        i.name = "abcdef";
+        rc_ptr<ByteArrayStream> bas = rc_new<ByteArrayStream>();
+        serialize(*bas, i);
+
+        // 截断
+        bas->resize(bas->size() - 2);
+        bas->seek(0);
+        Inner r;
+        NUT_TA(!deserialize(*bas, &r));
+
+        // 长度与内容不符
+        rc_ptr<ByteArrayStream> bas2 = rc_new<ByteArrayStream>();
+        bas2->write_varuint32(3);
+        bas2->write_varuint32((2 << 2) | 3); // name
+        bas2->write_varuint32(5);
+        bas2->write("abcde", 5);
+        bas2->seek(0);
+        NUT_TA(!deserialize(*bas2, &r));
+
+        // 截断的 varint、标签为 0、截断的长度, 不能死循环
+        const uint8_t corrupt[][3] = {
+            {0x02, 0x80, 0x80},
+            {0x02, 0x00, 0x00},
+            {0x02, 0x08, 0x80},
+            {0x02, 0x13, 0xff},
+            {0x80, 0x80, 0x80},
+        };
+        for (const auto& data : corrupt)
+        {
+            RecordV1 rec;
+            bas2->resize(0);
+            bas2->write(data, sizeof(data));
+            bas2->seek(0);
+            NUT_TA(!deserialize(*bas2, &rec));
+
+            // 通过基类接口
+            bas2->seek(0);
+            InputStream& is = *bas2;
+            NUT_TA(!deserialize(is, &rec));
+        }
+    }
+
+    void test_nested_size()
+    {
+        vector<Nested> v(3);
+        size_t count = 0;
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            v[i].grid.resize(i + 1, vector<Counted>(4));
+            v[i].groups[7].resize(i + 2);
+            count += 4 * (i + 1) + (i + 2);
+        }
+        v[2].grid[1][3].s = "abc";
+        v[1].groups[7][0].s = string(200, 'x');
+
+        // 嵌套多层时, 每个元素的长度只计算一次
+        rc_ptr<ByteArrayStream> bas = rc_new<ByteArrayStream>();
+        counted_sizes = 0;
+        serialize(*bas, v);
+        NUT_TA(counted_sizes == (int) count);
+
+        // 通过基类接口编码, 结果相同
+        rc_ptr<ByteArrayStream> bas2 = rc_new<ByteArrayStream>();
+        OutputStream& os = *bas2;
+        counted_sizes = 0;
+        serialize(os, v);
+        NUT_TA(counted_sizes == (int) count);
+        NUT_TA(bas2->byte_array() == bas->byte_array() && bas->size() == serialized_size(v));
+
+        bas->seek(0);
+        vector<Nested> r;
+        NUT_TA(deserialize(*bas, &r));
+        NUT_TA(r.size() == 3 && r[2].grid.size() == 3 && r[2].grid[1][3].s == "abc");
+        NUT_TA(r[1].groups[7].size() == 3 && r[1].groups[7][0].s == v[1].groups[7][0].s);
+        NUT_TA(bas->readable_size() == 0);
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestSerializer, "container, quiet")
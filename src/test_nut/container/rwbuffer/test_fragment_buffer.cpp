@@ -3,6 +3,10 @@
 
 #include <nut/container/rwbuffer/fragment_buffer.h>
 
+#if !NUT_PLATFORM_OS_WINDOWS
+#   include <unistd.h>
+#endif
+
 using namespace std;
 using namespace nut;
 
@@ -11,6 +15,11 @@ class TestFragmentBuffer : public TestFixture
     virtual void register_cases() noexcept override
     {
         NUT_REGISTER_CASE(test_smoke);
+        NUT_REGISTER_CASE(test_copy);
+        NUT_REGISTER_CASE(test_slice_cut_append);
+#if !NUT_PLATFORM_OS_WINDOWS
+        NUT_REGISTER_CASE(test_fd_io);
+#endif
     }
 
     void test_smoke()
@@ -59,6 +68,116 @@ class TestFragmentBuffer : public TestFixture
         NUT_TA(v == 0x7856);
         NUT_TA(fb.readable_size() == 6);
     }
+
+    void test_copy()
+    {
+        FragmentBuffer fb;
+        FragmentBuffer::Fragment *f = FragmentBuffer::new_fragment(3);
+        ::memcpy(f->buffer, "abc", 3);
+        f->size = 3;
+        fb.write_fragment(f);
+        f = FragmentBuffer::new_fragment(4);
+        ::memcpy(f->buffer, "defg", 4);
+        f->size = 4;
+        fb.write_fragment(f);
+        fb.skip_read(1);
+
+        // 复制共享 fragment
+        FragmentBuffer fb2(fb);
+        NUT_TA(fb2.readable_size() == 6);
+        const void *bufs1[2], *bufs2[2];
+        size_t lens1[2], lens2[2];
+        NUT_TA(fb.readable_pointers(bufs1, lens1, 2) == 2);
+        NUT_TA(fb2.readable_pointers(bufs2, lens2, 2) == 2);
+        NUT_TA(bufs1[0] == bufs2[0] && bufs1[1] == bufs2[1]);
+
+        // 共享的 fragment 不会被追加, 原来的数据不变
+        fb2.write("xyz", 3);
+        char out[9];
+        NUT_TA(fb.read(out, 9) == 6);
+        NUT_TA(0 == ::memcmp(out, "bcdefg", 6));
+        NUT_TA(fb2.read(out, 9) == 9);
+        NUT_TA(0 == ::memcmp(out, "bcdefgxyz", 9));
+
+        FragmentBuffer fb3;
+        fb3 = fb2;
+        NUT_TA(fb3.readable_size() == 0);
+    }
+
+    void test_slice_cut_append()
+    {
+        FragmentBuffer fb;
+        const char *msgs = "hello|world|!";
+        fb.write(msgs, 13);
+
+        FragmentBuffer s = fb.slice(6, 100);
+        NUT_TA(s.readable_size() == 7);
+        NUT_TA(fb.readable_size() == 13);
+        const void *buf1 = nullptr, *buf2 = nullptr;
+        size_t len = 0;
+        NUT_TA(s.readable_pointers(&buf1, &len, 1) == 1);
+        NUT_TA(fb.readable_pointers(&buf2, &len, 1) == 1);
+        NUT_TA(buf1 == (const uint8_t*) buf2 + 6); // 没有复制
+        NUT_TA(fb.slice(13, 1).readable_size() == 0);
+
+        // 在消息边界处拆分
+        FragmentBuffer head = fb.cut(6);
+        NUT_TA(head.readable_size() == 6 && fb.readable_size() == 7);
+        char out[13];
+        NUT_TA(head.look_ahead(out, 6) == 6);
+        NUT_TA(0 == ::memcmp(out, "hello|", 6));
+
+        // 拼接回去, 相邻的引用被合并
+        head.append(std::move(fb));
+        NUT_TA(fb.readable_size() == 0);
+        NUT_TA(head.readable_size() == 13);
+        NUT_TA(head.readable_pointers(&buf1, &len, 1) == 1 && len == 13);
+        head.append(s);
+        NUT_TA(head.readable_size() == 20);
+        NUT_TA(s.readable_size() == 7);
+        head.append(head);
+        NUT_TA(head.readable_size() == 40);
+        head.skip_read(26);
+        NUT_TA(head.read(out, 13) == 13);
+        NUT_TA(0 == ::memcmp(out, "world|!", 7));
+        NUT_TA(0 == ::memcmp(out + 7, "world|", 6));
+    }
+
+#if !NUT_PLATFORM_OS_WINDOWS
+    void test_fd_io()
+    {
+        int fds[2];
+        NUT_TA(0 == ::pipe(fds));
+
+        FragmentBuffer fb;
+        char data[300];
+        for (size_t i = 0; i < sizeof(data); ++i)
+            data[i] = (char) i;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            // 多个 fragment
+            FragmentBuffer::Fragment *f = FragmentBuffer::new_fragment(100);
+            ::memcpy(f->buffer, data + 100 * i, 100);
+            f->size = 100;
+            NUT_TA(nullptr == fb.write_fragment(f));
+        }
+        NUT_TA(fb.write_to_fd(fds[1]) == 300);
+        NUT_TA(fb.readable_size() == 0);
+
+        // 先写入一部分，使最后一个 fragment 有空余空间
+        fb.write(data, 10);
+        NUT_TA(fb.read_from_fd(fds[0], 290) == 290);
+        NUT_TA(fb.read_from_fd(fds[0], 100) == 10);
+        NUT_TA(fb.readable_size() == 310);
+        char out[310];
+        NUT_TA(fb.read(out, 310) == 310);
+        NUT_TA(0 == ::memcmp(out, data, 10) && 0 == ::memcmp(out + 10, data, 300));
+
+        ::close(fds[1]);
+        NUT_TA(fb.read_from_fd(fds[0]) == 0); // EOF
+        ::close(fds[0]);
+    }
+#endif
 };
 
 NUT_REGISTER_FIXTURE(TestFragmentBuffer, "container, quiet")
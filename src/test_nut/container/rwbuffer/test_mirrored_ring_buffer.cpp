@@ -0,0 +1,131 @@
+﻿
+#include <iostream>
+
+#include <nut/unittest/unittest.h>
+
+#include <nut/container/rwbuffer/mirrored_ring_buffer.h>
+
+#if !NUT_PLATFORM_OS_WINDOWS
+
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace nut;
+
+class TestMirroredRingBuffer : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_smoke);
+        NUT_REGISTER_CASE(test_wrap_contiguous);
+        NUT_REGISTER_CASE(test_grow_wrapped);
+        NUT_REGISTER_CASE(test_fd_io);
+    }
+
+    void test_smoke()
+    {
+        MirroredRingBuffer rb;
+        NUT_TA(rb.readable_size() == 0);
+        NUT_TA(rb.writable_size() == 0);
+        NUT_TA(nullptr == rb.readable_pointer());
+
+        uint8_t buf[10];
+        for (size_t i = 0; i < 10; ++i)
+            buf[i] = (uint8_t) i;
+        NUT_TA(rb.write(buf, 10) == 10);
+        NUT_TA(rb.readable_size() == 10);
+        NUT_TA(rb.capacity() > 0 && rb.readable_size() + rb.writable_size() == rb.capacity());
+
+        uint8_t out[10];
+        NUT_TA(rb.look_ahead(out, 10) == 10);
+        NUT_TA(0 == ::memcmp(out, buf, 10));
+        NUT_TA(rb.read(out, 2) == 2);
+        NUT_TA(rb.readable_size() == 8);
+        NUT_TA(0 == ::memcmp(rb.readable_pointer(), buf + 2, 8));
+
+        MirroredRingBuffer rb2(rb);
+        NUT_TA(rb2.readable_size() == 8);
+        NUT_TA(0 == ::memcmp(rb2.readable_pointer(), buf + 2, 8));
+    }
+
+    void test_wrap_contiguous()
+    {
+        MirroredRingBuffer rb(1);
+        const size_t cap = rb.capacity();
+        NUT_TA(cap > 0 && rb.writable_size() == cap);
+
+        // 写满后读掉大半, 再写入使数据环绕
+        rb.skip_write(cap);
+        rb.skip_read(cap - 4);
+        char msg[] = "wrapped-around-message";
+        NUT_TA(rb.write(msg, sizeof(msg)) == sizeof(msg));
+        NUT_TA(rb.capacity() == cap);
+
+        // 环绕的数据也只有一段
+        const void *rbufs[2];
+        size_t lens[2];
+        NUT_TA(rb.readable_pointers(rbufs, lens, rbufs + 1, lens + 1) == 1);
+        NUT_TA(lens[0] == 4 + sizeof(msg));
+        NUT_TA(0 == ::memcmp((const uint8_t*) rbufs[0] + 4, msg, sizeof(msg)));
+
+        void *wbufs[2];
+        NUT_TA(rb.writable_pointers(wbufs, lens, wbufs + 1, lens + 1) == 1);
+        NUT_TA(lens[0] == cap - 4 - sizeof(msg));
+    }
+
+    void test_grow_wrapped()
+    {
+        for (size_t head_len : {16, 3000})
+        {
+            MirroredRingBuffer rb(1);
+            const size_t cap = rb.capacity();
+
+            // 环绕状态: 末尾 head_len 字节, 开头 tail_len 字节
+            const size_t tail_len = cap / 2;
+            std::string expected;
+            rb.skip_write(cap - head_len);
+            rb.skip_read(cap - head_len);
+            for (size_t i = 0; i < head_len + tail_len; ++i)
+                expected.push_back((char) ('a' + i % 26));
+            NUT_TA(rb.write(expected.data(), expected.length()) == expected.length());
+
+            // 扩容后数据不变
+            std::string more(cap, 'z');
+            NUT_TA(rb.write(more.data(), more.length()) == more.length());
+            NUT_TA(rb.capacity() > cap);
+            expected += more;
+            NUT_TA(rb.readable_size() == expected.length());
+            NUT_TA(0 == ::memcmp(rb.readable_pointer(), expected.data(), expected.length()));
+        }
+    }
+
+    void test_fd_io()
+    {
+        int fds[2];
+        NUT_TA(0 == ::pipe(fds));
+
+        MirroredRingBuffer rb(1);
+        const size_t cap = rb.capacity();
+        rb.skip_write(cap);
+        rb.skip_read(cap - 2);
+        uint8_t buf[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+        rb.write(buf, 8);
+        NUT_TA(rb.write_to_fd(fds[1]) == 10);
+        NUT_TA(rb.readable_size() == 0);
+
+        NUT_TA(rb.read_from_fd(fds[0], 3) == 3);
+        NUT_TA(rb.read_from_fd(fds[0]) == 7);
+        uint8_t out[10];
+        NUT_TA(rb.read(out, 10) == 10);
+        NUT_TA(0 == ::memcmp(out + 2, buf, 8));
+
+        ::close(fds[1]);
+        NUT_TA(rb.read_from_fd(fds[0]) == 0); // EOF
+        ::close(fds[0]);
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestMirroredRingBuffer, "container, quiet")
+
+#endif
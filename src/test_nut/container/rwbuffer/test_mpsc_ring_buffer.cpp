@@ -0,0 +1,182 @@
+﻿
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <nut/unittest/unittest.h>
+
+#include <nut/container/rwbuffer/mpsc_ring_buffer.h>
+
+using namespace std;
+using namespace nut;
+
+class TestMPSCRingBuffer : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_smoke);
+        NUT_REGISTER_CASE(test_out_of_order_commit);
+        NUT_REGISTER_CASE(test_multi_thread);
+        NUT_REGISTER_CASE(test_never_spuriously_full);
+    }
+
+    void test_smoke()
+    {
+        MPSCRingBuffer rb(64);
+        NUT_TA(rb.capacity() == 64);
+        NUT_TA(rb.max_record_size() == 24);
+        NUT_TA(nullptr == rb.reserve(25));
+
+        const void *buf = nullptr;
+        size_t len = 0;
+        NUT_TA(rb.readable_pointers(&buf, &len) == 0);
+        NUT_TA(!rb.skip_read());
+
+        NUT_TA(rb.write("hello", 5));
+        NUT_TA(rb.write("", 0));
+        NUT_TA(rb.readable_pointers(&buf, &len) == 1);
+        NUT_TA(len == 5 && 0 == ::memcmp(buf, "hello", 5));
+        NUT_TA(rb.skip_read());
+        NUT_TA(rb.readable_pointers(&buf, &len) == 1);
+        NUT_TA(len == 0);
+        NUT_TA(rb.skip_read());
+
+        // 记录不会跨越末尾
+        for (int i = 0; i < 10; ++i)
+        {
+            char data[20];
+            ::memset(data, 'a' + i, sizeof(data));
+            NUT_TA(rb.write(data, sizeof(data)));
+            NUT_TA(rb.readable_pointers(&buf, &len) == 1);
+            NUT_TA(len == sizeof(data) && 0 == ::memcmp(buf, data, sizeof(data)));
+            NUT_TA(rb.skip_read());
+        }
+    }
+
+    void test_out_of_order_commit()
+    {
+        MPSCRingBuffer rb(128);
+        void *a = rb.reserve(3), *b = rb.reserve(4);
+        NUT_TA(nullptr != a && nullptr != b);
+        ::memcpy(b, "bbbb", 4);
+        rb.commit(b);
+
+        // 前面的记录未提交, 后面的记录不可读
+        NUT_TA(rb.readable_pointers(nullptr, nullptr) == 0);
+
+        ::memcpy(a, "aaa", 3);
+        rb.commit(a);
+        const void *buf = nullptr;
+        size_t len = 0;
+        NUT_TA(rb.readable_pointers(&buf, &len) == 1);
+        NUT_TA(len == 3 && 0 == ::memcmp(buf, "aaa", 3));
+        NUT_TA(rb.skip_read());
+        NUT_TA(rb.readable_pointers(&buf, &len) == 1);
+        NUT_TA(len == 4 && 0 == ::memcmp(buf, "bbbb", 4));
+        NUT_TA(rb.skip_read());
+    }
+
+    void test_multi_thread()
+    {
+        const unsigned producers = 4, count = 20000;
+        MPSCRingBuffer rb(4096);
+
+        vector<thread> threads;
+        for (unsigned p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&rb, p, count] {
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    // 变长记录: producer, seq, 然后 seq % 17 个填充字节
+                    const size_t len = 2 * sizeof(unsigned) + i % 17;
+                    uint8_t *data;
+                    while (nullptr == (data = (uint8_t*) rb.reserve(len)))
+                        this_thread::yield();
+                    ::memcpy(data, &p, sizeof(p));
+                    ::memcpy(data + sizeof(p), &i, sizeof(i));
+                    ::memset(data + 2 * sizeof(unsigned), (int) i, i % 17);
+                    rb.commit(data);
+                }
+            });
+        }
+
+        vector<unsigned> next(producers, 0);
+        size_t received = 0;
+        bool ok = true;
+        while (received < producers * count)
+        {
+            const void *buf = nullptr;
+            size_t len = 0;
+            if (0 == rb.readable_pointers(&buf, &len))
+            {
+                this_thread::yield();
+                continue;
+            }
+            unsigned p, i;
+            ::memcpy(&p, buf, sizeof(p));
+            ::memcpy(&i, (const uint8_t*) buf + sizeof(p), sizeof(i));
+            ok = ok && p < producers && i == next[p] && len == 2 * sizeof(unsigned) + i % 17;
+            if (p < producers)
+                ++next[p];
+            rb.skip_read();
+            ++received;
+        }
+        for (thread& t : threads)
+            t.join();
+        NUT_TA(ok);
+        NUT_TA(rb.readable_pointers(nullptr, nullptr) == 0);
+    }
+
+    void test_never_spuriously_full()
+    {
+        // 每个生产者最多只有一条未被消费的记录, 占用远小于容量, reserve() 不应失败
+        const unsigned producers = 4, count = 20000;
+        MPSCRingBuffer rb(1024);
+        atomic<unsigned> consumed[producers];
+        for (unsigned p = 0; p < producers; ++p)
+            consumed[p].store(0);
+        atomic<unsigned> failures(0);
+
+        vector<thread> threads;
+        for (unsigned p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&rb, &consumed, &failures, p, count] {
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    void *data = rb.reserve(sizeof(p) + i % 13);
+                    if (nullptr == data)
+                    {
+                        ++failures;
+                        return;
+                    }
+                    ::memcpy(data, &p, sizeof(p));
+                    rb.commit(data);
+                    while (consumed[p].load() <= i)
+                        this_thread::yield();
+                }
+            });
+        }
+
+        unsigned received = 0;
+        while (received < producers * count && 0 == failures.load())
+        {
+            const void *buf = nullptr;
+            if (0 == rb.readable_pointers(&buf, nullptr))
+            {
+                this_thread::yield();
+                continue;
+            }
+            unsigned p;
+            ::memcpy(&p, buf, sizeof(p));
+            rb.skip_read();
+            ++consumed[p];
+            ++received;
+        }
+        for (thread& t : threads)
+            t.join();
+        NUT_TA(0 == failures.load());
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestMPSCRingBuffer, "container, quiet")
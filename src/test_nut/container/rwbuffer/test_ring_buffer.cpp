@@ -5,6 +5,10 @@
 
 #include <nut/container/rwbuffer/ring_buffer.h>
 
+#if !NUT_PLATFORM_OS_WINDOWS
+#   include <unistd.h>
+#endif
+
 using namespace std;
 using namespace nut;
 
@@ -14,6 +18,9 @@ class TestRingBuffer : public TestFixture
     {
         NUT_REGISTER_CASE(test_smoke);
         NUT_REGISTER_CASE(test_wrap_write);
+#if !NUT_PLATFORM_OS_WINDOWS
+        NUT_REGISTER_CASE(test_fd_io);
+#endif
     }
 
     void test_smoke()
@@ -95,6 +102,39 @@ class TestRingBuffer : public TestFixture
         NUT_TA(rb.read(&v, 2) == 2);      // |------
         NUT_TA(v == 0x7856);
     }
+
+#if !NUT_PLATFORM_OS_WINDOWS
+    void test_fd_io()
+    {
+        int fds[2];
+        NUT_TA(0 == ::pipe(fds));
+
+        // 构造环写状态，使可读、可写区域都分成两段
+        RingBuffer rb;
+        uint8_t buf[16];
+        for (size_t i = 0; i < 16; ++i)
+            buf[i] = (uint8_t) i;
+        rb.write(buf, 10);
+        rb.skip_read(8);
+        rb.write(buf + 10, 6);
+        const void *rbufs[2];
+        size_t lens[2];
+        NUT_TA(rb.readable_pointers(rbufs, lens, rbufs + 1, lens + 1) == 2);
+
+        NUT_TA(rb.write_to_fd(fds[1]) == 8);
+        NUT_TA(rb.readable_size() == 0);
+
+        NUT_TA(rb.read_from_fd(fds[0], 3) == 3);
+        NUT_TA(rb.read_from_fd(fds[0]) == 5);
+        uint8_t out[8];
+        NUT_TA(rb.read(out, 8) == 8);
+        NUT_TA(0 == ::memcmp(out, buf + 8, 8));
+
+        ::close(fds[1]);
+        NUT_TA(rb.read_from_fd(fds[0]) == 0); // EOF
+        ::close(fds[0]);
+    }
+#endif
 };
 
 NUT_REGISTER_FIXTURE(TestRingBuffer, "container, quiet")
@@ -0,0 +1,116 @@
+﻿
+#include <iostream>
+#include <thread>
+
+#include <nut/unittest/unittest.h>
+
+#include <nut/container/rwbuffer/spsc_ring_buffer.h>
+
+using namespace std;
+using namespace nut;
+
+class TestSPSCRingBuffer : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_smoke);
+        NUT_REGISTER_CASE(test_wrap);
+        NUT_REGISTER_CASE(test_multi_thread);
+    }
+
+    void test_smoke()
+    {
+        SPSCRingBuffer rb(10);
+        NUT_TA(rb.capacity() == 16);
+        NUT_TA(rb.readable_size() == 0);
+        NUT_TA(rb.writable_size() == 16);
+
+        uint8_t buf[20];
+        for (size_t i = 0; i < 20; ++i)
+            buf[i] = (uint8_t) i;
+        NUT_TA(rb.write(buf, 20) == 16); // 只写入一部分
+        NUT_TA(rb.readable_size() == 16);
+        NUT_TA(rb.writable_size() == 0);
+
+        uint8_t out[16];
+        NUT_TA(rb.look_ahead(out, 4) == 4);
+        NUT_TA(0 == ::memcmp(out, buf, 4));
+        NUT_TA(rb.read(out, 4) == 4);
+        NUT_TA(0 == ::memcmp(out, buf, 4));
+        NUT_TA(rb.readable_size() == 12);
+        NUT_TA(rb.writable_size() == 4);
+    }
+
+    void test_wrap()
+    {
+        SPSCRingBuffer rb(8);
+        rb.skip_write(6);
+        rb.skip_read(6);
+
+        // 零拷贝写入, 可写区域分成两段
+        void *wbufs[2];
+        size_t lens[2];
+        NUT_TA(rb.writable_pointers(wbufs, lens, wbufs + 1, lens + 1) == 2);
+        NUT_TA(lens[0] == 2 && lens[1] == 6);
+        ::memcpy(wbufs[0], "ab", 2);
+        ::memcpy(wbufs[1], "cde", 3);
+        NUT_TA(rb.skip_write(5) == 5);
+
+        const void *rbufs[2];
+        NUT_TA(rb.readable_pointers(rbufs, lens, rbufs + 1, lens + 1) == 2);
+        NUT_TA(lens[0] == 2 && lens[1] == 3);
+        NUT_TA(0 == ::memcmp(rbufs[0], "ab", 2) && 0 == ::memcmp(rbufs[1], "cde", 3));
+
+        char out[5];
+        NUT_TA(rb.read(out, 5) == 5);
+        NUT_TA(0 == ::memcmp(out, "abcde", 5));
+        NUT_TA(rb.readable_pointers(rbufs, lens) == 0);
+    }
+
+    void test_multi_thread()
+    {
+        const size_t total = 1024 * 1024;
+        SPSCRingBuffer rb(1000);
+
+        thread producer([&] {
+            uint8_t buf[97];
+            size_t sent = 0;
+            while (sent < total)
+            {
+                const size_t len = std::min(sizeof(buf), total - sent);
+                for (size_t i = 0; i < len; ++i)
+                    buf[i] = (uint8_t) ((sent + i) * 7);
+                size_t done = 0;
+                while (done < len)
+                {
+                    done += rb.write(buf + done, len - done);
+                    this_thread::yield();
+                }
+                sent += len;
+            }
+        });
+
+        size_t received = 0;
+        bool ok = true;
+        while (received < total)
+        {
+            const void *bufs[2];
+            size_t lens[2];
+            const size_t n = rb.readable_pointers(bufs, lens, bufs + 1, lens + 1);
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j < lens[i]; ++j)
+                    ok = ok && ((const uint8_t*) bufs[i])[j] == (uint8_t) ((received + j) * 7);
+                rb.skip_read(lens[i]);
+                received += lens[i];
+            }
+            if (0 == n)
+                this_thread::yield();
+        }
+        producer.join();
+        NUT_TA(ok);
+        NUT_TA(rb.readable_size() == 0);
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestSPSCRingBuffer, "container, quiet")
@@ -2,8 +2,11 @@
 #include <nut/unittest/unittest.h>
 
 #include <iostream>
+#include <vector>
 #include <nut/container/skiplist/skiplist_set.h>
 #include <nut/container/skiplist/skiplist_map.h>
+#include <nut/mem/segments_mp.h>
+#include <nut/rc/rc_new.h>
 
 using namespace std;
 using namespace nut;
@@ -14,6 +17,9 @@ class TestSkipList : public TestFixture
     {
         NUT_REGISTER_CASE(test_set);
         NUT_REGISTER_CASE(test_map);
+        NUT_REGISTER_CASE(test_pooled);
+        NUT_REGISTER_CASE(test_rank_select);
+        NUT_REGISTER_CASE(test_assign_sorted);
     }
 
     void test_set()
@@ -54,6 +60,97 @@ class TestSkipList : public TestFixture
         NUT_TA(sl.size() == 2);
         NUT_TA(!sl.contains_key(1));
     }
+
+    void test_pooled()
+    {
+        rc_ptr<segments_stmp> mp = rc_new<segments_stmp>();
+        SkipListMap<int, int> sl(mp);
+        for (int i = 0; i < 1000; ++i)
+            NUT_TA(sl.put(i * 7 % 1000, i) == 1);
+        NUT_TA(sl.size() == 1000);
+        for (int i = 0; i < 1000; i += 2)
+            NUT_TA(sl.remove(i));
+        NUT_TA(sl.size() == 500);
+        NUT_TA(!sl.contains_key(10) && sl.contains_key(11));
+        NUT_TA(nullptr != sl.get(7) && *sl.get(7) == 1);
+
+        SkipListMap<int, int> sl2(sl);
+        NUT_TA(sl2 == sl);
+        sl2[3] = 1000;
+        NUT_TA(sl2 != sl && sl < sl2);
+        sl2.clear();
+        NUT_TA(sl2.size() == 0 && sl2 < sl);
+
+        SkipListSet<int> ss(mp);
+        NUT_TA(ss.add(3) && ss.add(1) && ss.emplace(2));
+        SkipListSet<int> ss2 = std::move(ss);
+        NUT_TA(ss.size() == 0 && ss2.size() == 3 && ss2.contains(2));
+    }
+
+    void test_rank_select()
+    {
+        SkipListMap<int, int> sl;
+        for (int i = 0; i < 100; ++i)
+            NUT_TA(sl.put(i * 37 % 100 * 2, i) == 1); // 0, 2, ..., 198
+        for (int i = 0; i < 100; i += 3)
+            NUT_TA(sl.remove(i * 2));
+        NUT_TA(sl.size() == 66);
+
+        // 剩余 2, 4, 8, 10, 14, ...
+        NUT_TA(sl.select(0)->get_key() == 2);
+        NUT_TA(sl.select(2)->get_key() == 8);
+        NUT_TA(sl.select(65)->get_key() == 196);
+        NUT_TA(sl.select(66) == sl.end());
+        NUT_TA(sl.rank(0) == 0 && sl.rank(2) == 0 && sl.rank(3) == 1 && sl.rank(8) == 2);
+        NUT_TA(sl.rank(1000) == 66);
+        for (size_t i = 0; i < sl.size(); ++i)
+            NUT_TA(sl.rank(sl.select(i)->get_key()) == i);
+
+        NUT_TA(sl.lower_bound(6)->get_key() == 8 && sl.lower_bound(8)->get_key() == 8);
+        NUT_TA(sl.upper_bound(8)->get_key() == 10);
+        NUT_TA(sl.lower_bound(197) == sl.end() && sl.upper_bound(196) == sl.end());
+
+        std::vector<int> keys;
+        const size_t count = sl.range(7, 20, [&] (const int& k, const int&) {
+                keys.push_back(k);
+                return true;
+            });
+        NUT_TA(count == 4 && keys == std::vector<int>({8, 10, 14, 16}));
+
+        SkipListSet<int> ss;
+        for (int i = 10; i > 0; --i)
+            NUT_TA(ss.add(i));
+        NUT_TA(*ss.select(3) == 4 && ss.rank(4) == 3);
+        NUT_TA(*ss.lower_bound(0) == 1 && *ss.upper_bound(9) == 10);
+        int sum = 0;
+        for (SkipListSet<int>::const_iterator iter = ss.begin(); iter != ss.end(); ++iter)
+            sum += *iter;
+        NUT_TA(sum == 55);
+    }
+
+    void test_assign_sorted()
+    {
+        std::vector<std::pair<int, int>> src;
+        for (int i = 0; i < 1000; ++i)
+            src.emplace_back(i * 3, i);
+        src.emplace_back(2997, -1); // 重复的键值被忽略
+
+        SkipListMap<int, int> sl;
+        sl.put(1, 1);
+        sl.assign_sorted(src.begin(), src.end());
+        NUT_TA(sl.size() == 1000 && !sl.contains_key(1));
+        NUT_TA(*sl.get(2997) == 999);
+        NUT_TA(sl.select(500)->get_key() == 1500 && sl.rank(1500) == 500);
+
+        // 批量构建后仍可正常增删
+        NUT_TA(sl.put(1, 1) == 1 && sl.remove(3));
+        NUT_TA(sl.select(1)->get_key() == 1 && sl.select(2)->get_key() == 6);
+
+        std::vector<int> vals = {1, 2, 3, 5, 8};
+        SkipListSet<int> ss;
+        ss.assign_sorted(vals.begin(), vals.end());
+        NUT_TA(ss.size() == 5 && *ss.select(4) == 8 && ss.rank(4) == 3);
+    }
 };
 
 NUT_REGISTER_FIXTURE(TestSkipList, "container, skiplist, quiet")
@@ -1,4 +1,7 @@
 ﻿#include <iostream>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
 
 #include <nut/unittest/unittest.h>
 
@@ -16,6 +19,8 @@ class TestBitStream : public TestFixture
         NUT_REGISTER_CASE(test_bug2);
         NUT_REGISTER_CASE(test_substream);
         NUT_REGISTER_CASE(test_bitop);
+        NUT_REGISTER_CASE(test_shifted_append);
+        NUT_REGISTER_CASE(test_rank_select);
     }
 
     void test_smoking()
@@ -70,6 +75,76 @@ class TestBitStream : public TestFixture
         NUT_TA((a & b).to_string() == "000001001000000000000000000000000000000000000000000000000000000000000000000000000000000000");
         NUT_TA((a | b).to_string() == "110111111111010110011001100110011001001101101100111111111010110011001100110011001001101101");
         NUT_TA((a ^ b).to_string() == "110110110111010110011001100110011001001101101100111111111010110011001100110011001001101101");
+        NUT_TA((~a).to_string() == "101110110");
+        NUT_TA((~b).size() == b.size() && (~b).bit1_count() == b.bit0_count());
+    }
+
+    static string random_bits(size_t n)
+    {
+        string s;
+        for (size_t i = 0; i < n; ++i)
+            s.push_back(0 == ::rand() % 2 ? '0' : '1');
+        return s;
+    }
+
+    void test_shifted_append()
+    {
+        // 各种非字对齐的拼接和截取
+        string expected;
+        BitStream bs;
+        for (int i = 0; i < 50; ++i)
+        {
+            const string s = random_bits(::rand() % 200);
+            bs.append(BitStream(s));
+            expected += s;
+            NUT_TA(bs.to_string() == expected);
+        }
+        for (int i = 0; i < 100; ++i)
+        {
+            const size_t pos = ::rand() % expected.length();
+            const size_t len = ::rand() % (expected.length() - pos + 1);
+            NUT_TA(bs.substream(pos, len).to_string() == expected.substr(pos, len));
+        }
+
+        bs.fill_bits(3, 150, 1);
+        expected.replace(3, 150, 150, '1');
+        NUT_TA(bs.to_string() == expected);
+        NUT_TA(bs.bit1_count() == (size_t) std::count(expected.begin(), expected.end(), '1'));
+    }
+
+    void test_rank_select()
+    {
+        BitStream bs(random_bits(5000));
+        vector<size_t> ones;
+        for (size_t i = 0; i < bs.size(); ++i)
+        {
+            if (1 == bs.bit_at(i))
+                ones.push_back(i);
+        }
+
+        for (int round = 0; round < 2; ++round)
+        {
+            if (1 == round)
+            {
+                bs.build_rank_select();
+                NUT_TA(bs.has_rank_select());
+            }
+
+            size_t rank = 0;
+            for (size_t i = 0; i <= bs.size(); ++i)
+            {
+                NUT_TA(bs.rank1(i) == rank);
+                if (i < bs.size() && 1 == bs.bit_at(i))
+                    ++rank;
+            }
+            for (size_t k = 0; k < ones.size(); ++k)
+                NUT_TA(bs.select1(k) == (ssize_t) ones[k]);
+            NUT_TA(bs.select1(ones.size()) == -1);
+        }
+
+        // 修改后目录失效
+        bs.set_bit(0, 1);
+        NUT_TA(!bs.has_rank_select());
     }
 };
 
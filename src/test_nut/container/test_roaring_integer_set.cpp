@@ -0,0 +1,235 @@
+﻿
+#include <stdlib.h>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+#include <nut/unittest/unittest.h>
+#include <nut/container/roaring_integer_set.h>
+#include <nut/container/integer_set.h>
+#include <nut/container/bytestream/byte_array_stream.h>
+#include <nut/rc/rc_new.h>
+
+
+using namespace std;
+using namespace nut;
+
+class TestRoaringIntegerSet : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_smoking);
+        NUT_REGISTER_CASE(test_chunk_type);
+        NUT_REGISTER_CASE(test_random);
+        NUT_REGISTER_CASE(test_set_operations);
+        NUT_REGISTER_CASE(test_iterator);
+        NUT_REGISTER_CASE(test_serialize);
+    }
+
+    static bool equals(const RoaringIntegerSet<int>& s, const set<int>& expected)
+    {
+        if (s.size_of_values() != expected.size())
+            return false;
+        return std::equal(s.begin(), s.end(), expected.begin());
+    }
+
+    void test_smoking()
+    {
+        RoaringIntegerSet<int> s;
+        s.add_value(1);
+        s.add_value_range(4,10);
+        NUT_TA(s.contains(1));
+        NUT_TA(!s.contains(2));
+        NUT_TA(s.contains(6));
+        NUT_TA(s.size_of_values() == 8);
+        NUT_TA(s.to_string() == "{1,[4,10]}");
+
+        // 跨越块边界以及符号
+        s.add_value_range(-3, 2);
+        s.add_value_range(65530, 65540);
+        NUT_TA(s.to_string() == "{[-3,2],[4,10],[65530,65540]}");
+        NUT_TA(s.get_first_value() == -3 && s.get_last_value() == 65540);
+        NUT_TA(s.index_of(65536) == 6 + 7 + 6);
+        NUT_TA(s.value_at(6 + 7 + 6) == 65536);
+        NUT_TA(s.index_of(3) == -1);
+
+        s.remove_value_range(0, 65535);
+        NUT_TA(s.to_string() == "{[-3,-1],[65536,65540]}");
+        s.remove_value(-2);
+        NUT_TA(s.to_string() == "{-3,-1,[65536,65540]}");
+    }
+
+    void test_chunk_type()
+    {
+        RoaringIntegerSet<unsigned> s;
+
+        // 稀疏
+        for (unsigned i = 0; i < 100; ++i)
+            s.add_value(i * 7);
+        NUT_TA(s.size_of_chunks() == 1);
+        NUT_TA(s.chunk_at(0).type() == RoaringChunk::Type::Array);
+
+        // 超过 4096 个分散的元素
+        for (unsigned i = 0; i < 5000; ++i)
+            s.add_value(i * 3);
+        NUT_TA(s.chunk_at(0).type() == RoaringChunk::Type::Bitmap);
+
+        // 连续区间
+        s.add_value_range(0, 40000);
+        NUT_TA(s.chunk_at(0).type() == RoaringChunk::Type::Run);
+        NUT_TA(s.chunk_at(0).memory_size() == 4);
+        NUT_TA(s.size_of_values() == 40001);
+
+        s.add_value_range(65536 * 3, 65536 * 5 - 1);
+        NUT_TA(s.size_of_chunks() == 3);
+        NUT_TA(s.size_of_values() == 40001 + 65536 * 2);
+    }
+
+    void test_random()
+    {
+        RoaringIntegerSet<int> s;
+        set<int> expected;
+        for (int i = 0; i < 5000; ++i)
+        {
+            const int op = ::rand() % 8;
+            // 集中在少数几个块中, 以便各种表示都被覆盖
+            int v = (::rand() % 6 - 3) * 65536 + ::rand() % 70000;
+            if (op < 4)
+            {
+                s.add_value(v);
+                expected.insert(v);
+            }
+            else if (op < 6)
+            {
+                s.remove_value(v);
+                expected.erase(v);
+            }
+            else
+            {
+                const int last = v + ::rand() % (0 == ::rand() % 8 ? 100000 : 50);
+                if (op == 6)
+                {
+                    s.add_value_range(v, last);
+                    for (int j = v; j <= last; ++j)
+                        expected.insert(j);
+                }
+                else
+                {
+                    s.remove_value_range(v, last);
+                    expected.erase(expected.lower_bound(v), expected.upper_bound(last));
+                }
+            }
+
+            if (0 == i % 500)
+            {
+                NUT_TA(equals(s, expected));
+                v = (::rand() % 6 - 3) * 65536 + ::rand() % 70000;
+                NUT_TA(s.contains(v) == (expected.count(v) > 0));
+            }
+        }
+        NUT_TA(equals(s, expected));
+
+        size_t index = 0;
+        for (set<int>::const_iterator iter = expected.begin(); iter != expected.end(); ++iter, ++index)
+        {
+            if (0 != index % 97)
+                continue;
+            NUT_TA(s.index_of(*iter) == (ssize_t) index);
+            NUT_TA(s.value_at(index) == *iter);
+        }
+    }
+
+    void test_set_operations()
+    {
+        for (int round = 0; round < 20; ++round)
+        {
+            RoaringIntegerSet<int> a, b;
+            IntegerSet<int> ia, ib;
+            for (int i = 0; i < 300; ++i)
+            {
+                const int v = ::rand() % 300000 - 100000;
+                const int len = (0 == ::rand() % 4 ? ::rand() % 20000 : 0);
+                a.add_value_range(v, v + len);
+                ia.add_value_range(v, v + len);
+
+                const int w = ::rand() % 300000 - 100000;
+                b.add_value(w);
+                ib.add_value(w);
+                if (0 == i % 3)
+                {
+                    const int len2 = ::rand() % 3000;
+                    b.add_value_range(w, w + len2);
+                    ib.add_value_range(w, w + len2);
+                }
+            }
+
+            NUT_TA((a | b).to_string() == (ia | ib).to_string());
+            NUT_TA((a & b).to_string() == (ia & ib).to_string());
+            NUT_TA((a - b).to_string() == (ia - ib).to_string());
+            NUT_TA((b - a).to_string() == (ib - ia).to_string());
+            NUT_TA((a ^ b).to_string() == ((ia | ib) - (ia & ib)).to_string());
+            NUT_TA((a & b) == (b & a));
+            NUT_TA(((a | b) - (a & b)) == (a ^ b));
+            NUT_TA(a.compare(b) == ia.compare(ib));
+
+            RoaringIntegerSet<int> c = a;
+            c |= b;
+            c -= b;
+            NUT_TA(c == a - b);
+        }
+    }
+
+    void test_iterator()
+    {
+        RoaringIntegerSet<long long> s;
+        s.add_value(-5);
+        s.add_value_range(65535, 65537);
+        s.add_value(1LL << 40);
+
+        const long long expected[] = {-5, 65535, 65536, 65537, 1LL << 40};
+        NUT_TA(std::equal(s.begin(), s.end(), expected));
+
+        vector<long long> reversed;
+        RoaringIntegerSet<long long>::const_iterator iter = s.end();
+        while (iter != s.begin())
+            reversed.push_back(*--iter);
+        NUT_TA(std::equal(reversed.rbegin(), reversed.rend(), expected));
+
+        NUT_TA(*s.value_iterator(0) == 65535);
+        NUT_TA(*s.value_iterator(65536) == 65536);
+        NUT_TA(*s.value_iterator(65538) == (1LL << 40));
+        NUT_TA(s.value_iterator((1LL << 40) + 1) == s.end());
+    }
+
+    void test_serialize()
+    {
+        RoaringIntegerSet<int> s;
+        for (int i = 0; i < 3000; ++i)
+            s.add_value(::rand() % 1000000 - 500000);
+        for (int i = 0; i < 10000; ++i)
+            s.add_value(::rand() % 65536);
+        s.add_value_range(200000, 300000);
+
+        rc_ptr<ByteArrayStream> bas = rc_new<ByteArrayStream>();
+        s.serialize(bas.pointer());
+        bas->seek(0);
+        RoaringIntegerSet<int> s2;
+        NUT_TA(s2.deserialize(bas.pointer()));
+        NUT_TA(s2 == s);
+        NUT_TA(0 == bas->readable_size());
+
+        // 截断的数据
+        bas->seek(0);
+        bas->resize(bas->size() - 1);
+        NUT_TA(!s2.deserialize(bas.pointer()));
+        NUT_TA(s2.empty());
+
+        // 整数位数不一致
+        bas->seek(0);
+        RoaringIntegerSet<long long> s3;
+        NUT_TA(!s3.deserialize(bas.pointer()));
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestRoaringIntegerSet, "container, quiet")
@@ -0,0 +1,200 @@
+﻿
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <nut/unittest/unittest.h>
+
+#include <nut/container/tree/rtree/packed_rtree.h>
+#include <nut/container/bytestream/byte_array_stream.h>
+#include <nut/rc/rc_new.h>
+
+using namespace nut;
+
+class TestPackedRTree : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_smoking);
+        NUT_REGISTER_CASE(test_random);
+        NUT_REGISTER_CASE(test_float);
+        NUT_REGISTER_CASE(test_serialize);
+    }
+
+    typedef PackedRTree<int, int> tree_type;
+    typedef tree_type::area_type Area;
+
+    static Area mkrect(int x1, int x2, int y1, int y2)
+    {
+        Area ret;
+        ret.lower[0] = x1;
+        ret.higher[0] = x2;
+        ret.lower[1] = y1;
+        ret.higher[1] = y2;
+        return ret;
+    }
+
+    static Area random_rect(int range, int max_size)
+    {
+        const int x = ::rand() % range, y = ::rand() % range;
+        return mkrect(x, x + ::rand() % max_size, y, y + ::rand() % max_size);
+    }
+
+    static std::vector<int> sorted_data(const std::vector<std::pair<Area,int>>& v)
+    {
+        std::vector<int> ret;
+        for (size_t i = 0; i < v.size(); ++i)
+            ret.push_back(v[i].second);
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+
+    void test_smoking()
+    {
+        tree_type t;
+        NUT_TA(t.size() == 0 && t.height() == 0 && t.is_valid());
+        std::vector<std::pair<Area,int>> result;
+        t.search_intersect(mkrect(0, 10, 0, 10), &result);
+        NUT_TA(result.empty());
+
+        std::vector<std::pair<Area,int>> items;
+        items.emplace_back(mkrect(1, 2, 3, 4), 1);
+        items.emplace_back(mkrect(3, 7, 2, 7), 2);
+        t.build(items);
+        NUT_TA(t.size() == 2 && t.height() == 1 && t.is_valid());
+
+        t.search_intersect(mkrect(2, 3, 0, 10), &result);
+        NUT_TA(sorted_data(result) == std::vector<int>({1, 2}));
+        result.clear();
+        t.search_contains(mkrect(0, 5, 0, 5), &result);
+        NUT_TA(result.size() == 1 && result[0].second == 1 && result[0].first == mkrect(1, 2, 3, 4));
+    }
+
+    void test_random()
+    {
+        std::vector<std::pair<Area,int>> items;
+        for (int i = 0; i < 5000; ++i)
+            items.emplace_back(random_rect(10000, 200), i);
+
+        tree_type t;
+        t.build(items);
+        NUT_TA(t.size() == items.size() && t.height() == 4 && t.is_valid());
+
+        for (int i = 0; i < 50; ++i)
+        {
+            const Area q = random_rect(10000, 1000);
+            std::vector<std::pair<Area,int>> expect_intersect, expect_contains, result;
+            for (size_t j = 0; j < items.size(); ++j)
+            {
+                if (items[j].first.intersects(q))
+                    expect_intersect.push_back(items[j]);
+                if (q.contains(items[j].first))
+                    expect_contains.push_back(items[j]);
+            }
+
+            t.search_intersect(q, &result);
+            NUT_TA(sorted_data(result) == sorted_data(expect_intersect));
+            result.clear();
+            t.search_contains(q, &result);
+            NUT_TA(sorted_data(result) == sorted_data(expect_contains));
+        }
+
+        // 提前终止
+        const size_t visited = t.visit_intersect(mkrect(0, 10000, 0, 10000),
+                                                 [] (const Area&, int) { return false; });
+        NUT_TA(1 == visited);
+
+        tree_type t2(t);
+        NUT_TA(t2.size() == t.size() && t2.is_valid());
+        t.clear();
+        std::vector<std::pair<Area,int>> result;
+        t2.search_intersect(mkrect(0, 20000, 0, 20000), &result);
+        NUT_TA(result.size() == items.size());
+    }
+
+    void test_float()
+    {
+        typedef PackedRTree<int, double, 3> dtree_type;
+        typedef dtree_type::area_type DArea;
+
+        std::vector<std::pair<DArea,int>> items;
+        for (int i = 0; i < 1000; ++i)
+        {
+            DArea a;
+            for (int d = 0; d < 3; ++d)
+            {
+                a.lower[d] = ::rand() % 1000 / 10.0;
+                a.higher[d] = a.lower[d] + ::rand() % 50 / 10.0;
+            }
+            items.emplace_back(a, i);
+        }
+
+        dtree_type t;
+        t.build(items);
+        NUT_TA(t.is_valid());
+
+        DArea q;
+        for (int d = 0; d < 3; ++d)
+        {
+            q.lower[d] = 20.5;
+            q.higher[d] = 60.5;
+        }
+        size_t expect = 0;
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            if (items[i].first.intersects(q))
+                ++expect;
+        }
+        NUT_TA(t.visit_intersect(q, [] (const DArea&, int) { return true; }) == expect);
+    }
+
+    void test_serialize()
+    {
+        std::vector<std::pair<Area,int>> items;
+        for (int i = 0; i < 1000; ++i)
+            items.emplace_back(random_rect(1000, 50), i);
+        tree_type t;
+        t.build(items);
+
+        rc_ptr<ByteArrayStream> bas = rc_new<ByteArrayStream>();
+        t.serialize(bas);
+        NUT_TA(bas->size() == t.serialized_size());
+
+        tree_type t2;
+        const std::vector<uint8_t>& buf = bas->byte_array();
+        NUT_TA(!t2.attach(buf.data(), buf.size() - 1));
+        NUT_TA(t2.attach(buf.data(), buf.size()));
+        NUT_TA(t2.is_attached() && t2.size() == t.size() && t2.is_valid());
+
+        const Area q = mkrect(100, 300, 200, 400);
+        std::vector<std::pair<Area,int>> r1, r2;
+        t.search_intersect(q, &r1);
+        t2.search_intersect(q, &r2);
+        NUT_TA(!r1.empty() && r1 == r2);
+
+        // 引用外部内存的树复制后依然引用外部内存
+        tree_type t3 = t2;
+        NUT_TA(t3.is_attached() && t3.size() == t.size());
+
+        // 格式不匹配
+        PackedRTree<int, int, 2, double, 8> t4;
+        NUT_TA(!t4.attach(buf.data(), buf.size()));
+
+        // 节点数据损坏. 头部 64 字节, 节点的 first 字段在区域数组之后
+        const size_t first_offset = 64 + sizeof(int) * 2 * 2 * 16;
+        std::vector<uint8_t> bad(buf);
+        const uint32_t huge = 0x7fffffff;
+        ::memcpy(bad.data() + first_offset, &huge, sizeof(huge));
+        tree_type t5;
+        NUT_TA(!t5.attach(bad.data(), bad.size()) && !t5.is_attached() && 0 == t5.size());
+        bad = buf;
+        const uint32_t zero = 0;
+        ::memcpy(bad.data() + first_offset + 4, &zero, sizeof(zero)); // count
+        NUT_TA(!t5.attach(bad.data(), bad.size()));
+        bad = buf;
+        NUT_TA(t5.attach(bad.data(), bad.size()));
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestPackedRTree, "container, tree, rtree, quiet")
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <stdlib.h>
 #include <algorithm>
+#include <vector>
 
 #include <nut/unittest/unittest.h>
 
@@ -19,6 +20,23 @@ class TestRTree : public TestFixture
         NUT_REGISTER_CASE(test_random);
         NUT_REGISTER_CASE(test_simple);
         NUT_REGISTER_CASE(test_copy);
+        NUT_REGISTER_CASE(test_random_remove);
+        NUT_REGISTER_CASE(test_nearest);
+    }
+
+    static Area random_rect(int range, int max_size)
+    {
+        const int x = rand() % range, y = rand() % range;
+        return mkrect(x, x + rand() % max_size, y, y + rand() % max_size);
+    }
+
+    static std::vector<int> sorted_data(const std::vector<std::pair<Area,int>>& v)
+    {
+        std::vector<int> ret;
+        for (size_t i = 0; i < v.size(); ++i)
+            ret.push_back(v[i].second);
+        std::sort(ret.begin(), ret.end());
+        return ret;
     }
 
     static Area mkrect(int x1, int x2, int y1, int y2)
@@ -104,6 +122,81 @@ class TestRTree : public TestFixture
         NUT_TA(t4.size() == 50);
         NUT_TA(t4.is_valid());
     }
+
+    void test_random_remove()
+    {
+        RTree<int,int> t;
+        std::vector<std::pair<Area,int>> items;
+        for (int i = 0; i < 3000; ++i)
+        {
+            items.emplace_back(random_rect(5000, 100), i);
+            t.insert(items.back().first, i);
+        }
+        NUT_TA(t.is_valid());
+        for (int i = 0; i < 3000; i += 2)
+            NUT_TA(t.remove(items[i].first, items[i].second));
+        NUT_TA(t.size() == 1500 && t.is_valid());
+
+        for (int i = 0; i < 20; ++i)
+        {
+            const Area q = random_rect(5000, 1000);
+            std::vector<std::pair<Area,int>> expect_intersect, expect_contains, result;
+            for (size_t j = 1; j < items.size(); j += 2)
+            {
+                if (items[j].first.intersects(q))
+                    expect_intersect.push_back(items[j]);
+                if (q.contains(items[j].first))
+                    expect_contains.push_back(items[j]);
+            }
+            t.search_intersect(q, &result);
+            NUT_TA(sorted_data(result) == sorted_data(expect_intersect));
+            result.clear();
+            t.search_contains(q, &result);
+            NUT_TA(sorted_data(result) == sorted_data(expect_contains));
+        }
+    }
+
+    void test_nearest()
+    {
+        RTree<int,int> t;
+        std::vector<std::pair<Area,int>> items;
+        for (int i = 0; i < 2000; ++i)
+        {
+            items.emplace_back(random_rect(10000, 50), i);
+            t.insert(items.back().first, i);
+        }
+
+        for (int i = 0; i < 20; ++i)
+        {
+            const Area q = random_rect(10000, 1);
+
+            // 暴力计算，按距离排序
+            std::vector<double> dists;
+            for (size_t j = 0; j < items.size(); ++j)
+                dists.push_back(q.distance_square(items[j].first));
+            std::vector<double> sorted_dists = dists;
+            std::sort(sorted_dists.begin(), sorted_dists.end());
+
+            std::vector<std::pair<Area,int>> result;
+            t.search_nearest(q, 10, &result);
+            NUT_TA(result.size() == 10);
+            for (size_t j = 0; j < result.size(); ++j)
+                NUT_TA(q.distance_square(result[j].first) == sorted_dists[j]);
+
+            const double r = 300;
+            result.clear();
+            t.search_within_distance(q, r, &result);
+            const size_t expect = std::upper_bound(sorted_dists.begin(), sorted_dists.end(), r * r) -
+                sorted_dists.begin();
+            NUT_TA(result.size() == expect);
+            for (size_t j = 1; j < result.size(); ++j)
+                NUT_TA(q.distance_square(result[j - 1].first) <= q.distance_square(result[j].first));
+        }
+
+        std::vector<std::pair<Area,int>> result;
+        t.search_nearest(mkrect(0, 0, 0, 0), 5000, &result);
+        NUT_TA(result.size() == items.size());
+    }
 };
 
 NUT_REGISTER_FIXTURE(TestRTree, "container, tree, rtree, quiet")
@@ -1,6 +1,9 @@
 ﻿
 
 #include <iostream>
+#include <stdlib.h>
+#include <set>
+#include <vector>
 #include <nut/unittest/unittest.h>
 
 #include <nut/container/tree/rbtree.h>
@@ -15,12 +18,15 @@ class TestRBTree : public TestFixture
     virtual void register_cases() noexcept override
     {
         NUT_REGISTER_CASE(test_bug1);
+        NUT_REGISTER_CASE(test_random);
+        NUT_REGISTER_CASE(test_build);
     }
 
     struct Node
     {
         int key;
         bool red = false;
+        size_t size = 0;
         Node *parent = nullptr;
         Node *left = nullptr;
         Node *right = nullptr;
@@ -38,8 +44,45 @@ class TestRBTree : public TestFixture
         void set_parent(Node *p) { parent = p; }
         void set_left_child(Node *p) { left = p; }
         void set_right_child(Node *p) { right = p; }
+        size_t get_size() const { return size; }
+        void set_size(size_t s) { size = s; }
     };
 
+    typedef RBTree<int,Node,true> rbtree_type;
+    typedef BSTree<int,Node,true> bstree_type;
+
+    /**
+     * 检查红黑树性质、父指针以及子树大小
+     *
+     * @return 黑高度, 出错返回 -1
+     */
+    static int check(const Node *n)
+    {
+        if (nullptr == n)
+            return 1;
+        if (n->red && ((nullptr != n->left && n->left->red) || (nullptr != n->right && n->right->red)))
+            return -1;
+        if ((nullptr != n->left && n->left->parent != n) || (nullptr != n->right && n->right->parent != n))
+            return -1;
+        const size_t size = 1 + (nullptr == n->left ? 0 : n->left->size) +
+            (nullptr == n->right ? 0 : n->right->size);
+        if (n->size != size)
+            return -1;
+        const int lh = check(n->left), rh = check(n->right);
+        if (lh < 0 || lh != rh)
+            return -1;
+        return lh + (n->red ? 0 : 1);
+    }
+
+    static void delete_tree(Node *n)
+    {
+        if (nullptr == n)
+            return;
+        delete_tree(n->left);
+        delete_tree(n->right);
+        delete n;
+    }
+
     void test_bug1()
     {
         Node *root = nullptr;
@@ -48,6 +91,84 @@ class TestRBTree : public TestFixture
         root = RBTree<int,Node>::remove(root, n); // 这里会崩溃
         delete n;
     }
+
+    void test_random()
+    {
+        Node *root = nullptr;
+        std::set<int> ref;
+        for (int i = 0; i < 5000; ++i)
+        {
+            const int k = ::rand() % 500;
+            Node *n = bstree_type::search(root, k);
+            if (0 != ::rand() % 3)
+            {
+                if (nullptr == n)
+                {
+                    root = rbtree_type::insert(root, new Node(k));
+                    ref.insert(k);
+                }
+            }
+            else if (nullptr != n)
+            {
+                root = rbtree_type::remove(root, n);
+                delete n;
+                ref.erase(k);
+            }
+            NUT_TA(nullptr == root || (!root->red && nullptr == root->parent));
+            NUT_TA(check(root) > 0);
+        }
+
+        size_t i = 0;
+        for (int k : ref)
+        {
+            NUT_TA(bstree_type::select(root, i)->key == k);
+            NUT_TA(bstree_type::rank(root, k) == i);
+            ++i;
+        }
+        NUT_TA(nullptr == bstree_type::select(root, ref.size()));
+
+        const int lo = 100, hi = 200;
+        Node *lb = bstree_type::lower_bound(root, lo);
+        NUT_TA(lb->key == *ref.lower_bound(lo));
+        Node *ub = bstree_type::upper_bound(root, lo);
+        NUT_TA(ub->key == *ref.upper_bound(lo));
+        std::vector<int> visited;
+        bstree_type::range(root, lo, hi, [&] (Node *n) {
+                visited.push_back(n->key);
+                return true;
+            });
+        NUT_TA(visited == std::vector<int>(ref.lower_bound(lo), ref.lower_bound(hi)));
+
+        delete_tree(root);
+    }
+
+    void test_build()
+    {
+        for (int n = 0; n < 70; ++n)
+        {
+            std::vector<Node*> nodes;
+            for (int i = 0; i < n; ++i)
+                nodes.push_back(new Node(i * 2));
+
+            Node *root = rbtree_type::build(nodes.data(), nodes.size());
+            NUT_TA(nullptr == root || !root->red);
+            NUT_TA(check(root) > 0);
+            for (int i = 0; i < n; ++i)
+                NUT_TA(bstree_type::select(root, i) == nodes[i]);
+
+            // 批量构建后仍可正常增删
+            root = rbtree_type::insert(root, new Node(n));
+            NUT_TA(check(root) > 0);
+            if (n > 0)
+            {
+                Node *x = bstree_type::select(root, n / 2);
+                root = rbtree_type::remove(root, x);
+                delete x;
+                NUT_TA(check(root) > 0);
+            }
+            delete_tree(root);
+        }
+    }
 };
 
 NUT_REGISTER_FIXTURE(TestRBTree, "container, tree, quiet")
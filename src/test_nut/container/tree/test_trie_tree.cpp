@@ -4,6 +4,7 @@
 
 #include <nut/unittest/unittest.h>
 #include <nut/container/tree/trie_tree.h>
+#include <nut/container/tree/frozen_trie_tree.h>
 
 
 using namespace std;
@@ -19,6 +20,8 @@ class TestTrieTree : public TestFixture
         NUT_REGISTER_CASE(test_remove_tree);
         NUT_REGISTER_CASE(test_get_descendants);
         NUT_REGISTER_CASE(test_get_ancestors);
+        NUT_REGISTER_CASE(test_frozen);
+        NUT_REGISTER_CASE(test_frozen_wide);
     }
 
     TrieTree<char,std::string> trie;
@@ -116,6 +119,70 @@ class TestTrieTree : public TestFixture
         // abc ab
         NUT_TA(trie.get_ancestors("abc", 6) == vector<string>({"c", "b"}));
     }
+
+    void test_frozen()
+    {
+        FrozenTrieTree<char,std::string> frozen(trie);
+        NUT_TA(frozen.size() == 4);
+        NUT_TA(*frozen.get("abde", 4) == "e");
+        NUT_TA(*frozen.get("abc", 3) == "c");
+        NUT_TA(*frozen.get("ab", 2) == "b");
+        NUT_TA(*frozen.get("af", 2) == "f");
+        NUT_TA(frozen.get("a", 1) == nullptr);
+        NUT_TA(frozen.get("abd", 3) == nullptr); // 被压缩到边 "de" 的中间
+        NUT_TA(frozen.get("afd", 3) == nullptr);
+        NUT_TA(frozen.get("", 0) == nullptr);
+
+        size_t matched = 0;
+        NUT_TA(*frozen.longest_prefix("abdex", 5, &matched) == "e" && 4 == matched);
+        NUT_TA(*frozen.longest_prefix("abdx", 4, &matched) == "b" && 2 == matched);
+        NUT_TA(*frozen.longest_prefix("afg", 3, &matched) == "f" && 2 == matched);
+        NUT_TA(frozen.longest_prefix("ax", 2, &matched) == nullptr && 0 == matched);
+
+        const std::vector<std::string> ancestors = frozen.get_ancestors("abde", 4);
+        NUT_TA(ancestors.size() == 2 && ancestors[0] == "e" && ancestors[1] == "b");
+
+        // 子节点较多, 覆盖 SIMD 查找
+        TrieTree<char,std::string> t2;
+        for (char c = '0'; c <= 'z'; ++c)
+        {
+            const char path[2] = {'/', c};
+            t2.put(path, 2, std::string(1, c));
+        }
+        FrozenTrieTree<char,std::string> f2(t2);
+        NUT_TA(f2.size() == t2.size());
+        for (char c = '0'; c <= 'z'; ++c)
+        {
+            const char path[2] = {'/', c};
+            NUT_TA(nullptr != f2.get(path, 2) && *f2.get(path, 2) == std::string(1, c));
+        }
+        NUT_TA(f2.get("/~", 2) == nullptr);
+    }
+
+    void test_frozen_wide()
+    {
+        // 非单字节的 ENTRY, 子节点较多时二分查找
+        TrieTree<std::string,int> t;
+        const std::string route1[] = {"api", "v1", "users"};
+        const std::string route2[] = {"api", "v1"};
+        t.put(route1, 3, 1);
+        t.put(route2, 2, 2);
+        for (int i = 0; i < 20; ++i)
+        {
+            const std::string route[] = {"static", std::to_string(i)};
+            t.put(route, 2, 100 + i);
+        }
+
+        FrozenTrieTree<std::string,int> f(t);
+        NUT_TA(f.size() == 22);
+        NUT_TA(*f.get(route1, 3) == 1 && *f.get(route2, 2) == 2);
+        const std::string static7[] = {"static", "7"};
+        NUT_TA(*f.get(static7, 2) == 107);
+
+        const std::string query[] = {"api", "v1", "groups", "x"};
+        size_t matched = 0;
+        NUT_TA(*f.longest_prefix(query, 4, &matched) == 2 && 2 == matched);
+    }
 };
 
 NUT_REGISTER_FIXTURE(TestTrieTree, "container, tree, quiet")
@@ -0,0 +1,26 @@
+﻿
+#ifndef ___HEADFILE_2DCFF1FC_C9CA_46F1_A56F_C85520324FE6_
+#define ___HEADFILE_2DCFF1FC_C9CA_46F1_A56F_C85520324FE6_
+
+#include <random>
+#include <vector>
+
+#include <nut/numeric/big_integer.h>
+
+
+/**
+ * 生成 n 个随机字, 每个字的所有比特都是随机的
+ *
+ * 供 numeric 下直接测试字数组算法的用例共用
+ */
+inline std::vector<nut::BigInteger::word_type> rand_words(std::mt19937& rand, size_t n)
+{
+    typedef nut::BigInteger::word_type word_type;
+
+    std::vector<word_type> ret(n);
+    for (size_t i = 0; i < n; ++i)
+        ret[i] = ((word_type) rand() << 16 << 16) ^ rand();
+    return ret;
+}
+
+#endif
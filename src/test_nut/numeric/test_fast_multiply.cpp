@@ -0,0 +1,214 @@
+﻿
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <nut/unittest/unittest.h>
+#include <nut/numeric/big_integer.h>
+#include <nut/numeric/word_array_integer/mul_op.h>
+#include <nut/numeric/numeric_algo/karatsuba.h>
+#include <nut/numeric/numeric_algo/fast_multiply.h>
+#include <nut/numeric/numeric_algo/ntt.h>
+#include <nut/time/performance_counter.h>
+
+#include "rand_words.h"
+
+
+using namespace std;
+using namespace nut;
+
+class TestFastMultiply : public TestFixture
+{
+    typedef BigInteger::word_type word_type;
+
+    virtual void register_cases() noexcept final override
+    {
+        NUT_REGISTER_CASE(test_toom3);
+        NUT_REGISTER_CASE(test_square);
+        NUT_REGISTER_CASE(test_dispatch);
+    }
+
+    mt19937 _rand;
+
+    void test_toom3()
+    {
+        const size_t sizes[][2] = {{5, 5}, {7, 3}, {30, 29}, {31, 11}, {100, 67}, {301, 300}};
+        for (auto& s : sizes)
+        {
+            const vector<word_type> a = rand_words(_rand, s[0]), b = rand_words(_rand, s[1]);
+            const size_t P = s[0] + s[1];
+            vector<word_type> x(P), y(P);
+            unsigned_multiply(a.data(), a.size(), b.data(), b.size(), x.data(), P);
+            unsigned_toom3_multiply(a.data(), a.size(), b.data(), b.size(), y.data(), P);
+            NUT_TA(x == y);
+
+            // 截断
+            unsigned_multiply(a.data(), a.size(), b.data(), b.size(), x.data(), s[0]);
+            unsigned_toom3_multiply(a.data(), a.size(), b.data(), b.size(), y.data(), s[0]);
+            NUT_TA(0 == ::memcmp(x.data(), y.data(), sizeof(word_type) * s[0]));
+        }
+
+        // 全 1 的乘数, 求值点上的中间结果最大
+        vector<word_type> a(90, ~(word_type) 0), x(180), y(180);
+        unsigned_multiply(a.data(), a.size(), a.data(), a.size(), x.data(), x.size());
+        unsigned_toom3_multiply(a.data(), a.size(), a.data(), a.size(), y.data(), y.size());
+        NUT_TA(x == y);
+    }
+
+    void test_square()
+    {
+        const size_t sizes[] = {1, 5, 64, 400, 1000, 1500};
+        for (size_t n : sizes)
+        {
+            vector<word_type> a = rand_words(_rand, n), x(2 * n), y(2 * n);
+            unsigned_multiply(a.data(), n, a.data(), n, x.data(), 2 * n);
+            unsigned_karatsuba_square(a.data(), n, y.data(), 2 * n);
+            NUT_TA(x == y);
+            unsigned_toom3_square(a.data(), n, y.data(), 2 * n);
+            NUT_TA(x == y);
+            unsigned_fast_square(a.data(), n, y.data(), 2 * n);
+            NUT_TA(x == y);
+
+            // 结果与乘数重叠
+            a.resize(2 * n);
+            unsigned_fast_square(a.data(), n, a.data(), 2 * n);
+            NUT_TA(a == x);
+        }
+    }
+
+    void test_dispatch()
+    {
+        // 覆盖各算法区间, 以及不平衡的乘数
+        const size_t sizes[][2] = {{10, 3}, {200, 150}, {900, 500}, {1500, 200}, {5000, 4500}};
+        for (auto& s : sizes)
+        {
+            vector<word_type> a = rand_words(_rand, s[0]), b = rand_words(_rand, s[1]);
+            const size_t P = s[0] + s[1];
+            vector<word_type> x(P), y(P);
+            unsigned_multiply(a.data(), a.size(), b.data(), b.size(), x.data(), P);
+            unsigned_fast_multiply(a.data(), a.size(), b.data(), b.size(), y.data(), P);
+            NUT_TA(x == y);
+
+            // 有符号
+            signed_negate(a.data(), a.size(), a.data(), a.size());
+            signed_multiply(a.data(), a.size(), b.data(), b.size(), x.data(), P);
+            signed_fast_multiply(a.data(), a.size(), b.data(), b.size(), y.data(), P);
+            NUT_TA(x == y);
+            signed_negate(b.data(), b.size(), b.data(), b.size());
+            signed_multiply(a.data(), a.size(), b.data(), b.size(), x.data(), P);
+            signed_fast_multiply(a.data(), a.size(), b.data(), b.size(), y.data(), P);
+            NUT_TA(x == y);
+
+            // 结果与乘数重叠
+            a.resize(P, ~(word_type) 0);
+            signed_fast_multiply(a.data(), s[0], b.data(), b.size(), a.data(), P);
+            NUT_TA(a == x);
+        }
+
+        // BigInteger
+        BigInteger a = BigInteger::rand_positive(40000), b = BigInteger::rand_positive(30000);
+        BigInteger c = a * b;
+        NUT_TA(c / a == b && c % a == 0);
+        NUT_TA((-a) * b == -c && (-a) * (-b) == c);
+        BigInteger d = a;
+        d *= a;
+        NUT_TA(d == a * a && d / a == a);
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestFastMultiply, "numeric,quiet")
+
+/**
+ * 性能测量, 只输出耗时而不做检查, 不在默认的 quiet 分组中, 需要用 -g benchmark 或者
+ * -f TestFastMultiplyBenchmark 单独运行
+ */
+class TestFastMultiplyBenchmark : public TestFixture
+{
+    typedef BigInteger::word_type word_type;
+
+    virtual void register_cases() noexcept final override
+    {
+        NUT_REGISTER_CASE(test_calibrate);
+    }
+
+    mt19937 _rand;
+
+    /**
+     * 测量各算法的耗时(ms), 作为 fast_multiply.h 中各边界值的依据
+     */
+    void test_calibrate()
+    {
+        const size_t sizes[] = {64, 128, 256, 512, 768, 1024, 2048, 4096, 8192, 16384, 32768};
+        printf("\n%6s %9s %9s %9s %9s %9s %9s %9s %9s", "words", "basic", "karatsuba",
+               "toom3", "ntt", "sqr", "k-sqr", "t3-sqr", "ntt-sqr");
+        for (size_t n : sizes)
+        {
+            const vector<word_type> a = rand_words(_rand, n), b = rand_words(_rand, n);
+            vector<word_type> x(2 * n);
+            const int rounds = (int) std::max<size_t>(1, 4096 / n);
+
+            double costs[8];
+            for (int k = 0; k < 8; ++k)
+            {
+                // 规模较大时略过一般算法
+                if ((0 == k || 4 == k) && n > 4096)
+                {
+                    costs[k] = 0;
+                    continue;
+                }
+                if ((3 == k || 7 == k) && !can_use_ntt_multiply(8 * sizeof(word_type) * n))
+                {
+                    costs[k] = 0;
+                    continue;
+                }
+
+                const PerformanceCounter s = PerformanceCounter::now();
+                for (int i = 0; i < rounds; ++i)
+                {
+                    switch (k)
+                    {
+                    case 0:
+                        unsigned_multiply(a.data(), n, b.data(), n, x.data(), 2 * n);
+                        break;
+
+                    case 1:
+                        unsigned_karatsuba_multiply(a.data(), n, b.data(), n, x.data(), 2 * n);
+                        break;
+
+                    case 2:
+                        unsigned_toom3_multiply(a.data(), n, b.data(), n, x.data(), 2 * n);
+                        break;
+
+                    case 3:
+                        unsigned_ntt_multiply(a.data(), n, b.data(), n, x.data(), 2 * n);
+                        break;
+
+                    case 4:
+                        _unsigned_square(a.data(), n, x.data(), 2 * n);
+                        break;
+
+                    case 5:
+                        unsigned_karatsuba_square(a.data(), n, x.data(), 2 * n);
+                        break;
+
+                    case 6:
+                        unsigned_toom3_square(a.data(), n, x.data(), 2 * n);
+                        break;
+
+                    default:
+                        unsigned_ntt_multiply(a.data(), n, a.data(), n, x.data(), 2 * n);
+                        break;
+                    }
+                }
+                costs[k] = (PerformanceCounter::now() - s) * 1000 / rounds;
+            }
+
+            printf("\n%6zu", n);
+            for (double c : costs)
+                printf(" %9.3f", c);
+        }
+        printf("\n");
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestFastMultiplyBenchmark, "numeric,benchmark")
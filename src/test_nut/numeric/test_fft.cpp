@@ -1,4 +1,5 @@
 ﻿
+#include <string.h> // for ::memcpy()
 #include <iostream>
 
 #include <nut/unittest/unittest.h>
@@ -16,6 +17,8 @@ class TestFFT : public TestFixture
     virtual void register_cases() noexcept final override
     {
         NUT_REGISTER_CASE(test_smoke);
+        NUT_REGISTER_CASE(test_transform);
+        NUT_REGISTER_CASE(test_large);
         NUT_REGISTER_CASE(test_profile);
     }
 
@@ -37,6 +40,65 @@ class TestFFT : public TestFixture
 		NUT_TA(c == a * b);
     }
 
+    void test_transform()
+    {
+        // 正变换后再逆变换应该还原
+        const unsigned loglen = 10;
+        const size_t len = 1 << loglen;
+        fft_complex_type *a = (fft_complex_type*) ::malloc(sizeof(fft_complex_type) * len * 2);
+        fft_complex_type *b = a + len;
+        for (size_t i = 0; i < len; ++i)
+            new (a + i) fft_complex_type((double) (::rand() % 100), (double) (::rand() % 100));
+        ::memcpy(b, a, sizeof(fft_complex_type) * len);
+
+        const FFTPlan& plan = FFTPlan::get(loglen);
+        NUT_TA(&plan == &FFTPlan::get(loglen));
+        NUT_TA(plan.size() == len);
+        plan.transform(b, true);
+
+        // 与定义式比较若干点
+        for (size_t k = 0; k < len; k += 97)
+        {
+            fft_complex_type sum(0, 0);
+            for (size_t j = 0; j < len; ++j)
+                sum += a[j] * std::polar(1.0, 2 * ::acos(-1.0) * ((j * k) % len) / len);
+            NUT_TA(std::abs(sum - b[k]) < 1e-6);
+        }
+
+        plan.transform(b, false);
+        for (size_t i = 0; i < len; ++i)
+            NUT_TA(std::abs(a[i] - b[i]) < 1e-9);
+        ::free(a);
+    }
+
+    void test_large()
+    {
+        // 之前在栈上分配, 规模较大时会栈溢出
+        const size_t bits_list[] = {1, 64, 1000, 65536, 800000};
+        for (size_t bits : bits_list)
+        {
+            BigInteger a = BigInteger::rand_positive(bits), b = BigInteger::rand_positive(bits / 3 + 1);
+            size_t a_len = a.significant_words_length(), b_len = b.significant_words_length();
+            BigInteger::word_type *rs = (BigInteger::word_type*) ::malloc(
+                sizeof(BigInteger::word_type) * (a_len + b_len));
+            unsigned_fft_multiply(a.data(), a_len, b.data(), b_len, rs, a_len + b_len);
+            BigInteger c(rs, sizeof(BigInteger::word_type) * (a_len + b_len), false);
+            ::free(rs);
+            NUT_TA(c == a * b);
+        }
+
+        // 有符号
+        BigInteger a = -BigInteger::rand_positive(3000), b = BigInteger::rand_positive(2000);
+        const size_t P = a.significant_words_length() + b.significant_words_length();
+        a.resize(P);
+        b.resize(P);
+        BigInteger::word_type *rs = (BigInteger::word_type*) ::malloc(sizeof(BigInteger::word_type) * P);
+        signed_fft_multiply(a.data(), P, b.data(), P, rs, P);
+        BigInteger c(rs, sizeof(BigInteger::word_type) * P, true);
+        ::free(rs);
+        NUT_TA(c == a * b);
+    }
+
     void test_profile()
     {
         const size_t bits = 2000;
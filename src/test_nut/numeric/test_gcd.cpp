@@ -0,0 +1,221 @@
+
+#include <stdio.h>
+#include <vector>
+
+#include <nut/unittest/unittest.h>
+#include <nut/numeric/big_integer.h>
+#include <nut/numeric/numeric_algo/gcd.h>
+#include <nut/numeric/numeric_algo/prime.h> // for inverse_of_coprime_mod()
+#include <nut/time/performance_counter.h>
+
+
+using namespace std;
+using namespace nut;
+
+class TestGcd : public TestFixture
+{
+    typedef BigInteger::word_type word_type;
+
+    virtual void register_cases() noexcept final override
+    {
+        NUT_REGISTER_CASE(test_small);
+        NUT_REGISTER_CASE(test_lehmer);
+        NUT_REGISTER_CASE(test_half_gcd);
+        NUT_REGISTER_CASE(test_inverse);
+    }
+
+    /**
+     * 逐步取模, 作为对照
+     */
+    static BigInteger naive_gcd(BigInteger a, BigInteger b)
+    {
+        while (!b.is_zero())
+        {
+            a %= b;
+            BigInteger::swap(&a, &b);
+        }
+        return a;
+    }
+
+    /**
+     * d 是 a、b 的公约数, 且 d = ax + by, 则 d 就是最大公约数
+     */
+    static bool check_extended(const BigInteger& a, const BigInteger& b, const BigInteger& d,
+                               const BigInteger& x, const BigInteger& y)
+    {
+        if (d.is_zero())
+            return a.is_zero() && b.is_zero();
+        return a % d == 0 && b % d == 0 && a * x + b * y == d;
+    }
+
+    void test_small()
+    {
+        const BigInteger::cast_int_type values[] = {0, 1, 2, 3, 12, 18, 65537, 1000000007LL,
+                                                    0x7fffffffffffffffLL};
+        for (BigInteger::cast_int_type i : values)
+        {
+            for (BigInteger::cast_int_type j : values)
+            {
+                const BigInteger a(i), b(j);
+                BigInteger d, x, y;
+                lehmer_gcd(a, b, &d, &x, &y);
+                NUT_TA(d == naive_gcd(a, b));
+                NUT_TA(check_extended(a, b, d, x, y));
+                NUT_TA(gcd(a, b) == d);
+            }
+        }
+
+        // 负数
+        BigInteger d, x, y;
+        extended_euclid(BigInteger(-12), BigInteger(18), &d, &x, &y);
+        NUT_TA(BigInteger(-12) * x + BigInteger(18) * y == d);
+    }
+
+    void test_lehmer()
+    {
+        const size_t bits_list[] = {100, 128, 129, 1000, 4096, 20000};
+        for (size_t bits : bits_list)
+        {
+            // 随机数, 以及有较大公约数的数
+            const BigInteger g = BigInteger::rand_positive(bits / 3 + 1);
+            const BigInteger pairs[][2] = {
+                {BigInteger::rand_positive(bits), BigInteger::rand_positive(bits)},
+                {BigInteger::rand_positive(bits), BigInteger::rand_positive(bits / 2 + 1)},
+                {g * BigInteger::rand_positive(bits), g * BigInteger::rand_positive(bits)},
+                {BigInteger::rand_positive(bits), BigInteger(1)},
+            };
+            for (auto& p : pairs)
+            {
+                const BigInteger expected = naive_gcd(p[0], p[1]);
+                BigInteger d, x, y;
+                lehmer_gcd(p[0], p[1], &d, &x, &y);
+                NUT_TA(d == expected);
+                NUT_TA(check_extended(p[0], p[1], d, x, y));
+
+                extended_euclid(p[1], p[0], &d, &x, &y);
+                NUT_TA(d == expected);
+                NUT_TA(check_extended(p[1], p[0], d, x, y));
+                NUT_TA(gcd(p[0], p[1]) == expected);
+            }
+        }
+
+        // 相邻的斐波那契数, 商全为 1
+        BigInteger f0(1), f1(1);
+        for (int i = 0; i < 3000; ++i)
+        {
+            f0 += f1;
+            BigInteger::swap(&f0, &f1);
+        }
+        BigInteger d, x, y;
+        lehmer_gcd(f1, f0, &d, &x, &y);
+        NUT_TA(d == 1 && check_extended(f1, f0, d, x, y));
+    }
+
+    void test_half_gcd()
+    {
+        const size_t words_list[] = {NUT_HALF_GCD_EXTENDED_THRESHOLD, NUT_HALF_GCD_THRESHOLD,
+                                     3 * NUT_HALF_GCD_THRESHOLD};
+        for (size_t words : words_list)
+        {
+            const size_t bits = 8 * sizeof(word_type) * words;
+            const BigInteger g = BigInteger::rand_positive(bits / 4);
+            const BigInteger pairs[][2] = {
+                {BigInteger::rand_positive(bits), BigInteger::rand_positive(bits)},
+                {BigInteger::rand_positive(bits), BigInteger::rand_positive(bits - 100)},
+                {g * BigInteger::rand_positive(bits), g * BigInteger::rand_positive(bits)},
+            };
+            for (auto& p : pairs)
+            {
+                BigInteger d, x, y, d2;
+                extended_euclid(p[0], p[1], &d, &x, &y);
+                NUT_TA(check_extended(p[0], p[1], d, x, y));
+                lehmer_gcd(p[0], p[1], &d2);
+                NUT_TA(d == d2);
+                NUT_TA(gcd(p[0], p[1]) == d);
+            }
+        }
+    }
+
+    void test_inverse()
+    {
+        const size_t bits_list[] = {64, 1024, 8 * sizeof(word_type) * 2 * NUT_HALF_GCD_EXTENDED_THRESHOLD};
+        for (size_t bits : bits_list)
+        {
+            const BigInteger n = BigInteger::rand_positive(bits);
+            BigInteger a = BigInteger::rand_between(BigInteger(1), n);
+            while (gcd(a, n) != 1)
+                a = BigInteger::rand_between(BigInteger(1), n);
+            const BigInteger inv = inverse_of_coprime_mod(a, n);
+            NUT_TA(inv.is_positive() && inv < n);
+            NUT_TA((a * inv) % n == 1);
+        }
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestGcd, "numeric,quiet")
+
+/**
+ * 性能测量, 只输出耗时而不做检查, 不在默认的 quiet 分组中, 需要用 -g benchmark 或者
+ * -f TestGcdBenchmark 单独运行
+ */
+class TestGcdBenchmark : public TestFixture
+{
+    typedef BigInteger::word_type word_type;
+
+    virtual void register_cases() noexcept final override
+    {
+        NUT_REGISTER_CASE(test_calibrate);
+    }
+
+    /**
+     * 测量 Lehmer 算法与 half-GCD 的耗时(ms), 作为 NUT_HALF_GCD_THRESHOLD 和
+     * NUT_HALF_GCD_EXTENDED_THRESHOLD 的依据
+     */
+    void test_calibrate()
+    {
+        const size_t sizes[] = {100, 200, 400, 800, 1200, 1600, 2400, 3200, 6400};
+        printf("\n%6s %9s %9s %9s %9s", "words", "lehmer", "half-gcd", "ext-lehm", "ext-half");
+        for (size_t n : sizes)
+        {
+            const size_t bits = 8 * sizeof(word_type) * n;
+            const BigInteger a = BigInteger::rand_positive(bits), b = BigInteger::rand_positive(bits);
+            const int rounds = (int) std::max<size_t>(1, 800 / n);
+            BigInteger d, x;
+
+            double costs[4];
+            for (int k = 0; k < 4; ++k)
+            {
+                const PerformanceCounter s = PerformanceCounter::now();
+                for (int i = 0; i < rounds; ++i)
+                {
+                    switch (k)
+                    {
+                    case 0:
+                        lehmer_gcd(a, b, &d);
+                        break;
+
+                    case 1:
+                        d = gcd(a, b);
+                        break;
+
+                    case 2:
+                        lehmer_gcd(a, b, &d, &x);
+                        break;
+
+                    default:
+                        extended_euclid(a, b, &d, &x, nullptr);
+                        break;
+                    }
+                }
+                costs[k] = (PerformanceCounter::now() - s) * 1000 / rounds;
+            }
+
+            printf("\n%6zu", n);
+            for (double c : costs)
+                printf(" %9.3f", c);
+        }
+        printf("\n");
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestGcdBenchmark, "numeric,benchmark")
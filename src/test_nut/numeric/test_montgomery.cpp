@@ -0,0 +1,163 @@
+﻿
+#include <iostream>
+#include <vector>
+
+#include <nut/unittest/unittest.h>
+#include <nut/numeric/big_integer.h>
+#include <nut/numeric/numeric_algo/mod.h>
+#include <nut/numeric/numeric_algo/montgomery.h>
+#include <nut/time/performance_counter.h>
+
+
+using namespace std;
+using namespace nut;
+
+class TestMontgomery : public TestFixture
+{
+    typedef BigInteger::word_type word_type;
+
+    virtual void register_cases() noexcept final override
+    {
+        NUT_REGISTER_CASE(test_mul_sqr);
+        NUT_REGISTER_CASE(test_pow);
+        NUT_REGISTER_CASE(test_copy);
+        NUT_REGISTER_CASE(test_performance);
+    }
+
+    static BigInteger rand_odd(size_t bit_len)
+    {
+        BigInteger n = BigInteger::rand_positive(bit_len, true);
+        n.set_bit(0, 1);
+        return n;
+    }
+
+    /**
+     * 按定义计算模幂, 作为对照
+     */
+    static BigInteger naive_pow_mod(const BigInteger& a, const BigInteger& b, const BigInteger& n)
+    {
+        BigInteger ret(1);
+        for (size_t i = b.bit_length(); i > 0; --i)
+        {
+            ret = (ret * ret) % n;
+            if (0 != b.bit_at(i - 1))
+                ret = (ret * a) % n;
+        }
+        return ret % n;
+    }
+
+    static vector<word_type> to_words(const BigInteger& a, size_t N)
+    {
+        vector<word_type> ret(N, 0);
+        for (size_t i = 0; i < N && i < a.significant_words_length(); ++i)
+            ret[i] = a.data()[i];
+        return ret;
+    }
+
+    void test_mul_sqr()
+    {
+        const size_t bits[] = {2, 63, 64, 65, 128, 500, 1024, 2048};
+        for (size_t bit_len : bits)
+        {
+            const BigInteger n = rand_odd(bit_len);
+            const MontgomeryContext ctx(n);
+            const size_t N = ctx.words_length();
+            NUT_TA(N == (bit_len + 8 * sizeof(word_type) - 1) / (8 * sizeof(word_type)));
+            vector<word_type> scratch(ctx.scratch_length()), x(N), y(N), z(N);
+
+            for (int round = 0; round < 20; ++round)
+            {
+                // 包括模减 1 这样的最大值
+                const BigInteger a = (0 == round ? n - 1 : BigInteger::rand_positive(bit_len) % n),
+                    b = BigInteger::rand_positive(bit_len) % n;
+                vector<word_type> wa = to_words(a, N), wb = to_words(b, N);
+
+                ctx.to_montgomery(wa.data(), x.data(), scratch.data());
+                ctx.to_montgomery(wb.data(), y.data(), scratch.data());
+                ctx.mul(x.data(), y.data(), z.data(), scratch.data());
+                ctx.from_montgomery(z.data(), z.data(), scratch.data());
+                NUT_TA(z == to_words(a * b % n, N));
+
+                ctx.sqr(x.data(), x.data(), scratch.data());
+                ctx.from_montgomery(x.data(), x.data(), scratch.data());
+                NUT_TA(x == to_words(a * a % n, N));
+            }
+
+            // 1 的蒙哥马利表示
+            ctx.from_montgomery(ctx.one(), x.data(), scratch.data());
+            NUT_TA(x == to_words(BigInteger(1), N));
+        }
+    }
+
+    void test_pow()
+    {
+        const size_t bits[] = {3, 64, 100, 512, 1030};
+        for (size_t bit_len : bits)
+        {
+            const BigInteger n = rand_odd(bit_len);
+            const MontgomeryContext ctx(n);
+            for (int round = 0; round < 5; ++round)
+            {
+                const BigInteger a = BigInteger::rand_positive(bit_len + 10),
+                    b = BigInteger::rand_positive(17 * round * round + 1);
+                const BigInteger x = naive_pow_mod(a, b, n);
+                NUT_TA(ctx.pow(a, b) == x);
+                NUT_TA(ctx.pow_fixed_window(a, b) == x);
+                NUT_TA(pow_mod(a, b, n) == x);
+            }
+            NUT_TA(ctx.pow(n - 2, BigInteger(0)) == 1 && ctx.pow_fixed_window(n - 2, BigInteger(0)) == 1);
+            NUT_TA(ctx.pow(n, BigInteger(5)).is_zero() && ctx.pow_fixed_window(n * 2, BigInteger(5)).is_zero());
+            NUT_TA(ctx.pow(BigInteger(-1), BigInteger(3)) == n - 1);
+        }
+
+        // 费马小定理
+        const BigInteger p = BigInteger::value_of("170141183460469231731687303715884105727"); // 2^127 - 1
+        const MontgomeryContext ctx(p);
+        NUT_TA(ctx.pow(BigInteger(3), p - 1) == 1);
+        NUT_TA(ctx.pow_fixed_window(BigInteger(3), p - 1) == 1);
+    }
+
+    void test_copy()
+    {
+        const BigInteger n1 = rand_odd(300), n2 = rand_odd(700);
+        const BigInteger a = BigInteger::rand_positive(200), b = BigInteger::rand_positive(200);
+        MontgomeryContext c1(n1), c2(n2);
+        const BigInteger x1 = c1.pow(a, b), x2 = c2.pow(a, b);
+
+        MontgomeryContext c3(c1);
+        NUT_TA(c3.pow(a, b) == x1);
+        c3 = c2;
+        NUT_TA(c3.pow(a, b) == x2 && c3.get_modulus() == n2);
+        MontgomeryContext c4(std::move(c3));
+        NUT_TA(c4.pow(a, b) == x2);
+        c4 = std::move(c1);
+        NUT_TA(c4.pow(a, b) == x1 && c4.get_modulus() == n1);
+    }
+
+    void test_performance()
+    {
+        // 同一个模下反复求模幂, 例如 RSA 加解密
+        const BigInteger n = rand_odd(2048);
+        const MontgomeryContext ctx(n);
+        vector<BigInteger> as, bs;
+        for (int i = 0; i < 20; ++i)
+        {
+            as.push_back(BigInteger::rand_positive(2047));
+            bs.push_back(BigInteger::rand_positive(2048));
+        }
+
+        const PerformanceCounter s = PerformanceCounter::now();
+        for (size_t i = 0; i < as.size(); ++i)
+            ctx.pow(as.at(i), bs.at(i));
+        const PerformanceCounter t1 = PerformanceCounter::now();
+        for (size_t i = 0; i < as.size(); ++i)
+            ctx.pow_fixed_window(as.at(i), bs.at(i));
+        const PerformanceCounter t2 = PerformanceCounter::now();
+        const BigInteger r1 = ctx.pow(as.at(0), bs.at(0));
+        const BigInteger r2 = naive_pow_mod(as.at(0), bs.at(0), n);
+        NUT_TA(r1 == r2);
+        printf(" sliding %.3fms, fixed %.3fms ", (t1 - s) * 1000 / as.size(), (t2 - t1) * 1000 / as.size());
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestMontgomery, "numeric,quiet")
@@ -1,12 +1,17 @@
 ﻿
+#include <string.h> // for ::memcmp()
 #include <iostream>
+#include <vector>
 
 #include <nut/unittest/unittest.h>
 #include <nut/numeric/big_integer.h>
 #include <nut/numeric/word_array_integer/mul_op.h>
+#include <nut/numeric/word_array_integer/bit_op.h>
 #include <nut/numeric/numeric_algo/mod.h>
 #include <nut/numeric/numeric_algo/ntt.h>
 #include <nut/numeric/numeric_algo/prime.h>
+#include <nut/rc/rc_new.h>
+#include <nut/threading/thread_pool.h>
 #include <nut/time/performance_counter.h>
 
 
@@ -18,6 +23,10 @@ class TestNTT : public TestFixture
     virtual void register_cases() noexcept final override
     {
         NUT_REGISTER_CASE(test_smoke);
+        NUT_REGISTER_CASE(test_transform);
+        NUT_REGISTER_CASE(test_sizes);
+        NUT_REGISTER_CASE(test_crt);
+        NUT_REGISTER_CASE(test_crt_in_pool);
         NUT_REGISTER_CASE(test_profile);
     }
 
@@ -41,6 +50,132 @@ class TestNTT : public TestFixture
 		NUT_TA(c == a * b);
     }
 
+    void test_transform()
+    {
+        // 正变换后再逆变换应该还原
+        const unsigned bits = 12;
+        const size_t len = 1 << bits;
+        ntt_word_type *a = (ntt_word_type*) ::malloc(sizeof(ntt_word_type) * len * 2);
+        ntt_word_type *b = a + len;
+        for (size_t i = 0; i < len; ++i)
+            a[i] = b[i] = (((ntt_word_type) ::rand()) << 31 | ::rand()) % NUT_NTT_M;
+
+        const NTTPlan& plan = NTTPlan::get(bits);
+        NUT_TA(&plan == &NTTPlan::get(bits));
+        NUT_TA(plan.size() == len);
+        plan.forward(b);
+        plan.inverse(b);
+        NUT_TA(0 == ::memcmp(a, b, sizeof(ntt_word_type) * len));
+        ::free(a);
+    }
+
+    void test_sizes()
+    {
+        const size_t bits_list[] = {1, 64, 1000, 65536, 300000};
+        for (size_t bits : bits_list)
+        {
+            NUT_TA(can_use_single_modulus_ntt(bits));
+            BigInteger a = BigInteger::rand_positive(bits), b = BigInteger::rand_positive(bits / 3 + 1);
+            size_t a_len = a.significant_words_length(), b_len = b.significant_words_length();
+            BigInteger::word_type *rs = (BigInteger::word_type*) ::malloc(
+                sizeof(BigInteger::word_type) * (a_len + b_len));
+            unsigned_single_modulus_ntt_multiply(a.data(), a_len, b.data(), b_len, rs, a_len + b_len);
+            BigInteger c(rs, sizeof(BigInteger::word_type) * (a_len + b_len), false);
+            ::free(rs);
+            NUT_TA(c == a * b);
+        }
+    }
+
+    void test_crt()
+    {
+        for (unsigned p = 0; p < NUT_NTT_PRIME_COUNT; ++p)
+            NUT_TA(psedoprime(BigInteger(NTTPlan::get(1, p).get_modulus())));
+
+        // 超出单模数 NTT 的限制
+        NUT_TA(!can_use_single_modulus_ntt(1 << 20));
+        NUT_TA(can_use_ntt_multiply(1 << 20));
+
+        const size_t bits_list[] = {1, 64, 1000, 65536, 800000, 3000000};
+        for (size_t bits : bits_list)
+        {
+            BigInteger a = BigInteger::rand_positive(bits), b = BigInteger::rand_positive(bits / 3 + 1);
+            size_t a_len = a.significant_words_length(), b_len = b.significant_words_length();
+            BigInteger::word_type *rs = (BigInteger::word_type*) ::malloc(
+                sizeof(BigInteger::word_type) * (a_len + b_len));
+            unsigned_ntt_multiply(a.data(), a_len, b.data(), b_len, rs, a_len + b_len);
+            BigInteger c(rs, sizeof(BigInteger::word_type) * (a_len + b_len), false);
+            NUT_TA(c == a * b);
+
+            // 多线程
+            unsigned_ntt_crt_multiply(a.data(), a_len, b.data(), b_len, rs, a_len + b_len, 3);
+            c.set(rs, sizeof(BigInteger::word_type) * (a_len + b_len), false);
+            NUT_TA(c == a * b);
+            ::free(rs);
+        }
+
+        // 系数全部取最大值, 卷积结果最大
+        const size_t n = 20000;
+        const BigInteger a = (BigInteger(1) << (8 * sizeof(BigInteger::word_type) * n)) - 1;
+        BigInteger::word_type *rs = (BigInteger::word_type*) ::malloc(
+            sizeof(BigInteger::word_type) * 2 * n);
+        unsigned_ntt_crt_multiply(a.data(), n, a.data(), n, rs, 2 * n); // 平方
+        BigInteger c(rs, sizeof(BigInteger::word_type) * 2 * n, false);
+        NUT_TA(c == a * a);
+
+        // 截断
+        unsigned_ntt_crt_multiply(a.data(), n, a.data(), n, rs, n + 3);
+        c.set(rs, sizeof(BigInteger::word_type) * (n + 3), false);
+        BigInteger aa = a * a;
+        aa.limit_positive_bits_to(8 * sizeof(BigInteger::word_type) * (n + 3));
+        NUT_TA(c == aa);
+        ::free(rs);
+
+        // 16 位字
+        const BigInteger b = BigInteger::rand_positive(100000), d = BigInteger::rand_positive(70000);
+        const size_t b_bytes = sizeof(BigInteger::word_type) * b.significant_words_length(),
+            d_bytes = sizeof(BigInteger::word_type) * d.significant_words_length(),
+            x_words = (b_bytes + d_bytes) / sizeof(BigInteger::word_type);
+        uint16_t *bb = (uint16_t*) ::malloc(b_bytes + d_bytes + b_bytes + d_bytes);
+        ::memset(bb, 0, b_bytes + d_bytes + b_bytes + d_bytes);
+        uint16_t *dd = bb + b_bytes / 2, *xx = dd + d_bytes / 2;
+        for (size_t i = 0; i < b_bytes; ++i)
+            set_byte_le(bb, i, get_byte_le(b.data(), i));
+        for (size_t i = 0; i < d_bytes; ++i)
+            set_byte_le(dd, i, get_byte_le(d.data(), i));
+        unsigned_ntt_crt_multiply(bb, b_bytes / 2, dd, d_bytes / 2, xx, (b_bytes + d_bytes) / 2);
+        BigInteger::word_type *ee = (BigInteger::word_type*) ::malloc(b_bytes + d_bytes);
+        for (size_t i = 0; i < b_bytes + d_bytes; ++i)
+            set_byte_le(ee, i, get_byte_le(xx, i));
+        BigInteger e(ee, sizeof(BigInteger::word_type) * x_words, false);
+        ::free(ee);
+        ::free(bb);
+        NUT_TA(e == b * d);
+    }
+
+    void test_crt_in_pool()
+    {
+        const BigInteger a = BigInteger::rand_positive(300000), b = BigInteger::rand_positive(200000);
+        const BigInteger expected = a * b;
+        const size_t a_len = a.significant_words_length(), b_len = b.significant_words_length();
+        vector<BigInteger::word_type> rs(a_len + b_len);
+
+        // 各模数的变换分摊到线程池中
+        rc_ptr<ThreadPool> pool = rc_new<ThreadPool>(2);
+        unsigned_ntt_crt_multiply(a.data(), a_len, b.data(), b_len, rs.data(), rs.size(), 0, pool);
+        NUT_TA(BigInteger(rs.data(), sizeof(BigInteger::word_type) * rs.size(), false) == expected);
+
+        // 在线程池的任务中使用同一个线程池, 线程池已无空闲线程
+        pool = rc_new<ThreadPool>(1);
+        bool ok = false;
+        pool->add_task([&] {
+            vector<BigInteger::word_type> x(a_len + b_len);
+            unsigned_ntt_crt_multiply(a.data(), a_len, b.data(), b_len, x.data(), x.size(), 0, pool);
+            ok = (BigInteger(x.data(), sizeof(BigInteger::word_type) * x.size(), false) == expected);
+        });
+        pool->wait_until_all_idle();
+        NUT_TA(ok);
+    }
+
     void test_profile()
     {
         const size_t bits = 50000;
@@ -0,0 +1,137 @@
+
+#include <stdio.h>
+#include <vector>
+
+#include <nut/unittest/unittest.h>
+#include <nut/numeric/big_integer.h>
+#include <nut/numeric/numeric_algo/prime.h>
+#include <nut/numeric/numeric_algo/prime_sieve.h>
+#include <nut/threading/thread_pool.h>
+#include <nut/time/performance_counter.h>
+#include <nut/rc/rc_new.h>
+
+
+using namespace std;
+using namespace nut;
+
+class TestPrimeSieve : public TestFixture
+{
+    virtual void register_cases() noexcept final override
+    {
+        NUT_REGISTER_CASE(test_small);
+        NUT_REGISTER_CASE(test_segments);
+        NUT_REGISTER_CASE(test_batch_miller_rabin);
+        NUT_REGISTER_CASE(test_next_prime);
+    }
+
+    rc_ptr<ThreadPool> _pool;
+
+    virtual void set_up() override
+    {
+        _pool = rc_new<ThreadPool>(4);
+    }
+
+    virtual void tear_down() override
+    {
+        _pool->interrupt();
+        _pool->join();
+        _pool = nullptr;
+    }
+
+    void test_small()
+    {
+        const uint64_t expected[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47,
+                                     53, 59, 61, 67, 71, 73, 79, 83, 89, 97};
+        NUT_TA(sieve_primes(0, 100) == vector<uint64_t>(expected, expected + 25));
+        NUT_TA(sieve_primes(5, 30) == vector<uint64_t>(expected + 2, expected + 10));
+        NUT_TA(sieve_primes(7, 8) == vector<uint64_t>(1, 7));
+        NUT_TA(sieve_primes(0, 2).empty());
+        NUT_TA(sieve_primes(24, 29).empty());
+        NUT_TA(sieve_primes(100, 50).empty());
+
+        NUT_TA(sieve_primes(0, 1000000).size() == 78498);
+    }
+
+    void test_segments()
+    {
+        // 跨越多个分段
+        PerformanceCounter s = PerformanceCounter::now();
+        const vector<uint64_t> primes = sieve_primes(0, 10000000);
+        const PerformanceCounter t1 = PerformanceCounter::now();
+        NUT_TA(primes.size() == 664579);
+        NUT_TA(sieve_primes(0, 10000000, _pool) == primes);
+        const PerformanceCounter t2 = PerformanceCounter::now();
+        printf(" 1 thread %.3fms, pool %.3fms ", (t1 - s) * 1000, (t2 - t1) * 1000);
+
+        // 区间拼接
+        vector<uint64_t> joined = sieve_primes(0, 3333331);
+        const vector<uint64_t> upper = sieve_primes(3333331, 10000000, _pool);
+        joined.insert(joined.end(), upper.begin(), upper.end());
+        NUT_TA(joined == primes);
+
+        // 远离原点的区间, 基础素数也需要递归筛出
+        const uint64_t lo = 1000000000000ULL, hi = lo + 100000;
+        const vector<uint64_t> far = sieve_primes(lo, hi, _pool);
+        NUT_TA(far == sieve_primes(lo, hi));
+        NUT_TA(!far.empty() && far.front() >= lo && far.back() < hi);
+        for (uint64_t p : far)
+            NUT_TA(miller_rabin(BigInteger((BigInteger::cast_int_type) p), 10));
+        NUT_TA(!miller_rabin(BigInteger((BigInteger::cast_int_type) far.front() - 2), 10) ||
+               far.front() - 2 < lo);
+    }
+
+    void test_batch_miller_rabin()
+    {
+        vector<BigInteger> candidates;
+        const BigInteger::cast_int_type smalls[] = {
+            0, 1, 2, 3, 4, 9, 97, 561, 1105, 16381, 16383, 16411, 1046527, 1046529,
+            1000000007, 999999999989LL};
+        for (BigInteger::cast_int_type v : smalls)
+            candidates.emplace_back(v);
+
+        // 两个大于试除上界的素数之积
+        const BigInteger p = next_prime(BigInteger(100003)), q = next_prime(BigInteger(2000003));
+        candidates.push_back(p * q);
+        candidates.push_back(p * p);
+
+        // 大素数及其附近的数
+        BigInteger big = next_prime(BigInteger::rand_positive(512, true));
+        for (int i = 0; i < 40; ++i)
+            candidates.push_back(big + i);
+        candidates.push_back(big * next_prime(BigInteger::rand_positive(256, true)));
+
+        const size_t count = candidates.size();
+        bool *results = new bool[2 * count];
+        miller_rabin(candidates.data(), count, 20, results);
+        miller_rabin(candidates.data(), count, 20, results + count, _pool);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const bool expected = (candidates[i] >= 2 && miller_rabin(candidates[i], 20));
+            NUT_TA(results[i] == expected);
+            NUT_TA(results[count + i] == expected);
+        }
+        NUT_TA(!results[0] && !results[1] && results[2] && results[3] && !results[4]);
+        NUT_TA(!results[7] && !results[8]); // Carmichael 数
+        NUT_TA(results[9] && !results[10] && results[11] && results[14] && results[15]);
+        NUT_TA(!results[16] && !results[17] && results[18]);
+        delete[] results;
+
+        miller_rabin(nullptr, 0, 20, nullptr, _pool);
+    }
+
+    void test_next_prime()
+    {
+        BigInteger bound(1);
+        bound <<= 512;
+
+        PerformanceCounter s = PerformanceCounter::now();
+        const BigInteger a = next_prime(bound);
+        const PerformanceCounter t1 = PerformanceCounter::now();
+        NUT_TA(next_prime(bound, _pool) == a);
+        const PerformanceCounter t2 = PerformanceCounter::now();
+        NUT_TA(a > bound && miller_rabin(a, 20));
+        printf(" 1 thread %.3fms, pool %.3fms ", (t1 - s) * 1000, (t2 - t1) * 1000);
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestPrimeSieve, "numeric,quiet")
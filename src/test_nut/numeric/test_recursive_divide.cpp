@@ -0,0 +1,263 @@
+﻿
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nut/unittest/unittest.h>
+#include <nut/numeric/big_integer.h>
+#include <nut/numeric/word_array_integer/mul_op.h>
+#include <nut/numeric/word_array_integer/div_op.h>
+#include <nut/numeric/numeric_algo/recursive_divide.h>
+#include <nut/time/performance_counter.h>
+#include <nut/util/string/string_utils.h>
+
+#include "rand_words.h"
+
+
+using namespace std;
+using namespace nut;
+
+class TestRecursiveDivide : public TestFixture
+{
+    typedef BigInteger::word_type word_type;
+
+    virtual void register_cases() noexcept final override
+    {
+        NUT_REGISTER_CASE(test_knuth_divide);
+        NUT_REGISTER_CASE(test_bz_divide);
+        NUT_REGISTER_CASE(test_radix_conversion);
+        NUT_REGISTER_CASE(test_radix_power_cache);
+    }
+
+    mt19937 _rand;
+
+    /**
+     * 按定义逐位转换, 作为对照
+     */
+    static string naive_to_string(BigInteger x, size_t radix)
+    {
+        const bool negative = x.is_negative();
+        if (negative)
+            x = -x;
+        string s;
+        const BigInteger r(radix);
+        do
+        {
+            BigInteger q, d;
+            BigInteger::divide(x, r, &q, &d);
+            s.push_back(int_to_char((int) d.to_integer(), true));
+            x = std::move(q);
+        } while (!x.is_zero());
+        if (negative)
+            s.push_back('-');
+        return string(s.rbegin(), s.rend());
+    }
+
+    void test_knuth_divide()
+    {
+        // 最高位为 1 的无符号数, 以及需要回加的情形
+        const size_t sizes[][2] = {{1, 1}, {2, 1}, {5, 2}, {9, 4}, {40, 39}, {100, 30}};
+        for (auto& s : sizes)
+        {
+            for (int round = 0; round < 20; ++round)
+            {
+                vector<word_type> a = rand_words(_rand, s[0]), b = rand_words(_rand, s[1]);
+                if (0 != round % 3)
+                    b[s[1] - 1] = ~(word_type) 0; // qhat 估值偏大
+                vector<word_type> q(s[0]), r(s[1]), p(s[0] + s[1]), t(s[0] + 1);
+                unsigned_divide(a.data(), a.size(), b.data(), b.size(), q.data(), q.size(), r.data(), r.size());
+
+                // a == q * b + r
+                unsigned_multiply(q.data(), q.size(), b.data(), b.size(), p.data(), p.size());
+                unsigned_add(p.data(), p.size(), r.data(), r.size(), t.data(), t.size());
+                NUT_TA(0 == ::memcmp(t.data(), a.data(), sizeof(word_type) * s[0]) && 0 == t[s[0]]);
+                NUT_TA(unsigned_compare(r.data(), r.size(), b.data(), b.size()) < 0);
+            }
+        }
+
+        // 单字除数
+        vector<word_type> a = rand_words(_rand, 50), q(50);
+        const word_type b = ~(word_type) 12345;
+        const word_type rem = unsigned_divide_word(a.data(), a.size(), b, q.data());
+        vector<word_type> p(51);
+        unsigned_multiply(q.data(), q.size(), &b, 1, p.data(), p.size());
+        unsigned_add(p.data(), p.size(), &rem, 1, p.data(), p.size());
+        NUT_TA(0 == ::memcmp(p.data(), a.data(), sizeof(word_type) * 50) && 0 == p[50]);
+        NUT_TA(rem < b);
+    }
+
+    void test_bz_divide()
+    {
+        const size_t sizes[][2] = {{200, 81}, {300, 100}, {1000, 170}, {1000, 500}, {3000, 1300}};
+        for (auto& s : sizes)
+        {
+            BigInteger a = BigInteger::rand_positive(s[0] * 8 * sizeof(word_type)),
+                b = BigInteger::rand_positive(s[1] * 8 * sizeof(word_type));
+            for (int sign = 0; sign < 4; ++sign)
+            {
+                const BigInteger sa = (0 == (sign & 1) ? a : -a), sb = (0 == (sign & 2) ? b : -b);
+                BigInteger q, r;
+                burnikel_ziegler_divide(sa, sb, &q, &r);
+                NUT_TA(q * sb + r == sa);
+                NUT_TA((r.is_negative() ? -r : r) < b);
+                NUT_TA(r.is_zero() || r.is_negative() == sa.is_negative());
+
+                // 与 Knuth 算法 D 的结果一致
+                vector<word_type> qq(sa.significant_words_length()), rr(sb.significant_words_length());
+                signed_divide(sa.data(), sa.significant_words_length(), sb.data(), sb.significant_words_length(),
+                              qq.data(), qq.size(), rr.data(), rr.size());
+                NUT_TA(q == BigInteger(qq.data(), sizeof(word_type) * qq.size(), true));
+                NUT_TA(r == BigInteger(rr.data(), sizeof(word_type) * rr.size(), true));
+            }
+        }
+
+        // 整除, 以及与参数重叠的输出
+        BigInteger a = BigInteger::rand_positive(40000), b = BigInteger::rand_positive(20000);
+        BigInteger c = a * b;
+        NUT_TA(c / b == a && c % b == 0);
+        c += 12345;
+        BigInteger d = c;
+        burnikel_ziegler_divide(d, b, &d, nullptr);
+        NUT_TA(d == a);
+        d = c;
+        burnikel_ziegler_divide(d, a, nullptr, &d);
+        NUT_TA(d == 12345);
+    }
+
+    void test_radix_conversion()
+    {
+        const size_t radixes[] = {2, 8, 10, 16, 32, 36};
+        const size_t bits[] = {1, 63, 64, 65, 2000, 2048, 30000};
+        for (size_t radix : radixes)
+        {
+            for (size_t bit_count : bits)
+            {
+                BigInteger x = BigInteger::rand_positive(bit_count);
+                x.set_bit(bit_count - 1, 1);
+                for (int sign = 0; sign < 2; ++sign)
+                {
+                    const string s = naive_to_string(x, radix);
+                    NUT_TA(x.to_string(radix) == s);
+                    NUT_TA(BigInteger::value_of(s, radix) == x);
+                    NUT_TA(x.to_wstring(radix) == wstring(s.begin(), s.end()));
+                    NUT_TA(BigInteger::value_of(wstring(s.begin(), s.end()), radix) == x);
+                    x = -x;
+                }
+            }
+        }
+
+        // 大量低位的 0, 分治时需要补齐
+        BigInteger x = BigInteger::value_of("1" + string(5000, '0') + "7");
+        NUT_TA(x.to_string() == "1" + string(5000, '0') + "7");
+        x = BigInteger::value_of(string(3000, '9'));
+        NUT_TA(x + 1 == BigInteger::value_of("1" + string(3000, '0')));
+
+        // 数字之间的空白以及前导 0
+        NUT_TA(BigInteger::value_of(" - 12 34\t56 ") == -123456);
+        NUT_TA(BigInteger::value_of("000000000000000000000000000000000000000012") == 12);
+        NUT_TA(BigInteger::value_of("ff fF", 16) == 0xffff);
+        NUT_TA(BigInteger::value_of("12x34") == 12);
+        NUT_TA(BigInteger::value_of("").is_zero() && BigInteger::value_of(" - ").is_zero());
+    }
+
+    /**
+     * radix 的幂次在调用之间缓存, 多个线程同时首次使用同一进制时也要得到正确结果
+     */
+    void test_radix_power_cache()
+    {
+        const size_t radixes[] = {3, 7, 10};
+        for (size_t radix : radixes)
+        {
+            const BigInteger x = BigInteger::rand_positive(60000), y = BigInteger::rand_positive(3000);
+            const string sx = naive_to_string(x, radix), sy = naive_to_string(y, radix);
+
+            bool ok[4] = {false, false, false, false};
+            vector<thread> threads;
+            for (size_t i = 0; i < 4; ++i)
+            {
+                threads.emplace_back([&, i] {
+                    // 先大后小, 后者复用已缓存的较低级的幂次
+                    ok[i] = (x.to_string(radix) == sx && BigInteger::value_of(sx, radix) == x &&
+                             y.to_string(radix) == sy && BigInteger::value_of(sy, radix) == y);
+                });
+            }
+            for (thread& t : threads)
+                t.join();
+            for (bool b : ok)
+                NUT_TA(b);
+        }
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestRecursiveDivide, "numeric,quiet")
+
+/**
+ * 性能测量, 只输出耗时, 不在默认的 quiet 分组中, 需要用 -g benchmark 或者
+ * -f TestRecursiveDivideBenchmark 单独运行
+ */
+class TestRecursiveDivideBenchmark : public TestFixture
+{
+    typedef BigInteger::word_type word_type;
+
+    virtual void register_cases() noexcept final override
+    {
+        NUT_REGISTER_CASE(test_calibrate);
+    }
+
+    mt19937 _rand;
+
+    /**
+     * 测量除法及进制转换的耗时(ms), 作为 recursive_divide.h 中边界值的依据
+     */
+    void test_calibrate()
+    {
+        const size_t sizes[] = {40, 80, 160, 320, 640, 1280, 2560};
+        printf("\n%6s %9s %9s", "words", "knuth", "bz");
+        for (size_t n : sizes)
+        {
+            const BigInteger a = BigInteger::rand_positive(2 * n * 8 * sizeof(word_type)),
+                b = BigInteger::rand_positive(n * 8 * sizeof(word_type));
+            const int rounds = (int) std::max<size_t>(1, 1024 / n);
+            vector<word_type> q(2 * n + 1), r(n + 1);
+
+            PerformanceCounter s = PerformanceCounter::now();
+            for (int i = 0; i < rounds; ++i)
+                unsigned_divide(a.data(), a.significant_words_length(), b.data(), b.significant_words_length(),
+                                q.data(), q.size(), r.data(), r.size());
+            const double knuth = (PerformanceCounter::now() - s) * 1000 / rounds;
+
+            s = PerformanceCounter::now();
+            BigInteger qq, rr;
+            for (int i = 0; i < rounds; ++i)
+                burnikel_ziegler_divide(a, b, &qq, &rr);
+            const double bz = (PerformanceCounter::now() - s) * 1000 / rounds;
+
+            printf("\n%6zu %9.3f %9.3f", n, knuth, bz);
+        }
+
+        const size_t digits[] = {1000, 10000, 100000};
+        printf("\n%6s %9s %9s", "digits", "to_str", "value_of");
+        for (size_t n : digits)
+        {
+            string s(n, '0');
+            for (size_t i = 0; i < n; ++i)
+                s[i] = (char) ('0' + _rand() % 10);
+
+            PerformanceCounter t = PerformanceCounter::now();
+            const BigInteger x = BigInteger::value_of(s);
+            const double parse = (PerformanceCounter::now() - t) * 1000;
+
+            t = PerformanceCounter::now();
+            const string ss = x.to_string();
+            const double print = (PerformanceCounter::now() - t) * 1000;
+            NUT_TA(ss == s.substr(s.find_first_not_of('0')));
+
+            printf("\n%6zu %9.3f %9.3f", n, print, parse);
+        }
+        printf("\n");
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestRecursiveDivideBenchmark, "numeric,benchmark")
@@ -3,6 +3,8 @@
 #include <nut/unittest/unittest.h>
 #include <nut/numeric/word_array_integer/word_array_integer.h>
 #include <nut/numeric/word_array_integer/bit_op.h>
+#include <nut/numeric/word_array_integer/mul_op.h>
+#include <nut/numeric/word_array_integer/div_op.h>
 
 
 using namespace std;
@@ -17,6 +19,8 @@ class TestWordArrayInteger : public TestFixture
         NUT_REGISTER_CASE(test_lowest_bit);
         NUT_REGISTER_CASE(test_highest_bit);
         NUT_REGISTER_CASE(test_bug1);
+        NUT_REGISTER_CASE(test_word_op);
+        NUT_REGISTER_CASE(test_64bit_word);
     }
 
     void test_bit_count()
@@ -102,6 +106,51 @@ class TestWordArrayInteger : public TestFixture
         uint8_t a = 0x80; // 1000 0000
         NUT_TA(lowest_bit1(a) == 7);
     }
+
+    void test_word_op()
+    {
+        uint8_t carry = 1;
+        NUT_TA(add_with_carry<uint64_t>(~(uint64_t) 0, 0, &carry) == 0 && 1 == carry);
+        NUT_TA(add_with_carry<uint64_t>(~(uint64_t) 0, ~(uint64_t) 0, &carry) == ~(uint64_t) 0 && 1 == carry);
+        carry = 0;
+        NUT_TA(add_with_carry<uint64_t>(1, 2, &carry) == 3 && 0 == carry);
+        NUT_TA(add_with_carry<uint32_t>(0xffffffff, 1, &carry) == 0 && 1 == carry);
+
+        // (2^64 - 1)^2 + 2 * (2^64 - 1) = 2^128 - 1, 恰好不溢出
+        const uint64_t m = ~(uint64_t) 0;
+        uint64_t hi = 0;
+        NUT_TA(multiply_add<uint64_t>(m, m, m, m, &hi) == m && hi == m);
+        NUT_TA(multiply_add<uint64_t>(0x100000000ULL, 0x100000000ULL, 5, 0, &hi) == 5 && hi == 1);
+        uint32_t hi32 = 0;
+        NUT_TA(multiply_add<uint32_t>(0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, &hi32) == 0xffffffff &&
+               hi32 == 0xffffffff);
+    }
+
+    void test_64bit_word()
+    {
+        // (2^128 - 1) * (2^64 + 1) = 2^192 + 2^128 - 2^64 - 1
+        const uint64_t a[2] = {~(uint64_t) 0, ~(uint64_t) 0}, b[2] = {1, 1};
+        uint64_t x[4];
+        unsigned_multiply(a, 2, b, 2, x, 4);
+        NUT_TA(x[0] == ~(uint64_t) 0 && x[1] == ~(uint64_t) 1 && x[2] == 0 && x[3] == 1);
+
+        // 平方
+        _unsigned_square(a, 2, x, 4);
+        NUT_TA(x[0] == 1 && x[1] == 0 && x[2] == ~(uint64_t) 1 && x[3] == ~(uint64_t) 0);
+
+        // 除法
+        uint64_t q[4], r[2];
+        const uint64_t p[4] = {~(uint64_t) 0, ~(uint64_t) 1, 0, 1};
+        unsigned_divide(p, 4, b, 2, q, 4, r, 2);
+        NUT_TA(q[0] == ~(uint64_t) 0 && q[1] == ~(uint64_t) 0 && q[2] == 0 && q[3] == 0);
+        NUT_TA(r[0] == 0 && r[1] == 0);
+
+        // 有符号: -1 - 1 = -2
+        const uint64_t neg1[1] = {~(uint64_t) 0}, one[1] = {1};
+        uint64_t y[2];
+        signed_sub(neg1, 1, one, 1, y, 2);
+        NUT_TA(y[0] == ~(uint64_t) 1 && y[1] == ~(uint64_t) 0);
+    }
 };
 
 NUT_REGISTER_FIXTURE(TestWordArrayInteger, "numeric,quiet")
@@ -0,0 +1,141 @@
+﻿
+#include <string.h>
+
+#include <nut/unittest/unittest.h>
+#include <nut/platform/fd_io.h>
+#include <nut/platform/os.h>
+
+#if !NUT_PLATFORM_OS_WINDOWS
+#   include <errno.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/socket.h>
+#endif
+
+using namespace std;
+using namespace nut;
+
+class TestFdIO : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+#if !NUT_PLATFORM_OS_WINDOWS
+        NUT_REGISTER_CASE(test_file_to_pipe);
+        NUT_REGISTER_CASE(test_pipe_to_file);
+        NUT_REGISTER_CASE(test_socket_to_full_socket);
+        NUT_REGISTER_CASE(test_socket_relay);
+#endif
+    }
+
+#if !NUT_PLATFORM_OS_WINDOWS
+    void test_file_to_pipe()
+    {
+        const char *filename = "test-fd-io.data";
+        int fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0664);
+        NUT_TA(fd >= 0);
+        NUT_TA(::write(fd, "abcdefgh", 8) == 8);
+        ::close(fd);
+
+        fd = ::open(filename, O_RDONLY);
+        NUT_TA(fd >= 0);
+        int fds[2];
+        NUT_TA(0 == ::pipe(fds));
+        NUT_TA(transfer_fd(fds[1], fd, 5) == 5);
+        NUT_TA(transfer_fd(fds[1], fd, 100) == 3);
+        NUT_TA(transfer_fd(fds[1], fd, 100) == 0); // EOF
+
+        char buf[8];
+        NUT_TA(::read(fds[0], buf, 8) == 8);
+        NUT_TA(0 == ::memcmp(buf, "abcdefgh", 8));
+
+        ::close(fds[0]);
+        ::close(fds[1]);
+        ::close(fd);
+        OS::removefile(filename);
+    }
+
+    void test_pipe_to_file()
+    {
+        int fds[2];
+        NUT_TA(0 == ::pipe(fds));
+        NUT_TA(::write(fds[1], "12345", 5) == 5);
+
+        const char *filename = "test-fd-io.data";
+        int fd = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0664);
+        NUT_TA(fd >= 0);
+        NUT_TA(transfer_fd(fd, fds[0], 5) == 5);
+
+        char buf[5];
+        NUT_TA(::pread(fd, buf, 5, 0) == 5);
+        NUT_TA(0 == ::memcmp(buf, "12345", 5));
+
+        ::close(fds[0]);
+        ::close(fds[1]);
+        ::close(fd);
+        OS::removefile(filename);
+    }
+
+    void test_socket_to_full_socket()
+    {
+        int in[2], out[2];
+        NUT_TA(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, in));
+        NUT_TA(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, out));
+        NUT_TA(::write(in[1], "abcdefgh", 8) == 8);
+
+        // 填满非阻塞的 out_fd
+        NUT_TA(0 == ::fcntl(out[0], F_SETFL, ::fcntl(out[0], F_GETFL) | O_NONBLOCK));
+        char buf[4096];
+        ::memset(buf, 'x', sizeof(buf));
+        size_t filled = 0;
+        ssize_t rs;
+        while ((rs = ::write(out[0], buf, sizeof(buf))) > 0)
+            filled += rs;
+
+        // out_fd 不可写, 不能从 in_fd 读走数据
+        NUT_TA(transfer_fd(out[0], in[0], 8) < 0 && EAGAIN == errno);
+
+        // 腾出空间后全部送达
+        NUT_TA(0 == ::fcntl(out[1], F_SETFL, ::fcntl(out[1], F_GETFL) | O_NONBLOCK));
+        while (filled > 0 && (rs = ::read(out[1], buf, sizeof(buf))) > 0)
+            filled -= rs;
+        NUT_TA(transfer_fd(out[0], in[0], 8) == 8);
+        NUT_TA(::read(out[1], buf, sizeof(buf)) == 8);
+        NUT_TA(0 == ::memcmp(buf, "abcdefgh", 8));
+
+        ::close(in[0]);
+        ::close(in[1]);
+        ::close(out[0]);
+        ::close(out[1]);
+    }
+
+    void test_socket_relay()
+    {
+        // 多次经过同一个中转管道
+        int in[2], out[2];
+        NUT_TA(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, in));
+        NUT_TA(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, out));
+        char src[3000], dst[3000];
+        for (int round = 0; round < 100; ++round)
+        {
+            ::memset(src, 'a' + round % 26, sizeof(src));
+            NUT_TA(::write(in[1], src, sizeof(src)) == (ssize_t) sizeof(src));
+            size_t got = 0;
+            while (got < sizeof(src))
+            {
+                const ssize_t rs = transfer_fd(out[0], in[0], sizeof(src) - got);
+                NUT_TA(rs > 0);
+                NUT_TA(::read(out[1], dst + got, rs) == rs);
+                got += rs;
+            }
+            NUT_TA(0 == ::memcmp(src, dst, sizeof(src)));
+        }
+
+        ::close(in[0]);
+        ::close(in[1]);
+        ::close(out[0]);
+        ::close(out[1]);
+    }
+#endif
+};
+
+NUT_REGISTER_FIXTURE(TestFdIO, "platform, quiet")
@@ -64,6 +64,9 @@ class TestPem : public TestFixture
         NUT_TA("0" + key.d.to_string(16) == "04A19F22AC9B7589");
         NUT_TA(key.p.to_string(16) == "DC61AD13");
         NUT_TA(key.q.to_string(16) == "DA961C35");
+        NUT_TA(key.dp == key.d % (key.p - 1) && key.dq == key.d % (key.q - 1));
+        NUT_TA((key.qinv * key.q) % key.p == 1);
+        NUT_TA(!key.crt_context.is_null());
     }
 
     void test_read_pkcs8_public()
@@ -1,11 +1,14 @@
 ﻿
 #include <stdio.h>
 #include <iostream>
+#include <vector>
 
 
 #include <nut/unittest/unittest.h>
 #include <nut/time/performance_counter.h>
 #include <nut/security/encrypt/rsa.h>
+#include <nut/numeric/numeric_algo/mod.h>
+#include <nut/threading/thread_pool.h>
 
 #include <time.h>
 
@@ -18,6 +21,9 @@ class TestRSA : public TestFixture
     {
         NUT_REGISTER_CASE(test_profile);
         NUT_REGISTER_CASE(test_bugs);
+        NUT_REGISTER_CASE(test_crt);
+        NUT_REGISTER_CASE(test_batch);
+        NUT_REGISTER_CASE(test_gen_key_in_pool);
     }
 
     void test_profile()
@@ -64,6 +70,107 @@ class TestRSA : public TestFixture
         b = RSA::public_transfer(a, key);
         NUT_TA(b == 0x457a);
     }
+
+    void test_crt()
+    {
+        RSA::PrivateKey key = RSA::gen_key(1024);
+        NUT_TA(!key.crt_context.is_null());
+        NUT_TA(key.dp == key.d % (key.p - 1) && key.dq == key.d % (key.q - 1));
+        NUT_TA((key.qinv * key.q) % key.p == 1);
+
+        // 未预计算的密钥, 以及只有 n、d 的密钥
+        RSA::PrivateKey raw;
+        raw.n = key.n;
+        raw.e = key.e;
+        raw.d = key.d;
+        raw.p = key.p;
+        raw.q = key.q;
+        RSA::PrivateKey nd;
+        nd.n = key.n;
+        nd.e = key.e;
+        nd.d = key.d;
+
+        for (int i = 0; i < 10; ++i)
+        {
+            const BigInteger c = BigInteger::rand_positive(1100) % key.n;
+            const BigInteger m = pow_mod(c, key.d, key.n);
+            NUT_TA(RSA::private_transfer(c, key) == m);
+            NUT_TA(RSA::private_transfer(c, raw) == m);
+            NUT_TA(RSA::private_transfer(c, nd) == m);
+        }
+
+        // 性能对比
+        const BigInteger c = BigInteger::rand_positive(1000);
+        const int iteration = 20;
+        const PerformanceCounter s = PerformanceCounter::now();
+        for (int i = 0; i < iteration; ++i)
+            RSA::private_transfer(c, key);
+        const PerformanceCounter t1 = PerformanceCounter::now();
+        for (int i = 0; i < iteration; ++i)
+            RSA::private_transfer(c, nd);
+        const double t2 = PerformanceCounter::now() - t1;
+        printf(" crt %.3fms < %.3fms ", (t1 - s) * 1000 / iteration, t2 * 1000 / iteration);
+    }
+
+    void test_batch()
+    {
+        RSA::PrivateKey key = RSA::gen_key(1024);
+        const size_t count = 64;
+        vector<BigInteger> ms, cs(count), rs(count), expected(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            ms.push_back(BigInteger::rand_positive(1000));
+            expected[i] = RSA::private_transfer(ms[i], key);
+        }
+
+        rc_ptr<ThreadPool> pool = rc_new<ThreadPool>(4);
+
+        // 单线程
+        const PerformanceCounter s = PerformanceCounter::now();
+        RSA::batch_private_transfer(ms.data(), count, key, rs.data());
+        const PerformanceCounter t1 = PerformanceCounter::now();
+        NUT_TA(rs == expected);
+
+        // 多线程
+        RSA::batch_private_transfer(ms.data(), count, key, rs.data(), pool);
+        const PerformanceCounter t2 = PerformanceCounter::now();
+        NUT_TA(rs == expected);
+
+        RSA::batch_public_transfer(rs.data(), count, key, cs.data(), pool);
+        NUT_TA(cs == ms);
+
+        // 输出与输入相同, 以及未预计算的密钥
+        RSA::PrivateKey raw;
+        raw.n = key.n;
+        raw.e = key.e;
+        raw.d = key.d;
+        raw.p = key.p;
+        raw.q = key.q;
+        RSA::batch_private_transfer(cs.data(), count, raw, cs.data(), pool);
+        NUT_TA(cs == expected);
+        raw.p = 0;
+        raw.q = 0;
+        RSA::batch_private_transfer(ms.data(), count, raw, rs.data(), pool);
+        NUT_TA(rs == expected);
+
+        pool->interrupt();
+        pool->join();
+        printf(" 1 thread %.3fms, pool %.3fms ", (t1 - s) * 1000, (t2 - t1) * 1000);
+    }
+
+    void test_gen_key_in_pool()
+    {
+        // 在线程池的任务中使用同一个线程池, 线程池已无空闲线程
+        rc_ptr<ThreadPool> pool = rc_new<ThreadPool>(1);
+        bool ok = false;
+        pool->add_task([&] {
+            RSA::PrivateKey key = RSA::gen_key(512, pool);
+            const BigInteger m = BigInteger::rand_positive(500);
+            ok = (RSA::private_transfer(RSA::public_transfer(m, key), key) == m);
+        });
+        pool->wait_until_all_idle();
+        NUT_TA(ok);
+    }
 };
 
 NUT_REGISTER_FIXTURE(TestRSA, "security, encrypt, quiet")
@@ -0,0 +1,96 @@
+
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <nut/unittest/unittest.h>
+#include <nut/threading/lockfree/concurrent_skiplist_map.h>
+
+using namespace std;
+using namespace nut;
+
+class TestConcurrentSkipListMap : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_smoking);
+        NUT_REGISTER_CASE(test_range);
+        NUT_REGISTER_CASE(test_multi_thread);
+    }
+
+    void test_smoking()
+    {
+        ConcurrentSkipListMap<int,int> m;
+        NUT_TA(m.insert(1, 2));
+        NUT_TA(m.size() == 1);
+        NUT_TA(m.contains_key(1));
+        NUT_TA(!m.insert(1, 3));
+        m.insert(2, 4);
+
+        int v = 0;
+        NUT_TA(m.get(1, &v));
+        NUT_TA(v == 2);
+
+        v = 0;
+        NUT_TA(m.remove(1, &v));
+        NUT_TA(m.size() == 1 && v == 2);
+        NUT_TA(!m.remove(1));
+        m.clear();
+        NUT_TA(m.size() == 0 && !m.contains_key(2));
+    }
+
+    void test_range()
+    {
+        ConcurrentSkipListMap<int,int> m;
+        for (int i = 0; i < 100; ++i)
+            m.insert(i * 37 % 100, i);
+
+        int expect = 10;
+        const size_t count = m.range(10, 20, [&] (const int& k, const int&) {
+                if (k != expect)
+                    return false;
+                ++expect;
+                return true;
+            });
+        NUT_TA(10 == count && 20 == expect);
+
+        NUT_TA(3 == m.range(0, 100, [] (const int& k, const int&) { return k < 2; }));
+    }
+
+    void test_multi_thread()
+    {
+        ConcurrentSkipListMap<int,int> m;
+        const int thread_count = 4, range = 2000;
+        vector<thread> threads;
+        for (int t = 0; t < thread_count; ++t)
+        {
+            threads.emplace_back([=,&m] {
+                    std::mt19937 gen(t);
+                    std::uniform_int_distribution<> dis(0, range - 1);
+                    for (int i = 0; i < 100000; ++i)
+                    {
+                        const int r = dis(gen);
+                        if (0 == (i & 1))
+                            m.insert(r, r + 1);
+                        else
+                            m.remove(r);
+                    }
+                });
+        }
+        for (size_t i = 0, sz = threads.size(); i < sz; ++i)
+            threads.at(i).join();
+
+        // Keys must be ordered and consistent with size
+        int last = -1;
+        const size_t count = m.range(0, range, [&] (const int& k, const int& v) {
+                if (k <= last || v != k + 1)
+                    return false;
+                last = k;
+                return true;
+            });
+        NUT_TA(count == m.size());
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestConcurrentSkipListMap, "threading, lockfree, quiet")
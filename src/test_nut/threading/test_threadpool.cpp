@@ -6,6 +6,8 @@
 #endif
 
 #include <stdio.h>
+#include <atomic>
+#include <vector>
 
 #include <nut/unittest/unittest.h>
 
@@ -20,6 +22,8 @@ class TestThreadPool : public TestFixture
         NUT_REGISTER_CASE(test_smoke);
         NUT_REGISTER_CASE(test_auto_release);
         NUT_REGISTER_CASE(test_bug1);
+        NUT_REGISTER_CASE(test_parallel_for);
+        NUT_REGISTER_CASE(test_parallel_for_busy_pool);
     }
 
     void test_smoke()
@@ -95,6 +99,51 @@ class TestThreadPool : public TestFixture
         tp->join();
         NUT_TA(!has_bug);
     }
+
+    void test_parallel_for()
+    {
+        rc_ptr<ThreadPool> tp = rc_new<ThreadPool>(3);
+        std::vector<int> hits(1000, 0);
+        parallel_for(hits.size(), tp, [&] (size_t i) { ++hits[i]; });
+        NUT_TA(std::vector<int>(1000, 1) == hits);
+
+        // 在池内任务中调用, 线程池已无空闲线程
+        std::atomic<bool> done(false);
+        rc_ptr<ThreadPool> single = rc_new<ThreadPool>(1);
+        single->add_task([&] {
+            std::vector<int> inner(100, 0);
+            parallel_for(inner.size(), single, [&] (size_t i) { ++inner[i]; });
+            done = (std::vector<int>(100, 1) == inner);
+        });
+        single->wait_until_all_idle();
+        NUT_TA(done);
+
+        // 已中断的线程池
+        tp->interrupt();
+        tp->join();
+        std::fill(hits.begin(), hits.end(), 0);
+        parallel_for(hits.size(), tp, [&] (size_t i) { ++hits[i]; });
+        NUT_TA(std::vector<int>(1000, 1) == hits);
+    }
+
+    void test_parallel_for_busy_pool()
+    {
+        // 线程池被无关的长任务占满时, 当前线程独自完成, 不等待排队中的任务
+        rc_ptr<ThreadPool> tp = rc_new<ThreadPool>(1);
+        std::atomic<bool> release(false);
+        tp->add_task([&] {
+            while (!release)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+
+        std::vector<int> hits(100, 0);
+        parallel_for(hits.size(), tp, [&] (size_t i) { ++hits[i]; });
+        NUT_TA(std::vector<int>(100, 1) == hits);
+
+        // 迟到的辅助任务领取不到输入, 不会再访问已失效的 func
+        release = true;
+        tp->wait_until_all_idle();
+    }
 };
 
 NUT_REGISTER_FIXTURE(TestThreadPool, "threading")